@@ -0,0 +1,472 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "dayill.h"
+#include "functions.h"
+#include "filepath.h"
+#include "buildingcontrol.h"
+#include "illkernels.h"
+#include "logging.h"
+#include "metrics.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void usage(){
+    std::cerr << "Usage: stadic_bench [OPTIONS]" << std::endl;
+    std::cerr << stadic::wrapAtN("Time the hot paths of the metrics on synthetic inputs: the writers and parsers of"
+        " illuminance files, the summing of intermediate illuminance files, and each metric run through"
+        " Metrics::processMetrics on its own. The inputs are generated in a scratch directory, so neither"
+        " Radiance nor a model is needed. The results are written as JSON.") << std::endl;
+    std::cerr<<std::endl;
+    std::cerr << stadic::wrapAtN("-points N     Number of points in the synthetic data, 1000 by default.", 72, 14, true) << std::endl;
+    std::cerr << stadic::wrapAtN("-timesteps N  Number of timesteps in the synthetic data, 8760 by default.", 72, 14, true) << std::endl;
+    std::cerr << stadic::wrapAtN("-groups N     Number of window groups, each with a base case and one shade"
+        " setting, 2 by default.", 72, 14, true) << std::endl;
+    std::cerr << stadic::wrapAtN("-repeat N     Number of times to repeat each measurement, 3 by default.", 72, 14, true) << std::endl;
+    std::cerr << stadic::wrapAtN("-directory D  Scratch directory for the synthetic inputs, stadic_bench/ by"
+        " default. It is removed afterwards.", 72, 14, true) << std::endl;
+    std::cerr << stadic::wrapAtN("-output F     Write the JSON results to F rather than to the standard output.", 72, 14, true) << std::endl;
+}
+
+//Size of the synthetic space
+struct Fixture
+{
+    std::string directory;
+    unsigned points;
+    unsigned timesteps;
+    unsigned groups;
+};
+
+//Outcome of one measurement
+struct Result
+{
+    std::string name;
+    double seconds;
+    double values;                                                              //Illuminance values handled by one run
+};
+
+//An hourly calendar from January 1, repeated past the end of the year
+static void syntheticTimeAxis(unsigned timesteps, std::vector<int> *month, std::vector<int> *day, std::vector<double> *hour)
+{
+    int daysInMonth[]={31,28,31,30,31,30,31,31,30,31,30,31};
+    for (unsigned i=0;i<timesteps;i++){
+        int dayOfYear=(i/24)%365;
+        int m=0;
+        while (dayOfYear>=daysInMonth[m]){
+            dayOfYear-=daysInMonth[m];
+            m++;
+        }
+        month->push_back(m+1);
+        day->push_back(dayOfYear+1);
+        hour->push_back(i%24+0.5);
+    }
+}
+
+//Illuminance that is zero at night and varies smoothly by day and point
+static void syntheticData(stadic::DaylightIlluminanceData &data, unsigned points, unsigned timesteps, unsigned seed=0, double scale=1)
+{
+    std::vector<int> month;
+    std::vector<int> day;
+    std::vector<double> hour;
+    syntheticTimeAxis(timesteps,&month,&day,&hour);
+    data.setTimeAxis(month,day,hour);
+    data.resize(points);
+    for (unsigned j=0;j<points;j++){
+        double *values=data.pointData(j);
+        for (unsigned i=0;i<timesteps;i++){
+            double sun=hour[i]>6 && hour[i]<18 ? (hour[i]-6)*(18-hour[i]) : 0;
+            values[i]=scale*sun*(17.3+(j+seed)%97)*(1+0.37*((i*7919+(j+seed)*104729)%1000)/1000.0);
+        }
+    }
+}
+
+//The loop writeIllFileLux ran before the BufferedWriter
+static bool writeWithStream(const stadic::DaylightIlluminanceData &data, const std::string &fileName)
+{
+    std::ofstream oFile;
+    oFile.open(fileName);
+    if (!oFile.is_open()){
+        return false;
+    }
+    for (unsigned i=0;i<data.timesteps();i++){
+        oFile<<data.month(i)<<" "<<data.day(i)<<" "<<data.hour(i);
+        for (unsigned j=0;j<data.points();j++){
+            oFile<<" "<<data.lux(j,i);
+        }
+        oFile<<std::endl;
+    }
+    oFile.close();
+    return true;
+}
+
+//The intermediate files that sumIlluminanceFiles merges: a point-major file and a layer with a row per timestep
+static bool writeIntermediate(const stadic::DaylightIlluminanceData &data, const std::string &pointMajor, const std::string &layer)
+{
+    stadic::BufferedWriter points;
+    stadic::BufferedWriter rows;
+    if (!points.open(pointMajor) || !rows.open(layer)){
+        return false;
+    }
+    for (unsigned j=0;j<data.points();j++){
+        for (unsigned i=0;i<data.timesteps();i++){
+            points<<data.lux(j,i)<<'\n';
+        }
+    }
+    for (unsigned i=0;i<data.timesteps();i++){
+        for (unsigned j=0;j<data.points();j++){
+            rows<<(j>0 ? " " : "")<<data.lux(j,i)/2;
+        }
+        rows<<'\n';
+    }
+    return points.close() && rows.close();
+}
+
+//Occupancy from 8 to 18 on every day, and a schedule that shades the odd window groups around noon
+static bool writeSchedules(const Fixture &fixture, const stadic::DaylightIlluminanceData &axis)
+{
+    std::ofstream occupancy(fixture.directory+"data/bench_occ.csv");
+    std::ofstream shades(fixture.directory+"res/bench_shades.sch");
+    if (!occupancy.is_open() || !shades.is_open()){
+        return false;
+    }
+    for (unsigned i=0;i<axis.timesteps();i++){
+        occupancy<<axis.month(i)<<","<<axis.day(i)<<","<<axis.hour(i)<<","<<(axis.hour(i)>8 && axis.hour(i)<18 ? 1 : 0)<<"\n";
+        shades<<axis.month(i)<<","<<axis.day(i)<<","<<axis.hour(i);
+        for (unsigned g=0;g<fixture.groups;g++){
+            shades<<","<<(g%2==1 && axis.hour(i)>11 && axis.hour(i)<15 ? 1 : 0);
+        }
+        shades<<"\n";
+    }
+    std::ofstream geometry(fixture.directory+"rad/bench_geo.rad");
+    geometry<<"l_floor polygon floor\n0\n0\n12 0 0 0 20 0 0 20 30 0 0 30 0\n";
+    return !occupancy.fail() && !shades.fail() && !geometry.fail();
+}
+
+//A control file for the synthetic space that calculates only the metrics in metrics
+static bool writeControl(const Fixture &fixture, const std::string &fileName, const std::string &metrics)
+{
+    std::ostringstream groups;
+    for (unsigned g=0;g<fixture.groups;g++){
+        groups<<(g>0 ? "," : "")<<"{\"name\" : \"WG"<<g<<"\", \"base_geometry\" : \"wg"<<g<<"base.rad\","
+              <<"\"calculate_base\" : true, \"glazing_materials\" : [\"l_glazing\"],"
+              <<"\"shade_settings\" : [\"wg"<<g<<"set1.rad\"], \"calculate_setting\" : [true]}";
+    }
+    std::ofstream json(fileName);
+    json<<"{\"spaces\" : [{\"space_name\" : \"bench\", \"space_directory\" : \""<<fixture.directory<<"\","
+        <<"\"geometry_directory\" : \"rad/\", \"results_directory\" : \"res/\", \"input_directory\" : \"data/\","
+        <<"\"ground_reflectance\" : 0.2, \"lighting_schedule\" : \"bench_occ.csv\", \"occupancy_schedule\" : \"bench_occ.csv\","
+        <<"\"material_file\" : \"bench_mat.rad\", \"geometry_file\" : \"bench_geo.rad\","
+        <<"\"analysis_points\" : {\"files\" : [\"bench.pts\"], \"modifier\" : [\"l_floor\"]},"
+        <<"\"window_groups\" : ["<<groups.str()<<"],"
+        <<"\"DF\" : false"
+        <<metrics<<"}],"
+        <<"\"general\" : {\"import_units\" : \"ft\", \"illum_units\" : \"lux\", \"display_units\" : \"ft\","
+        <<"\"epw_file\" : \"bench.epw\", \"first_day\" : 1, \"building_rotation\" : 0,"
+        <<"\"target_illuminance\" : 500, \"sky_divisions\" : 4, \"sun_divisions\" : 4,"
+        <<"\"radiance_parameters\" : {\"default\" : {\"ab\" : 5}}, \"daylight_savings_time\" : false}}"<<std::endl;
+    json.close();
+    return !json.fail();
+}
+
+template <typename F> static double bestTime(unsigned repeat, F function)
+{
+    double best=0;
+    for (unsigned i=0;i<repeat;i++){
+        std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+        if (!function()){
+            return -1;
+        }
+        double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        if (i==0 || seconds<best){
+            best=seconds;
+        }
+    }
+    return best;
+}
+
+//Time processMetrics over the synthetic space with a control file that asks for a set of metrics
+static double timeMetrics(const Fixture &fixture, unsigned repeat, const std::string &metrics, const std::string &output, size_t memoryBudget=0)
+{
+    std::string controlFile=fixture.directory+"bench_control.json";
+    if (!writeControl(fixture,controlFile,metrics)){
+        return -1;
+    }
+    double best=0;
+    for (unsigned i=0;i<repeat;i++){
+        std::remove(output.c_str());
+        //Only the calculation is timed, and its messages are held back unless it fails
+        stadic::LogCapture quiet;
+        stadic::BuildingControl model;
+        if (!model.parseJson(controlFile)){
+            std::cerr<<quiet.text();
+            return -1;
+        }
+        stadic::Metrics metrics(&model);
+        metrics.setMemoryBudget(memoryBudget);
+        std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+        bool success=metrics.processMetrics() && stadic::isFile(output);
+        double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        if (!success){
+            std::cerr<<quiet.text();
+            return -1;
+        }
+        if (i==0 || seconds<best){
+            best=seconds;
+        }
+    }
+    std::remove(controlFile.c_str());
+    return best;
+}
+
+static std::string jsonString(const std::string &text)
+{
+    std::string quoted="\"";
+    for (char c : text){
+        if (c=='"' || c=='\\'){
+            quoted+='\\';
+        }
+        quoted+=c;
+    }
+    return quoted+"\"";
+}
+
+static const char *instructionSetName()
+{
+    switch (stadic::kernels::instructionSet()){
+    case stadic::kernels::InstructionSet::AVX2:
+        return "AVX2";
+    case stadic::kernels::InstructionSet::SSE2:
+        return "SSE2";
+    default:
+        return "Portable";
+    }
+}
+
+int main (int argc, char *argv[])
+{
+    Fixture fixture;
+    fixture.directory="stadic_bench/";
+    fixture.points=1000;
+    fixture.timesteps=8760;
+    fixture.groups=2;
+    unsigned repeat=3;
+    std::string outputFile;
+    for (int i=1;i<argc;i++){
+        std::string argument=argv[i];
+        if (i+1<argc && argument=="-points"){
+            fixture.points=std::atoi(argv[++i]);
+        }else if (i+1<argc && argument=="-timesteps"){
+            fixture.timesteps=std::atoi(argv[++i]);
+        }else if (i+1<argc && argument=="-groups"){
+            fixture.groups=std::atoi(argv[++i]);
+        }else if (i+1<argc && argument=="-repeat"){
+            repeat=std::atoi(argv[++i]);
+        }else if (i+1<argc && argument=="-directory"){
+            fixture.directory=argv[++i];
+            if (fixture.directory.back()!='/'){
+                fixture.directory+="/";
+            }
+        }else if (i+1<argc && argument=="-output"){
+            outputFile=argv[++i];
+        }else{
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (fixture.points==0 || fixture.timesteps==0 || fixture.groups==0 || repeat==0){
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    //Generate the synthetic space
+    std::string res=fixture.directory+"res/";
+    std::string prefix=res+"bench";
+    if (!stadic::PathName(res).create() || !stadic::PathName(fixture.directory+"data/").create() || !stadic::PathName(fixture.directory+"rad/").create()){
+        std::cerr<<"The scratch directory "<<fixture.directory<<" could not be created."<<std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<std::string> files;
+    stadic::DaylightIlluminanceData data;
+    syntheticData(data,fixture.points,fixture.timesteps);
+    bool generated=writeSchedules(fixture,data);
+    files.push_back(fixture.directory+"data/bench_occ.csv");
+    files.push_back(prefix+"_shades.sch");
+    files.push_back(fixture.directory+"rad/bench_geo.rad");
+    files.push_back(prefix+".ill");
+    generated=generated && data.writeIllFileLux(prefix+".ill");
+    for (unsigned g=0;g<fixture.groups;g++){
+        std::string group=prefix+"_WG"+std::to_string(g);
+        stadic::DaylightIlluminanceData groupIll;
+        syntheticData(groupIll,fixture.points,fixture.timesteps,g+1,1.0/fixture.groups);
+        generated=generated && groupIll.writeIllFileLux(group+"_base.ill");
+        syntheticData(groupIll,fixture.points,fixture.timesteps,g+1,0.2/fixture.groups);
+        generated=generated && groupIll.writeIllFileLux(group+"_set1.ill");
+        syntheticData(groupIll,fixture.points,fixture.timesteps,g+7,2.0/fixture.groups);
+        generated=generated && groupIll.writeIllFileLux(group+"_base_direct.ill");
+        files.push_back(group+"_base.ill");
+        files.push_back(group+"_set1.ill");
+        files.push_back(group+"_base_direct.ill");
+    }
+    std::string pointMajor=fixture.directory+"bench_ill.tmp";
+    std::string layer=fixture.directory+"bench_bsdf0.ill";
+    generated=generated && writeIntermediate(data,pointMajor,layer);
+    files.push_back(pointMajor);
+    files.push_back(layer);
+    if (!generated){
+        std::cerr<<"The synthetic inputs could not be written to "<<fixture.directory<<"."<<std::endl;
+        return EXIT_FAILURE;
+    }
+
+    //Writers, of which the two text writers have to agree
+    std::vector<Result> results;
+    double values=double(fixture.points)*fixture.timesteps;
+    std::string streamFile=fixture.directory+"bench_stream.ill";
+    std::string bufferedFile=fixture.directory+"bench_buffered.ill";
+    std::string binaryFile=fixture.directory+"bench.bill";
+    files.push_back(streamFile);
+    files.push_back(bufferedFile);
+    files.push_back(binaryFile);
+    results.push_back({"write_ofstream",bestTime(repeat,[&](){ return writeWithStream(data,streamFile); }),values});
+    results.push_back({"write_buffered",bestTime(repeat,[&](){ return data.writeIllFileLux(bufferedFile); }),values});
+    results.push_back({"write_binary",bestTime(repeat,[&](){ return data.writeIllFileBinary(binaryFile); }),values});
+    std::ifstream streamText(streamFile);
+    std::ifstream bufferedText(bufferedFile);
+    bool identical=std::string(std::istreambuf_iterator<char>(streamText),std::istreambuf_iterator<char>())
+        ==std::string(std::istreambuf_iterator<char>(bufferedText),std::istreambuf_iterator<char>());
+    streamText.close();
+    bufferedText.close();
+
+    //Parsers
+    results.push_back({"parse_text",bestTime(repeat,[&](){
+        stadic::DaylightIlluminanceData parsed;
+        parsed.setThreads(1);
+        return parsed.parseTimeBased(prefix+".ill");
+    }),values});
+    results.push_back({"parse_text_threaded",bestTime(repeat,[&](){
+        stadic::DaylightIlluminanceData parsed;
+        parsed.setThreads(0);
+        return parsed.parseTimeBased(prefix+".ill");
+    }),values});
+    results.push_back({"parse_binary",bestTime(repeat,[&](){
+        stadic::DaylightIlluminanceData parsed;
+        return parsed.parseTimeBased(binaryFile);
+    }),values});
+
+    //The merge behind Daylight::sumIlluminanceFiles, for one window group setting
+    std::string mergedFile=fixture.directory+"bench_merged.ill";
+    files.push_back(mergedFile);
+    results.push_back({"sum_illuminance",bestTime(repeat,[&](){
+        std::vector<int> month;
+        std::vector<int> day;
+        std::vector<double> hour;
+        syntheticTimeAxis(fixture.timesteps,&month,&day,&hour);
+        stadic::IlluminanceMerger merger;
+        merger.setTimeAxis(month,day,hour);
+        merger.setPointMajorInput(pointMajor);
+        merger.addLayer(layer);
+        return merger.write(mergedFile);
+    }),2*values});
+
+    //Each metric on its own; the times include parsing the illuminance the metric reads
+    double inputs=double(fixture.groups)*values;
+    results.push_back({"metrics_DA",timeMetrics(fixture,repeat,",\"DA\" : {\"calculate\" : true, \"illuminance\" : 300}",prefix+"_DA.res"),values});
+    results.push_back({"metrics_cDA",timeMetrics(fixture,repeat,",\"cDA\" : {\"calculate\" : true, \"illuminance\" : 300}",prefix+"_cDA.res"),values});
+    results.push_back({"metrics_UDI",timeMetrics(fixture,repeat,",\"UDI\" : {\"calculate\" : true, \"minimum\" : 100, \"maximum\" : 2000}",prefix+"_UDI.res"),values});
+    results.push_back({"metrics_sweep",timeMetrics(fixture,repeat,",\"metric_sweep\" : {\"calculate\" : true, \"DA\" : [100, 300, 500, 1000],"
+        " \"cDA\" : [300], \"UDI\" : [[100, 2000], [300, 3000]]}",prefix+"_sweep.res"),values});
+    std::string allMetrics=",\"DA\" : {\"calculate\" : true, \"illuminance\" : 300}, \"cDA\" : {\"calculate\" : true, \"illuminance\" : 300},"
+        " \"UDI\" : {\"calculate\" : true, \"minimum\" : 100, \"maximum\" : 2000}";
+    results.push_back({"metrics_DA_cDA_UDI",timeMetrics(fixture,repeat,allMetrics,prefix+"_UDI.res"),values});
+    results.push_back({"metrics_DA_cDA_UDI_blocked",timeMetrics(fixture,repeat,allMetrics,prefix+"_UDI.res",
+        size_t(fixture.points/4+1)*fixture.timesteps*sizeof(double)),values});
+    std::string settings;
+    for (unsigned g=0;g<fixture.groups;g++){
+        settings+=g>0 ? ", 1" : "1";
+    }
+    results.push_back({"metrics_sDA",timeMetrics(fixture,repeat,",\"sDA\" : {\"calculate\" : true, \"illuminance\" : 300, \"DA_fraction\" : 0.5,"
+        " \"start_time\" : 8, \"end_time\" : 17, \"window_group_settings\" : ["+settings+"]}",prefix+"_sDA_Points.res"),3*inputs});
+    results.push_back({"metrics_occupied_sDA",timeMetrics(fixture,repeat,",\"occupied_sDA\" : {\"calculate\" : true, \"illuminance\" : 300, \"DA_fraction\" : 0.5}",
+        prefix+"_occupancy_sDA_Points.res"),2*inputs});
+
+    //Remove the scratch directory
+    const char *outputs[]={"_DA.res","_cDA.res","_below_UDI.res","_UDI.res","_above_UDI.res","_sweep.res","_ASE.res",
+        "_sDA_ShadeSchedule.res","_sDA_Points.res","_sDA.ill","_occupancy_sDA_Points.res","_occupancy_sDA.ill"};
+    for (const char *output : outputs){
+        files.push_back(prefix+output);
+    }
+    for (const std::string &file : files){
+        std::remove(file.c_str());
+    }
+    stadic::PathName(res).remove();
+    stadic::PathName(fixture.directory+"data/").remove();
+    stadic::PathName(fixture.directory+"rad/").remove();
+
+    bool failed=!identical;
+    std::ostringstream json;
+    json.precision(6);
+    json<<"{\n";
+    json<<"  \"points\": "<<fixture.points<<",\n";
+    json<<"  \"timesteps\": "<<fixture.timesteps<<",\n";
+    json<<"  \"window_groups\": "<<fixture.groups<<",\n";
+    json<<"  \"repeat\": "<<repeat<<",\n";
+    json<<"  \"instruction_set\": "<<jsonString(instructionSetName())<<",\n";
+    json<<"  \"identical_writers\": "<<(identical ? "true" : "false")<<",\n";
+    json<<"  \"results\": [\n";
+    for (size_t i=0;i<results.size();i++){
+        json<<"    {\"name\": "<<jsonString(results[i].name);
+        if (results[i].seconds<0){
+            failed=true;
+            json<<", \"seconds\": null, \"values_per_second\": null}";
+        }else{
+            json<<", \"seconds\": "<<results[i].seconds<<", \"values_per_second\": "<<results[i].values/results[i].seconds<<"}";
+        }
+        json<<(i+1<results.size() ? ",\n" : "\n");
+    }
+    json<<"  ]\n";
+    json<<"}\n";
+    if (outputFile.empty()){
+        std::cout<<json.str();
+    }else{
+        std::ofstream output(outputFile);
+        output<<json.str();
+        if (output.fail()){
+            std::cerr<<"The results could not be written to "<<outputFile<<"."<<std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
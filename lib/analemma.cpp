@@ -83,11 +83,9 @@ bool Analemma::genSun()
     if (!getSunPos()){
         return false;
     }
-    /*
     if (!closestSun()){
         return false;
     }
-    */
     if (!genSunMtx()){
         return false;
     }
@@ -98,7 +96,8 @@ bool Analemma::genSun()
 //Private Functions
 bool Analemma::parseWeather()
 {
-    if (!m_WeaData.parseWeather(m_WeatherFile)){
+    m_WeaData=WeatherCache::weatherData(m_WeatherFile);
+    if (!m_WeaData){
         return false;
     }
     return true;
@@ -141,6 +140,7 @@ bool Analemma::getSunPos()
     int nskip=0;
     m_ClosestSun.resize(8760);
     temporarySun.resize(8760);
+    m_HourSuns.clear();
 
 
     // Loop through all hours of the day
@@ -330,6 +330,7 @@ bool Analemma::getSunPos()
             nskip=0;
         }
         n_overlap=0;
+        m_HourSuns.push_back(std::make_pair(n_first,m_numSuns));
     }
     /*
     std::ofstream debugFile;
@@ -448,17 +449,17 @@ double Analemma::solarDec(int julianDate)
 
 double Analemma::solarTimeAdj(int julianDate)
 {
-    return 0.170*sin((4*PI/373)*(julianDate-80))-0.129*sin((2*PI/355)*(julianDate-8))+12 *(degToRad(m_WeaData.timeZoneDeg())-degToRad(m_WeaData.longitude()))/PI;
+    return 0.170*sin((4*PI/373)*(julianDate-80))-0.129*sin((2*PI/355)*(julianDate-8))+12 *(degToRad(m_WeaData->timeZoneDeg())-degToRad(m_WeaData->longitude()))/PI;
 }
 
 double Analemma::solarAlt(double solarDeclination, double time)
 {
-    return asin(sin(degToRad(m_WeaData.latitude()))*sin(solarDeclination)-cos(degToRad(m_WeaData.latitude()))*cos(solarDeclination)*cos(PI*time/12));
+    return asin(sin(degToRad(m_WeaData->latitude()))*sin(solarDeclination)-cos(degToRad(m_WeaData->latitude()))*cos(solarDeclination)*cos(PI*time/12));
 }
 
 double Analemma::solarAz(double solarDeclination, double time)
 {
-    return -atan2(cos(solarDeclination)*sin(time*(PI/12)),-cos(degToRad(m_WeaData.latitude()))*sin(solarDeclination)-sin(degToRad(m_WeaData.latitude()))*cos(solarDeclination)*cos(time*(PI/12)));
+    return -atan2(cos(solarDeclination)*sin(time*(PI/12)),-cos(degToRad(m_WeaData->latitude()))*sin(solarDeclination)-sin(degToRad(m_WeaData->latitude()))*cos(solarDeclination)*cos(time*(PI/12)));
 }
 
 double Analemma::dotProd(std::vector<double> vec1,std::vector<double> vec2)
@@ -468,77 +469,82 @@ double Analemma::dotProd(std::vector<double> vec1,std::vector<double> vec2)
 
 bool Analemma::closestSun()
 {
-    //std::ofstream debugFile;
-    //debugFile.open("c:/001/SpeedUpData.txt");
-    int hr_count=0;
-    double hr=0;
-    double sda;         //Solar Declination Angle
-    double sta;         //Solar Time Adjustment
-    double altitude;
-    double azimuth;
-    double dprod;
-    std::vector<double> svec;
-    for (int julian_date=1;julian_date<366;julian_date++){
-        for (int hri=0;hri<24; hri++){
-            hr=hri+.5;
-            hr_count=hr_count+1;
-            sda = solarDec(julian_date);
-            sta = solarTimeAdj(julian_date);
-            altitude = solarAlt(sda, hr+sta);
-            azimuth = solarAz(sda, hr+sta) + PI - degToRad(m_Rotation);
-            svec=pos(altitude,azimuth);
-            double dp_closest=0;
-            if(altitude > 0){
-              for (unsigned int j=0; j<m_SunLoc.size(); j++) {
-                std::vector<double> tempvec;
-                tempvec.push_back(m_SunLoc[j][0]);
-                tempvec.push_back(m_SunLoc[j][1]);
-                tempvec.push_back(m_SunLoc[j][2]);
-                dprod = dotProd(tempvec,svec);
-                if(dprod>dp_closest){
-                    if (m_ClosestSun.size()<hr_count){
-                        m_ClosestSun.push_back(j);
-                    }else{
-                        m_ClosestSun[hr_count-1]=j;
-                    }
+    //Each timestep of the weather file is given the closest sun.  Hourly data falls on the hours
+    //of the analemma, so the table built with the suns is used.  Other timesteps search only the
+    //suns of the two hours of the analemma on either side, so the work grows with the timesteps.
+    std::vector<int> julianDate=m_WeaData->julianDate();
+    std::vector<double> hour=m_WeaData->hour();
+    m_StepSun.assign(julianDate.size(),-1);
+    for (int i=0;i<julianDate.size();i++){
+        int date=julianDate[i]<1 ? 1 : (julianDate[i]>365 ? 365 : julianDate[i]);
+        if (m_WeaData->intervalsPerHour()==1){
+            int hri=int(floor(hour[i]));
+            if (hri<0 || hri>23){
+                STADIC_ERROR("The hour "+toString(hour[i])+" of the weather file is outside of the day.");
+                return false;
+            }
+            m_StepSun[i]=m_ClosestSun[(date-1)*24+hri];
+            continue;
+        }
+        double sda=solarDec(date);
+        double sta=solarTimeAdj(date);
+        double altitude=solarAlt(sda,hour[i]+sta);
+        if (altitude<=0.00278){
+            continue;
+        }
+        std::vector<double> svec=pos(altitude,solarAz(sda,hour[i]+sta)+PI-degToRad(m_Rotation));
+        int before=int(floor(hour[i]-0.5));
+        int first=before<0 ? 0 : (before>23 ? 23 : before);
+        int last=before+1>23 ? 23 : (before+1<0 ? 0 : before+1);
+        double dp_closest=-1;
+        for (int hri=first;hri<=last;hri++){
+            for (int j=m_HourSuns[hri].first;j<m_HourSuns[hri].second;j++){
+                double dprod=m_SunLoc[j][0]*svec[0]+m_SunLoc[j][1]*svec[1]+m_SunLoc[j][2]*svec[2];
+                if (dprod>dp_closest){
+                    m_StepSun[i]=j;
                     dp_closest=dprod;
                 }
-              }
-              //debugFile<<"Time: "<<hr<<" julianDate: "<<julian_date<<" ClosestSun: "<<temporarySun[m_ClosestSun[hr_count-1]]<<std::endl;
-            }else {
-                if (m_ClosestSun.size()<hr_count){
-                    m_ClosestSun.push_back(-1);
-                }else{
-                    m_ClosestSun[hr_count-1]=-1;
+            }
+        }
+        if (m_StepSun[i]==-1){
+            //Neither hour has a sun above the horizon, so look through all of them
+            for (int j=0;j<m_SunLoc.size();j++){
+                double dprod=m_SunLoc[j][0]*svec[0]+m_SunLoc[j][1]*svec[1]+m_SunLoc[j][2]*svec[2];
+                if (dprod>dp_closest){
+                    m_StepSun[i]=j;
+                    dp_closest=dprod;
                 }
             }
         }
     }
-    //debugFile.close();
     return true;
 }
 
 bool Analemma::genSunMtx()
 {
-    std::ofstream smx;
-    smx.open(m_SMXFile);
-    if (!smx.is_open()){
+    BufferedWriter smx;
+    if (!smx.open(m_SMXFile)){
         STADIC_ERROR("There was a problem opening the smx file \""+m_SMXFile+"\".");
         return false;
     }
     //smx.setf(std::ios::scientific);
     //smx.setf(std::ios::fixed);
     //smx.precision(6);
+    std::vector<double> directIlluminance=m_WeaData->directIlluminance();
     for (int j=0;j<m_numSuns;j++){
-        for (int i=0;i<8760;i++){
-            if (m_ClosestSun[i]==j){
-                smx<<m_WeaData.directIlluminance()[i]/6.797e-05<<"\t"<<m_WeaData.directIlluminance()[i]/6.797e-05<<"\t"<<m_WeaData.directIlluminance()[i]/6.797e-05<<std::endl;
+        for (int i=0;i<m_StepSun.size();i++){
+            if (m_StepSun[i]==j){
+                double radiance=directIlluminance[i]/6.797e-05;
+                smx<<radiance<<'\t'<<radiance<<'\t'<<radiance<<'\n';
             }else{
                 smx<<"0\t0\t0\n";
             }
         }
     }
-    smx.close();
+    if (!smx.close()){
+        STADIC_ERROR("There was a problem writing the smx file \""+m_SMXFile+"\".");
+        return false;
+    }
 
     /*
     std::clog<<"Resizing Sun Matrix."<<std::endl;
@@ -553,12 +559,12 @@ bool Analemma::genSunMtx()
         }
     }
     std::clog<<"Finished resizing Sun Matrix."<<std::endl;
-    for (int i=0;i<m_WeaData.hour().size();i++){
+    for (int i=0;i<m_WeaData->hour().size();i++){
         if (m_ClosestSun[i]>-1){
             std::vector<double> tempVec;
-            tempVec.push_back(m_WeaData.directIlluminance()[i]/6.797e-05);
-            tempVec.push_back(m_WeaData.directIlluminance()[i]/6.797e-05);
-            tempVec.push_back(m_WeaData.directIlluminance()[i]/6.797e-05);
+            tempVec.push_back(m_WeaData->directIlluminance()[i]/6.797e-05);
+            tempVec.push_back(m_WeaData->directIlluminance()[i]/6.797e-05);
+            tempVec.push_back(m_WeaData->directIlluminance()[i]/6.797e-05);
             m_SunVal[i][m_ClosestSun[i]]=tempVec;
         }
     }
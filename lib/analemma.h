@@ -34,6 +34,7 @@
 #include <string>
 #include "stadicapi.h"
 #include <vector>
+#include <utility>
 
 /*
  * Adapted from Greg Ward's and Ian Ashdown's gendaymtx
@@ -60,7 +61,7 @@ public:
 private:
     //Variables
     std::string m_WeatherFile;                                              //Variable holding the input weather file
-    WeatherData m_WeaData;                                                  //WeatherData object
+    std::shared_ptr<const WeatherData> m_WeaData;                           //WeatherData object shared through the WeatherCache
     std::vector<std::vector<double> > m_SunLoc;                              //Vector holding the sun locations
     //std::vector<std::vector<std::vector<double> > > m_SunVal;                 //Vector holding the sun luminance values
     double m_Rotation;                                                      //Variable holding the building rotation
@@ -68,7 +69,9 @@ private:
     std::string m_MatFile;                                                  //Variable holding the sun mateterial filename
     std::string m_GeoFile;                                                  //Variable holding the sun geometry filename
     std::string m_SMXFile;                                                  //Variable holding the sun smx filename
-    std::vector<int> m_ClosestSun;                                          //Vector holding which sun is closest at any given hour
+    std::vector<int> m_ClosestSun;                                          //Vector holding which sun is closest at any given hour of the analemma
+    std::vector<std::pair<int,int> > m_HourSuns;                            //Vector holding the first and one past the last sun of each hour of the analemma
+    std::vector<int> m_StepSun;                                             //Vector holding which sun is closest at each timestep of the weather file
     std::vector<std::string> temporarySun;
 
     //Functions
@@ -82,7 +85,7 @@ private:
     double solarAlt(double solarDeclination, double time);                  //Function to calculate the solar altitude angle
     double solarAz(double solarDeclination, double time);                   //Function to calculate the solar azimuth angle
     double dotProd(std::vector<double> vec1,std::vector<double> vec2);      //Function to calculate the dot product of two 3 dimensional vectors
-    bool closestSun();                                                      //Function to find the closest sun
+    bool closestSun();                                                      //Function to find the closest sun at each timestep of the weather file
     bool genSunMtx();                                                       //Function to generate the sun matrix
 };
 
@@ -31,269 +31,1160 @@
 #include "dayill.h"
 #include "logging.h"
 #include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <limits>
 #include "functions.h"
+#include "filepath.h"
+#include "illkernels.h"
+#include "parallel.h"
 #include "weatherdata.h"
 
 namespace stadic {
 
-TemporalIlluminance::TemporalIlluminance()
+//Layout of the binary illuminance file, see dayill.h
+static const char binaryMagic[8]={'S','T','A','D','I','L','L','\0'};
+static const uint32_t binaryVersion=1;
+static const uint32_t binarySparseVersion=2;
+static const uint32_t binaryByteOrder=0x01020304;
+static const uint64_t binaryHeaderSize=64;
+static const uint64_t binaryAlignment=64;
+
+//Text files are only split between threads in pieces of at least this size
+static const size_t minimumChunkSize=1<<16;
+
+//The part of a text illuminance file parsed by one thread
+struct TextChunk
 {
-    m_Month = 1;
-    m_Day = 1;
-    m_Hour = 1.0/60.0;
-}
+    const char *begin;
+    const char *end;
+    unsigned lines;                                                             //Number of lines in the chunk, blank ones included
+    unsigned firstRowLine;                                                      //Line within the chunk of the first row of values
+    unsigned points;                                                            //Number of points on each row of a time based file
+    std::vector<int> month;
+    std::vector<int> day;
+    std::vector<double> hour;
+    std::vector<double> values;
+    std::string problem;                                                        //Description of the first problem found, empty if none
+    unsigned problemLine;                                                       //Line within the chunk of the problem
+    unsigned problemColumn;                                                     //Column of a malformed value, 0 otherwise
+};
 
-TemporalIlluminance::TemporalIlluminance(int month, int day, double hour, const std::vector<double> &illuminance)
-    : m_Month(month), m_Day(day), m_Hour(hour)
+static size_t textFileSize(const std::string &fileName)
 {
-    m_Illuminance = illuminance;
+    std::ifstream iFile(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!iFile.is_open()){
+        return 0;
+    }
+    return static_cast<size_t>(iFile.tellg());
 }
 
-bool TemporalIlluminance::add(std::vector<double> addIll){
-    if (addIll.size()!=m_Illuminance.size()){
-        STADIC_ERROR("The adding of the two illuminance vectors cannot be completed because they are not the same size.");
-        return false;
+//Splits a buffer into about count pieces that each start at the beginning of a line
+static std::vector<TextChunk> splitAtLines(const char *data, size_t size, unsigned count)
+{
+    size_t chunkSize=size/count;
+    if (chunkSize<minimumChunkSize){
+        chunkSize=minimumChunkSize;
     }
-    for (int i=0;i<m_Illuminance.size();i++){
-        m_Illuminance[i]=m_Illuminance[i]+addIll[i];
+    std::vector<TextChunk> chunks;
+    const char *begin=data;
+    const char *end=data+size;
+    while (begin<end){
+        const char *split=end;
+        if (static_cast<size_t>(end-begin)>chunkSize){
+            split=static_cast<const char*>(std::memchr(begin+chunkSize,'\n',end-begin-chunkSize));
+            split=split==nullptr ? end : split+1;
+        }
+        TextChunk chunk;
+        chunk.begin=begin;
+        chunk.end=split;
+        chunk.lines=0;
+        chunk.firstRowLine=0;
+        chunk.points=0;
+        chunk.problemLine=0;
+        chunk.problemColumn=0;
+        chunks.push_back(chunk);
+        begin=split;
     }
+    return chunks;
+}
 
+//Walks the lines of a chunk, parsing each into row and handing the non-blank
+//ones to process, which returns false to stop. Returns false if a line holds
+//a malformed value or process stopped.
+template <typename Function> static bool forEachRow(TextChunk &chunk, Function process)
+{
+    std::vector<double> row;
+    const char *line=chunk.begin;
+    while (line<chunk.end){
+        const char *newline=static_cast<const char*>(std::memchr(line,'\n',chunk.end-line));
+        const char *lineEnd=newline==nullptr ? chunk.end : newline;
+        chunk.lines++;
+        if (!parseRow(line,lineEnd,row,&chunk.problemColumn)){
+            chunk.problem="contains a malformed value";
+            chunk.problemLine=chunk.lines;
+            return false;
+        }
+        if (!row.empty() && !process(row)){
+            chunk.problemLine=chunk.lines;
+            return false;
+        }
+        line=newline==nullptr ? chunk.end : newline+1;
+    }
     return true;
 }
 
-//Getters
-std::vector<double> TemporalIlluminance::lux(){
-    return m_Illuminance;
-}
-std::vector<double> TemporalIlluminance::fc(){
-    std::vector<double> tempVec;
-    for (int i=0;i<m_Illuminance.size();i++){
-        tempVec.push_back(m_Illuminance[i]/10.764);
+//Checks the month, day and hour at the start of a row of a time based file,
+//returning a description of the problem or an empty string
+static std::string checkTimeBasedRow(const std::vector<double> &vals)
+{
+    if (vals.size()<4){
+        return "contains a line without any illuminance values";
+    }
+    int month=static_cast<int>(vals[0]);
+    if (month<1 || month>12){
+        return "contains a month value that is not acceptable";
     }
-    return tempVec;
+    int day=static_cast<int>(vals[1]);
+    if (day<1 || day>31){
+        return "contains a day value that is not acceptable";
+    }
+    if (vals[2]<0 || vals[2]>24){
+        return "contains an hour value that is not acceptable";
+    }
+    return std::string();
 }
 
-int TemporalIlluminance::month(){
-    return m_Month;
+//Reports the first problem found in the chunks, returning false if there was one
+static bool reportChunkProblems(const std::string &fileName, const std::vector<TextChunk> &chunks)
+{
+    unsigned line=0;
+    for (unsigned i=0;i<chunks.size();i++){
+        if (!chunks[i].problem.empty()){
+            std::string position="line "+toString(line+chunks[i].problemLine);
+            if (chunks[i].problemColumn>0){
+                position+=", column "+toString(chunks[i].problemColumn);
+            }
+            STADIC_ERROR("The illuminance file "+fileName+" "+chunks[i].problem+" at "+position+".");
+            return false;
+        }
+        line+=chunks[i].lines;
+    }
+    return true;
 }
-int TemporalIlluminance::day(){
-    return m_Day;
+
+template <typename T> static T readBinary(const char *data)
+{
+    T value;
+    std::memcpy(&value,data,sizeof(T));
+    return value;
 }
-double TemporalIlluminance::hour(){
-    return m_Hour;
+
+template <typename T> static void writeBinary(char *data, T value)
+{
+    std::memcpy(data,&value,sizeof(T));
 }
-bool TemporalIlluminance::allZeros(){
-    for (int i=0;i<m_Illuminance.size();i++){
-        if (m_Illuminance[i]>0){
+
+bool IlluminanceView::allZeros() const
+{
+    if (m_Stride==1){
+        return !kernels::anyAbove(m_Data,m_Size,0);
+    }
+    for (unsigned i=0;i<m_Size;i++){
+        if (m_Data[size_t(i)*m_Stride]>0){
             return false;
         }
     }
     return true;
 }
-double TemporalIlluminance::fractionAboveTarget(double target){
+double IlluminanceView::fractionAboveTarget(double target) const
+{
+    if (m_Stride==1){
+        return double(kernels::countAbove(m_Data,nullptr,m_Size,target))/m_Size;
+    }
     double tempFrac=0;
-    for (int i=0;i<m_Illuminance.size();i++){
-        if (m_Illuminance[i]>target){
+    for (unsigned i=0;i<m_Size;i++){
+        if (m_Data[size_t(i)*m_Stride]>target){
             tempFrac++;
         }
     }
-    return tempFrac/m_Illuminance.size();
+    return tempFrac/m_Size;
 }
 
-DaylightIlluminanceData::DaylightIlluminanceData()
+DaylightIlluminanceData::DaylightIlluminanceData() : m_Points(0), m_MappedValues(nullptr), m_Threads(0), m_Sparse(false)
 {
 }
 
 
 bool DaylightIlluminanceData::parse(std::string fileName, std::string weaFile){
-    std::ifstream iFile;
-    iFile.open(fileName);
-    if (!iFile.is_open()){
+    NumericReader reader;
+    if (!reader.open(fileName)){
         STADIC_ERROR("The opening of the illuminance file "+fileName+" failed.");
         return false;
     }
 
-    WeatherData weaData;
-    if(!weaData.parseWeather(weaFile)){
+    std::shared_ptr<const WeatherData> weaData=WeatherCache::weatherData(weaFile);
+    if(!weaData){
         return false;
     }
+    setTimeAxis(weaData->month(),weaData->day(),weaData->hour());
 
-    std::string line;
-    int countHours=0;
-    bool firstPoint=true;
-    std::vector<std::vector<double>> illData;
-    while (std::getline(iFile, line)){
-        countHours++;
-        if (firstPoint){
-            std::vector<double> tmpIll;
-            tmpIll.push_back(toDouble(line));
-            illData.push_back(tmpIll);
-        }else{
-            illData[countHours-1].push_back(toDouble(line));
+    //The file holds one value per line, running through every timestep for
+    //the first point before moving on to the next, which is the same order
+    //as the matrix itself.
+    unsigned threads=resolveThreads(m_Threads);
+    if (threads>1 && textFileSize(fileName)>=2*minimumChunkSize){
+        reader.close();
+        if (!parseChunks(fileName,threads)){
+            m_Data.clear();
+            return false;
+        }
+    }else{
+        std::vector<double> row;
+        while (reader.readRow(row)){
+            m_Data.insert(m_Data.end(),row.begin(),row.end());
         }
-        if (countHours==weaData.hour().size()){
-            countHours=0;
-            firstPoint=false;
+        if (reader.failed()){
+            STADIC_ERROR("The illuminance file "+fileName+" contains a malformed value at "+reader.position()+".");
+            m_Data.clear();
+            return false;
         }
     }
-    iFile.close();
-    for (int i=0;i<weaData.hour().size();i++){
-        TemporalIlluminance datapoint(weaData.month()[i],weaData.day()[i],weaData.hour()[i],illData[i]);
-        m_data.push_back(datapoint);
+    if (timesteps()==0 || m_Data.size()%timesteps()!=0){
+        STADIC_ERROR("The number of values in the illuminance file "+fileName+" is not a multiple of the number of timesteps in "+weaFile+".");
+        m_Data.clear();
+        return false;
     }
+    m_Points=m_Data.size()/timesteps();
 
     return true;
 }
 
 
 bool DaylightIlluminanceData::parseTimeBased(std::string fileName){
-    std::ifstream iFile;
-    iFile.open(fileName);
-    if (!iFile.is_open()){
+    if (isBinaryIllFile(fileName)){
+        return parseBinary(fileName);
+    }
+    unsigned threads=resolveThreads(m_Threads);
+    if (threads>1 && textFileSize(fileName)>=2*minimumChunkSize){
+        return parseTimeBasedChunks(fileName,threads);
+    }
+    NumericReader reader;
+    if (!reader.open(fileName)){
         STADIC_ERROR("The opening of the illuminance file "+fileName+" could not be opened.");
         return false;
     }
-    std::string line;
-    while (std::getline(iFile,line)){
-        int month,day;
-        double hour;
-        std::vector<std::string> vals;
-        vals=split(line,' ');
-        if(vals.size() < 4) {
-            //ERROR!
-        }
-        month = atoi(vals[0].c_str());
-        if (month<1 || month>12){
-            STADIC_ERROR("One of the month values is not acceptable.");
-            return false;
+    m_Month.clear();
+    m_Day.clear();
+    m_Hour.clear();
+    std::vector<double> rows;
+    unsigned points=0;
+    std::vector<double> vals;
+    while (reader.readRow(vals)){
+        if (vals.empty()){
+            continue;
         }
-        day=atoi(vals[1].c_str());
-        if (day<1 || day>31){
-            STADIC_ERROR("One of the day values is not acceptable.");
+        std::string problem=checkTimeBasedRow(vals);
+        if (!problem.empty()){
+            STADIC_ERROR("The illuminance file "+fileName+" "+problem+" at "+reader.position()+".");
             return false;
         }
-        hour=atof(vals[2].c_str());
-        if (hour<0 || hour>24){
-            STADIC_ERROR("One of the hour values is not acceptable.");
+        if (m_Hour.empty()){
+            points=vals.size()-3;
+        }else if (vals.size()-3!=points){
+            STADIC_ERROR("The illuminance file "+fileName+" does not contain the same number of points on every line at "+reader.position()+".");
             return false;
         }
-        std::vector<double> ill;
-
-        for (int i=3;i<vals.size()-3;i++){
-            ill.push_back(atof(vals[i].c_str()));
-        }
-
-        TemporalIlluminance datapoint(month,day,hour,ill);
-        m_data.push_back(datapoint);
+        m_Month.push_back(static_cast<int>(vals[0]));
+        m_Day.push_back(static_cast<int>(vals[1]));
+        m_Hour.push_back(vals[2]);
+        rows.insert(rows.end(),vals.begin()+3,vals.end());
     }
-    iFile.close();
-    return true;
+    if (reader.failed()){
+        STADIC_ERROR("The illuminance file "+fileName+" contains a malformed value at "+reader.position()+".");
+        return false;
+    }
+    return setFromRows(rows,points);
 }
 
 bool DaylightIlluminanceData::addIllFile(std::string fileName){
-    std::ifstream iFile;
-    iFile.open(fileName);
-    if (!iFile.is_open()){
+    NumericReader reader;
+    if (!reader.open(fileName)){
         STADIC_ERROR("The opening of the illuminance file "+fileName+" failed.");
         return false;
     }
-    std::string line;
-    int i;
-    while (std::getline(iFile,line)){
-        i=0;
-        std::vector<std::string> vals;
-
-        vals=split(line,' ');
-        std::vector<double> ill;
-
+    detach();
+    restoreDarkTimesteps();
+    std::vector<double> vals;
+    unsigned i=0;
+    while (reader.readRow(vals)){
+        if (vals.empty()){
+            continue;
+        }
+        if (vals.size()!=m_Points || i>=timesteps()){
+            STADIC_ERROR("The adding of the two illuminance vectors cannot be completed because they are not the same size.");
+            return false;
+        }
         for (int j=0;j<vals.size();j++){
-            ill.push_back(atof(vals[j].c_str()));
+            m_Data[size_t(j)*timesteps()+i]+=vals[j];
         }
-        m_data[i].add(ill);
         i++;
     }
-    iFile.close();
+    if (reader.failed()){
+        STADIC_ERROR("The illuminance file "+fileName+" contains a malformed value at "+reader.position()+".");
+        return false;
+    }
+    if (i!=timesteps()){
+        STADIC_ERROR("The adding of the two illuminance vectors cannot be completed because they are not the same size.");
+        return false;
+    }
     return true;
 }
 
 bool DaylightIlluminanceData::addTimeBasedIll(std::string fileName){
-    std::ifstream iFile;
-    iFile.open(fileName);
-    if (!iFile.is_open()){
+    if (isBinaryIllFile(fileName)){
+        DaylightIlluminanceData other;
+        if (!other.parseBinary(fileName)){
+            return false;
+        }
+        return addData(other);
+    }
+    NumericReader reader;
+    if (!reader.open(fileName)){
         STADIC_ERROR("The opening of the illuminance file "+fileName+" failed.");
         return false;
     }
-    std::string line;
-    int i;
-    while (std::getline(iFile,line)){
-        i=0;
-        std::vector<std::string> vals;
-
-        vals=split(line,' ');
-        std::vector<double> ill;
-
+    detach();
+    restoreDarkTimesteps();
+    std::vector<double> vals;
+    unsigned i=0;
+    while (reader.readRow(vals)){
+        if (vals.empty()){
+            continue;
+        }
+        if (vals.size()<3 || vals.size()-3!=m_Points || i>=timesteps()){
+            STADIC_ERROR("The adding of the two illuminance vectors cannot be completed because they are not the same size.");
+            return false;
+        }
         for (int j=3;j<vals.size();j++){
-            ill.push_back(atof(vals[j].c_str()));
+            m_Data[size_t(j-3)*timesteps()+i]+=vals[j];
         }
-        m_data[i].add(ill);
         i++;
     }
-    iFile.close();
+    if (reader.failed()){
+        STADIC_ERROR("The illuminance file "+fileName+" contains a malformed value at "+reader.position()+".");
+        return false;
+    }
+    if (i!=timesteps()){
+        STADIC_ERROR("The adding of the two illuminance vectors cannot be completed because they are not the same size.");
+        return false;
+    }
     return true;
 }
 
 bool DaylightIlluminanceData::writeIllFileLux(std::string fileName){
-    std::ofstream oFile;
-    oFile.open(fileName);
-    if (!oFile.is_open()){
+    return writeIllFile(fileName,1);
+}
+bool DaylightIlluminanceData::writeIllFileFC(std::string fileName){
+    return writeIllFile(fileName,10.764);
+}
+
+bool DaylightIlluminanceData::parseBinary(std::string fileName){
+    std::shared_ptr<MappedFile> mapped=std::make_shared<MappedFile>();
+    if (!mapped->open(fileName)){
+        return false;
+    }
+    const char *data=mapped->data();
+    if (mapped->size()<binaryHeaderSize || std::memcmp(data,binaryMagic,sizeof(binaryMagic))!=0){
+        STADIC_ERROR("The file "+fileName+" is not a binary illuminance file.");
+        return false;
+    }
+    uint32_t version=readBinary<uint32_t>(data+8);
+    if (version!=binaryVersion && version!=binarySparseVersion){
+        STADIC_ERROR("The binary illuminance file "+fileName+" was written with an unsupported format version.");
         return false;
     }
-    for (int i=0;i<m_data.size();i++){
-        oFile<<m_data[i].month()<<" "<<m_data[i].day()<<" "<<m_data[i].hour();
-        for (int j=0;j<m_data[i].lux().size();j++){
-            oFile<<" "<<m_data[i].lux()[j];
+    if (readBinary<uint32_t>(data+12)!=binaryByteOrder){
+        STADIC_ERROR("The binary illuminance file "+fileName+" was written on a machine with a different byte order.");
+        return false;
+    }
+    uint32_t valueSize=readBinary<uint32_t>(data+16);
+    uint32_t units=readBinary<uint32_t>(data+20);
+    uint64_t points=readBinary<uint64_t>(data+24);
+    uint64_t steps=readBinary<uint64_t>(data+32);
+    uint64_t bodyOffset=readBinary<uint64_t>(data+40);
+    uint64_t stored=version==binarySparseVersion ? readBinary<uint64_t>(data+48) : steps;
+    if ((valueSize!=sizeof(float) && valueSize!=sizeof(double)) || units>Footcandles){
+        STADIC_ERROR("The binary illuminance file "+fileName+" has an unknown value type or units.");
+        return false;
+    }
+    //Each count is bounded by the file size before it is multiplied, so that a
+    //corrupt header cannot wrap the products checked below
+    uint64_t size=mapped->size();
+    if (stored>steps || steps>size/(2*sizeof(int32_t)+sizeof(double)) || bodyOffset>size
+            || points>std::numeric_limits<unsigned>::max()
+            || (stored>0 && points>(size-bodyOffset)/valueSize/stored)){
+        STADIC_ERROR("The binary illuminance file "+fileName+" is truncated or has an inconsistent header.");
+        return false;
+    }
+    uint64_t indexSize=version==binarySparseVersion ? stored*sizeof(uint32_t) : 0;
+    if (bodyOffset<binaryHeaderSize+steps*(2*sizeof(int32_t)+sizeof(double))+indexSize
+            || bodyOffset%binaryAlignment!=0 || bodyOffset+points*stored*valueSize>mapped->size()){
+        STADIC_ERROR("The binary illuminance file "+fileName+" is truncated or has an inconsistent header.");
+        return false;
+    }
+
+    std::vector<int> month(steps);
+    std::vector<int> day(steps);
+    std::vector<double> hour(steps);
+    const char *axis=data+binaryHeaderSize;
+    for (uint64_t i=0;i<steps;i++){
+        month[i]=readBinary<int32_t>(axis+i*sizeof(int32_t));
+        day[i]=readBinary<int32_t>(axis+(steps+i)*sizeof(int32_t));
+        hour[i]=readBinary<double>(axis+2*steps*sizeof(int32_t)+i*sizeof(double));
+    }
+    setTimeAxis(month,day,hour);
+    m_Points=points;
+    if (version==binarySparseVersion){
+        const char *index=axis+2*steps*sizeof(int32_t)+steps*sizeof(double);
+        m_Column.assign(steps,-1);
+        for (uint64_t i=0;i<stored;i++){
+            uint32_t timestep=readBinary<uint32_t>(index+i*sizeof(uint32_t));
+            if (timestep>=steps || (i>0 && timestep<=m_Lit.back())){
+                STADIC_ERROR("The binary illuminance file "+fileName+" has an invalid list of stored timesteps.");
+                clearDarkIndex();
+                return false;
+            }
+            m_Column[timestep]=m_Lit.size();
+            m_Lit.push_back(timestep);
+        }
+        m_Sparse=true;
+        m_DarkColumn.assign(m_Points,0);
+    }
+
+    const char *body=data+bodyOffset;
+    if (valueSize==sizeof(double) && units==Lux){
+        //The mapping is page aligned and the body offset is a multiple of 64,
+        //so the values can be used where they lie.
+        m_Mapped=mapped;
+        m_MappedValues=reinterpret_cast<const double*>(body);
+        return true;
+    }
+    double scale=units==Footcandles ? 10.764 : 1;
+    m_Data.resize(points*stored);
+    for (uint64_t i=0;i<m_Data.size();i++){
+        if (valueSize==sizeof(float)){
+            m_Data[i]=readBinary<float>(body+i*sizeof(float))*scale;
+        }else{
+            m_Data[i]=readBinary<double>(body+i*sizeof(double))*scale;
         }
-        oFile<<std::endl;
     }
-    oFile.close();
     return true;
 }
-bool DaylightIlluminanceData::writeIllFileFC(std::string fileName){
+
+bool DaylightIlluminanceData::writeIllFileBinary(std::string fileName, Units units, Precision precision){
     std::ofstream oFile;
-    oFile.open(fileName);
+    oFile.open(fileName, std::ios::out | std::ios::binary);
     if (!oFile.is_open()){
+        STADIC_ERROR("The opening of the binary illuminance file "+fileName+" failed.");
         return false;
     }
-    for (int i=0;i<m_data.size();i++){
-        oFile<<m_data[i].month()<<" "<<m_data[i].day()<<" "<<m_data[i].hour();
-        for (int j=0;j<m_data[i].fc().size();j++){
-            oFile<<" "<<m_data[i].fc()[j];
+    uint64_t steps=timesteps();
+    uint64_t stored=storedTimesteps();
+    uint32_t valueSize=precision==SinglePrecision ? sizeof(float) : sizeof(double);
+    uint64_t axisSize=steps*(2*sizeof(int32_t)+sizeof(double));
+    if (m_Sparse){
+        axisSize+=stored*sizeof(uint32_t);
+    }
+    uint64_t bodyOffset=(binaryHeaderSize+axisSize+binaryAlignment-1)/binaryAlignment*binaryAlignment;
+
+    std::vector<char> header(bodyOffset,0);
+    std::memcpy(header.data(),binaryMagic,sizeof(binaryMagic));
+    writeBinary<uint32_t>(header.data()+8,m_Sparse ? binarySparseVersion : binaryVersion);
+    writeBinary<uint32_t>(header.data()+12,binaryByteOrder);
+    writeBinary<uint32_t>(header.data()+16,valueSize);
+    writeBinary<uint32_t>(header.data()+20,units);
+    writeBinary<uint64_t>(header.data()+24,m_Points);
+    writeBinary<uint64_t>(header.data()+32,steps);
+    writeBinary<uint64_t>(header.data()+40,bodyOffset);
+    if (m_Sparse){
+        writeBinary<uint64_t>(header.data()+48,stored);
+    }
+    char *axis=header.data()+binaryHeaderSize;
+    for (uint64_t i=0;i<steps;i++){
+        writeBinary<int32_t>(axis+i*sizeof(int32_t),m_Month[i]);
+        writeBinary<int32_t>(axis+(steps+i)*sizeof(int32_t),m_Day[i]);
+        writeBinary<double>(axis+2*steps*sizeof(int32_t)+i*sizeof(double),m_Hour[i]);
+    }
+    for (uint64_t i=0;i<m_Lit.size();i++){
+        writeBinary<uint32_t>(axis+2*steps*sizeof(int32_t)+steps*sizeof(double)+i*sizeof(uint32_t),m_Lit[i]);
+    }
+    oFile.write(header.data(),header.size());
+
+    //Write the body one point at a time so that a converted copy of the
+    //whole matrix is never needed.
+    double divisor=units==Footcandles ? 10.764 : 1;
+    std::vector<double> converted(stored);
+    std::vector<char> buffer(stored*valueSize);
+    for (unsigned i=0;i<m_Points;i++){
+        IlluminanceView view=point(i);
+        if (units==Lux && precision==DoublePrecision){
+            oFile.write(reinterpret_cast<const char*>(view.data()),stored*sizeof(double));
+            continue;
+        }
+        kernels::scaledCopy(converted.data(),view.data(),stored,divisor);
+        if (precision==SinglePrecision){
+            for (uint64_t j=0;j<stored;j++){
+                writeBinary<float>(buffer.data()+j*sizeof(float),static_cast<float>(converted[j]));
+            }
+            oFile.write(buffer.data(),buffer.size());
+        }else{
+            oFile.write(reinterpret_cast<const char*>(converted.data()),stored*sizeof(double));
         }
-        oFile<<std::endl;
+    }
+    if (!oFile.good()){
+        STADIC_ERROR("The writing of the binary illuminance file "+fileName+" failed.");
+        return false;
     }
     oFile.close();
     return true;
 }
-void DaylightIlluminanceData::addDataPoint(TemporalIlluminance dataPoint){
-    m_data.push_back(dataPoint);
+
+bool DaylightIlluminanceData::isBinaryIllFile(std::string fileName){
+    std::ifstream iFile;
+    iFile.open(fileName, std::ios::in | std::ios::binary);
+    if (!iFile.is_open()){
+        return false;
+    }
+    char magic[sizeof(binaryMagic)];
+    if (!iFile.read(magic,sizeof(magic))){
+        return false;
+    }
+    return std::memcmp(magic,binaryMagic,sizeof(binaryMagic))==0;
+}
+
+//Setters
+void DaylightIlluminanceData::setTimeAxis(const std::vector<int> &month, const std::vector<int> &day, const std::vector<double> &hour){
+    m_Month=month;
+    m_Day=day;
+    m_Hour=hour;
+    m_Points=0;
+    m_Data.clear();
+    m_Mapped.reset();
+    m_MappedValues=nullptr;
+    clearDarkIndex();
+}
+
+void DaylightIlluminanceData::copyTimeAxis(const DaylightIlluminanceData &other){
+    setTimeAxis(other.m_Month,other.m_Day,other.m_Hour);
+}
+
+void DaylightIlluminanceData::resize(unsigned points){
+    m_Mapped.reset();
+    m_MappedValues=nullptr;
+    m_Points=points;
+    m_Data.assign(m_Points*m_Hour.size(),0);
+    clearDarkIndex();
+}
+
+double *DaylightIlluminanceData::pointData(unsigned point){
+    detach();
+    return m_Data.data()+size_t(point)*storedTimesteps();
+}
+
+void DaylightIlluminanceData::setThreads(unsigned threads){
+    m_Threads=threads;
 }
 
-/*
-int DaylightIlluminanceData::hoursGreaterThan(double value,int point)
+void DaylightIlluminanceData::elideDarkTimesteps(){
+    if (m_Sparse){
+        return;
+    }
+    //Find the lit timesteps a point at a time so the matrix is read in order
+    unsigned steps=m_Hour.size();
+    const double *dense=values();
+    std::vector<unsigned char> lit(steps,0);
+    for (unsigned i=0;i<m_Points;i++){
+        const double *series=dense+size_t(i)*steps;
+        for (unsigned j=0;j<steps;j++){
+            if (series[j]!=0){
+                lit[j]=1;
+            }
+        }
+    }
+    m_Column.assign(steps,-1);
+    m_Lit.clear();
+    for (unsigned j=0;j<steps;j++){
+        if (lit[j]){
+            m_Column[j]=m_Lit.size();
+            m_Lit.push_back(j);
+        }
+    }
+    unsigned stored=m_Lit.size();
+    if (m_Mapped){
+        std::vector<double> compact(size_t(m_Points)*stored);
+        for (unsigned i=0;i<m_Points;i++){
+            for (unsigned j=0;j<stored;j++){
+                compact[size_t(i)*stored+j]=dense[size_t(i)*steps+m_Lit[j]];
+            }
+        }
+        m_Data.swap(compact);
+        m_Mapped.reset();
+        m_MappedValues=nullptr;
+    }else{
+        //Each stored value moves to an earlier position, so compact in place
+        for (unsigned i=0;i<m_Points;i++){
+            for (unsigned j=0;j<stored;j++){
+                m_Data[size_t(i)*stored+j]=m_Data[size_t(i)*steps+m_Lit[j]];
+            }
+        }
+        m_Data.resize(size_t(m_Points)*stored);
+        m_Data.shrink_to_fit();
+    }
+    m_Sparse=true;
+    m_DarkColumn.assign(m_Points,0);
+}
+
+void DaylightIlluminanceData::restoreDarkTimesteps(){
+    if (!m_Sparse){
+        return;
+    }
+    unsigned steps=m_Hour.size();
+    unsigned stored=m_Lit.size();
+    const double *compact=values();
+    std::vector<double> dense(size_t(m_Points)*steps,0);
+    for (unsigned i=0;i<m_Points;i++){
+        for (unsigned j=0;j<stored;j++){
+            dense[size_t(i)*steps+m_Lit[j]]=compact[size_t(i)*stored+j];
+        }
+    }
+    m_Data.swap(dense);
+    m_Mapped.reset();
+    m_MappedValues=nullptr;
+    clearDarkIndex();
+}
+
+//Getters
+unsigned DaylightIlluminanceData::threads() const{
+    return m_Threads;
+}
+
+int DaylightIlluminanceData::month(unsigned timestep) const{
+    return m_Month[timestep];
+}
+
+int DaylightIlluminanceData::day(unsigned timestep) const{
+    return m_Day[timestep];
+}
+
+double DaylightIlluminanceData::hour(unsigned timestep) const{
+    return m_Hour[timestep];
+}
+
+std::vector<unsigned char> DaylightIlluminanceData::storedMask(const std::vector<unsigned char> &mask) const{
+    if (!m_Sparse){
+        return mask;
+    }
+    std::vector<unsigned char> stored(m_Lit.size());
+    for (unsigned i=0;i<m_Lit.size();i++){
+        stored[i]=mask[m_Lit[i]];
+    }
+    return stored;
+}
+
+//Private
+bool DaylightIlluminanceData::writeIllFile(const std::string &fileName, double divisor){
+    BufferedWriter oFile;
+    if (!oFile.open(fileName)){
+        STADIC_ERROR("The opening of the illuminance file "+fileName+" failed.");
+        return false;
+    }
+    for (unsigned i=0;i<timesteps();i++){
+        oFile<<m_Month[i]<<' '<<m_Day[i]<<' '<<m_Hour[i];
+        IlluminanceView values=timestep(i);
+        for (unsigned j=0;j<m_Points;j++){
+            oFile<<' '<<values[j]/divisor;
+        }
+        oFile<<'\n';
+    }
+    if (!oFile.close()){
+        STADIC_ERROR("The writing of the illuminance file "+fileName+" failed.");
+        return false;
+    }
+    return true;
+}
+
+bool DaylightIlluminanceData::setFromRows(const std::vector<double> &rows, unsigned points){
+    unsigned steps=timesteps();
+    if (rows.size()!=size_t(points)*steps){
+        STADIC_ERROR("The illuminance values do not fill the matrix.");
+        return false;
+    }
+    m_Mapped.reset();
+    m_MappedValues=nullptr;
+    clearDarkIndex();
+    m_Points=points;
+    m_Data.resize(rows.size());
+    for (unsigned i=0;i<steps;i++){
+        for (unsigned j=0;j<points;j++){
+            m_Data[size_t(j)*steps+i]=rows[size_t(i)*points+j];
+        }
+    }
+    return true;
+}
+
+bool DaylightIlluminanceData::addData(const DaylightIlluminanceData &other){
+    if (other.points()!=m_Points || other.timesteps()!=timesteps()){
+        STADIC_ERROR("The adding of the two illuminance vectors cannot be completed because they are not the same size.");
+        return false;
+    }
+    detach();
+    restoreDarkTimesteps();
+    if (other.m_Sparse){
+        unsigned steps=timesteps();
+        unsigned stored=other.m_Lit.size();
+        const double *compact=other.values();
+        for (unsigned i=0;i<m_Points;i++){
+            for (unsigned j=0;j<stored;j++){
+                m_Data[size_t(i)*steps+other.m_Lit[j]]+=compact[size_t(i)*stored+j];
+            }
+        }
+        return true;
+    }
+    kernels::accumulate(m_Data.data(),other.values(),m_Data.size());
+    return true;
+}
+
+void DaylightIlluminanceData::detach(){
+    if (!m_Mapped){
+        return;
+    }
+    m_Data.assign(m_MappedValues,m_MappedValues+size_t(m_Points)*storedTimesteps());
+    m_Mapped.reset();
+    m_MappedValues=nullptr;
+}
+
+void DaylightIlluminanceData::clearDarkIndex(){
+    m_Sparse=false;
+    m_Lit.clear();
+    m_Column.clear();
+    m_DarkColumn.clear();
+}
+
+bool DaylightIlluminanceData::parseChunks(const std::string &fileName, unsigned threads){
+    MappedFile file;
+    if (!file.open(fileName)){
+        return false;
+    }
+    std::vector<TextChunk> chunks=splitAtLines(file.data(),file.size(),4*threads);
+    parallelFor(chunks.size(),threads,[&chunks](unsigned i){
+        TextChunk &chunk=chunks[i];
+        forEachRow(chunk,[&chunk](const std::vector<double> &row){
+            chunk.values.insert(chunk.values.end(),row.begin(),row.end());
+            return true;
+        });
+    });
+    if (!reportChunkProblems(fileName,chunks)){
+        return false;
+    }
+    std::vector<size_t> offsets(chunks.size()+1,0);
+    for (unsigned i=0;i<chunks.size();i++){
+        offsets[i+1]=offsets[i]+chunks[i].values.size();
+    }
+    m_Data.resize(offsets.back());
+    parallelFor(chunks.size(),threads,[&](unsigned i){
+        std::copy(chunks[i].values.begin(),chunks[i].values.end(),m_Data.begin()+offsets[i]);
+    });
+    return true;
+}
+
+bool DaylightIlluminanceData::parseTimeBasedChunks(const std::string &fileName, unsigned threads){
+    MappedFile file;
+    if (!file.open(fileName)){
+        return false;
+    }
+    std::vector<TextChunk> chunks=splitAtLines(file.data(),file.size(),4*threads);
+    parallelFor(chunks.size(),threads,[&chunks](unsigned i){
+        TextChunk &chunk=chunks[i];
+        forEachRow(chunk,[&chunk](const std::vector<double> &row){
+            chunk.problem=checkTimeBasedRow(row);
+            if (!chunk.problem.empty()){
+                chunk.problemColumn=0;
+                return false;
+            }
+            if (chunk.hour.empty()){
+                chunk.points=row.size()-3;
+                chunk.firstRowLine=chunk.lines;
+            }else if (row.size()-3!=chunk.points){
+                chunk.problem="does not contain the same number of points on every line";
+                chunk.problemColumn=0;
+                return false;
+            }
+            chunk.month.push_back(static_cast<int>(row[0]));
+            chunk.day.push_back(static_cast<int>(row[1]));
+            chunk.hour.push_back(row[2]);
+            chunk.values.insert(chunk.values.end(),row.begin()+3,row.end());
+            return true;
+        });
+    });
+    //Each chunk only knows its own point count, so check them against each other
+    unsigned points=0;
+    bool pointsSet=false;
+    for (unsigned i=0;i<chunks.size();i++){
+        if (!chunks[i].hour.empty()){
+            if (!pointsSet){
+                points=chunks[i].points;
+                pointsSet=true;
+            }else if (chunks[i].points!=points){
+                chunks[i].problem="does not contain the same number of points on every line";
+                chunks[i].problemLine=chunks[i].firstRowLine;
+                chunks[i].problemColumn=0;
+                break;
+            }
+        }
+        if (!chunks[i].problem.empty()){
+            break;
+        }
+    }
+    if (!reportChunkProblems(fileName,chunks)){
+        return false;
+    }
+
+    std::vector<size_t> offsets(chunks.size()+1,0);
+    for (unsigned i=0;i<chunks.size();i++){
+        offsets[i+1]=offsets[i]+chunks[i].hour.size();
+    }
+    size_t steps=offsets.back();
+    m_Month.resize(steps);
+    m_Day.resize(steps);
+    m_Hour.resize(steps);
+    m_Mapped.reset();
+    m_MappedValues=nullptr;
+    clearDarkIndex();
+    m_Points=points;
+    m_Data.resize(size_t(points)*steps);
+    //Each chunk fills its own run of timesteps in every point's series
+    parallelFor(chunks.size(),threads,[&](unsigned i){
+        const TextChunk &chunk=chunks[i];
+        size_t offset=offsets[i];
+        std::copy(chunk.month.begin(),chunk.month.end(),m_Month.begin()+offset);
+        std::copy(chunk.day.begin(),chunk.day.end(),m_Day.begin()+offset);
+        std::copy(chunk.hour.begin(),chunk.hour.end(),m_Hour.begin()+offset);
+        for (size_t t=0;t<chunk.hour.size();t++){
+            for (unsigned j=0;j<points;j++){
+                m_Data[size_t(j)*steps+offset+t]=chunk.values[t*points+j];
+            }
+        }
+    });
+    return true;
+}
+
+IlluminanceMerger::IlluminanceMerger()
 {
-    int count = 0;
-    for(unsigned i=0; i<m_data.size();i++) {
-        if(m_data[i].illuminance()[point] > value) {
-            count++;
+}
+
+void IlluminanceMerger::setTimeAxis(const std::vector<int> &month, const std::vector<int> &day, const std::vector<double> &hour){
+    m_Month=month;
+    m_Day=day;
+    m_Hour=hour;
+}
+
+void IlluminanceMerger::setPointMajorInput(const std::string &fileName){
+    m_PointMajorFile=fileName;
+}
+
+void IlluminanceMerger::addLayer(const std::string &fileName){
+    m_Layers.push_back(fileName);
+}
+
+void IlluminanceMerger::clearInputs(){
+    m_PointMajorFile.clear();
+    m_Layers.clear();
+}
+
+static bool isBlankLine(const char *begin, const char *end)
+{
+    for (;begin<end;begin++){
+        if (*begin!=' ' && *begin!='\t' && *begin!='\r' && *begin!='\v' && *begin!='\f'){
+            return false;
         }
     }
-    return count;
+    return true;
 }
-*/
 
-std::vector<TemporalIlluminance> DaylightIlluminanceData::illuminance() const
+bool IlluminanceMerger::write(const std::string &fileName){
+    unsigned steps=m_Hour.size();
+    if (steps==0 || (m_PointMajorFile.empty() && m_Layers.empty())){
+        STADIC_ERROR("The illuminance file "+fileName+" cannot be written without a time axis and at least one input.");
+        return false;
+    }
+
+    //The point-major file is mapped and read through one cursor per point,
+    //each of which steps down its point's block of lines a timestep at a time.
+    MappedFile pointMajor;
+    std::vector<const char*> cursors;
+    const char *pointMajorEnd=nullptr;
+    if (!m_PointMajorFile.empty()){
+        if (!pointMajor.open(m_PointMajorFile)){
+            return false;
+        }
+        const char *line=pointMajor.data();
+        pointMajorEnd=line+pointMajor.size();
+        size_t values=0;
+        while (line<pointMajorEnd){
+            const char *newline=static_cast<const char*>(std::memchr(line,'\n',pointMajorEnd-line));
+            const char *lineEnd=newline==nullptr ? pointMajorEnd : newline;
+            if (!isBlankLine(line,lineEnd)){
+                if (values%steps==0){
+                    cursors.push_back(line);
+                }
+                values++;
+            }
+            line=newline==nullptr ? pointMajorEnd : newline+1;
+        }
+        if (values%steps!=0){
+            STADIC_ERROR("The number of values in the illuminance file "+m_PointMajorFile+" is not a multiple of the number of timesteps.");
+            return false;
+        }
+    }
+
+    std::vector<std::unique_ptr<NumericReader>> layers;
+    for (unsigned i=0;i<m_Layers.size();i++){
+        layers.push_back(std::unique_ptr<NumericReader>(new NumericReader(1<<16)));
+        if (!layers.back()->open(m_Layers[i])){
+            STADIC_ERROR("The opening of the illuminance file "+m_Layers[i]+" failed.");
+            return false;
+        }
+    }
+
+    BufferedWriter oFile;
+    if (!oFile.open(fileName)){
+        STADIC_ERROR("The opening of the illuminance file "+fileName+" failed.");
+        return false;
+    }
+    bool pointsKnown=false;
+    std::vector<double> total(cursors.size());
+    const kernels::KernelSet kernelSet;
+    std::vector<double> row;
+    for (unsigned i=0;i<steps;i++){
+        for (unsigned j=0;j<cursors.size();j++){
+            const char *line=cursors[j];
+            const char *newline;
+            const char *lineEnd;
+            while (true){
+                newline=static_cast<const char*>(std::memchr(line,'\n',pointMajorEnd-line));
+                lineEnd=newline==nullptr ? pointMajorEnd : newline;
+                if (!isBlankLine(line,lineEnd)){
+                    break;
+                }
+                line=newline+1;
+            }
+            if (!parseRow(line,lineEnd,row) || row.size()!=1){
+                STADIC_ERROR("The illuminance file "+m_PointMajorFile+" does not hold a single value on every line.");
+                return false;
+            }
+            total[j]=row[0];
+            cursors[j]=newline==nullptr ? pointMajorEnd : newline+1;
+        }
+        for (unsigned k=0;k<layers.size();k++){
+            do {
+                if (!layers[k]->readRow(row)){
+                    if (layers[k]->failed()){
+                        STADIC_ERROR("The illuminance file "+m_Layers[k]+" contains a malformed value at "+layers[k]->position()+".");
+                    }else{
+                        STADIC_ERROR("The illuminance file "+m_Layers[k]+" has fewer rows than there are timesteps.");
+                    }
+                    return false;
+                }
+            } while (row.empty());
+            if (k==0 && cursors.empty()){
+                if (pointsKnown && row.size()!=total.size()){
+                    STADIC_ERROR("The adding of the two illuminance vectors cannot be completed because they are not the same size.");
+                    return false;
+                }
+                total.assign(row.begin(),row.end());
+                pointsKnown=true;
+                continue;
+            }
+            if (row.size()!=total.size()){
+                STADIC_ERROR("The adding of the two illuminance vectors cannot be completed because they are not the same size.");
+                return false;
+            }
+            kernelSet.accumulate(total.data(),row.data(),total.size());
+        }
+        oFile<<m_Month[i]<<' '<<m_Day[i]<<' '<<m_Hour[i];
+        for (unsigned j=0;j<total.size();j++){
+            oFile<<' '<<total[j];
+        }
+        oFile<<'\n';
+    }
+    for (unsigned k=0;k<layers.size();k++){
+        while (layers[k]->readRow(row)){
+            if (!row.empty()){
+                STADIC_ERROR("The illuminance file "+m_Layers[k]+" has more rows than there are timesteps.");
+                return false;
+            }
+        }
+    }
+    if (!oFile.close()){
+        STADIC_ERROR("The writing of the illuminance file "+fileName+" failed.");
+        return false;
+    }
+    return true;
+}
+
+IlluminanceBlockReader::IlluminanceBlockReader() : m_Points(0)
+{
+}
+
+IlluminanceBlockReader::~IlluminanceBlockReader()
 {
-    return m_data;
+    close();
+}
+
+bool IlluminanceBlockReader::open(const std::string &fileName, const std::string &scratchFile){
+    close();
+    if (DaylightIlluminanceData::isBinaryIllFile(fileName)){
+        if (!m_Binary.parseBinary(fileName)){
+            return false;
+        }
+        m_Axis.copyTimeAxis(m_Binary);
+        m_Points=m_Binary.points();
+        return true;
+    }
+    NumericReader reader;
+    if (!reader.open(fileName)){
+        STADIC_ERROR("The opening of the illuminance file "+fileName+" could not be opened.");
+        return false;
+    }
+    std::ofstream rows(scratchFile,std::ios::binary|std::ios::trunc);
+    if (!rows.is_open()){
+        STADIC_ERROR("The opening of the scratch file "+scratchFile+" has failed.");
+        return false;
+    }
+    m_ScratchFile=scratchFile;
+    std::vector<int> month;
+    std::vector<int> day;
+    std::vector<double> hour;
+    std::vector<double> vals;
+    while (reader.readRow(vals)){
+        if (vals.empty()){
+            continue;
+        }
+        std::string problem=checkTimeBasedRow(vals);
+        if (!problem.empty()){
+            STADIC_ERROR("The illuminance file "+fileName+" "+problem+" at "+reader.position()+".");
+            close();
+            return false;
+        }
+        if (hour.empty()){
+            m_Points=vals.size()-3;
+        }else if (vals.size()-3!=m_Points){
+            STADIC_ERROR("The illuminance file "+fileName+" does not contain the same number of points on every line at "+reader.position()+".");
+            close();
+            return false;
+        }
+        month.push_back(static_cast<int>(vals[0]));
+        day.push_back(static_cast<int>(vals[1]));
+        hour.push_back(vals[2]);
+        rows.write(reinterpret_cast<const char*>(vals.data()+3),m_Points*sizeof(double));
+    }
+    if (reader.failed()){
+        STADIC_ERROR("The illuminance file "+fileName+" contains a malformed value at "+reader.position()+".");
+        close();
+        return false;
+    }
+    rows.close();
+    if (rows.fail()){
+        STADIC_ERROR("The writing of the scratch file "+scratchFile+" has failed.");
+        close();
+        return false;
+    }
+    m_Axis.setTimeAxis(month,day,hour);
+    if (m_Points>0 && !m_Rows.open(scratchFile)){
+        STADIC_ERROR("The mapping of the scratch file "+scratchFile+" has failed.");
+        close();
+        return false;
+    }
+    return true;
+}
+
+void IlluminanceBlockReader::close(){
+    m_Rows.close();
+    m_Binary=DaylightIlluminanceData();
+    m_Axis=DaylightIlluminanceData();
+    m_Points=0;
+    if (!m_ScratchFile.empty()){
+        std::remove(m_ScratchFile.c_str());
+        m_ScratchFile.clear();
+    }
+}
+
+unsigned IlluminanceBlockReader::points() const{
+    return m_Points;
+}
+
+unsigned IlluminanceBlockReader::timesteps() const{
+    return m_Axis.timesteps();
+}
+
+const DaylightIlluminanceData &IlluminanceBlockReader::timeAxis() const{
+    return m_Axis;
+}
+
+void IlluminanceBlockReader::readBlock(unsigned first, unsigned count, DaylightIlluminanceData *block) const{
+    block->copyTimeAxis(m_Axis);
+    block->resize(count);
+    unsigned steps=timesteps();
+    if (m_Rows.isOpen()){
+        const double *rows=reinterpret_cast<const double*>(m_Rows.data());
+        std::vector<double*> targets(count);
+        for (unsigned j=0;j<count;j++){
+            targets[j]=block->pointData(j);
+        }
+        for (unsigned i=0;i<steps;i++){                                         //Each row is read once, in file order
+            const double *row=rows+size_t(i)*m_Points+first;
+            for (unsigned j=0;j<count;j++){
+                targets[j][i]=row[j];
+            }
+        }
+        return;
+    }
+    for (unsigned j=0;j<count;j++){
+        double *target=block->pointData(j);
+        if (m_Binary.isSparse()){
+            for (unsigned i=0;i<steps;i++){
+                target[i]=m_Binary.lux(first+j,i);
+            }
+        }else{
+            IlluminanceView source=m_Binary.point(first+j);
+            std::copy(source.data(),source.data()+steps,target);
+        }
+    }
+}
+
+void IlluminanceBlockReader::readRow(unsigned timestep, double *row) const{
+    readRow(timestep,0,m_Points,row);
+}
+
+void IlluminanceBlockReader::readRow(unsigned timestep, unsigned first, unsigned count, double *row) const{
+    if (m_Rows.isOpen()){
+        const double *source=reinterpret_cast<const double*>(m_Rows.data())+size_t(timestep)*m_Points+first;
+        std::copy(source,source+count,row);
+        return;
+    }
+    if (m_Binary.isDark(timestep)){
+        std::fill(row,row+count,0.0);
+        return;
+    }
+    IlluminanceView source=m_Binary.timestep(timestep);
+    size_t stride=source.stride();
+    const double *values=source.data()+first*stride;
+    for (unsigned j=0;j<count;j++){
+        row[j]=values[j*stride];
+    }
 }
 
 }
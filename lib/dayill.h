@@ -34,56 +34,307 @@
 #include "stadicapi.h"
 #include <vector>
 #include <string>
+#include <memory>
+#include "filepath.h"
 
 namespace stadic {
 
-class STADIC_API TemporalIlluminance
+class MappedFile;
+
+// An IlluminanceView is a non-owning window onto a run of illuminance values
+// (in lux) held by a DaylightIlluminanceData object. A view over a point is
+// contiguous (the annual series for that point), while a view over a timestep
+// strides across the points. Views are cheap to copy and are invalidated by
+// anything that reallocates the owning object.
+class STADIC_API IlluminanceView
 {
 public:
-    TemporalIlluminance();
-    TemporalIlluminance(int month, int day, double hour, const std::vector<double> &illuminance);
-
-    bool add(std::vector<double> newIll);                                       //Function to add a vector of illuminance values to the current object
-
+    IlluminanceView();
+    IlluminanceView(const double *data, unsigned size, unsigned stride=1);
 
     //Getters
-    std::vector<double> lux();                                                  //Function that returns the temporal illuminance as a vector in lux
-    std::vector<double> fc();                                                   //Function that returns the temporal illuminance as a vector in fc
-    int month();                                                                //Function that returns the month as an int
-    int day();                                                                  //Function that returns the day as an int
-    double hour();                                                              //Function that returns the hour as a double
-    bool allZeros();                                                            //Function that returns true if all values in the illuminance vector are zero.
-    double fractionAboveTarget(double target);                                  //Function that returns the fraction of points above the target value
+    unsigned size() const;                                                      //Function that returns the number of values in the view
+    double lux(unsigned i) const;                                               //Function that returns the i-th value in lux
+    double fc(unsigned i) const;                                                //Function that returns the i-th value in fc
+    double operator[](unsigned i) const;                                        //Function that returns the i-th value in lux
+    const double *data() const;                                                 //Function that returns a pointer to the first value
+    unsigned stride() const;                                                    //Function that returns the distance between consecutive values
+    bool allZeros() const;                                                      //Function that returns true if all values in the view are zero.
+    double fractionAboveTarget(double target) const;                            //Function that returns the fraction of values above the target value
 
 private:
-    std::vector<double> m_Illuminance;                                          //Vector holding the illuminance values for a given interval
-    int m_Month;                                                                //Variable holding the month as an int
-    int m_Day;                                                                  //Variable holding the day as an int
-    double m_Hour;                                                              //Variable holding the hour as an int
+    const double *m_Data;                                                       //Pointer to the first value
+    unsigned m_Size;                                                            //Number of values in the view
+    unsigned m_Stride;                                                          //Distance between consecutive values
 };
 
-
+// DaylightIlluminanceData holds a points x timesteps matrix of illuminance
+// values (in lux) in a single contiguous allocation, stored point-major so
+// that the annual series for each point is contiguous. The time axis (month,
+// day, hour) is held separately and is shared by every point.
+//
+// Besides the text formats, the data may be stored in a binary .ill file
+// made up of a 64 byte header, the time axis and then the point-major body:
+//
+//   offset  size  field
+//        0     8  magic "STADILL\0"
+//        8     4  format version (1)
+//       12     4  byte order mark (0x01020304 as written by the host)
+//       16     4  value size in bytes (4 for float32, 8 for float64)
+//       20     4  units of the body (0 lux, 1 fc)
+//       24     8  number of points
+//       32     8  number of timesteps
+//       40     8  byte offset of the body, a multiple of 64
+//       48     8  number of stored timesteps (version 2 only)
+//       56     8  reserved, zero
+//       64        int32 month[timesteps], int32 day[timesteps],
+//                 float64 hour[timesteps], then in version 2 only
+//                 uint32 timestep[stored timesteps], padding, then the body
+//
+// Version 1 files hold every timestep. Version 2 files hold only the
+// timesteps listed after the time axis, see elideDarkTimesteps.
+//
+// A float64 body in lux is used directly from the memory mapped file without
+// being copied; anything else is converted into memory when it is read.
+//
+// Large text files are split into pieces at line boundaries that are parsed
+// on several threads (see setThreads); the result is identical to reading
+// the file on one thread.
+//
+// Around half of the timesteps in an annual result are at night, when every
+// point is zero. elideDarkTimesteps drops those timesteps from the matrix and
+// keeps an index of the ones that remain, the stored timesteps. lux() and
+// timestep() still take any timestep and return zeros for the dropped ones,
+// but a point view and pointData then only run over the stored timesteps,
+// which storedTimestep and storedMask relate back to the time axis.
 class STADIC_API DaylightIlluminanceData
 {
 public:
+    enum Units { Lux, Footcandles };
+    enum Precision { DoublePrecision, SinglePrecision };
+
     explicit DaylightIlluminanceData();
     bool parse(std::string fileName,std::string weaFile);                       //Function to parse an illuminance file that doesn't contain time values
     bool parseTimeBased(std::string fileName);                                  //Function to parse an illuminance file that contains time values
     bool addIllFile(std::string fileName);                                      //Function to add the illuminance of a file that doesn't contain time values to the object
     bool addTimeBasedIll(std::string fileName);                                 //Function to add the illuminance of a file that contains time values to the object
-    bool writeIllFileLux(std::string fileName);                                    //Function to write the illuminance file in lux
+    bool writeIllFileLux(std::string fileName);                                 //Function to write the illuminance file in lux
     bool writeIllFileFC(std::string fileName);                                  //Function to write the illuminance file in fc
-    void addDataPoint(TemporalIlluminance dataPoint);
+    bool parseBinary(std::string fileName);                                     //Function to map a binary illuminance file
+    bool writeIllFileBinary(std::string fileName, Units units=Lux, Precision precision=DoublePrecision);    //Function to write a binary illuminance file
+    static bool isBinaryIllFile(std::string fileName);                          //Function that returns true if the file starts with the binary header
+
+    //Setters
+    void setTimeAxis(const std::vector<int> &month, const std::vector<int> &day, const std::vector<double> &hour);   //Function to set the time axis, clearing any illuminance values
+    void copyTimeAxis(const DaylightIlluminanceData &other);                    //Function to set the time axis to that of another object, clearing any illuminance values
+    void resize(unsigned points);                                               //Function to allocate a zeroed matrix for the given number of points over the time axis
+    double *pointData(unsigned point);                                          //Function that returns a writable pointer to the annual series of a point
+    void setThreads(unsigned threads);                                          //Function to set the number of threads used to parse text files, 0 uses all of them
+    void elideDarkTimesteps();                                                  //Function to drop the timesteps at which every point is zero
+    void restoreDarkTimesteps();                                                //Function to store every timestep again
+
     //Getters
-    std::vector<TemporalIlluminance> illuminance() const;                             //Function that returns the illuminance values in a vector
+    unsigned threads() const;                                                   //Function that returns the number of threads used to parse text files
+    unsigned points() const;                                                    //Function that returns the number of points
+    unsigned timesteps() const;                                                 //Function that returns the number of timesteps
+    bool isSparse() const;                                                      //Function that returns true if dark timesteps have been dropped
+    bool isDark(unsigned timestep) const;                                       //Function that returns true if a timestep has been dropped as dark
+    unsigned storedTimesteps() const;                                           //Function that returns the number of timesteps held in the matrix
+    unsigned storedTimestep(unsigned column) const;                             //Function that returns the timestep of a column of the matrix
+    std::vector<unsigned char> storedMask(const std::vector<unsigned char> &mask) const;  //Function that reduces a mask over every timestep to the stored timesteps
+    int month(unsigned timestep) const;                                         //Function that returns the month of a timestep
+    int day(unsigned timestep) const;                                           //Function that returns the day of a timestep
+    double hour(unsigned timestep) const;                                       //Function that returns the hour of a timestep
+    double lux(unsigned point, unsigned timestep) const;                        //Function that returns a single value in lux
+    IlluminanceView point(unsigned point) const;                                //Function that returns a view of one point over all timesteps
+    IlluminanceView timestep(unsigned timestep) const;                          //Function that returns a view of all points at one timestep
+
+private:
+    bool parseChunks(const std::string &fileName, unsigned threads);            //Function to parse a file without time values on several threads
+    bool parseTimeBasedChunks(const std::string &fileName, unsigned threads);   //Function to parse a file with time values on several threads
+    bool setFromRows(const std::vector<double> &rows, unsigned points);         //Function to fill the matrix from timestep-major rows
+    bool addData(const DaylightIlluminanceData &other);                         //Function to add the values of a matching object to this one
+    void detach();                                                              //Function to copy mapped values into memory before they are modified
+    const double *values() const;                                               //Function that returns a pointer to the first value of the matrix
+    void clearDarkIndex();                                                      //Function to forget which timesteps were dropped
+    bool writeIllFile(const std::string &fileName, double divisor);             //Function to write a time based text file with the values divided by divisor
+
+    std::vector<int> m_Month;                                                   //Vector holding the month per timestep
+    std::vector<int> m_Day;                                                     //Vector holding the day per timestep
+    std::vector<double> m_Hour;                                                 //Vector holding the hour per timestep
+    unsigned m_Points;                                                          //Variable holding the number of points
+    std::vector<double> m_Data;                                                 //Vector holding the illuminance values, point-major
+    std::shared_ptr<MappedFile> m_Mapped;                                       //Binary file the values are read from, shared between copies
+    const double *m_MappedValues;                                               //Pointer to the first value within the mapped file
+    unsigned m_Threads;                                                         //Number of threads used to parse text files, 0 for all of them
+    bool m_Sparse;                                                              //True if only the timesteps in m_Lit are stored
+    std::vector<unsigned> m_Lit;                                                //Vector holding the timestep of each stored column
+    std::vector<int> m_Column;                                                  //Vector holding the stored column of each timestep, -1 if dropped
+    std::vector<double> m_DarkColumn;                                           //Vector of zeros viewed for a dropped timestep
+
+};
+
+// An IlluminanceMerger sums the intermediate illuminance files for one window
+// group setting and writes the result as a time based .ill file. The first
+// input may be a point-major file (one value per line, every timestep of the
+// first point, then of the second, ...), and any number of layer files with a
+// row of point values per timestep may be added to it. The output is written
+// a timestep at a time while the inputs are read in lockstep, so only a
+// single row of values is ever held in memory.
+class STADIC_API IlluminanceMerger
+{
+public:
+    explicit IlluminanceMerger();
+    void setTimeAxis(const std::vector<int> &month, const std::vector<int> &day, const std::vector<double> &hour);   //Function to set the time axis of the output
+    void setPointMajorInput(const std::string &fileName);                       //Function to set the point-major file that the layers are added to
+    void addLayer(const std::string &fileName);                                 //Function to add a file with a row of values per timestep
+    void clearInputs();                                                         //Function to remove all of the inputs, keeping the time axis
+    bool write(const std::string &fileName);                                    //Function to sum the inputs and write the time based .ill file
+
+private:
+    std::vector<int> m_Month;                                                   //Vector holding the month per timestep
+    std::vector<int> m_Day;                                                     //Vector holding the day per timestep
+    std::vector<double> m_Hour;                                                 //Vector holding the hour per timestep
+    std::string m_PointMajorFile;                                               //Point-major input, empty if there is none
+    std::vector<std::string> m_Layers;                                          //Inputs with a row per timestep
+
+};
 
-    //int hoursGreaterThan(double value, int point);
+// An IlluminanceBlockReader reads an annual illuminance file a block of
+// points at a time, for grids whose whole matrix would not fit in memory. A
+// binary file is mapped and read where it lies. A time based text file is
+// parsed once into a scratch file of binary rows (the values of every point
+// at one timestep, timestep after timestep) which is then mapped. Either way
+// a block of points is copied out into a DaylightIlluminanceData of its own,
+// and the values of one timestep can be read as a row, so what is held in
+// memory grows with the size of the block rather than with the file. The
+// scratch file is removed when the reader is closed.
+class STADIC_API IlluminanceBlockReader
+{
+public:
+    explicit IlluminanceBlockReader();
+    ~IlluminanceBlockReader();
+    bool open(const std::string &fileName, const std::string &scratchFile);     //Function to open an illuminance file, converting a text file into scratchFile
+    void close();                                                               //Function to release the file and remove the scratch file
+    unsigned points() const;                                                    //Function that returns the number of points
+    unsigned timesteps() const;                                                 //Function that returns the number of timesteps
+    const DaylightIlluminanceData &timeAxis() const;                            //Function that returns an object holding the time axis and no points
+    void readBlock(unsigned first, unsigned count, DaylightIlluminanceData *block) const;  //Function to copy the points [first, first+count) into block
+    void readRow(unsigned timestep, double *row) const;                         //Function to copy the values of every point at one timestep into row
+    void readRow(unsigned timestep, unsigned first, unsigned count, double *row) const;    //Function to copy the values of the points [first, first+count) at one timestep into row
 
 private:
-    std::vector<TemporalIlluminance> m_data;                                    //Vector holding the illuminance values
+    IlluminanceBlockReader(const IlluminanceBlockReader&);
+    IlluminanceBlockReader &operator=(const IlluminanceBlockReader&);
+
+    DaylightIlluminanceData m_Axis;                                             //Time axis of the file
+    DaylightIlluminanceData m_Binary;                                           //Mapped binary file, if the file is binary
+    MappedFile m_Rows;                                                          //Mapped scratch file, if the file is text
+    std::string m_ScratchFile;                                                  //Scratch file to remove on closing, empty if there is none
+    unsigned m_Points;
 
 };
 
+inline IlluminanceView::IlluminanceView() : m_Data(nullptr), m_Size(0), m_Stride(1)
+{
+}
+
+inline IlluminanceView::IlluminanceView(const double *data, unsigned size, unsigned stride)
+    : m_Data(data), m_Size(size), m_Stride(stride)
+{
+}
+
+inline unsigned IlluminanceView::size() const
+{
+    return m_Size;
+}
+
+inline double IlluminanceView::lux(unsigned i) const
+{
+    return m_Data[size_t(i)*m_Stride];
+}
+
+inline double IlluminanceView::fc(unsigned i) const
+{
+    return m_Data[size_t(i)*m_Stride]/10.764;
+}
+
+inline double IlluminanceView::operator[](unsigned i) const
+{
+    return m_Data[size_t(i)*m_Stride];
+}
+
+inline const double *IlluminanceView::data() const
+{
+    return m_Data;
+}
+
+inline unsigned IlluminanceView::stride() const
+{
+    return m_Stride;
+}
+
+inline unsigned DaylightIlluminanceData::points() const
+{
+    return m_Points;
+}
+
+inline unsigned DaylightIlluminanceData::timesteps() const
+{
+    return m_Hour.size();
+}
+
+inline bool DaylightIlluminanceData::isSparse() const
+{
+    return m_Sparse;
+}
+
+inline bool DaylightIlluminanceData::isDark(unsigned timestep) const
+{
+    return m_Sparse && m_Column[timestep]<0;
+}
+
+inline unsigned DaylightIlluminanceData::storedTimesteps() const
+{
+    return m_Sparse ? m_Lit.size() : m_Hour.size();
+}
+
+inline unsigned DaylightIlluminanceData::storedTimestep(unsigned column) const
+{
+    return m_Sparse ? m_Lit[column] : column;
+}
+
+inline const double *DaylightIlluminanceData::values() const
+{
+    return m_Mapped ? m_MappedValues : m_Data.data();
+}
+
+inline double DaylightIlluminanceData::lux(unsigned point, unsigned timestep) const
+{
+    if (m_Sparse){
+        int column=m_Column[timestep];
+        return column<0 ? 0 : values()[size_t(point)*m_Lit.size()+column];
+    }
+    return values()[size_t(point)*m_Hour.size()+timestep];
+}
+
+inline IlluminanceView DaylightIlluminanceData::point(unsigned point) const
+{
+    return IlluminanceView(values()+size_t(point)*storedTimesteps(), storedTimesteps());
+}
+
+inline IlluminanceView DaylightIlluminanceData::timestep(unsigned timestep) const
+{
+    if (m_Sparse){
+        int column=m_Column[timestep];
+        if (column<0){
+            return IlluminanceView(m_DarkColumn.data(), m_Points);
+        }
+        return IlluminanceView(values()+column, m_Points, m_Lit.size());
+    }
+    return IlluminanceView(values()+timestep, m_Points, m_Hour.size());
+}
+
 }
 
 #endif // DAYILL_H
@@ -33,7 +33,11 @@
 #include "dayill.h"
 #include "filepath.h"
 #include "stadicprocess.h"
+#include "taskgraph.h"
+#include "skymatrixcache.h"
+#include "parallel.h"
 #include <fstream>
+#include <cstdio>
 #include "materialprimitives.h"
 #include "gridmaker.h"
 #include "weatherdata.h"
@@ -41,12 +45,22 @@
 
 namespace stadic {
 Daylight::Daylight(BuildingControl *model) :
-    m_Model(model)
+    m_Model(model), m_Threads(0)
 {
 }
 
 bool Daylight::simDaylight()
 {
+    //The weather file sets the number of timesteps of every matrix multiplication
+    if (!m_Model->weaDataFile()){
+        STADIC_LOG(Severity::Error, "The weather file needed for running the simulation does not exist.");
+        return false;
+    }
+    std::shared_ptr<const WeatherData> weather=WeatherCache::weatherData(m_Model->weaDataFile().get());
+    if (!weather){
+        return false;
+    }
+    m_Timesteps=toString(weather->timesteps());
     std::vector<std::shared_ptr<Control>> spaces=m_Model->spaces();
     for (int i=0;i<spaces.size();i++){
         //Set up the directories if they do not already exist
@@ -93,54 +107,108 @@ bool Daylight::simDaylight()
         if (!createBaseRadFiles(spaces[i].get())){
             return false;
         }
-        //Configure the simulation for each window group
-        for (int j=0;j<spaces[i].get()->windowGroups().size();j++){
-            switch (m_SimCase[j]){
-                case 1:
-                    if (!simCase1(j,spaces[i].get())){
-                        return false;
-                    }
-                    break;
-                case 2:
-                    if (!simCase2(j, spaces[i].get())){
-                        return false;
-                    }
-                    break;
-                case 3:
-                    //Simulation case 3 will be for window groups that contain BSDFs even in the base case, but the glazing layers are not BSDFs
-                    if(!simCase3(j,spaces[i].get())){
-                        return false;
-                    }
-                    break;
-                case 4:
-                    //Simulation case 4 will be for window groups that have shade materials in addition to the glazing layer
-                    if (!simCase4(j,spaces[i].get())){
-                        return false;
-                    }
-                    break;
-                case 5:
-                    //Simulation case 5 will be for window groups that have added geometry, but it is a proxy geometry
-                    if (!simCase5(j,spaces[i].get())){
-                        return false;
-                    }
-                    break;
-                case 6:
-                    //Simulation case 6 will be for window groups that only have the glazing layer as a BSDF
-                    if (!simCase6(j,spaces[i].get())){
-                        return false;
-                    }
-                    break;
+        if (!writeWea(spaces[i].get())){
+            return false;
+        }
+        if (!preparePoints(spaces[i].get())){
+            return false;
+        }
 
+        //The window groups only share the suns and are summed once they are all done
+        Control *space=spaces[i].get();
+        std::string sunsRad=space->spaceDirectory()+space->intermediateDataDirectory()+space->spaceName()+"_suns_m"+std::to_string(space->sunDivisions())+".rad";
+        TaskGraph graph;
+        graph.setCancelOnFailure(true);
+        graph.addTask("suns",std::vector<std::string>(),std::vector<std::string>(1,sunsRad),[this,space](){return writeSunsRad(space);});
+        std::vector<std::string> groupInputs(1,sunsRad);
+        if (m_WeaFileName){
+            groupInputs.push_back(m_WeaFileName.get());
+        }
+        //Each shade setting of a window group is its own task, named by the files it writes
+        std::vector<std::string> groupResults;
+        for (int j=0;j<space->windowGroups().size();j++){
+            unsigned baseTask=0;
+            for (int setting=-1;setting<int(space->windowGroups()[j].shadeSettingGeometry().size());setting++){
+                std::vector<std::string> results;
+                for (const IlluminanceSum &sum : illuminanceSums(j,setting,space)){
+                    results.push_back(sum.standard);
+                    results.insert(results.end(),sum.layers.begin(),sum.layers.end());
+                }
+                groupResults.insert(groupResults.end(),results.begin(),results.end());
+                std::string name=space->windowGroups()[j].name()+(setting<0 ? "" : " setting "+std::to_string(setting+1));
+                unsigned task=graph.addTask(name,groupInputs,results,[this,j,setting,space](){return simWindowGroup(j,setting,space);});
+                if (setting<0){
+                    baseTask=task;
+                }else if (m_SimCase[j]==6){
+                    //The settings of case 6 reuse the matrices and octree of the base simulation
+                    graph.addDependency(task,baseTask);
+                }
             }
         }
-        if(!sumIlluminanceFiles(spaces[i].get())){
+        graph.addTask("sum",groupResults,std::vector<std::string>(),[this,space](){return sumIlluminanceFiles(space);});
+
+        //The running limit keeps the programs started by the tasks within the jobs as well
+        unsigned maxRunning=Process::maxRunning();
+        Process::setMaxRunning(resolveThreads(m_Threads));
+        bool success=graph.run(m_Threads);
+        Process::setMaxRunning(maxRunning);
+        if (!success){
+            for (unsigned j=0;j<graph.size();j++){
+                if (graph.state(j)==TaskGraph::Failed){
+                    STADIC_ERROR("The simulation of "+graph.name(j)+" has failed for "+space->spaceName()+"."+(graph.error(j).empty() ? "" : "\n"+graph.error(j)));
+                }
+            }
             return false;
         }
     }
     return true;
 }
 
+void Daylight::setThreads(unsigned threads){
+    m_Threads=threads;
+}
+
 //Private
+bool Daylight::simWindowGroup(int blindGroupNum, int setting, Control *model){
+    switch (m_SimCase[blindGroupNum]){
+        case 1:
+            if (!simCase1(blindGroupNum,setting,model)){
+                return false;
+            }
+            break;
+        case 2:
+            if (!simCase2(blindGroupNum,setting,model)){
+                return false;
+            }
+            break;
+        case 3:
+            //Simulation case 3 will be for window groups that contain BSDFs even in the base case, but the glazing layers are not BSDFs
+            if(!simCase3(blindGroupNum,setting,model)){
+                return false;
+            }
+            break;
+        case 4:
+            //Simulation case 4 will be for window groups that have shade materials in addition to the glazing layer
+            if (!simCase4(blindGroupNum,setting,model)){
+                return false;
+            }
+            break;
+        case 5:
+            //Simulation case 5 will be for window groups that have added geometry, but it is a proxy geometry
+            if (!simCase5(blindGroupNum,setting,model)){
+                return false;
+            }
+            break;
+        case 6:
+            //Simulation case 6 will be for window groups that only have the glazing layer as a BSDF
+            if (!simCase6(blindGroupNum,setting,model)){
+                return false;
+            }
+            break;
+    }
+    return true;
+}
+
 bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string bsdfRad,std::string remainingRad, std::vector<double> normal, std::string thickness, std::string bsdfXML, std::string bsdfLayer, Control *model){
     std::string mainFileName;
     if (setting==-1){
@@ -184,53 +252,7 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
         return false;
     }
 
-    //Create Suns
-    int nSuns;
-    if(model->sunDivisions()==1){
-        nSuns=145;
-    }else if (model->sunDivisions()==2){
-        nSuns=577;
-    }else if (model->sunDivisions()==3){
-        nSuns=1297;
-    }else if (model->sunDivisions()==4){
-        nSuns=2305;
-    }else if (model->sunDivisions()==5){
-        nSuns=3601;
-    }else if (model->sunDivisions()==6){
-        nSuns=5185;
-    }
-
-    std::string tempFile=model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad";
-    if(!isFile(tempFile)){
-        arguments.clear();
-        arguments.push_back(std::to_string(nSuns));
-        std::string cntProgram="cnt";
-        Process cnt(cntProgram,arguments);
-
-        std::vector<std::string> arguments2;
-        arguments2.push_back("-e");
-        arguments2.push_back("MF:"+std::to_string(model->sunDivisions()));
-        arguments2.push_back("-f");
-        arguments2.push_back("reinsrc.cal");
-        arguments2.push_back("-e");
-        arguments2.push_back("Rbin=recno");
-        arguments2.push_back("-o");
-        arguments2.push_back("\"solar source sun 0 0 4 ${ Dx } ${ Dy } ${ Dz } 0.533\"");
-        std::string rcalcProgram="rcalc";
-        Process rcalc(rcalcProgram,arguments2);
-
-        cnt.setStandardOutputProcess(&rcalc);
-        rcalc.setStandardOutputFile(model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad");
-        cnt.start();
-        rcalc.start();
-
-        if(!rcalc.wait()){
-            STADIC_ERROR("The running of rcalc for the suns has failed.");
-            //I want to display the errors here if the standard error has any errors to show.
-            return false;
-        }
-    }
-
+    //The suns are written by writeSunsRad before any window group is simulated
     //Create suns octree
     std::string sunsOct;
     files.clear();
@@ -266,7 +288,8 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
     arguments.push_back(mainOct);
     std::string rcontribProgram="rcontrib";
 
-    Process rcontrib(rcontribProgram,arguments);
+    PartitionedProcess rcontrib(rcontribProgram,arguments);
+    rcontrib.setMaxPartitions(m_Threads);
 
     std::string vmx=mainFileName+"_3PH.vmx";
     rcontrib.setStandardOutputFile(vmx);
@@ -322,26 +345,11 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
         return false;
     }
 
-    //Compute S Matrix
-    //gendaymtx
-    arguments.clear();
-    arguments.push_back("MF:"+std::to_string(model->skyDivisions()));
-    if (m_Model->buildingRotation() && m_Model->buildingRotation().get()!=0){
-        arguments.push_back("-r");
-        arguments.push_back(std::to_string((-1)*m_Model->buildingRotation().get()));
-    }
-    arguments.push_back("-c");
-    arguments.push_back("1");
-    arguments.push_back("1");
-    arguments.push_back("1");
-    arguments.push_back(m_Model->weaDataFile().get());
-    std::string gendaymtxProgram="gendaymtx";
-    Process gendaymtx(gendaymtxProgram,arguments);
-    std::string smx=mainFileName+"_3PH.smx";
-    gendaymtx.setStandardOutputFile(smx);
-    gendaymtx.start();
-    if (!gendaymtx.wait()){
-        STADIC_ERROR("The gendaymtx run for the smx has failed with the following errors.");        //I want to display the errors here if the standard error has any errors to show.
+    //Compute S Matrix, Sd Matrix and Ssun Matrix
+    std::string smx;
+    std::string dirSMX;
+    std::string dir5PHsmx;
+    if (!bsdfSkyMatrices(model,smx,dirSMX,dir5PHsmx)){
         return false;
     }
 
@@ -406,7 +414,8 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
         STADIC_LOG(Severity::Fatal, "The vmx parameter set is not found for " + model->spaceName());
     }
     arguments.push_back(blackOct);
-    Process rcontrib4(rcontribProgram,arguments);
+    PartitionedProcess rcontrib4(rcontribProgram,arguments);
+    rcontrib4.setMaxPartitions(m_Threads);
     std::string dirVMX=mainFileName+"_3Dir.vmx";
     rcontrib4.setStandardOutputFile(dirVMX);
     rcontrib4.setStandardInputFile(model->inputDirectory()+model->ptsFile()[0]);
@@ -418,47 +427,6 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
         return false;
     }
 
-    //Compute Sd Matrix
-    //gendaymtx
-    arguments.clear();
-    arguments.push_back("MF:"+std::to_string(model->skyDivisions()));
-    if (m_Model->buildingRotation() && m_Model->buildingRotation().get()!=0){
-        arguments.push_back("-r");
-        arguments.push_back(std::to_string((-1)*m_Model->buildingRotation().get()));
-    }
-    arguments.push_back("-d");
-    arguments.push_back(m_Model->weaDataFile().get());
-    Process gendaymtx2(gendaymtxProgram,arguments);
-    std::string dirSMX=mainFileName+"_3DIR.smx";
-    gendaymtx2.setStandardOutputFile(dirSMX);
-    gendaymtx2.start();
-    if (!gendaymtx2.wait()){
-        STADIC_ERROR("The gendaymtx run for the direct smx has failed with the following errors.");
-        //I want to display the errors here if the standard error has any errors to show.
-        return false;
-    }
-
-    //Compute Ssun Matrix
-    //gendaymtx
-    arguments.clear();
-    arguments.push_back("MF:"+std::to_string(model->sunDivisions()));
-    if (m_Model->buildingRotation() && m_Model->buildingRotation().get()!=0){
-        arguments.push_back("-r");
-        arguments.push_back(std::to_string((-1)*m_Model->buildingRotation().get()));
-    }
-    arguments.push_back("-5");
-    arguments.push_back("-d");
-    arguments.push_back(m_Model->weaDataFile().get());
-    Process gendaymtx3(gendaymtxProgram,arguments);
-    std::string dir5PHsmx=mainFileName+"_5PH.smx";
-    gendaymtx3.setStandardOutputFile(dir5PHsmx);
-    gendaymtx3.start();
-    if (!gendaymtx3.wait()){
-        STADIC_ERROR("The gendaymtx run for the direct 5 phase smx has failed with the following errors.");
-        //I want to display the errors here if the standard error has any errors to show.
-        return false;
-    }
-
     //Compute DCsun matrix
     //rcontrib
     arguments.clear();
@@ -484,7 +452,8 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
     arguments.push_back("solar");
     arguments.push_back(sunsOct);
     std::string dirDSMX=mainFileName+"_5PH.dsmx";
-    Process rcontrib5(rcontribProgram,arguments);
+    PartitionedProcess rcontrib5(rcontribProgram,arguments);
+    rcontrib5.setMaxPartitions(m_Threads);
     rcontrib5.setStandardOutputFile(dirDSMX);
     rcontrib5.setStandardInputFile(model->inputDirectory()+model->ptsFile()[0]);
 
@@ -499,7 +468,7 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
     //dctimestep | rcollate
     arguments.clear();
     arguments.push_back("-n");
-    arguments.push_back("8760");
+    arguments.push_back(m_Timesteps);
     arguments.push_back(vmx);
     arguments.push_back(bsdfXML);
     arguments.push_back(dmx);
@@ -533,7 +502,7 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
     //dctimestep | rcollate
     arguments.clear();
     arguments.push_back("-n");
-    arguments.push_back("8760");
+    arguments.push_back(m_Timesteps);
     arguments.push_back(dirVMX);
     arguments.push_back(bsdfXML);
     arguments.push_back(dirDMX);
@@ -565,7 +534,7 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
     //dctimestep | rcollate
     arguments.clear();
     arguments.push_back("-n");
-    arguments.push_back("8760");
+    arguments.push_back(m_Timesteps);
     arguments.push_back(dirDSMX);
     arguments.push_back(dir5PHsmx);
     Process dctimestep3(dctimestepProgram,arguments);
@@ -615,7 +584,7 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
     arguments3.push_back("-h");
     arguments3.push_back("-fa");
     arguments3.push_back("-or");
-    arguments3.push_back("8760");
+    arguments3.push_back(m_Timesteps);
     arguments3.push_back("-t");
     Process rcollate4(rcollateProgram,arguments3);
     rcalc.setStandardOutputProcess(&rcollate4);
@@ -634,49 +603,70 @@ bool Daylight::simBSDF(int blindGroupNum, int setting, int bsdfNum, std::string
   return true;
 }
 
+bool Daylight::bsdfSkyMatrices(Control *model, std::string &smx, std::string &dirSMX, std::string &dir5PHsmx){
+    //S Matrix
+    std::vector<std::string> arguments;
+    arguments.push_back("MF:"+std::to_string(model->skyDivisions()));
+    if (m_Model->buildingRotation() && m_Model->buildingRotation().get()!=0){
+        arguments.push_back("-r");
+        arguments.push_back(std::to_string((-1)*m_Model->buildingRotation().get()));
+    }
+    arguments.push_back("-c");
+    arguments.push_back("1");
+    arguments.push_back("1");
+    arguments.push_back("1");
+    arguments.push_back(m_Model->weaDataFile().get());
+    smx=m_SkyMatrices.matrix(m_SkyMatrixPrefix+"_3PH",arguments);
+
+    //Sd Matrix
+    arguments.clear();
+    arguments.push_back("MF:"+std::to_string(model->skyDivisions()));
+    if (m_Model->buildingRotation() && m_Model->buildingRotation().get()!=0){
+        arguments.push_back("-r");
+        arguments.push_back(std::to_string((-1)*m_Model->buildingRotation().get()));
+    }
+    arguments.push_back("-d");
+    arguments.push_back(m_Model->weaDataFile().get());
+    dirSMX=m_SkyMatrices.matrix(m_SkyMatrixPrefix+"_3DIR",arguments);
+
+    //Ssun Matrix
+    arguments.clear();
+    arguments.push_back("MF:"+std::to_string(model->sunDivisions()));
+    if (m_Model->buildingRotation() && m_Model->buildingRotation().get()!=0){
+        arguments.push_back("-r");
+        arguments.push_back(std::to_string((-1)*m_Model->buildingRotation().get()));
+    }
+    arguments.push_back("-5");
+    arguments.push_back("-d");
+    arguments.push_back(m_Model->weaDataFile().get());
+    dir5PHsmx=m_SkyMatrices.matrix(m_SkyMatrixPrefix+"_5PH",arguments);
+
+    if (!m_SkyMatrices.wait(smx)){
+        STADIC_ERROR("The gendaymtx run for the smx has failed with the following errors.\n"+m_SkyMatrices.error(smx));
+        return false;
+    }
+    if (!m_SkyMatrices.wait(dirSMX)){
+        STADIC_ERROR("The gendaymtx run for the direct smx has failed with the following errors.\n"+m_SkyMatrices.error(dirSMX));
+        return false;
+    }
+    if (!m_SkyMatrices.wait(dir5PHsmx)){
+        STADIC_ERROR("The gendaymtx run for the direct 5 phase smx has failed with the following errors.\n"+m_SkyMatrices.error(dir5PHsmx));
+        return false;
+    }
+    return true;
+}
+
 bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
     bool writeCL=true;
     std::ofstream outCL;
-    outCL.open(model->spaceDirectory()+"commandLine.bat");
-    //Get number of suns
-    int nSuns;
-    if(model->sunDivisions()==1){
-        nSuns=145;
-    }else if (model->sunDivisions()==2){
-        nSuns=577;
-    }else if (model->sunDivisions()==3){
-        nSuns=1297;
-    }else if (model->sunDivisions()==4){
-        nSuns=2305;
-    }else if (model->sunDivisions()==5){
-        nSuns=3601;
-    }else if (model->sunDivisions()==6){
-        nSuns=5185;
+    //Each window group setting keeps its own list since the window groups are simulated at the same time
+    if (setting==-1){
+        outCL.open(model->spaceDirectory()+"commandLine_"+model->windowGroups()[blindGroupNum].name()+"_base.bat");
+    }else{
+        outCL.open(model->spaceDirectory()+"commandLine_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+".bat");
     }
-    //Generate Weather file if it hasn't been generated already.
-    if (!m_WeaFileName){
-        WeatherData tmpWeather;
-        if (m_Model->weaDataFile()){
-            if (!tmpWeather.parseWeather(m_Model->weaDataFile().get())){
-                return false;
-            }
-            std::string tmpWeaFileName;
-            tmpWeaFileName=model->spaceDirectory()+model->inputDirectory()+tmpWeather.place()+".wea";
-            std::vector<std::string> placeArgs;
-            placeArgs=trimmedSplit(tmpWeaFileName, ' ');
-            tmpWeaFileName.clear();
-            for (int i=0;i<placeArgs.size();i++){
-                tmpWeaFileName=tmpWeaFileName+placeArgs.at(i);
-            }
-            m_WeaFileName=tmpWeaFileName;
-            if (!tmpWeather.writeWea(m_WeaFileName.get())){
-                STADIC_LOG(stadic::Severity::Error, "The creation of the .wea file failed.");
-                return false;
-            }
-        }else{
-            STADIC_LOG(stadic::Severity::Error, "The weather file needed for running the simulation does not exist.");
-            return false;
-        }
+    if (!writeWea(model)){
+        return false;
     }
     std::vector<std::string> arguments;
     std::string skyDC;
@@ -687,6 +677,30 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
     std::string sunPatchSMX;
     std::string sensorSkyDC;
     std::string sensorSunDC;
+    //Create suns octree
+    std::vector<std::string> octFiles;
+    std::string sunsOct;
+    if (setting==-1){
+        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_base.rad");
+        //Added the next line because oconv produced a fatal error with undefined modifier "solar" without it.
+        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns.rad");
+        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad");
+        sunsOct=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_sun_base.oct";
+
+    }else{
+        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_std.rad");
+        //Added the next line because oconv produced a fatal error with undefined modifier "solar" without it.
+        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns.rad");
+        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad");
+        sunsOct=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_sun_set"+std::to_string(setting+1)+"_std.oct";
+
+    }
+    if(!createOctree(octFiles,sunsOct)){
+        return false;
+    }
+    if (writeCL){
+        outCL<<"## Create the suns octree here"<<std::endl<<std::endl;;
+    }
     if ((setting==-1 && model->windowGroups()[blindGroupNum].runBase())||(setting>=0 && model->windowGroups()[blindGroupNum].runSetting()[setting])){
         //rcontrib for sky
         arguments.push_back("-I+");
@@ -732,134 +746,29 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
             arguments.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_std.oct");
             skyDC=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_1k_std.dc";
         }
-        Process rcontrib(rcontribProgram,arguments);
+        PartitionedProcess rcontrib(rcontribProgram,arguments);
+        rcontrib.setMaxPartitions(m_Threads);
         rcontrib.setStandardOutputFile(skyDC);
 
-        //Test whether the points file exists.  If it doesn't, test whether the necessary arguments to create one exist.
-        if (stadic::exists(model->spaceDirectory()+model->inputDirectory()+model->ptsFile()[0])){
-            rcontrib.setStandardInputFile(model->spaceDirectory()+model->inputDirectory()+model->ptsFile()[0]);
-        }else{
-            if (model->xSpacing()&&model->ySpacing()&& model->offset() && model->zOffset()&& (model->modifiers()||model->identifiers())){
-                STADIC_LOG(stadic::Severity::Info, "The points file "+model->ptsFile()[0] + " does not exist.  The creation of a new points file will be attempted.");
-                GridMaker ptsCreator(model->spaceDirectory()+model->geoDirectory()+ model->geoFile());
-                ptsCreator.setSpaceX(toDouble(model->xSpacing().get()));
-                ptsCreator.setSpaceY(toDouble(model->ySpacing().get()));
-                ptsCreator.setOffset(toDouble(model->offset().get()));
-                ptsCreator.setOffsetZ(toDouble(model->zOffset().get()));
-                if (model->modifiers()){
-                    ptsCreator.setLayerNames(model->modifiers().get());
-                }else{
-                    ptsCreator.setIdentifiers(model->identifiers().get());
-                }
-                if (ptsCreator.makeGrid()){
-                    if (!ptsCreator.writePTS(model->spaceDirectory()+model->inputDirectory()+model->spaceName()+"_AutoGen.pts")){
-                        STADIC_LOG(stadic::Severity::Error, "The writing of the points file has failed.");
-                        return false;
-                    }
-                    std::vector<std::string> ptsFiles;
-                    ptsFiles.push_back(model->spaceName()+"_AutoGen.pts");
-                    model->setPTSFile(ptsFiles);
-                }else{
-                    STADIC_LOG(stadic::Severity::Error, "The creation of the points file has failed.");
-                    return false;
-                }
-            }else{
-                STADIC_LOG(stadic::Severity::Info, "The points file "+model->ptsFile()[0] + " does not exist.  And no arguments exist for one to be generated.");
-                return false;
-            }
-            rcontrib.setStandardInputFile(model->spaceDirectory()+model->inputDirectory()+model->ptsFile()[0]);
-            STADIC_LOG(stadic::Severity::Info, "A new points file has been successfully generated.");
-        }
+        rcontrib.setStandardInputFile(model->spaceDirectory()+model->inputDirectory()+model->ptsFile()[0]);
         if (writeCL){
             outCL<<rcontrib.commandLine()<<std::endl<<std::endl;;
         }
 
-        rcontrib.start();
-        if (!rcontrib.wait()){
-            STADIC_ERROR("The rcontrib run for the sky has failed with the following errors.");
-            //I want to display the errors here if the standard error has any errors to show.
-            STADIC_LOG(stadic::Severity::Info, "The command line entry is as follows:\n\t"+rcontrib.commandLine());
-            return false;
-        }
-
-
-        std::string tempFile=model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad";
-        if(!isFile(tempFile)){
-            arguments.clear();
-            arguments.push_back(std::to_string(nSuns));
-            std::string cntProgram="cnt";
-            Process cnt(cntProgram,arguments);
-
-            std::vector<std::string> arguments2;
-            arguments2.push_back("-e");
-            arguments2.push_back("MF:"+std::to_string(model->sunDivisions()));
-            arguments2.push_back("-f");
-            arguments2.push_back("reinsrc.cal");
-            arguments2.push_back("-e");
-            arguments2.push_back("Rbin=recno");
-            arguments2.push_back("-o");
-            arguments2.push_back("\"solar source sun 0 0 4 ${ Dx } ${ Dy } ${ Dz } 0.533\"");
-            std::string rcalcProgram="rcalc";
-            Process rcalc(rcalcProgram,arguments2);
-            cnt.setStandardOutputProcess(&rcalc);
-            rcalc.setStandardOutputFile(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad");
-            if (writeCL){
-                //outCL<<"## Pipe the next two lines together."<<std::endl;
-                outCL<<cnt.commandLine()<<std::endl<<std::endl;;
-            }
-
-            cnt.start();
-            rcalc.start();
 
-            if(!rcalc.wait()){
-                STADIC_LOG(Severity::Error, "The running of rcalc for the suns has failed.");
-                //I want to display the errors here if the standard error has any errors to show.
-                PathName badFile(tempFile);
-                if (!badFile.remove()){
-                    STADIC_LOG(Severity::Error, "The deletion of the file "+tempFile+" has failed.  Please manually delete this file.");
+        //rcontrib for sun
+        arguments.clear();
+        arguments.push_back("-I+");
+        if (model->getParamSet("default")){
+            std::unordered_map<std::string, std::string> tempMap=model->getParamSet("default").get();
+            for (std::unordered_map<std::string, std::string>::iterator it=tempMap.begin(); it!=tempMap.end();++it){
+                if (it->first!="sj"){
+                    arguments.push_back("-"+it->first);
+                    arguments.push_back(it->second);
                 }
-                return false;
             }
-        }
-    }
-    //Create suns octree
-    std::vector<std::string> octFiles;
-    std::string sunsOct;
-    if (setting==-1){
-        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_base.rad");
-        //Added the next line because oconv produced a fatal error with undefined modifier "solar" without it.
-        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns.rad");
-        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad");
-        sunsOct=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_sun_base.oct";
-
-    }else{
-        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_std.rad");
-        //Added the next line because oconv produced a fatal error with undefined modifier "solar" without it.
-        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns.rad");
-        octFiles.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad");
-        sunsOct=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_sun_set"+std::to_string(setting+1)+"_std.oct";
-
-    }
-    if(!createOctree(octFiles,sunsOct)){
-        return false;
-    }
-    if (writeCL){
-        outCL<<"## Create the suns octree here"<<std::endl<<std::endl;;
-    }
-    if ((setting==-1 && model->windowGroups()[blindGroupNum].runBase())||(setting>=0 && model->windowGroups()[blindGroupNum].runSetting()[setting])){
-        //rcontrib for sun
-        arguments.clear();
-        arguments.push_back("-I+");
-        if (model->getParamSet("default")){
-            std::unordered_map<std::string, std::string> tempMap=model->getParamSet("default").get();
-            for (std::unordered_map<std::string, std::string>::iterator it=tempMap.begin(); it!=tempMap.end();++it){
-                if (it->first!="sj"){
-                    arguments.push_back("-"+it->first);
-                    arguments.push_back(it->second);
-                }
-            }
-        }else{
-            STADIC_LOG(Severity::Fatal, "The default parameter set is not found for " + model->spaceName());
+        }else{
+            STADIC_LOG(Severity::Fatal, "The default parameter set is not found for " + model->spaceName());
         }
         arguments.push_back("-e");
         arguments.push_back("MF:"+std::to_string(model->sunDivisions()));
@@ -880,20 +789,13 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
             //This is for the settings
             sunDC=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_1d_std.dc";
         }
-        std::string rcontribProgram="rcontrib";
-        Process rcontrib2(rcontribProgram,arguments);
+        PartitionedProcess rcontrib2(rcontribProgram,arguments);
+        rcontrib2.setMaxPartitions(m_Threads);
         rcontrib2.setStandardOutputFile(sunDC);
         rcontrib2.setStandardInputFile(model->spaceDirectory()+model->inputDirectory()+model->ptsFile()[0]);
         if (writeCL){
             outCL<<rcontrib2.commandLine()<<std::endl<<std::endl;;
         }
-        rcontrib2.start();
-        if (!rcontrib2.wait()){
-            STADIC_ERROR("The sun rcontrib run failed with the following errors.");
-            //I want to display the errors here if the standard error has any errors to show.
-
-            return false;
-        }
 
         //rcontrib for direct sun (sDA & ASE)
         arguments.clear();
@@ -930,16 +832,30 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
             //This is for the settings
             directSunDC=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_1d_std_direct.dc";
         }
-        Process rcontrib3(rcontribProgram,arguments);
+        PartitionedProcess rcontrib3(rcontribProgram,arguments);
+        rcontrib3.setMaxPartitions(m_Threads);
         rcontrib3.setStandardOutputFile(directSunDC);
         rcontrib3.setStandardInputFile(model->spaceDirectory()+model->inputDirectory()+model->ptsFile()[0]);
         if (writeCL){
             outCL<<rcontrib3.commandLine()<<std::endl<<std::endl;;
         }
+
+        //The sky, sun and direct sun contributions do not depend on each other, so they are run together,
+        //each one split over the points
+        rcontrib.start();
+        rcontrib2.start();
         rcontrib3.start();
+        if (!rcontrib.wait()){
+            STADIC_ERROR("The rcontrib run for the sky has failed with the following errors.\n"+rcontrib.error());
+            STADIC_LOG(stadic::Severity::Info, "The command line entry is as follows:\n\t"+rcontrib.commandLine());
+            return false;
+        }
+        if (!rcontrib2.wait()){
+            STADIC_ERROR("The sun rcontrib run failed with the following errors.\n"+rcontrib2.error());
+            return false;
+        }
         if (!rcontrib3.wait()){
-            STADIC_ERROR("The direct sun rcontrib run failed with the following errors.");
-            //I want to display the errors here if the standard error has any errors to show.
+            STADIC_ERROR("The direct sun rcontrib run failed with the following errors.\n"+rcontrib3.error());
             return false;
         }
     }
@@ -1025,13 +941,6 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         sensorSkyDC=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_shade_sky.dc";
         rcontribSkySen.setStandardOutputFile(sensorSkyDC);
 
-        rsensor.start();
-        rcontribSkySen.start();
-
-        if (!rcontribSkySen.wait()){
-            STADIC_LOG(Severity::Error, "The running of rcontrib for the shade sensor has failed for window group "+model->windowGroups()[blindGroupNum].name()+" within "+model->spaceName()+".");
-            return false;
-        }
 
         //rsensor and rcontrib for shade sensors for sun contribution
         Process rsensor2(rsensorProgram, arguments);
@@ -1068,9 +977,15 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         sensorSunDC=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_shade_sun.dc";
         rcontribSunSen.setStandardOutputFile(sensorSunDC);
 
-        rsensor2.start();
-        rcontribSunSen.start();
-
+        //The sky and sun sensor contributions are independent of each other
+        ProcessGroup sensorContributions;
+        sensorContributions.add(&rcontribSkySen);
+        sensorContributions.add(&rcontribSunSen);
+        sensorContributions.waitAll();
+        if (!rcontribSkySen.wait()){
+            STADIC_LOG(Severity::Error, "The running of rcontrib for the shade sensor has failed for window group "+model->windowGroups()[blindGroupNum].name()+" within "+model->spaceName()+".");
+            return false;
+        }
         if (!rcontribSunSen.wait()){
             STADIC_LOG(Severity::Error, "The running of rcontrib for the shade sensor has failed for window group "+model->windowGroups()[blindGroupNum].name()+" within "+model->spaceName()+".");
             return false;
@@ -1090,22 +1005,10 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         arguments.push_back("-d");
         arguments.push_back("-ho");
         arguments.push_back(m_WeaFileName.get());
-        std::string gendaymtxProgram="gendaymtx";
-        Process gendaymtx(gendaymtxProgram,arguments);
-
-        if (setting==-1){
-            sunSMX=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_base_d.smx";
-        }else{
-            sunSMX=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_d_std.smx";
-        }
-        gendaymtx.setStandardOutputFile(sunSMX);
+        //The matrices only depend on the weather, so every window group and setting shares them
+        sunSMX=m_SkyMatrices.matrix(m_SkyMatrixPrefix+"_d",arguments);
         if (writeCL){
-            outCL<<gendaymtx.commandLine()<<std::endl<<std::endl;;
-        }
-        gendaymtx.start();
-        if (!gendaymtx.wait()){
-            STADIC_ERROR("The creation of the suns has failed. The command line is displayed below:\n\t"+gendaymtx.commandLine());
-            return false;
+            outCL<<m_SkyMatrices.commandLine(sunSMX)<<std::endl<<std::endl;;
         }
 
 
@@ -1119,23 +1022,9 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         arguments.push_back("1");
         arguments.push_back("-ho");
         arguments.push_back(m_WeaFileName.get());
-        Process gendaymtx2(gendaymtxProgram,arguments);
-
-        if (setting==-1){
-            skySMX=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_base_k.smx";
-        }else{
-            skySMX=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_k_std.smx";
-        }
-        gendaymtx2.setStandardOutputFile(skySMX);
+        skySMX=m_SkyMatrices.matrix(m_SkyMatrixPrefix+"_k",arguments);
         if (writeCL){
-            outCL<<gendaymtx2.commandLine()<<std::endl<<std::endl;;
-        }
-        gendaymtx2.start();
-        if (!gendaymtx2.wait()){
-            STADIC_ERROR("The creation of the sky has failed with the following errors.");
-            //I want to display the errors here if the standard error has any errors to show.
-
-            return false;
+            outCL<<m_SkyMatrices.commandLine(skySMX)<<std::endl<<std::endl;;
         }
 
         //gendaymtx for sun in patches
@@ -1145,20 +1034,21 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         arguments.push_back("-d");
         arguments.push_back("-ho");
         arguments.push_back(m_WeaFileName.get());
-        Process gendaymtx3(gendaymtxProgram,arguments);
+        sunPatchSMX=m_SkyMatrices.matrix(m_SkyMatrixPrefix+"_kd",arguments);
+        if (writeCL){
+            outCL<<m_SkyMatrices.commandLine(sunPatchSMX)<<std::endl<<std::endl;;
+        }
 
-        if (setting==-1){
-            sunPatchSMX=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_base_kd.smx";
-        }else{
-            sunPatchSMX=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(setting+1)+"_kd_std.smx";
+        if (!m_SkyMatrices.wait(sunSMX)){
+            STADIC_ERROR("The creation of the suns has failed. The command line is displayed below:\n\t"+m_SkyMatrices.commandLine(sunSMX)+"\n"+m_SkyMatrices.error(sunSMX));
+            return false;
         }
-        gendaymtx3.setStandardOutputFile(sunPatchSMX);
-        if (writeCL){
-            outCL<<gendaymtx3.commandLine()<<std::endl<<std::endl;;
+        if (!m_SkyMatrices.wait(skySMX)){
+            STADIC_ERROR("The creation of the sky has failed with the following errors.\n"+m_SkyMatrices.error(skySMX));
+            return false;
         }
-        gendaymtx3.start();
-        if (!gendaymtx3.wait()){
-            STADIC_ERROR("The creation of the sun patches has failed.  The command line is as follows:\n\t"+gendaymtx3.commandLine());
+        if (!m_SkyMatrices.wait(sunPatchSMX)){
+            STADIC_ERROR("The creation of the sun patches has failed.  The command line is as follows:\n\t"+m_SkyMatrices.commandLine(sunPatchSMX)+"\n"+m_SkyMatrices.error(sunPatchSMX));
             return false;
         }
     }
@@ -1167,7 +1057,7 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         //dctimestep | rcollate for the sensor for the sky
         arguments.clear();
         arguments.push_back("-n");
-        arguments.push_back("8760");
+        arguments.push_back(m_Timesteps);
         arguments.push_back(sensorSkyDC);
         arguments.push_back(skySMX);
         std::string dctimestepProgram="dctimestep";
@@ -1184,13 +1074,6 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         std::string sensorSkyCollated=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_shade_sky.txt";
         rcollate.setStandardOutputFile(sensorSkyCollated);
 
-        dctimestep.start();
-        rcollate.start();
-        if (!rcollate.wait()){
-            STADIC_LOG(Severity::Error, "The running of rcollate for the sensor sky contribution has failed.");
-            return false;
-        }
-
         //dctimestep | rcollate for the sensor for the sun
         //Added this line from an email that didn't exist before
         arguments[2]=sensorSunDC;
@@ -1201,16 +1084,6 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         dctimestep2.setStandardOutputProcess(&rcollate2);
         rcollate2.setStandardOutputFile(sensorSunCollated);
 
-        dctimestep2.start();
-        rcollate2.start();
-
-        if(!rcollate2.wait()){
-            STADIC_ERROR("The running of rcollate for the sensor sun contribution has failed.");
-            //I want to display the errors here if the standard error has any errors to show.
-
-            return false;
-        }
-
 
         //dctimestep | rcollate for the sensor for the sun patch
         //Added this line from an email that didn't exist before
@@ -1222,11 +1095,22 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         dctimestep3.setStandardOutputProcess(&rcollate3);
         rcollate3.setStandardOutputFile(sensorSunPatchCollated);
 
-        dctimestep3.start();
-        rcollate3.start();
-
+        //The three sensor pipelines only share their inputs
+        ProcessGroup sensorCollations;
+        sensorCollations.add(&rcollate);
+        sensorCollations.add(&rcollate2);
+        sensorCollations.add(&rcollate3);
+        sensorCollations.waitAll();
+        if (!rcollate.wait()){
+            STADIC_LOG(Severity::Error, "The running of rcollate for the sensor sky contribution has failed.");
+            return false;
+        }
+        if(!rcollate2.wait()){
+            STADIC_ERROR("The running of rcollate for the sensor sun contribution has failed.\n"+dctimestep2.error());
+            return false;
+        }
         if(!rcollate3.wait()){
-            STADIC_ERROR("The running of rcollate for the sensor sun patch contribution has failed.");
+            STADIC_ERROR("The running of rcollate for the sensor sun patch contribution has failed.\n"+dctimestep3.error());
             //I want to display the errors here if the standard error has any errors to show.
 
             return false;
@@ -1269,7 +1153,7 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         //dctimestep | rcollate for the sky
         arguments.clear();
         arguments.push_back("-n");
-        arguments.push_back("8760");
+        arguments.push_back(m_Timesteps);
         //Added this line from an email that didn't exist before
         arguments.push_back(skyDC);
         arguments.push_back(skySMX);
@@ -1296,16 +1180,6 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
             //outCL<<"## Pipe the next two lines together"<<std::endl;
             outCL<<dctimestep.commandLine()<<std::endl<<std::endl;;
         }
-        dctimestep.start();
-        rcollate.start();
-
-        if(!rcollate.wait()){
-            STADIC_ERROR("The running of rcollate for the sky has failed.");
-            //I want to display the errors here if the standard error has any errors to show.
-
-            return false;
-        }
-
         //dctimestep | rcollate for the sun
         //Added this line from an email that didn't exist before
         arguments[2]=sunDC;
@@ -1326,15 +1200,6 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
             outCL<<dctimestep2.commandLine()<<std::endl<<std::endl;;
         }
         STADIC_LOG(Severity::Info, dctimestep2.commandLine());
-        dctimestep2.start();
-        rcollate2.start();
-
-        if(!rcollate2.wait()){
-            STADIC_ERROR("The running of rcollate for the sun has failed.");
-            //I want to display the errors here if the standard error has any errors to show.
-
-            return false;
-        }
 
         //dctimestep | rcollate for the direct sun (sDA & ASE)
         //Added this line from an email that didn't exist before
@@ -1354,15 +1219,6 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
             //outCL<<"## Pipe the next two lines together"<<std::endl;
             outCL<<dctimestep3.commandLine()<<std::endl<<std::endl;;
         }
-        dctimestep3.start();
-        rcollate3.start();
-
-        if(!rcollate3.wait()){
-            STADIC_ERROR("The running of rcollate for the direct sun has failed.");
-            //I want to display the errors here if the standard error has any errors to show.
-
-            return false;
-        }
 
         //dctimestep | rcollate for the sun patch
         //Added this line from an email that didn't exist before
@@ -1382,13 +1238,28 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
             //outCL<<"## Pipe the next two lines together"<<std::endl;
             outCL<<dctimestep4.commandLine()<<std::endl<<std::endl;;
         }
-        dctimestep4.start();
-        rcollate4.start();
 
+        //The four matrix multiplications only share their inputs
+        ProcessGroup collations;
+        collations.add(&rcollate);
+        collations.add(&rcollate2);
+        collations.add(&rcollate3);
+        collations.add(&rcollate4);
+        collations.waitAll();
+        if(!rcollate.wait()){
+            STADIC_ERROR("The running of rcollate for the sky has failed.\n"+dctimestep.error());
+            return false;
+        }
+        if(!rcollate2.wait()){
+            STADIC_ERROR("The running of rcollate for the sun has failed.\n"+dctimestep2.error());
+            return false;
+        }
+        if(!rcollate3.wait()){
+            STADIC_ERROR("The running of rcollate for the direct sun has failed.\n"+dctimestep3.error());
+            return false;
+        }
         if(!rcollate4.wait()){
-            STADIC_ERROR("The running of rcollate for the sun patches has failed.");
-            //I want to display the errors here if the standard error has any errors to show.
-
+            STADIC_ERROR("The running of rcollate for the sun patches has failed.\n"+dctimestep4.error());
             return false;
         }
 
@@ -1424,12 +1295,6 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
             //outCL<<"## Pipe the next two lines together"<<std::endl;
             outCL<<rlam.commandLine()<<std::endl<<std::endl;;
         }
-        rlam.start();
-        rcalc.start();
-
-        if(!rcalc.wait()){
-            return false;
-        }
 
         //rcalc for the direct component illuminance file by itself
         arguments.clear();
@@ -1449,9 +1314,17 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
         if (writeCL){
             outCL<<rcalc.commandLine()<<std::endl<<std::endl;
         }
-        rcalc2.start();
 
+        ProcessGroup illuminances;
+        illuminances.add(&rcalc);
+        illuminances.add(&rcalc2);
+        illuminances.waitAll();
+        if(!rcalc.wait()){
+            STADIC_ERROR("The running of rcalc for the illuminance has failed.\n"+rlam.error()+rcalc.error());
+            return false;
+        }
         if (!rcalc2.wait()){
+            STADIC_ERROR("The running of rcalc for the direct illuminance has failed.\n"+rcalc2.error());
             return false;
         }
     }
@@ -1459,9 +1332,34 @@ bool Daylight::simStandard(int blindGroupNum, int setting, Control *model){
     return true;
 }
 
-bool Daylight::simCase1(int blindGroupNum, Control *model){
+bool Daylight::simCase1(int blindGroupNum, int setting, Control *model){
     // Passing an integer blind group number is very, very dangerous
     //Simulation Case 1 will be for window groups that do not contain BSDFs
+    //A shade setting on its own
+    if (setting>=0){
+        unsigned int i=setting;
+        std::vector<std::string> files(1);
+        files.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+"sky_white1.rad");
+        std::string outFileName;
+        // Memory leak
+        RadFileData *wgRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
+        wgRad->addRad(model->spaceDirectory()+model->geoDirectory()+model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
+        std::string wgSetFile=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.rad";
+        wgRad->writeRadFile(wgSetFile);
+        files.clear();
+        files.push_back(wgSetFile);
+        files.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+"sky_white1.rad");
+        outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.oct";
+        if (!createOctree(files, outFileName)){
+            return false;
+        }
+        //call Standard Radiance run
+        if (!simStandard(blindGroupNum,i,model)){
+            return false;
+        }
+        return true;
+    }
+
     //First simulate the base condition
     // This is not making a copy *and* it is a memory leak.
     RadFileData *baseRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());    //This used to be (m_RadFiles[i],this), but the program failed to build
@@ -1487,33 +1385,93 @@ bool Daylight::simCase1(int blindGroupNum, Control *model){
     if (!simStandard(blindGroupNum,-1,model)){
         return false;
     }
+    return true;
+}
+
+bool Daylight::simCase2(int blindGroupNum, int setting, Control *model){
+    //Simulation case 2 will be for window groups that contain BSDFs, but not in the base case
+    //A shade setting on its own
+    if (setting>=0){
+        unsigned int i=setting;
+        std::vector<std::string> files(1);
+        files.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+"sky_white1.rad");
+        std::string outFileName;
+        // Memory leak
+        RadFileData *settingRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
+        settingRad->addRad(model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
+        if (model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size()>0){
+            //Create a file of the glazing layers with all BSDFs blacked out and simulate it
+            // Memory leak
+            RadFileData *settingStdRad=new RadFileData(settingRad->primitives());
+            for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
+//                if (!settingStdRad->blackOutLayer(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j])){
+//                    return false;
+//                }
+            }
+            std::string wgSettingFileStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.rad";
+            files[0]=wgSettingFileStd;
+            outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.oct";
+            if (!createOctree(files, outFileName)){
+                return false;
+            }
+
+            //Call Standard Radiance run
+            if (!simStandard(blindGroupNum,i,model)){
+                return false;
+            }
 
-    //Loop through the shade settings
-    if (model->windowGroups()[blindGroupNum].shadeSettingGeometry().size()>0){
-        for (unsigned int i=0;i<model->windowGroups()[blindGroupNum].shadeSettingGeometry().size();i++){
+            //Loop through each of the BSDFs and remove it along with the glazing layers and simulate them with simBSDF
+            for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
+                std::vector<std::string> layers=model->windowGroups()[blindGroupNum].glazingLayers();
+                layers.push_back(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
+                std::pair<shared_vector<RadPrimitive>, shared_vector<RadPrimitive> > splitGeo = settingRad->split(layers);
+                if (splitGeo.first.size() == 0 || splitGeo.second.size() == 0){
+                    STADIC_ERROR("The program quit...");
+                    return false;
+                }
+                std::string wgSettingFileBSDF=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+".rad";
+                RadFileData first(splitGeo.first);
+                first.writeRadFile(wgSettingFileBSDF);
+                std::vector<double> normal=first.surfaceNormal(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
+                std::string thickness;
+                std::string bsdfXML;
+                for (int k=0;k<first.primitives().size();k++){
+                    if (first.primitives()[k]->name()==model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]){
+                        thickness=first.primitives()[k]->getArg1(0);
+                        bsdfXML=first.primitives()[k]->getArg1(1);
+                    }
+                }
+                std::string wgSettingFileBSDFStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+"_std.rad";
+                RadFileData second(splitGeo.second);
+                second.writeRadFile(wgSettingFileBSDFStd);
+                if (!simBSDF(blindGroupNum,i,j,wgSettingFileBSDF,wgSettingFileBSDFStd,normal,thickness,bsdfXML,model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j],model)){
+                    STADIC_ERROR("The program quit...");
+                    return false;
+                }
+            }
+        }else{
             // Memory leak
             RadFileData *wgRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
             wgRad->addRad(model->spaceDirectory()+model->geoDirectory()+model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
-            std::string wgSetFile=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.rad";
+            std::string wgSetFile=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+".rad";
             wgRad->writeRadFile(wgSetFile);
             files.clear();
             files.push_back(wgSetFile);
             files.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+"sky_white1.rad");
-            outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.oct";
+            outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+".oct";
             if (!createOctree(files, outFileName)){
                 return false;
             }
+
             //call Standard Radiance run
             if (!simStandard(blindGroupNum,i,model)){
                 return false;
             }
         }
+        delete settingRad;
+        return true;
     }
-    return true;
-}
 
-bool Daylight::simCase2(int blindGroupNum, Control *model){
-    //Simulation case 2 will be for window groups that contain BSDFs, but not in the base case
     //First simulate the base condition
     // Memory leak
     RadFileData *baseRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());    //This used to be (m_RadFiles[i],this), but the program failed to build
@@ -1533,90 +1491,93 @@ bool Daylight::simCase2(int blindGroupNum, Control *model){
     if (!simStandard(blindGroupNum,-1,model)){
         return false;
     }
+    return true;
+}
 
-    //Loop through the shade settings
-    if (model->windowGroups()[blindGroupNum].shadeSettingGeometry().size()>0){
-        for (unsigned int i=0;i<model->windowGroups()[blindGroupNum].shadeSettingGeometry().size();i++){
+bool Daylight::simCase3(int blindGroupNum, int setting, Control *model){
+    //	Simulation case 3 will be for window groups that contain BSDFs even in the base case, but the glazing layers are not BSDFs
+    //A shade setting on its own
+    if (setting>=0){
+        unsigned int i=setting;
+        std::vector<std::string> files(1);
+        files.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+"sky_white1.rad");
+        std::string outFileName;
+        // Memory leak
+        RadFileData *settingRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
+        settingRad->addRad(model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
+        if (model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size()>0){
+            //Create a file of the glazing layers with all BSDFs blacked out and simulate it
             // Memory leak
-            RadFileData *settingRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
-            settingRad->addRad(model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
-            if (model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size()>0){
-                //Create a file of the glazing layers with all BSDFs blacked out and simulate it
-                // Memory leak
-                RadFileData *settingStdRad=new RadFileData(settingRad->primitives());
-                for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
-//                    if (!settingStdRad->blackOutLayer(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j])){
-//                        return false;
-//                    }
-                }
-                std::string wgSettingFileStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.rad";
-                files[0]=wgSettingFileStd;
-                outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.oct";
-                if (!createOctree(files, outFileName)){
-                    return false;
-                }
+            RadFileData *settingStdRad=new RadFileData(settingRad->primitives());
+            for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
+//                if (!settingStdRad->blackOutLayer(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j])){
+//                    return false;
+//                }
+            }
+            std::string wgSettingFileStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.rad";
+            files[0]=wgSettingFileStd;
+            outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.oct";
+            if (!createOctree(files, outFileName)){
+                return false;
+            }
+
+            //Call Standard Radiance run
+            if (!simStandard(blindGroupNum,i,model)){
+                return false;
+            }
 
-                //Call Standard Radiance run
-                if (!simStandard(blindGroupNum,i,model)){
+            //Loop through each of the BSDFs and remove it along with the glazing layers and simulate them with simBSDF
+            for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
+                std::vector<std::string> layers=model->windowGroups()[blindGroupNum].glazingLayers();
+                layers.push_back(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
+                std::pair<shared_vector<RadPrimitive>,shared_vector<RadPrimitive> > splitGeo=settingRad->split(layers);
+                if (splitGeo.first.size()==0|| splitGeo.second.size()==0){
+                    STADIC_ERROR("The program quit...");
                     return false;
                 }
-
-                //Loop through each of the BSDFs and remove it along with the glazing layers and simulate them with simBSDF
-                for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
-                    std::vector<std::string> layers=model->windowGroups()[blindGroupNum].glazingLayers();
-                    layers.push_back(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
-                    std::pair<shared_vector<RadPrimitive>, shared_vector<RadPrimitive> > splitGeo = settingRad->split(layers);
-                    if (splitGeo.first.size() == 0 || splitGeo.second.size() == 0){
-                        STADIC_ERROR("The program quit...");
-                        return false;
-                    }
-                    std::string wgSettingFileBSDF=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+".rad";
-                    RadFileData first(splitGeo.first);
-                    first.writeRadFile(wgSettingFileBSDF);
-                    std::vector<double> normal=first.surfaceNormal(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
-                    std::string thickness;
-                    std::string bsdfXML;
-                    for (int k=0;k<first.primitives().size();k++){
-                        if (first.primitives()[k]->name()==model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]){
-                            thickness=first.primitives()[k]->getArg1(0);
-                            bsdfXML=first.primitives()[k]->getArg1(1);
-                        }
-                    }
-                    std::string wgSettingFileBSDFStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+"_std.rad";
-                    RadFileData second(splitGeo.second);
-                    second.writeRadFile(wgSettingFileBSDFStd);
-                    if (!simBSDF(blindGroupNum,i,j,wgSettingFileBSDF,wgSettingFileBSDFStd,normal,thickness,bsdfXML,model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j],model)){
-                        STADIC_ERROR("The program quit...");
-                        return false;
+                std::string wgSettingFileBSDF=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+".rad";
+                RadFileData first(splitGeo.first);
+                first.writeRadFile(wgSettingFileBSDF);
+                std::vector<double> normal=first.surfaceNormal(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
+                std::string thickness;
+                std::string bsdfXML;
+                for (int k=0;k<first.primitives().size();k++){
+                    if (first.primitives()[k]->name()==model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]){
+                        thickness=first.primitives()[k]->getArg1(0);
+                        bsdfXML=first.primitives()[k]->getArg1(1);
                     }
                 }
-            }else{
-                // Memory leak
-                RadFileData *wgRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
-                wgRad->addRad(model->spaceDirectory()+model->geoDirectory()+model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
-                std::string wgSetFile=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+".rad";
-                wgRad->writeRadFile(wgSetFile);
-                files.clear();
-                files.push_back(wgSetFile);
-                files.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+"sky_white1.rad");
-                outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+".oct";
-                if (!createOctree(files, outFileName)){
+                std::string wgSettingFileBSDFStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+"_std.rad";
+                RadFileData second(splitGeo.second);
+                second.writeRadFile(wgSettingFileBSDFStd);
+                if (!simBSDF(blindGroupNum,i,j,wgSettingFileBSDF,wgSettingFileBSDFStd,normal,thickness,bsdfXML,model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j],model)){
+                    STADIC_ERROR("The program quit...");
                     return false;
                 }
+            }
+        }else{
+            // Memory leak
+            RadFileData *wgRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
+            wgRad->addRad(model->spaceDirectory()+model->geoDirectory()+model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
+            std::string wgSetFile=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+".rad";
+            wgRad->writeRadFile(wgSetFile);
+            files.clear();
+            files.push_back(wgSetFile);
+            files.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+"sky_white1.rad");
+            outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+".oct";
+            if (!createOctree(files, outFileName)){
+                return false;
+            }
 
-                //call Standard Radiance run
-                if (!simStandard(blindGroupNum,i,model)){
-                    return false;
-                }
+            //call Standard Radiance run
+            if (!simStandard(blindGroupNum,i,model)){
+                return false;
             }
-            delete settingRad;
         }
+        delete settingRad;
+        return true;
     }
-    return true;
-}
 
-bool Daylight::simCase3(int blindGroupNum, Control *model){
-    //	Simulation case 3 will be for window groups that contain BSDFs even in the base case, but the glazing layers are not BSDFs
     //First simulate the base condition
     //Standard radiance run with all bsdfs blacked out
     // Memory leak
@@ -1678,90 +1639,55 @@ bool Daylight::simCase3(int blindGroupNum, Control *model){
             }
         }
     }
+    return true;
+}
 
-    //Loop through the shade settings
-    if (model->windowGroups()[blindGroupNum].shadeSettingGeometry().size()>0){
-        for (unsigned int i=0;i<model->windowGroups()[blindGroupNum].shadeSettingGeometry().size();i++){
-            // Memory leak
-            RadFileData *settingRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
-            settingRad->addRad(model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
-            if (model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size()>0){
-                //Create a file of the glazing layers with all BSDFs blacked out and simulate it
-                // Memory leak
-                RadFileData *settingStdRad=new RadFileData(settingRad->primitives());
-                for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
-//                    if (!settingStdRad->blackOutLayer(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j])){
-//                        return false;
-//                    }
-                }
-                std::string wgSettingFileStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.rad";
-                files[0]=wgSettingFileStd;
-                outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_std.oct";
-                if (!createOctree(files, outFileName)){
-                    return false;
-                }
-
-                //Call Standard Radiance run
-                if (!simStandard(blindGroupNum,i,model)){
+bool Daylight::simCase4(int blindGroupNum, int setting, Control *model){
+    //	Simulation case 4 will be for window groups that have shade materials in addition to the glazing layer which is a BSDF
+    //A shade setting on its own
+    if (setting>=0){
+        unsigned int i=setting;
+        // Memory leak
+        RadFileData *settingRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
+        settingRad->addRad(model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
+        if (model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size()>0){
+            //Loop through each of the BSDFs and remove it along with the glazing layers and simulate them with simBSDF
+            for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
+                std::vector<std::string> layers=model->windowGroups()[blindGroupNum].glazingLayers();
+                layers.push_back(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
+                std::pair<shared_vector<RadPrimitive>, shared_vector<RadPrimitive> > splitGeo=settingRad->split(layers);
+                if (splitGeo.first.size()==0|| splitGeo.second.size()==0){
+                    STADIC_ERROR("The program quit...");
                     return false;
                 }
-
-                //Loop through each of the BSDFs and remove it along with the glazing layers and simulate them with simBSDF
-                for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
-                    std::vector<std::string> layers=model->windowGroups()[blindGroupNum].glazingLayers();
-                    layers.push_back(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
-                    std::pair<shared_vector<RadPrimitive>,shared_vector<RadPrimitive> > splitGeo=settingRad->split(layers);
-                    if (splitGeo.first.size()==0|| splitGeo.second.size()==0){
-                        STADIC_ERROR("The program quit...");
-                        return false;
-                    }
-                    std::string wgSettingFileBSDF=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+".rad";
-                    RadFileData first(splitGeo.first);
-                    first.writeRadFile(wgSettingFileBSDF);
-                    std::vector<double> normal=first.surfaceNormal(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
-                    std::string thickness;
-                    std::string bsdfXML;
-                    for (int k=0;k<first.primitives().size();k++){
-                        if (first.primitives()[k]->name()==model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]){
-                            thickness=first.primitives()[k]->getArg1(0);
-                            bsdfXML=first.primitives()[k]->getArg1(1);
-                        }
-                    }
-                    std::string wgSettingFileBSDFStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+"_std.rad";
-                    RadFileData second(splitGeo.second);
-                    second.writeRadFile(wgSettingFileBSDFStd);
-                    if (!simBSDF(blindGroupNum,i,j,wgSettingFileBSDF,wgSettingFileBSDFStd,normal,thickness,bsdfXML,model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j],model)){
-                        STADIC_ERROR("The program quit...");
-                        return false;
+                std::string wgSettingFileBSDF=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+".rad";
+                RadFileData first(splitGeo.first);
+                first.writeRadFile(wgSettingFileBSDF);
+                std::vector<double> normal=first.surfaceNormal(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
+                std::string thickness;
+                std::string bsdfXML;
+                for (int k=0;k<first.primitives().size();k++){
+                    if (first.primitives()[k]->name()==model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]){
+                        thickness=first.primitives()[k]->getArg1(0);
+                        bsdfXML=first.primitives()[k]->getArg1(1);
                     }
                 }
-            }else{
-                // Memory leak
-                RadFileData *wgRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
-                wgRad->addRad(model->spaceDirectory()+model->geoDirectory()+model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
-                std::string wgSetFile=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+".rad";
-                wgRad->writeRadFile(wgSetFile);
-                files.clear();
-                files.push_back(wgSetFile);
-                files.push_back(model->spaceDirectory()+model->intermediateDataDirectory()+"sky_white1.rad");
-                outFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+".oct";
-                if (!createOctree(files, outFileName)){
-                    return false;
-                }
-
-                //call Standard Radiance run
-                if (!simStandard(blindGroupNum,i,model)){
+                std::string wgSettingFileBSDFStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+"_std.rad";
+                RadFileData second(splitGeo.second);
+                second.writeRadFile(wgSettingFileBSDFStd);
+                if (!simBSDF(blindGroupNum,i,j,wgSettingFileBSDF,wgSettingFileBSDFStd,normal,thickness,bsdfXML,model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j],model)){
+                    STADIC_ERROR("The program quit...");
                     return false;
                 }
             }
-            delete settingRad;
+        }else{
+            STADIC_ERROR("Blind Group "+std::to_string(blindGroupNum)+" setting "+std::to_string(i)+ " does not contain a bsdf layer.");
+            return false;
         }
+        delete settingRad;
+        return true;
     }
-    return true;
-}
 
-bool Daylight::simCase4(int blindGroupNum, Control *model){
-    //	Simulation case 4 will be for window groups that have shade materials in addition to the glazing layer which is a BSDF
     // Memory leak
     RadFileData *baseRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
     baseRad->addRad(model->spaceDirectory()+model->geoDirectory()+model->windowGroups()[blindGroupNum].baseGeometry());
@@ -1802,61 +1728,284 @@ bool Daylight::simCase4(int blindGroupNum, Control *model){
             }
         }
     }
-
-    //Loop through the shade settings
-    if (model->windowGroups()[blindGroupNum].shadeSettingGeometry().size()>0){
-        for (unsigned int i=0;i<model->windowGroups()[blindGroupNum].shadeSettingGeometry().size();i++){
-            // Memory leak
-            RadFileData *settingRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
-            settingRad->addRad(model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
-            if (model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size()>0){
-                //Loop through each of the BSDFs and remove it along with the glazing layers and simulate them with simBSDF
-                for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
-                    std::vector<std::string> layers=model->windowGroups()[blindGroupNum].glazingLayers();
-                    layers.push_back(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
-                    std::pair<shared_vector<RadPrimitive>, shared_vector<RadPrimitive> > splitGeo=settingRad->split(layers);
-                    if (splitGeo.first.size()==0|| splitGeo.second.size()==0){
-                        STADIC_ERROR("The program quit...");
-                        return false;
-                    }
-                    std::string wgSettingFileBSDF=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+".rad";
-                    RadFileData first(splitGeo.first);
-                    first.writeRadFile(wgSettingFileBSDF);
-                    std::vector<double> normal=first.surfaceNormal(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
-                    std::string thickness;
-                    std::string bsdfXML;
-                    for (int k=0;k<first.primitives().size();k++){
-                        if (first.primitives()[k]->name()==model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]){
-                            thickness=first.primitives()[k]->getArg1(0);
-                            bsdfXML=first.primitives()[k]->getArg1(1);
-                        }
-                    }
-                    std::string wgSettingFileBSDFStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+"_std.rad";
-                    RadFileData second(splitGeo.second);
-                    second.writeRadFile(wgSettingFileBSDFStd);
-                    if (!simBSDF(blindGroupNum,i,j,wgSettingFileBSDF,wgSettingFileBSDFStd,normal,thickness,bsdfXML,model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j],model)){
-                        STADIC_ERROR("The program quit...");
-                        return false;
-                    }
-                }
-            }else{
-                STADIC_ERROR("Blind Group "+std::to_string(blindGroupNum)+" setting "+std::to_string(i)+ " does not contain a bsdf layer.");
-                return false;
-            }
-            delete settingRad;
-        }
-    }
     return true;
 }
 
-bool Daylight::simCase5(int blindGroupNum, Control *model){
+bool Daylight::simCase5(int blindGroupNum, int setting, Control *model){
     //	Simulation case 5 will be for window groups that have added geometry, but it is a proxy geometry
 
     return true;
 }
 
-bool Daylight::simCase6(int blindGroupNum, Control *model){
+bool Daylight::simCase6(int blindGroupNum, int setting, Control *model){
     //	Simulation case 6 will be for window groups that only have the glazing layer as a BSDF
+    //For a setting only run the last part of the calculation
+    if (setting>=0){
+        unsigned int i=setting;
+        // Memory leak
+        RadFileData *settingRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
+        settingRad->addRad(model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
+        if (model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size()>0){
+            //Loop through each of the BSDFs and remove it along with the glazing layers and simulate them with simBSDF
+            for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
+                std::vector<std::string> layers=model->windowGroups()[blindGroupNum].glazingLayers();
+                layers.push_back(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
+                std::pair<shared_vector<RadPrimitive>, shared_vector<RadPrimitive> > splitGeo=settingRad->split(layers);
+                if (splitGeo.first.size()==0|| splitGeo.second.size()==0){
+                    STADIC_ERROR("The program quit...");
+                    return false;
+                }
+                std::string wgSettingFileBSDF=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+".rad";
+                RadFileData first(splitGeo.first);
+                first.writeRadFile(wgSettingFileBSDF);
+                //std::vector<double> normal=splitGeo.first->surfaceNormal(model->windowGroups()[blindGroupNum]->bsdfSettingLayers()[i][j]);
+                std::string thickness;
+                std::string bsdfXML;
+                for (int k=0;k<first.primitives().size();k++){
+                    if (first.primitives()[k]->name()==model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]){
+                        thickness=first.primitives()[k]->getArg1(0);
+                        bsdfXML=first.primitives()[k]->getArg1(1);
+                    }
+                }
+                std::string wgSettingFileBSDFStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+"_std.rad";
+                RadFileData second;
+                second.writeRadFile(wgSettingFileBSDFStd);
+                /*  This would be correct, but for time savings we don't have to run the entire calculation so the next steps are taken.
+                if (!simBSDF(blindGroupNum,i,j,wgSettingFileBSDF,wgSettingFileBSDFStd,normal,thickness,bsdfXML,model->windowGroups()[blindGroupNum]->bsdfSettingLayers()[i][j],model)){
+                    STADIC_ERROR("The program quit...");
+                    return false;
+                }
+                */
+                //Create the blacked out rad file
+                std::string mainFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i)+"_bsdf"+std::to_string(j);
+                std::string baseFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_base_bsdf"+std::to_string(j);
+                std::vector<std::string> arguments;
+                arguments.push_back("-m");
+                arguments.push_back("black");
+                arguments.push_back(wgSettingFileBSDFStd);
+                std::string xformProgram="xform";
+                Process xform(xformProgram,arguments);
+                std::string blackRad=mainFileName+"_allblack.rad";
+                xform.setStandardOutputFile(blackRad);
+                xform.start();
+                if (!xform.wait()){
+                    STADIC_ERROR("The xform command failed to convert layers to black.");
+                    //I want to display the errors here if the standard error has any errors to show.
+                    return false;
+                }
+                std::vector<std::string> files;
+                files.push_back(blackRad);
+                std::string blackOct=mainFileName+"_allblack.oct";
+                if(!createOctree(files,blackOct)){
+                    return false;
+                }
+                std::string sunsOct=baseFileName+"_suns.oct";
+                //rcontrib
+                arguments.clear();
+                arguments.push_back("-I");
+                arguments.push_back("-ab");
+                //This value should probably be based off of a value in the control file
+                arguments.push_back("1");
+                arguments.push_back("-ad");
+                //This value should probably be based off of a value in the control file
+                arguments.push_back("65000");
+                arguments.push_back("-lw");
+                //This value should probably be based off of a value in the control file
+                arguments.push_back("2e-5");
+                arguments.push_back("-dc");
+                arguments.push_back("1");
+                arguments.push_back("-dt");
+                arguments.push_back("0");
+                arguments.push_back("-dj");
+                arguments.push_back("0");
+                arguments.push_back("-st");
+                arguments.push_back("1");
+                arguments.push_back("-ss");
+                arguments.push_back("0");
+                arguments.push_back("-faa");
+                arguments.push_back("-e");
+                arguments.push_back("MF:"+std::to_string(model->sunDivisions()));
+                arguments.push_back("-f");
+                arguments.push_back("klems_int.cal");
+                arguments.push_back("-b");
+                arguments.push_back("rbin");
+                arguments.push_back("-bn");
+                arguments.push_back("Nrbins");
+                arguments.push_back("-m");
+                arguments.push_back("solar");
+                arguments.push_back(sunsOct);
+                std::string rcontribProgram="rcontrib";
+                PartitionedProcess rcontrib(rcontribProgram,arguments);
+                rcontrib.setMaxPartitions(m_Threads);
+                std::string dirDSMX=mainFileName+"_5PH.dsmx";
+                rcontrib.setStandardOutputFile(dirDSMX);
+                rcontrib.setStandardInputFile(model->inputDirectory()+model->ptsFile()[0]);
+
+                rcontrib.start();
+                if (!rcontrib.wait()){
+                    STADIC_ERROR("The rcontrib run for the 5-phase direct smx has failed with the following errors.");
+                    //I want to display the errors here if the standard error has any errors to show.
+                    return false;
+                }
+
+                //Create file names from base output
+
+                std::string vmx=baseFileName+"_3PH.vmx";
+                std::string dmx=baseFileName+"_3PH.dmx";
+                std::string dirDMX=baseFileName+"_3DIR.dmx";
+                std::string dirVMX=baseFileName+"_3Dir.vmx";
+                std::string smx;
+                std::string dirSMX;
+                std::string dir5PHsmx;
+                if (!bsdfSkyMatrices(model,smx,dirSMX,dir5PHsmx)){
+                    return false;
+                }
+                //3Phase
+                //dctimestep | rcollate
+                arguments.clear();
+                arguments.push_back("-n");
+                arguments.push_back(m_Timesteps);
+                arguments.push_back(vmx);
+                arguments.push_back(bsdfXML);
+                arguments.push_back(dmx);
+                arguments.push_back(smx);
+                std::string dctimestepProgram="dctimestep.exe";
+                Process dctimestep(dctimestepProgram,arguments);
+
+                std::vector<std::string> arguments2;
+                arguments2.push_back("-h");
+                arguments2.push_back("-fa");
+                arguments2.push_back("-oc");
+                arguments2.push_back("3");
+                std::string rcollateProgram="rcollate.exe";
+                Process rcollate(rcollateProgram,arguments2);
+                dctimestep.setStandardOutputProcess(&rcollate);
+
+                std::string threePhaseCollated=mainFileName+"_3ph.dat";
+                rcollate.setStandardOutputFile(threePhaseCollated);
+
+                dctimestep.start();
+                rcollate.start();
+
+                if(!rcollate.wait()){
+                    STADIC_ERROR("The running of rcollate for the 3-phase has failed.");
+                    //I want to display the errors here if the standard error has any errors to show.
+
+                    return false;
+                }
+
+                //3Phase Direct
+                //dctimestep | rcollate
+                arguments.clear();
+                arguments.push_back("-n");
+                arguments.push_back(m_Timesteps);
+                arguments.push_back(dirVMX);
+                arguments.push_back(bsdfXML);
+                arguments.push_back(dirDMX);
+                arguments.push_back(dirSMX);
+                Process dctimestep2(dctimestepProgram,arguments);
+
+                arguments2.clear();
+                arguments2.push_back("-h");
+                arguments2.push_back("-fa");
+                arguments2.push_back("-oc");
+                arguments2.push_back("3");
+                Process rcollate2(rcollateProgram,arguments2);
+                dctimestep2.setStandardOutputProcess(&rcollate2);
+
+                std::string threePhaseDirectCollated=mainFileName+"_3Dir.dat";
+                rcollate2.setStandardOutputFile(threePhaseDirectCollated);
+
+                dctimestep2.start();
+                rcollate2.start();
+
+                if(!rcollate2.wait()){
+                    STADIC_ERROR("The running of rcollate for the 3-phase direct has failed.");
+                    //I want to display the errors here if the standard error has any errors to show.
+
+                    return false;
+                }
+
+                //5Phase
+                //dctimestep | rcollate
+                arguments.clear();
+                arguments.push_back("-n");
+                arguments.push_back(m_Timesteps);
+                arguments.push_back(dirDSMX);
+                arguments.push_back(dir5PHsmx);
+                Process dctimestep3(dctimestepProgram,arguments);
+
+
+                arguments2.clear();
+                arguments2.push_back("-h");
+                arguments2.push_back("-fa");
+                arguments2.push_back("-oc");
+                arguments2.push_back("3");
+                Process rcollate3(rcollateProgram,arguments2);
+                dctimestep3.setStandardOutputProcess(&rcollate3);
+                std::string fivePhaseCollated=mainFileName+"_5PH.dat";
+                rcollate3.setStandardOutputFile(fivePhaseCollated);
+
+                dctimestep3.start();
+                rcollate3.start();
+
+                if(!rcollate3.wait()){
+                    STADIC_ERROR("The running of rcollate for the 3-phase has failed.");
+                    //I want to display the errors here if the standard error has any errors to show.
+
+                    return false;
+                }
+
+                //Process final data into ill file
+
+                arguments.clear();
+                arguments.push_back(threePhaseCollated);
+                arguments.push_back(threePhaseDirectCollated);
+                arguments.push_back(fivePhaseCollated);
+                std::string rlamProgram="rlam";
+                Process rlam(rlamProgram,arguments);
+
+                arguments2.clear();
+                arguments2.push_back("-e");
+                arguments2.push_back("r=$1-$4+7;g=$2-$5+$8;b=$3-$6+$9");
+                arguments2.push_back("-e");
+                arguments2.push_back("ill=179*(.265*r+.670*g+.65*b)");
+                arguments2.push_back("-e");
+                arguments2.push_back("$1=floor(ill+.5)");
+                std::string rcalcProgram="rcalc";
+                Process rcalc(rcalcProgram,arguments2);
+                rlam.setStandardOutputProcess(&rcalc);
+
+
+                std::vector<std::string> arguments3;
+                arguments3.clear();
+                arguments3.push_back("-h");
+                arguments3.push_back("-fa");
+                arguments3.push_back("-or");
+                arguments3.push_back(m_Timesteps);
+                arguments3.push_back("-t");
+                Process rcollate4(rcollateProgram,arguments3);
+                rcalc.setStandardOutputProcess(&rcollate4);
+                rcollate4.setStandardOutputFile(mainFileName+".ill");
+
+                rlam.start();
+                rcalc.start();
+                rcollate4.start();
+                if(!rcollate4.wait()){
+                    STADIC_ERROR("The running of rcollate for final illuminance has failed.");
+                    //I want to display the errors here if the standard error has any errors to show.
+
+                    return false;
+                }
+            }
+        }else{
+            STADIC_ERROR("Blind Group "+std::to_string(blindGroupNum)+" setting "+std::to_string(i)+ " does not contain a bsdf layer.");
+            return false;
+        }
+        delete settingRad;
+        return true;
+    }
+
     // Memory leak
     RadFileData *baseRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
     baseRad->addRad(model->spaceDirectory()+model->geoDirectory()+model->windowGroups()[blindGroupNum].baseGeometry());
@@ -1897,268 +2046,6 @@ bool Daylight::simCase6(int blindGroupNum, Control *model){
             }
         }
     }
-    //For the settings only run the last part of the calculation
-    if (model->windowGroups()[blindGroupNum].shadeSettingGeometry().size()>0){
-        for (unsigned int i=0;i<model->windowGroups()[blindGroupNum].shadeSettingGeometry().size();i++){
-            // Memory leak
-            RadFileData *settingRad=new RadFileData(m_RadFiles[blindGroupNum]->primitives());
-            settingRad->addRad(model->windowGroups()[blindGroupNum].shadeSettingGeometry()[i]);
-            if (model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size()>0){
-                //Loop through each of the BSDFs and remove it along with the glazing layers and simulate them with simBSDF
-                for (int j=0;j<model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i].size();j++){
-                    std::vector<std::string> layers=model->windowGroups()[blindGroupNum].glazingLayers();
-                    layers.push_back(model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]);
-                    std::pair<shared_vector<RadPrimitive>, shared_vector<RadPrimitive> > splitGeo=settingRad->split(layers);
-                    if (splitGeo.first.size()==0|| splitGeo.second.size()==0){
-                        STADIC_ERROR("The program quit...");
-                        return false;
-                    }
-                    std::string wgSettingFileBSDF=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+".rad";
-                    RadFileData first(splitGeo.first);
-                    first.writeRadFile(wgSettingFileBSDF);
-                    //std::vector<double> normal=splitGeo.first->surfaceNormal(model->windowGroups()[blindGroupNum]->bsdfSettingLayers()[i][j]);
-                    std::string thickness;
-                    std::string bsdfXML;
-                    for (int k=0;k<first.primitives().size();k++){
-                        if (first.primitives()[k]->name()==model->windowGroups()[blindGroupNum].bsdfSettingLayers()[i][j]){
-                            thickness=first.primitives()[k]->getArg1(0);
-                            bsdfXML=first.primitives()[k]->getArg1(1);
-                        }
-                    }
-                    std::string wgSettingFileBSDFStd=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i+1)+"_bsdf"+std::to_string(j+1)+"_std.rad";
-                    RadFileData second;
-                    second.writeRadFile(wgSettingFileBSDFStd);
-                    /*  This would be correct, but for time savings we don't have to run the entire calculation so the next steps are taken.
-                    if (!simBSDF(blindGroupNum,i,j,wgSettingFileBSDF,wgSettingFileBSDFStd,normal,thickness,bsdfXML,model->windowGroups()[blindGroupNum]->bsdfSettingLayers()[i][j],model)){
-                        STADIC_ERROR("The program quit...");
-                        return false;
-                    }
-                    */
-                    //Create the blacked out rad file
-                    std::string mainFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_set"+std::to_string(i)+"_bsdf"+std::to_string(j);
-                    std::string baseFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[blindGroupNum].name()+"_base_bsdf"+std::to_string(j);
-                    std::vector<std::string> arguments;
-                    arguments.push_back("-m");
-                    arguments.push_back("black");
-                    arguments.push_back(wgSettingFileBSDFStd);
-                    std::string xformProgram="xform";
-                    Process xform(xformProgram,arguments);
-                    std::string blackRad=mainFileName+"_allblack.rad";
-                    xform.setStandardOutputFile(blackRad);
-                    xform.start();
-                    if (!xform.wait()){
-                        STADIC_ERROR("The xform command failed to convert layers to black.");
-                        //I want to display the errors here if the standard error has any errors to show.
-                        return false;
-                    }
-                    std::vector<std::string> files;
-                    files.push_back(blackRad);
-                    std::string blackOct=mainFileName+"_allblack.oct";
-                    if(!createOctree(files,blackOct)){
-                        return false;
-                    }
-                    std::string sunsOct=baseFileName+"_suns.oct";
-                    //rcontrib
-                    arguments.clear();
-                    arguments.push_back("-I");
-                    arguments.push_back("-ab");
-                    //This value should probably be based off of a value in the control file
-                    arguments.push_back("1");
-                    arguments.push_back("-ad");
-                    //This value should probably be based off of a value in the control file
-                    arguments.push_back("65000");
-                    arguments.push_back("-lw");
-                    //This value should probably be based off of a value in the control file
-                    arguments.push_back("2e-5");
-                    arguments.push_back("-dc");
-                    arguments.push_back("1");
-                    arguments.push_back("-dt");
-                    arguments.push_back("0");
-                    arguments.push_back("-dj");
-                    arguments.push_back("0");
-                    arguments.push_back("-st");
-                    arguments.push_back("1");
-                    arguments.push_back("-ss");
-                    arguments.push_back("0");
-                    arguments.push_back("-faa");
-                    arguments.push_back("-e");
-                    arguments.push_back("MF:"+std::to_string(model->sunDivisions()));
-                    arguments.push_back("-f");
-                    arguments.push_back("klems_int.cal");
-                    arguments.push_back("-b");
-                    arguments.push_back("rbin");
-                    arguments.push_back("-bn");
-                    arguments.push_back("Nrbins");
-                    arguments.push_back("-m");
-                    arguments.push_back("solar");
-                    arguments.push_back(sunsOct);
-                    std::string rcontribProgram="rcontrib";
-                    Process rcontrib(rcontribProgram,arguments);
-                    std::string dirDSMX=mainFileName+"_5PH.dsmx";
-                    rcontrib.setStandardOutputFile(dirDSMX);
-                    rcontrib.setStandardInputFile(model->inputDirectory()+model->ptsFile()[0]);
-
-                    rcontrib.start();
-                    if (!rcontrib.wait()){
-                        STADIC_ERROR("The rcontrib run for the 5-phase direct smx has failed with the following errors.");
-                        //I want to display the errors here if the standard error has any errors to show.
-                        return false;
-                    }
-
-                    //Create file names from base output
-
-                    std::string vmx=baseFileName+"_3PH.vmx";
-                    std::string dmx=baseFileName+"_3PH.dmx";
-                    std::string smx=baseFileName+"_3PH.smx";
-                    std::string dirDMX=baseFileName+"_3DIR.dmx";
-                    std::string dirVMX=baseFileName+"_3Dir.vmx";
-                    std::string dirSMX=baseFileName+"_3DIR.smx";
-                    std::string dir5PHsmx=baseFileName+"_5PH.smx";
-                    //3Phase
-                    //dctimestep | rcollate
-                    arguments.clear();
-                    arguments.push_back("-n");
-                    arguments.push_back("8760");
-                    arguments.push_back(vmx);
-                    arguments.push_back(bsdfXML);
-                    arguments.push_back(dmx);
-                    arguments.push_back(smx);
-                    std::string dctimestepProgram="dctimestep.exe";
-                    Process dctimestep(dctimestepProgram,arguments);
-
-                    std::vector<std::string> arguments2;
-                    arguments2.push_back("-h");
-                    arguments2.push_back("-fa");
-                    arguments2.push_back("-oc");
-                    arguments2.push_back("3");
-                    std::string rcollateProgram="rcollate.exe";
-                    Process rcollate(rcollateProgram,arguments2);
-                    dctimestep.setStandardOutputProcess(&rcollate);
-
-                    std::string threePhaseCollated=mainFileName+"_3ph.dat";
-                    rcollate.setStandardOutputFile(threePhaseCollated);
-
-                    dctimestep.start();
-                    rcollate.start();
-
-                    if(!rcollate.wait()){
-                        STADIC_ERROR("The running of rcollate for the 3-phase has failed.");
-                        //I want to display the errors here if the standard error has any errors to show.
-
-                        return false;
-                    }
-
-                    //3Phase Direct
-                    //dctimestep | rcollate
-                    arguments.clear();
-                    arguments.push_back("-n");
-                    arguments.push_back("8760");
-                    arguments.push_back(dirVMX);
-                    arguments.push_back(bsdfXML);
-                    arguments.push_back(dirDMX);
-                    arguments.push_back(dirSMX);
-                    Process dctimestep2(dctimestepProgram,arguments);
-
-                    arguments2.clear();
-                    arguments2.push_back("-h");
-                    arguments2.push_back("-fa");
-                    arguments2.push_back("-oc");
-                    arguments2.push_back("3");
-                    Process rcollate2(rcollateProgram,arguments2);
-                    dctimestep2.setStandardOutputProcess(&rcollate2);
-
-                    std::string threePhaseDirectCollated=mainFileName+"_3Dir.dat";
-                    rcollate2.setStandardOutputFile(threePhaseDirectCollated);
-
-                    dctimestep2.start();
-                    rcollate2.start();
-
-                    if(!rcollate2.wait()){
-                        STADIC_ERROR("The running of rcollate for the 3-phase direct has failed.");
-                        //I want to display the errors here if the standard error has any errors to show.
-
-                        return false;
-                    }
-
-                    //5Phase
-                    //dctimestep | rcollate
-                    arguments.clear();
-                    arguments.push_back("-n");
-                    arguments.push_back("8760");
-                    arguments.push_back(dirDSMX);
-                    arguments.push_back(dir5PHsmx);
-                    Process dctimestep3(dctimestepProgram,arguments);
-
-
-                    arguments2.clear();
-                    arguments2.push_back("-h");
-                    arguments2.push_back("-fa");
-                    arguments2.push_back("-oc");
-                    arguments2.push_back("3");
-                    Process rcollate3(rcollateProgram,arguments2);
-                    dctimestep3.setStandardOutputProcess(&rcollate3);
-                    std::string fivePhaseCollated=mainFileName+"_5PH.dat";
-                    rcollate3.setStandardOutputFile(fivePhaseCollated);
-
-                    dctimestep3.start();
-                    rcollate3.start();
-
-                    if(!rcollate3.wait()){
-                        STADIC_ERROR("The running of rcollate for the 3-phase has failed.");
-                        //I want to display the errors here if the standard error has any errors to show.
-
-                        return false;
-                    }
-
-                    //Process final data into ill file
-
-                    arguments.clear();
-                    arguments.push_back(threePhaseCollated);
-                    arguments.push_back(threePhaseDirectCollated);
-                    arguments.push_back(fivePhaseCollated);
-                    std::string rlamProgram="rlam";
-                    Process rlam(rlamProgram,arguments);
-
-                    arguments2.clear();
-                    arguments2.push_back("-e");
-                    arguments2.push_back("r=$1-$4+7;g=$2-$5+$8;b=$3-$6+$9");
-                    arguments2.push_back("-e");
-                    arguments2.push_back("ill=179*(.265*r+.670*g+.65*b)");
-                    arguments2.push_back("-e");
-                    arguments2.push_back("$1=floor(ill+.5)");
-                    std::string rcalcProgram="rcalc";
-                    Process rcalc(rcalcProgram,arguments2);
-                    rlam.setStandardOutputProcess(&rcalc);
-
-
-                    std::vector<std::string> arguments3;
-                    arguments3.clear();
-                    arguments3.push_back("-h");
-                    arguments3.push_back("-fa");
-                    arguments3.push_back("-or");
-                    arguments3.push_back("8760");
-                    arguments3.push_back("-t");
-                    Process rcollate4(rcollateProgram,arguments3);
-                    rcalc.setStandardOutputProcess(&rcollate4);
-                    rcollate4.setStandardOutputFile(mainFileName+".ill");
-
-                    rlam.start();
-                    rcalc.start();
-                    rcollate4.start();
-                    if(!rcollate4.wait()){
-                        STADIC_ERROR("The running of rcollate for final illuminance has failed.");
-                        //I want to display the errors here if the standard error has any errors to show.
-
-                        return false;
-                    }
-                }
-            }else{
-                STADIC_ERROR("Blind Group "+std::to_string(blindGroupNum)+" setting "+std::to_string(i)+ " does not contain a bsdf layer.");
-                return false;
-            }
-            delete settingRad;
-        }
-    }
     return true;
 }
 
@@ -2309,6 +2196,132 @@ bool Daylight::writeSky(Control *model){
     return true;
 }
 
+bool Daylight::writeWea(Control *model){
+    //Generate Weather file if it hasn't been generated already.
+    if (!m_WeaFileName){
+        if (m_Model->weaDataFile()){
+            std::shared_ptr<const WeatherData> tmpWeather=WeatherCache::weatherData(m_Model->weaDataFile().get());
+            if (!tmpWeather){
+                return false;
+            }
+            std::string tmpWeaFileName;
+            tmpWeaFileName=model->spaceDirectory()+model->inputDirectory()+tmpWeather->place()+".wea";
+            std::vector<std::string> placeArgs;
+            placeArgs=trimmedSplit(tmpWeaFileName, ' ');
+            tmpWeaFileName.clear();
+            for (int i=0;i<placeArgs.size();i++){
+                tmpWeaFileName=tmpWeaFileName+placeArgs.at(i);
+            }
+            m_WeaFileName=tmpWeaFileName;
+            //The sky matrices are shared by the whole building, so they are named after the weather
+            placeArgs=trimmedSplit(tmpWeather->place(), ' ');
+            m_SkyMatrixPrefix=model->spaceDirectory()+model->intermediateDataDirectory();
+            for (int i=0;i<placeArgs.size();i++){
+                m_SkyMatrixPrefix=m_SkyMatrixPrefix+placeArgs.at(i);
+            }
+            if (!tmpWeather->writeWea(m_WeaFileName.get())){
+                STADIC_LOG(stadic::Severity::Error, "The creation of the .wea file failed.");
+                return false;
+            }
+        }else{
+            STADIC_LOG(stadic::Severity::Error, "The weather file needed for running the simulation does not exist.");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Daylight::preparePoints(Control *model){
+    //Test whether the points file exists.  If it doesn't, test whether the necessary arguments to create one exist.
+    if (!stadic::exists(model->spaceDirectory()+model->inputDirectory()+model->ptsFile()[0])){
+        if (model->xSpacing()&&model->ySpacing()&& model->offset() && model->zOffset()&& (model->modifiers()||model->identifiers())){
+            STADIC_LOG(stadic::Severity::Info, "The points file "+model->ptsFile()[0] + " does not exist.  The creation of a new points file will be attempted.");
+            GridMaker ptsCreator(model->spaceDirectory()+model->geoDirectory()+ model->geoFile());
+            ptsCreator.setSpaceX(toDouble(model->xSpacing().get()));
+            ptsCreator.setSpaceY(toDouble(model->ySpacing().get()));
+            ptsCreator.setOffset(toDouble(model->offset().get()));
+            ptsCreator.setOffsetZ(toDouble(model->zOffset().get()));
+            if (model->modifiers()){
+                ptsCreator.setLayerNames(model->modifiers().get());
+            }else{
+                ptsCreator.setIdentifiers(model->identifiers().get());
+            }
+            if (ptsCreator.makeGrid()){
+                if (!ptsCreator.writePTS(model->spaceDirectory()+model->inputDirectory()+model->spaceName()+"_AutoGen.pts")){
+                    STADIC_LOG(stadic::Severity::Error, "The writing of the points file has failed.");
+                    return false;
+                }
+                std::vector<std::string> ptsFiles;
+                ptsFiles.push_back(model->spaceName()+"_AutoGen.pts");
+                model->setPTSFile(ptsFiles);
+            }else{
+                STADIC_LOG(stadic::Severity::Error, "The creation of the points file has failed.");
+                return false;
+            }
+        }else{
+            STADIC_LOG(stadic::Severity::Info, "The points file "+model->ptsFile()[0] + " does not exist.  And no arguments exist for one to be generated.");
+            return false;
+        }
+        STADIC_LOG(stadic::Severity::Info, "A new points file has been successfully generated.");
+    }
+
+    return true;
+}
+
+bool Daylight::writeSunsRad(Control *model){
+    //Get number of suns
+    int nSuns;
+    if(model->sunDivisions()==1){
+        nSuns=145;
+    }else if (model->sunDivisions()==2){
+        nSuns=577;
+    }else if (model->sunDivisions()==3){
+        nSuns=1297;
+    }else if (model->sunDivisions()==4){
+        nSuns=2305;
+    }else if (model->sunDivisions()==5){
+        nSuns=3601;
+    }else{
+        nSuns=5185;
+    }
+
+    std::string sunsFile=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_suns_m"+std::to_string(model->sunDivisions())+".rad";
+    if(isFile(sunsFile)){
+        return true;
+    }
+    std::vector<std::string> arguments;
+    arguments.push_back(std::to_string(nSuns));
+    std::string cntProgram="cnt";
+    Process cnt(cntProgram,arguments);
+
+    std::vector<std::string> arguments2;
+    arguments2.push_back("-e");
+    arguments2.push_back("MF:"+std::to_string(model->sunDivisions()));
+    arguments2.push_back("-f");
+    arguments2.push_back("reinsrc.cal");
+    arguments2.push_back("-e");
+    arguments2.push_back("Rbin=recno");
+    arguments2.push_back("-o");
+    arguments2.push_back("solar source sun 0 0 4 ${ Dx } ${ Dy } ${ Dz } 0.533");
+    std::string rcalcProgram="rcalc";
+    Process rcalc(rcalcProgram,arguments2);
+    cnt.setStandardOutputProcess(&rcalc);
+    rcalc.setStandardOutputFile(sunsFile);
+
+    cnt.start();
+    rcalc.start();
+
+    if(!rcalc.wait()){
+        //A partial file would be taken as the suns by the next run
+        if (isFile(sunsFile) && std::remove(sunsFile.c_str())!=0){
+            STADIC_ERROR("The deletion of the file "+sunsFile+" has failed.  Please manually delete this file.");
+        }
+        STADIC_LOG(Severity::Error, "The running of rcalc for the suns has failed.\n"+rcalc.error());
+        return false;
+    }
+    return true;
+}
+
 bool Daylight::createBaseRadFiles(Control *model){
     RadFileData radModel;
     //Add the main material file to the primitive list
@@ -2370,214 +2383,90 @@ bool Daylight::createOctree(std::vector<std::string> files, std::string octreeNa
     return true;
 }
 
-bool Daylight::sumIlluminanceFiles(Control *model){
-    std::string FinalIllFileName;
-    std::string tempFileName;
-    std::string finalSensorFileName;
-    std::string tempSensorFileName;
-    for (int i=0;i<model->windowGroups().size();i++){
-        //Base Illuminance files
-        FinalIllFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base.ill";
-        tempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_ill.tmp";
-        DaylightIlluminanceData baseIll;
-
-        if(isFile(tempFileName)){
-            if (!baseIll.parse(tempFileName,m_Model->weaDataFile().get())){
-                return false;
-            }
-            if (model->windowGroups()[i].bsdfBaseLayers().size()>0){
-                for (int j=0;j<model->windowGroups()[i].bsdfBaseLayers().size();j++){
-                    tempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_bsdf"+std::to_string(j)+".ill";
-                    if(isFile(tempFileName)){
-                        if (!baseIll.addIllFile(tempFileName)){
-                            return false;
-                        }
-                    }
-                }
+bool Daylight::sumIlluminance(const std::string &tempFile, const std::vector<std::string> &layerFiles, const std::string &finalFile, IlluminanceMerger &merger){
+    merger.clearInputs();
+    if(isFile(tempFile)){
+        merger.setPointMajorInput(tempFile);
+        for (unsigned i=0;i<layerFiles.size();i++){
+            if(isFile(layerFiles[i])){
+                merger.addLayer(layerFiles[i]);
             }
-            baseIll.writeIllFileLux(FinalIllFileName);
-        }else{
-            tempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_bsdf0.ill";
-            if(isFile(tempFileName)){
-                if (!baseIll.parse(tempFileName, m_Model->weaDataFile().get())){
-                    return false;
-                }
-            }else{
-                STADIC_ERROR("The illuminance file "+tempFileName+" does not exist.");
+        }
+    }else{
+        //Without the standard result the first BSDF layer becomes the base
+        //that the others are added to
+        for (unsigned i=0;i<layerFiles.size();i++){
+            if(!isFile(layerFiles[i])){
+                STADIC_ERROR("The illuminance file "+layerFiles[i]+" does not exist.");
                 return false;
             }
-            if (model->windowGroups()[i].bsdfBaseLayers().size()>1){
-                for (int j=1;j<model->windowGroups()[i].bsdfBaseLayers().size();j++){
-                    tempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_bsdf"+std::to_string(j)+".ill";
-                    if (!baseIll.addIllFile(tempFileName)){
-                        return false;
-                    }
-                }
-            }
-            baseIll.writeIllFileLux(FinalIllFileName);
-        }
-        //base signal files
-        if (model->windowGroups()[i].shadeControl()->needsSensor()){
-            finalSensorFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+ model->windowGroups()[i].name()+"_shade.sig";;
-            tempSensorFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+ model->windowGroups()[i].name()+"_shade_sig.tmp";
-            DaylightIlluminanceData baseSig;
-            if(isFile(tempSensorFileName)){
-                if (!baseSig.parse(tempSensorFileName,m_Model->weaDataFile().get())){
-                    return false;
-                }
-                if (model->windowGroups()[i].bsdfBaseLayers().size()>0){
-                    for (int j=0;j<model->windowGroups()[i].bsdfBaseLayers().size();j++){
-                        tempSensorFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_shade_bsdf"+std::to_string(j)+".sig";
-                        if(isFile(tempSensorFileName)){
-                            if (!baseSig.addIllFile(tempSensorFileName)){
-                                return false;
-                            }
-                        }
-                    }
-                }
-                baseSig.writeIllFileLux(finalSensorFileName);
-            }else{
-                tempSensorFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_shade_bsdf0.sig";
-                if(isFile(tempSensorFileName)){
-                    if (!baseSig.parse(tempSensorFileName, m_Model->weaDataFile().get())){
-                        return false;
-                    }
-                }else{
-                    STADIC_ERROR("The illuminance file "+tempSensorFileName+" does not exist.");
-                    return false;
-                }
-                if (model->windowGroups()[i].bsdfBaseLayers().size()>1){
-                    for (int j=1;j<model->windowGroups()[i].bsdfBaseLayers().size();j++){
-                        tempSensorFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_shade_bsdf"+std::to_string(j)+".sig";
-                        if (!baseSig.addIllFile(tempSensorFileName)){
-                            return false;
-                        }
-                    }
-                }
-                baseSig.writeIllFileLux(finalSensorFileName);
-            }
+            merger.addLayer(layerFiles[i]);
         }
-        //Shade Setting Illuminance files
-        for (int j=0;j<model->windowGroups()[i].shadeSettingGeometry().size();j++){
-            DaylightIlluminanceData settingIll;
-            tempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string((j+1))+"_ill_std.tmp";
-            FinalIllFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string((j+1))+".ill";
-            if(isFile(tempFileName)){
-                if (!settingIll.parse(tempFileName,m_Model->weaDataFile().get())){
-                    return false;
-                }
-                if (model->windowGroups()[i].bsdfSettingLayers().size()>=j+1){
-                    if (model->windowGroups()[i].bsdfSettingLayers()[j].size()>0){
-                        for (int k=0;k<model->windowGroups()[i].bsdfSettingLayers()[j].size();k++){
-                            tempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string(j)+"_bsdf"+std::to_string(k)+".ill";
-                            settingIll.addIllFile(tempFileName);
-                        }
-                    }
-                }
-                settingIll.writeIllFileLux(FinalIllFileName);
-            }else{
-                tempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string(j)+"_bsdf0.ill";
-                if(isFile(tempFileName)){
-                    if (!settingIll.parse(tempFileName,m_Model->weaDataFile().get())){
-                        return false;
-                    }
-                    if (model->windowGroups()[i].bsdfSettingLayers()[j].size()!=1){
-                        for (int k=1;k<model->windowGroups()[i].bsdfSettingLayers()[j].size();k++){
-                            tempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string(j)+"_bsdf"+std::to_string(k)+".ill";
-                            settingIll.addIllFile(tempFileName);
-                        }
-                    }
-                    settingIll.writeIllFileLux(FinalIllFileName);
-                }else{
-                    STADIC_ERROR("The illuminance file "+tempFileName+" does not exist.");
-                    return false;
-                }
-            }
+        if (layerFiles.empty()){
+            STADIC_ERROR("The illuminance file "+tempFile+" does not exist.");
+            return false;
         }
     }
+    return merger.write(finalFile);
+}
 
-    //Direct illuminance file generation (for sDA and ASE)
-    std::string directFinalIllFileName;
-    std::string directTempFileName;
-    for (int i=0;i<model->windowGroups().size();i++){
-        //Base Illuminance files
-        directFinalIllFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_direct.ill";
-        directTempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_direct_ill.tmp";
-        DaylightIlluminanceData baseIllDirect;
-        if(isFile(directTempFileName)){
-            if (!baseIllDirect.parse(directTempFileName,m_Model->weaDataFile().get())){
-                return false;
-            }
-            if (model->windowGroups()[i].bsdfBaseLayers().size()>0){
-                for (int j=0;j<model->windowGroups()[i].bsdfBaseLayers().size();j++){
-                    directTempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_bsdf"+std::to_string(j)+"_direct.ill";
-                    if(isFile(directTempFileName)){
-                        if (!baseIllDirect.addIllFile(directTempFileName)){
-                            return false;
-                        }
-                    }
-                }
+std::vector<Daylight::IlluminanceSum> Daylight::illuminanceSums(int blindGroupNum, int setting, Control *model){
+    WindowGroup group=model->windowGroups()[blindGroupNum];
+    std::string prefix=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+group.name();
+    std::string results=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+group.name();
+    std::vector<IlluminanceSum> sums;
+    //The direct illuminance files are summed the same way for sDA and ASE
+    for (const std::string &direct : {std::string(""),std::string("_direct")}){
+        IlluminanceSum sum;
+        if (setting<0){
+            //Base Illuminance files
+            sum.standard=prefix+"_base"+direct+"_ill.tmp";
+            for (int j=0;j<group.bsdfBaseLayers().size();j++){
+                sum.layers.push_back(prefix+"_base_bsdf"+std::to_string(j)+direct+".ill");
             }
-            baseIllDirect.writeIllFileLux(directFinalIllFileName);
+            sum.final=results+"_base"+direct+".ill";
         }else{
-            directTempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_bsdf0_direct.ill";
-            if(isFile(directTempFileName)){
-                if (!baseIllDirect.parse(directTempFileName, m_Model->weaDataFile().get())){
-                    return false;
-                }
-            }else{
-                STADIC_ERROR("The illuminance file "+directTempFileName+" does not exist.");
-                return false;
-            }
-            if (model->windowGroups()[i].bsdfBaseLayers().size()>1){
-                for (int j=1;j<model->windowGroups()[i].bsdfBaseLayers().size();j++){
-                    directTempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_bsdf"+std::to_string(j)+"_direct.ill";
-                    if (!baseIllDirect.addIllFile(directTempFileName)){
-                        return false;
-                    }
+            //Shade Setting Illuminance files
+            sum.standard=prefix+"_set"+std::to_string(setting+1)+direct+"_ill_std.tmp";
+            if (group.bsdfSettingLayers().size()>=setting+1){
+                for (int k=0;k<group.bsdfSettingLayers()[setting].size();k++){
+                    sum.layers.push_back(prefix+"_set"+std::to_string(setting)+"_bsdf"+std::to_string(k)+direct+".ill");
                 }
             }
-            baseIllDirect.writeIllFileLux(directFinalIllFileName);
-        }
-        //Shade Setting Illuminance files
-        for (int j=0;j<model->windowGroups()[i].shadeSettingGeometry().size();j++){
-            DaylightIlluminanceData settingIllDirect;
-            directTempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string((j+1))+"_direct_ill_std.tmp";
-            directFinalIllFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string((j+1))+"_direct.ill";
-            if(isFile(tempFileName)){
-                if (!settingIllDirect.parse(directTempFileName,m_Model->weaDataFile().get())){
-                    return false;
-                }
-                if (model->windowGroups()[i].bsdfSettingLayers().size()>=j+1){
-                    if (model->windowGroups()[i].bsdfSettingLayers()[j].size()>0){
-                        for (int k=0;k<model->windowGroups()[i].bsdfSettingLayers()[j].size();k++){
-                            directTempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string(j)+"_bsdf"+std::to_string(k)+"_direct.ill";
-                            settingIllDirect.addIllFile(directTempFileName);
-                        }
-                    }
-                }
-                settingIllDirect.writeIllFileLux(directFinalIllFileName);
-            }else{
-                directTempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string(j)+"_bsdf0_direct.ill";
-                if(isFile(directTempFileName)){
-                    if (!settingIllDirect.parse(directTempFileName,m_Model->weaDataFile().get())){
-                        return false;
-                    }
-                    if (model->windowGroups()[i].bsdfSettingLayers()[j].size()!=1){
-                        for (int k=1;k<model->windowGroups()[i].bsdfSettingLayers()[j].size();k++){
-                            directTempFileName=model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+std::to_string(j)+"_bsdf"+std::to_string(k)+"_direct.ill";
-                            settingIllDirect.addIllFile(directTempFileName);
-                        }
-                    }
-                    settingIllDirect.writeIllFileLux(directFinalIllFileName);
-                }else{
-                    STADIC_ERROR("The illuminance file "+directTempFileName+" does not exist.");
+            sum.final=results+"_set"+std::to_string(setting+1)+direct+".ill";
+        }
+        sums.push_back(sum);
+    }
+    //base signal files
+    if (setting<0 && group.shadeControl()->needsSensor()){
+        IlluminanceSum sum;
+        sum.standard=prefix+"_shade_sig.tmp";
+        for (int j=0;j<group.bsdfBaseLayers().size();j++){
+            sum.layers.push_back(prefix+"_shade_bsdf"+std::to_string(j)+".sig");
+        }
+        sum.final=prefix+"_shade.sig";
+        sums.push_back(sum);
+    }
+    return sums;
+}
+
+bool Daylight::sumIlluminanceFiles(Control *model){
+    std::shared_ptr<const WeatherData> weaData=WeatherCache::weatherData(m_Model->weaDataFile().get());
+    if(!weaData){
+        return false;
+    }
+    IlluminanceMerger merger;
+    merger.setTimeAxis(weaData->month(),weaData->day(),weaData->hour());
+
+    for (int i=0;i<model->windowGroups().size();i++){
+        for (int setting=-1;setting<int(model->windowGroups()[i].shadeSettingGeometry().size());setting++){
+            for (const IlluminanceSum &sum : illuminanceSums(i,setting,model)){
+                if (!sumIlluminance(sum.standard,sum.layers,sum.final,merger)){
                     return false;
                 }
             }
         }
     }
-
     return true;
 }
 
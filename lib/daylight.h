@@ -36,6 +36,8 @@
 #include <vector>
 #include <string>
 #include "radfiledata.h"
+#include "dayill.h"
+#include "skymatrixcache.h"
 
 #include "stadicapi.h"
 
@@ -45,28 +47,46 @@ class STADIC_API Daylight
 public:
     explicit Daylight(BuildingControl *model);                         //Constructor that takes a Control object as an argument
     bool simDaylight();                                                             //Function to simulate the daylight
+    void setThreads(unsigned threads);                                              //Function to set the number of simulation jobs, 0 uses every core
 
 private:
+    struct IlluminanceSum{
+        std::string standard;                                                       //Standard radiance result
+        std::vector<std::string> layers;                                            //BSDF layer results added to the standard result
+        std::string final;                                                          //File the sum is written to
+    };
+
+    bool simWindowGroup(int blindGroupNum, int setting, Control *model);            //Function to simulate the base (-1) or a shade setting of a window group with its simulation case
     bool simBSDF(int blindGroupNum, int setting, int bsdfNum,std::string bsdfRad,std::string remainingRad,std::vector<double> normal,std::string thickness,std::string bsdfXML, std::string bsdfLayer, Control *model);         //Function for simulating a BSDF case
+    bool bsdfSkyMatrices(Control *model, std::string &smx, std::string &dirSMX, std::string &dir5PHsmx);    //Function to get the sky, direct sky and sun matrices of the BSDF cases
     bool simStandard(int blindGroupNum, int setting, Control *model);               //Function to simulate the standard radiance material cases
-    bool simCase1(int blindGroupNum, Control *model);                               //Function for simulating simCase1 : window groups that do not contain BSDFs
-    bool simCase2(int blindGroupNum, Control *model);                               //Function for simulating simCase2 : window groups that contain BSDFs, but not in the base case
-    bool simCase3(int blindGroupNum, Control *model);                               //Function for simulating simCase3 : window groups that contain BSDFs even in the base case, but the glazing layers are not BSDFs
-    bool simCase4(int blindGroupNum, Control *model);                               //Function for simulating simCase4 : window groups that have shade materials in addition to the glazing layer which is a BSDF
-    bool simCase5(int blindGroupNum, Control *model);                               //Function for simulating simCase5 : window groups that have added geometry, but it is a proxy geometry
-    bool simCase6(int blindGroupNum, Control *model);                               //Function for simulating simCase6 : window groups that only have the glazing layer as a BSDF
+    bool simCase1(int blindGroupNum, int setting, Control *model);                  //Function for simulating simCase1 : window groups that do not contain BSDFs
+    bool simCase2(int blindGroupNum, int setting, Control *model);                  //Function for simulating simCase2 : window groups that contain BSDFs, but not in the base case
+    bool simCase3(int blindGroupNum, int setting, Control *model);                  //Function for simulating simCase3 : window groups that contain BSDFs even in the base case, but the glazing layers are not BSDFs
+    bool simCase4(int blindGroupNum, int setting, Control *model);                  //Function for simulating simCase4 : window groups that have shade materials in addition to the glazing layer which is a BSDF
+    bool simCase5(int blindGroupNum, int setting, Control *model);                  //Function for simulating simCase5 : window groups that have added geometry, but it is a proxy geometry
+    bool simCase6(int blindGroupNum, int setting, Control *model);                  //Function for simulating simCase6 : window groups that only have the glazing layer as a BSDF
     bool uniqueGlazingMaterials(Control *model);                                    //Function to ensure that the each window group contains unique glazing materials
     bool testSimCase(Control *model);                                               //Function to determine the simulation case for each window group
     bool setSimCase(int setting, int simCase);                                      //Function to set the simulation case for a window group
     bool writeSky(Control *model);                                                  //Function to write the sky rad file
+    bool writeWea(Control *model);                                                  //Function to write the wea file for gendaymtx
+    bool preparePoints(Control *model);                                             //Function to generate the points file if it does not exist
+    bool writeSunsRad(Control *model);                                              //Function to write the rad file of the suns
     bool createBaseRadFiles(Control *model);                                        //Function to create the base rad files
     bool createOctree(std::vector<std::string> files, std::string octreeName);      //Function to create an octree given a vector of files
+    bool sumIlluminance(const std::string &tempFile, const std::vector<std::string> &layerFiles, const std::string &finalFile, IlluminanceMerger &merger);    //Function to sum one standard result and its BSDF layers into a final file
     bool sumIlluminanceFiles(Control *model);                                       //Function to sum the illuminance files for each window group setting
+    std::vector<IlluminanceSum> illuminanceSums(int blindGroupNum, int setting, Control *model);    //Function that returns the files summed for the base (-1) or a shade setting of a window group
 
     std::vector<int> m_SimCase;                                                     //Vector holding the simulation case for each window group
     BuildingControl *m_Model;                                                               //Control object
     std::vector<RadFileData* > m_RadFiles;                                          //Vector of RadFileData objects
     boost::optional<std::string> m_WeaFileName;                                                      //String that holds the name of the wea data file for input to gendaymtx.
+    std::string m_Timesteps;                                                        //String that holds the number of timesteps in the weather file for dctimestep and rcollate
+    unsigned m_Threads;                                                             //Number of simulation jobs, 0 uses every core
+    SkyMatrixCache m_SkyMatrices;                                                   //Sky matrices shared by every space, window group and setting
+    std::string m_SkyMatrixPrefix;                                                  //Path that the sky matrices are named from
 
 };
 
@@ -31,7 +31,6 @@
 #include "elecill.h"
 #include "logging.h"
 #include "functions.h"
-#include <fstream>
 
 namespace stadic {
 
@@ -95,24 +94,27 @@ std::vector<SpatialIlluminance> ElectricIlluminanceData::illuminance(){
 }
 
 bool ElectricIlluminanceData::parseIlluminance(std::string fileName){
-    std::ifstream iFile;
-    iFile.open(fileName);
-    if (!iFile.is_open()){
+    NumericReader reader;
+    if (!reader.open(fileName)){
         STADIC_ERROR("The opening of the illuminance file "+fileName+ " failed.");
         return false;
     }
-    std::string line;
+    std::vector<double> vals;
 
-    while (std::getline(iFile, line)){
-        std::vector<std::string> vals;
-        vals=split(line, ' ');
+    while (reader.readRow(vals)){
+        if (vals.empty()){
+            continue;
+        }
         if(vals.size() != 4) {
-            STADIC_ERROR("The illuminance file "+fileName +" does not contain 4 items per line.");
+            STADIC_ERROR("The illuminance file "+fileName +" does not contain 4 items per line ("+reader.position()+").");
             return false;
         }
-        m_Illuminance.push_back(SpatialIlluminance(vals[0], vals[1], vals[2], toDouble(vals[3])));
+        m_Illuminance.push_back(SpatialIlluminance(reader.token(0), reader.token(1), reader.token(2), vals[3]));
+    }
+    if (reader.failed()){
+        STADIC_ERROR("The illuminance file "+fileName+" contains a malformed value at "+reader.position()+".");
+        return false;
     }
-    iFile.close();
     return true;
 }
 
@@ -36,8 +36,11 @@
 #include <iostream>
 #ifdef _MSC_VER
 #include <Windows.h>
+#include <sys/stat.h>
 #else //POSIX
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
 #endif
@@ -97,6 +100,42 @@ bool exists(const std::string &path)
     return isFile(path);
 }
 
+bool fileStamp(const std::string &file, time_t *modified, long long *size, long *nanoseconds)
+{
+#ifdef _MSC_VER
+    struct _stat64 path;
+
+    if(_stat64(file.c_str(), &path)==0 && (path.st_mode & _S_IFREG)){
+        if(nanoseconds) {
+            //The write time is held in 100 ns ticks
+            WIN32_FILE_ATTRIBUTE_DATA attributes;
+            *nanoseconds = 0;
+            if(GetFileAttributesEx(file.c_str(), GetFileExInfoStandard, &attributes)) {
+                ULARGE_INTEGER ticks;
+                ticks.LowPart = attributes.ftLastWriteTime.dwLowDateTime;
+                ticks.HighPart = attributes.ftLastWriteTime.dwHighDateTime;
+                *nanoseconds = long(ticks.QuadPart % 10000000) * 100;
+            }
+        }
+#else //POSIX
+    struct stat path;
+
+    if(stat(file.c_str(), &path)==0 && S_ISREG(path.st_mode)){
+        if(nanoseconds) {
+#ifdef __APPLE__
+            *nanoseconds = path.st_mtimespec.tv_nsec;
+#else
+            *nanoseconds = path.st_mtim.tv_nsec;
+#endif
+        }
+#endif
+        *modified = path.st_mtime;
+        *size = path.st_size;
+        return true;
+    }
+    return false;
+}
+
 PathName::PathName(const std::string &path) : m_isFile(false)
 {
     if(path.size() > 0) {
@@ -204,4 +243,105 @@ bool PathName::exists() const
     return stadic::exists(file);
 }
 
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_handle(nullptr), m_mapping(nullptr)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string &file)
+{
+    close();
+#ifdef _MSC_VER
+    HANDLE handle = CreateFile(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, NULL);
+    if(handle == INVALID_HANDLE_VALUE) {
+        STADIC_ERROR("The opening of the file "+file+" failed.");
+        return false;
+    }
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+        STADIC_ERROR("The file "+file+" is empty and cannot be mapped.");
+        CloseHandle(handle);
+        return false;
+    }
+    HANDLE mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL) {
+        STADIC_ERROR("The mapping of the file "+file+" failed.");
+        CloseHandle(handle);
+        return false;
+    }
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(view == NULL) {
+        STADIC_ERROR("The mapping of the file "+file+" failed.");
+        CloseHandle(mapping);
+        CloseHandle(handle);
+        return false;
+    }
+    m_handle = handle;
+    m_mapping = mapping;
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else //POSIX
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if(fd < 0) {
+        STADIC_ERROR("The opening of the file "+file+" failed.");
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0) {
+        STADIC_ERROR("The file "+file+" is empty and cannot be mapped.");
+        ::close(fd);
+        return false;
+    }
+    void *view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file
+    ::close(fd);
+    if(view == MAP_FAILED) {
+        STADIC_ERROR("The mapping of the file "+file+" failed.");
+        return false;
+    }
+    m_mapping = view;
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(m_data == nullptr) {
+        return;
+    }
+#ifdef _MSC_VER
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    CloseHandle(static_cast<HANDLE>(m_handle));
+#else //POSIX
+    munmap(m_mapping, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_handle = nullptr;
+    m_mapping = nullptr;
+}
+
+bool MappedFile::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+const char *MappedFile::data() const
+{
+    return m_data;
+}
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
+
 }
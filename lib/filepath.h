@@ -45,6 +45,7 @@ namespace stadic{
 bool STADIC_API isDir(const std::string &dir);
 bool STADIC_API isFile(const std::string &file);
 bool STADIC_API exists(const std::string &path);
+bool STADIC_API fileStamp(const std::string &file, time_t *modified, long long *size, long *nanoseconds=nullptr);
 
 class STADIC_API PathName
 {
@@ -62,5 +63,29 @@ private:
     bool m_isFile;
 };
 
+// A MappedFile maps the whole of a file read-only into memory so that large
+// binary files can be used in place rather than read into a buffer.  The
+// mapping is released when the object is destroyed.
+class STADIC_API MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &file);                                         //Function to map a file, returns false on failure
+    void close();                                                               //Function to release the mapping
+    bool isOpen() const;                                                        //Function that returns true if a file is mapped
+    const char *data() const;                                                   //Function that returns a pointer to the start of the mapping
+    size_t size() const;                                                        //Function that returns the size of the mapping in bytes
+
+private:
+    const char *m_data;
+    size_t m_size;
+    void *m_handle;
+    void *m_mapping;
+};
+
 }
 #endif // OBJECTS_H
@@ -32,6 +32,11 @@
 #include "functions.h"
 #include <iostream>
 #include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
 #include <boost/optional.hpp>
 
 namespace stadic{
@@ -195,4 +200,600 @@ void tokenize(std::queue<std::string> &container, const std::string &string)
     }
 }
 
+//Number parsing without the std::string and stream overhead of toDouble.
+//Numbers with at most 19 significant digits and a decimal exponent within
+//+/-22 are converted exactly with a single multiplication or division, which
+//gives the same correctly rounded result as strtod. Anything else is handed
+//to strtod.
+static const double exactPowersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+const char *parseDouble(const char *begin, const char *end, double *value)
+{
+    const char *p = begin;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    //Locate the integer and fraction digits before converting anything
+    const char *integer = p;
+    while(p < end && isDigit(*p)) {
+        ++p;
+    }
+    const char *integerEnd = p;
+    const char *fraction = p;
+    const char *fractionEnd = p;
+    if(p < end && *p == '.') {
+        fraction = ++p;
+        while(p < end && isDigit(*p)) {
+            ++p;
+        }
+        fractionEnd = p;
+    }
+    if(integer == integerEnd && fraction == fractionEnd) {
+        return nullptr;
+    }
+    int exponent = 0;
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        bool negativeExponent = false;
+        if(e < end && (*e == '-' || *e == '+')) {
+            negativeExponent = *e == '-';
+            ++e;
+        }
+        if(e == end || !isDigit(*e)) {
+            return nullptr;
+        }
+        for(; e < end && isDigit(*e); ++e) {
+            if(exponent < 100000) {
+                exponent = exponent * 10 + (*e - '0');
+            }
+        }
+        if(negativeExponent) {
+            exponent = -exponent;
+        }
+        p = e;
+    }
+    //Leading zeros do not count against the 19 digits that fit in the mantissa
+    while(integer < integerEnd && *integer == '0') {
+        ++integer;
+    }
+    if(integer == integerEnd) {
+        while(fraction < fractionEnd && *fraction == '0') {
+            ++fraction;
+            --exponent;
+        }
+    }
+    if((integerEnd - integer) + (fractionEnd - fraction) <= 19) {
+        uint64_t mantissa = 0;
+        for(const char *c = integer; c < integerEnd; ++c) {
+            mantissa = mantissa * 10 + (*c - '0');
+        }
+        for(const char *c = fraction; c < fractionEnd; ++c) {
+            mantissa = mantissa * 10 + (*c - '0');
+        }
+        exponent -= static_cast<int>(fractionEnd - fraction);
+        if(mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+            double result = static_cast<double>(mantissa);
+            if(exponent < 0) {
+                result /= exactPowersOfTen[-exponent];
+            } else {
+                result *= exactPowersOfTen[exponent];
+            }
+            *value = negative ? -result : result;
+            return p;
+        }
+    }
+    char buffer[128];
+    size_t length = p - begin;
+    if(length < sizeof(buffer)) {
+        std::memcpy(buffer, begin, length);
+        buffer[length] = '\0';
+        *value = std::strtod(buffer, nullptr);
+    } else {
+        *value = std::strtod(std::string(begin, p).c_str(), nullptr);
+    }
+    return p;
+}
+
+bool parseRow(const char *begin, const char *end, std::vector<double> &row, unsigned *column)
+{
+    row.clear();
+    const char *p = begin;
+    while(true) {
+        while(p < end && isBlank(*p)) {
+            ++p;
+        }
+        if(p == end) {
+            return true;
+        }
+        double value;
+        const char *next = parseDouble(p, end, &value);
+        if(next == nullptr || (next < end && !isBlank(*next))) {
+            if(column != nullptr) {
+                *column = static_cast<unsigned>(p - begin) + 1;
+            }
+            row.clear();
+            return false;
+        }
+        row.push_back(value);
+        p = next;
+    }
+}
+
+NumericReader::NumericReader(size_t bufferSize) : m_Buffer(bufferSize > 0 ? bufferSize : 1), m_Begin(0), m_End(0),
+    m_AtEnd(false), m_Failed(false), m_Line(0), m_Column(0), m_LineBegin(0), m_LineEnd(0)
+{
+}
+
+bool NumericReader::open(const std::string &fileName)
+{
+    close();
+    m_File.open(fileName, std::ios::in | std::ios::binary);
+    return m_File.is_open();
+}
+
+void NumericReader::close()
+{
+    if(m_File.is_open()) {
+        m_File.close();
+    }
+    m_File.clear();
+    m_Begin = m_End = 0;
+    m_AtEnd = false;
+    m_Failed = false;
+    m_Line = 0;
+    m_Column = 0;
+    m_LineBegin = m_LineEnd = 0;
+}
+
+bool NumericReader::readRow(std::vector<double> &row)
+{
+    row.clear();
+    m_LineBegin = m_LineEnd = 0;
+    if(m_Failed || !m_File.is_open()) {
+        return false;
+    }
+    //Find the end of the line, reading more of the file as needed
+    size_t searched = m_Begin;
+    const char *newline;
+    while((newline = static_cast<const char*>(std::memchr(m_Buffer.data() + searched, '\n', m_End - searched))) == nullptr) {
+        searched = m_End - m_Begin;
+        if(!fill()) {
+            break;
+        }
+        searched += m_Begin;
+    }
+    if(newline == nullptr && m_Begin == m_End) {
+        return false;
+    }
+    const char *lineBegin = m_Buffer.data() + m_Begin;
+    const char *lineEnd = newline != nullptr ? newline : m_Buffer.data() + m_End;
+    m_Line++;
+    if(!parseRow(lineBegin, lineEnd, row, &m_Column)) {
+        m_Failed = true;
+        return false;
+    }
+    m_LineBegin = m_Begin;
+    m_LineEnd = lineEnd - m_Buffer.data();
+    m_Begin = newline != nullptr ? newline - m_Buffer.data() + 1 : m_End;
+    return true;
+}
+
+bool NumericReader::failed() const
+{
+    return m_Failed;
+}
+
+unsigned NumericReader::line() const
+{
+    return m_Line;
+}
+
+unsigned NumericReader::column() const
+{
+    return m_Column;
+}
+
+std::string NumericReader::position() const
+{
+    std::string position = "line " + toString(m_Line);
+    if(m_Failed) {
+        position += ", column " + toString(m_Column);
+    }
+    return position;
+}
+
+std::string NumericReader::token(unsigned i) const
+{
+    //The line is still in the buffer, so walk it again rather than keeping
+    //the position of every value on every line
+    const char *p = m_Buffer.data() + m_LineBegin;
+    const char *end = m_Buffer.data() + m_LineEnd;
+    while(true) {
+        while(p < end && isBlank(*p)) {
+            ++p;
+        }
+        const char *tokenEnd = p;
+        while(tokenEnd < end && !isBlank(*tokenEnd)) {
+            ++tokenEnd;
+        }
+        if(i == 0 || p == end) {
+            return std::string(p, tokenEnd);
+        }
+        --i;
+        p = tokenEnd;
+    }
+}
+
+bool NumericReader::fill()
+{
+    if(m_AtEnd) {
+        return false;
+    }
+    if(m_Begin > 0) {
+        std::memmove(m_Buffer.data(), m_Buffer.data() + m_Begin, m_End - m_Begin);
+        m_End -= m_Begin;
+        m_Begin = 0;
+    }
+    if(m_End == m_Buffer.size()) {
+        //A line longer than the buffer
+        m_Buffer.resize(2 * m_Buffer.size());
+    }
+    m_File.read(m_Buffer.data() + m_End, m_Buffer.size() - m_End);
+    size_t count = static_cast<size_t>(m_File.gcount());
+    if(count == 0) {
+        m_AtEnd = true;
+        return false;
+    }
+    m_End += count;
+    return true;
+}
+
+unsigned formatInteger(long long value, char *buffer)
+{
+    char *out = buffer;
+    unsigned long long magnitude = static_cast<unsigned long long>(value);
+    if(value < 0) {
+        *out++ = '-';
+        magnitude = 0 - magnitude;
+    }
+    char digits[20];
+    unsigned count = 0;
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude != 0);
+    while(count > 0) {
+        *out++ = digits[--count];
+    }
+    return out - buffer;
+}
+
+//Digits of mantissa, which has count significant digits, with exponent
+//being the power of ten of the first one, laid out as printf's %g does
+static unsigned writeGeneral(unsigned long long mantissa, unsigned count, int exponent, char *out)
+{
+    char digits[20];
+    for(unsigned i = count; i > 0; --i) {
+        digits[i - 1] = '0' + mantissa % 10;
+        mantissa /= 10;
+    }
+    bool exponential = exponent < -4 || exponent >= int(count);
+    while(count > 1 && digits[count - 1] == '0') {
+        --count;
+    }
+    char *start = out;
+    if(exponential) {
+        *out++ = digits[0];
+        if(count > 1) {
+            *out++ = '.';
+            for(unsigned i = 1; i < count; ++i) {
+                *out++ = digits[i];
+            }
+        }
+        *out++ = 'e';
+        *out++ = exponent < 0 ? '-' : '+';
+        unsigned magnitude = exponent < 0 ? -exponent : exponent;
+        if(magnitude >= 100) {
+            *out++ = '0' + magnitude / 100;
+        }
+        *out++ = '0' + magnitude / 10 % 10;
+        *out++ = '0' + magnitude % 10;
+    } else if(exponent < 0) {
+        *out++ = '0';
+        *out++ = '.';
+        for(int i = -1; i > exponent; --i) {
+            *out++ = '0';
+        }
+        for(unsigned i = 0; i < count; ++i) {
+            *out++ = digits[i];
+        }
+    } else {
+        for(int i = 0; i <= exponent; ++i) {
+            *out++ = unsigned(i) < count ? digits[i] : '0';
+        }
+        if(count > unsigned(exponent) + 1) {
+            *out++ = '.';
+            for(unsigned i = exponent + 1; i < count; ++i) {
+                *out++ = digits[i];
+            }
+        }
+    }
+    return out - start;
+}
+
+//Rounds value (positive and finite) to precision significant digits with a
+//single multiplication or division by an exact power of ten. That carries
+//one rounding error, so a result that lands near a tie is left for printf,
+//which rounds the exact binary value.
+static bool roundGeneral(double value, unsigned precision, unsigned long long *mantissa, int *exponent)
+{
+    int e = static_cast<int>(std::floor(std::log10(value)));
+    int shift = int(precision) - 1 - e;
+    if(shift > 22 || shift < -22) {
+        return false;
+    }
+    double scaled = shift >= 0 ? value * exactPowersOfTen[shift] : value / exactPowersOfTen[-shift];
+    double lower = exactPowersOfTen[precision - 1];
+    if(scaled < lower) {
+        //log10 came out one too high
+        ++shift;
+        --e;
+        if(shift > 22) {
+            return false;
+        }
+        scaled = shift >= 0 ? value * exactPowersOfTen[shift] : value / exactPowersOfTen[-shift];
+    }
+    double whole = std::floor(scaled);
+    double fraction = scaled - whole;
+    if(std::fabs(fraction - 0.5) < 1e-6) {
+        return false;
+    }
+    unsigned long long rounded = static_cast<unsigned long long>(whole) + (fraction > 0.5 ? 1 : 0);
+    if(rounded >= static_cast<unsigned long long>(exactPowersOfTen[precision])) {
+        //Either log10 came out one too low or the rounding carried over
+        if(rounded % 10 != 0) {
+            return false;
+        }
+        rounded /= 10;
+        ++e;
+    }
+    *mantissa = rounded;
+    *exponent = e;
+    return true;
+}
+
+//The shortest text is the inverse of the parseDouble fast path: an integer m
+//below 2^53 divided by an exact power of ten is correctly rounded, so if
+//m/10^d gives back the value then writing m with d decimals reads back
+//exactly, and the smallest such d gives the shortest text. Values outside
+//the range it covers are printed with increasing precision until they read
+//back.
+unsigned formatDouble(double value, char *buffer, unsigned precision)
+{
+    if(value != value || value - value != 0) {
+        return std::sprintf(buffer, "%g", value);
+    }
+    char *out = buffer;
+    if(std::signbit(value)) {
+        *out++ = '-';
+        value = -value;
+    }
+    if(value == 0) {
+        *out++ = '0';
+        return out - buffer;
+    }
+    if(precision > 0) {
+        unsigned long long mantissa;
+        int exponent;
+        if(precision <= 9 && roundGeneral(value, precision, &mantissa, &exponent)) {
+            return out - buffer + writeGeneral(mantissa, precision, exponent, out);
+        }
+        return out - buffer + std::sprintf(out, "%.*g", int(precision), value);
+    }
+    const double exactInteger = 9007199254740992.0;
+    if(value >= 1e-5 && value < exactInteger) {
+        for(unsigned decimals = 0; decimals <= 22; ++decimals) {
+            double scaled = value * exactPowersOfTen[decimals];
+            if(scaled >= exactInteger) {
+                break;
+            }
+            unsigned long long mantissa = static_cast<unsigned long long>(scaled + 0.5);
+            if(static_cast<double>(mantissa) / exactPowersOfTen[decimals] != value) {
+                continue;
+            }
+            char digits[20];
+            unsigned count = 0;
+            do {
+                digits[count++] = '0' + mantissa % 10;
+                mantissa /= 10;
+            } while(mantissa != 0);
+            while(count <= decimals) {
+                digits[count++] = '0';
+            }
+            while(count > decimals) {
+                *out++ = digits[--count];
+            }
+            if(decimals > 0) {
+                *out++ = '.';
+                while(count > 0) {
+                    *out++ = digits[--count];
+                }
+            }
+            return out - buffer;
+        }
+    }
+    for(int precision = 15; precision < 17; ++precision) {
+        int length = std::sprintf(out, "%.*g", precision, value);
+        if(std::strtod(out, nullptr) == value) {
+            return out - buffer + length;
+        }
+    }
+    return out - buffer + std::sprintf(out, "%.17g", value);
+}
+
+BufferedWriter::BufferedWriter(size_t bufferSize) : m_File(nullptr), m_Buffer(bufferSize < 64 ? 64 : bufferSize),
+    m_Used(0), m_Precision(6), m_Failed(false)
+{
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    close();
+}
+
+bool BufferedWriter::open(const std::string &fileName, bool append)
+{
+    close();
+    m_File = std::fopen(fileName.c_str(), append ? "a" : "w");
+    if(m_File == nullptr) {
+        return false;
+    }
+    //The buffer here is the only one, so each flush is a single write
+    std::setvbuf(m_File, nullptr, _IONBF, 0);
+    m_Failed = false;
+    return true;
+}
+
+bool BufferedWriter::close()
+{
+    if(m_File == nullptr) {
+        return !m_Failed;
+    }
+    flush();
+    if(std::fclose(m_File) != 0) {
+        m_Failed = true;
+    }
+    m_File = nullptr;
+    return !m_Failed;
+}
+
+bool BufferedWriter::isOpen() const
+{
+    return m_File != nullptr;
+}
+
+bool BufferedWriter::failed() const
+{
+    return m_Failed;
+}
+
+void BufferedWriter::write(const char *data, size_t size)
+{
+    if(m_Used + size > m_Buffer.size()) {
+        flush();
+        if(size > m_Buffer.size()) {
+            if(m_File != nullptr && std::fwrite(data, 1, size, m_File) != size) {
+                m_Failed = true;
+            }
+            return;
+        }
+    }
+    std::memcpy(m_Buffer.data() + m_Used, data, size);
+    m_Used += size;
+}
+
+void BufferedWriter::setPrecision(unsigned precision)
+{
+    m_Precision = precision > 17 ? 17 : precision;
+}
+
+BufferedWriter &BufferedWriter::operator<<(char value)
+{
+    reserve(1);
+    m_Buffer[m_Used++] = value;
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(const char *value)
+{
+    write(value, std::strlen(value));
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(const std::string &value)
+{
+    write(value.data(), value.size());
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(int value)
+{
+    return *this << static_cast<long long>(value);
+}
+
+BufferedWriter &BufferedWriter::operator<<(unsigned value)
+{
+    return *this << static_cast<unsigned long long>(value);
+}
+
+BufferedWriter &BufferedWriter::operator<<(long value)
+{
+    return *this << static_cast<long long>(value);
+}
+
+BufferedWriter &BufferedWriter::operator<<(unsigned long value)
+{
+    return *this << static_cast<unsigned long long>(value);
+}
+
+BufferedWriter &BufferedWriter::operator<<(long long value)
+{
+    reserve(21);
+    m_Used += formatInteger(value, m_Buffer.data() + m_Used);
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(unsigned long long value)
+{
+    reserve(21);
+    char digits[20];
+    unsigned count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while(value != 0);
+    while(count > 0) {
+        m_Buffer[m_Used++] = digits[--count];
+    }
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(double value)
+{
+    reserve(32);
+    m_Used += formatDouble(value, m_Buffer.data() + m_Used, m_Precision);
+    return *this;
+}
+
+void BufferedWriter::reserve(size_t size)
+{
+    if(m_Used + size > m_Buffer.size()) {
+        flush();
+    }
+}
+
+void BufferedWriter::flush()
+{
+    if(m_Used == 0) {
+        return;
+    }
+    if(m_File == nullptr || std::fwrite(m_Buffer.data(), 1, m_Used, m_File) != m_Used) {
+        m_Failed = true;
+    }
+    m_Used = 0;
+}
+
 }
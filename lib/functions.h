@@ -34,6 +34,8 @@
 #include <vector>
 #include <queue>
 #include <sstream>
+#include <fstream>
+#include <cstdio>
 #include "stadicapi.h"
 #include "logging.h"
 namespace stadic{
@@ -64,5 +66,89 @@ template<class T> void tokenize(T &container, const std::string &string)
     }
 }
 void STADIC_API tokenize(std::queue<std::string> &container, const std::string &string);
+const char STADIC_API *parseDouble(const char *begin, const char *end, double *value);  //Function that parses a number at begin and returns a pointer past it, or nullptr if there is none
+bool STADIC_API parseRow(const char *begin, const char *end, std::vector<double> &row, unsigned *column = nullptr);  //Function that parses the whitespace separated numbers of one line into row, setting column on a malformed value
+
+// A NumericReader reads whitespace separated numbers from a text file one
+// line at a time. The file is read through a single large buffer and the
+// values are parsed where they lie, so once the row vector has grown to the
+// length of a line no further allocation takes place. Reading stops at the
+// first malformed value, the position of which is then given by line() and
+// column().
+class STADIC_API NumericReader
+{
+public:
+    explicit NumericReader(size_t bufferSize = 1 << 20);
+    bool open(const std::string &fileName);                                     //Function to open a file, returns false on failure
+    void close();                                                               //Function to close the file
+    bool readRow(std::vector<double> &row);                                     //Function that parses the next line into row, returns false at the end of the file or on a malformed value
+    bool failed() const;                                                        //Function that returns true if reading stopped on a malformed value
+    unsigned line() const;                                                      //Function that returns the number of the last line read
+    unsigned column() const;                                                    //Function that returns the column of the malformed value
+    std::string position() const;                                               //Function that returns the position of the last line read for use in messages
+    std::string token(unsigned i) const;                                        //Function that returns the text of the i-th value on the last line read
+
+private:
+    bool fill();                                                                //Function to move the unread text to the front of the buffer and read more
+
+    std::ifstream m_File;
+    std::vector<char> m_Buffer;
+    size_t m_Begin;                                                             //Offset of the first unread character
+    size_t m_End;                                                               //Offset one past the last character read from the file
+    bool m_AtEnd;
+    bool m_Failed;
+    unsigned m_Line;
+    unsigned m_Column;
+    size_t m_LineBegin;                                                         //Offset of the start of the last line read
+    size_t m_LineEnd;                                                           //Offset of the end of the last line read
+};
+
+unsigned STADIC_API formatInteger(long long value, char *buffer);              //Function that writes an integer into buffer (at least 21 characters) and returns the length
+unsigned STADIC_API formatDouble(double value, char *buffer, unsigned precision = 6);   //Function that writes value into buffer (at least 32 characters) as printf's %.*g would, or as the shortest text that reads back exactly for a precision of 0, and returns the length
+
+// A BufferedWriter is the output counterpart of NumericReader. Text is
+// gathered in a single large buffer and handed to the operating system one
+// buffer at a time, and numbers are formatted directly into the buffer. By
+// default doubles come out exactly as a std::ostream would write them (six
+// significant digits); setPrecision(0) writes the shortest text that reads
+// back as the same value instead. Nothing is flushed at the end of a line;
+// close() writes whatever remains and reports whether every write succeeded.
+class STADIC_API BufferedWriter
+{
+public:
+    explicit BufferedWriter(size_t bufferSize = 1 << 20);
+    ~BufferedWriter();
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    bool open(const std::string &fileName, bool append = false);                //Function to create or truncate (or append to) a file, returns false on failure
+    bool close();                                                               //Function to write out the buffer and close the file, returns false if any write failed
+    bool isOpen() const;                                                        //Function that returns true if a file is open
+    bool failed() const;                                                        //Function that returns true if a write has failed
+    void write(const char *data, size_t size);                                  //Function to append raw characters
+    void setPrecision(unsigned precision);                                      //Function to set the significant digits of doubles, 0 for the shortest exact text
+
+    BufferedWriter &operator<<(char value);
+    BufferedWriter &operator<<(const char *value);
+    BufferedWriter &operator<<(const std::string &value);
+    BufferedWriter &operator<<(int value);
+    BufferedWriter &operator<<(unsigned value);
+    BufferedWriter &operator<<(long value);
+    BufferedWriter &operator<<(unsigned long value);
+    BufferedWriter &operator<<(long long value);
+    BufferedWriter &operator<<(unsigned long long value);
+    BufferedWriter &operator<<(double value);
+
+private:
+    void reserve(size_t size);                                                  //Function to make room for size more characters in the buffer
+    void flush();                                                               //Function to hand the buffer to the operating system
+
+    std::FILE *m_File;
+    std::vector<char> m_Buffer;
+    size_t m_Used;                                                              //Number of characters waiting in the buffer
+    unsigned m_Precision;                                                       //Significant digits of doubles, 0 for the shortest exact text
+    bool m_Failed;
+};
+
 }
 #endif // FUNCTIONS_H
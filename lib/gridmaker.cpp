@@ -65,6 +65,7 @@ GridMaker::GridMaker(std::vector<std::string> fileList)
     m_PolySetHeight.clear();
     m_UseThreshold=false;
     m_UseRotation=false;
+    m_Area=0;
 }
 GridMaker::GridMaker(std::string file){
     m_RadFile.addRad(file);
@@ -75,6 +76,7 @@ GridMaker::GridMaker(std::string file){
     m_PolySetHeight.clear();
     m_UseThreshold=false;
     m_UseRotation=false;
+    m_Area=0;
 }
 
 //Setters
@@ -271,7 +273,7 @@ bool GridMaker::calcArea(){
     for (int i=0;i<m_UnitedPolygon.size();i++){
         area=area+boost::geometry::area(m_UnitedPolygon[i]);
     }
-
+    m_Area=area;
     return true;
 }
 
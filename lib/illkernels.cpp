@@ -0,0 +1,712 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "illkernels.h"
+#include <atomic>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STADIC_X86_KERNELS
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define STADIC_X86_KERNELS
+#define TARGET_SSE2
+#define TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace stadic {
+
+namespace kernels {
+
+//Kernels that take a divisor or a comparison are templates on them, so lux
+//values skip the division and nothing is decided inside the loops. The tables
+//hold every specialization, indexed [divide][comparison]
+struct KernelTable
+{
+    InstructionSet set;
+    void (*accumulate)(double *, const double *, size_t);
+    void (*scaledCopy)(double *, const double *, size_t, double);
+    size_t (*countAbove[2][2])(const double *, const unsigned char *, size_t, double, double);
+    bool (*anyAbove)(const double *, size_t, double);
+    void (*countBands[2])(const double *, const unsigned char *, size_t, double, double, double, size_t *);
+    double (*sum[2])(const double *, const unsigned char *, size_t, double);
+    size_t (*countAboveAt[2][2])(const double *, const unsigned *, size_t, double, double);
+    void (*countBandsAt[2])(const double *, const unsigned *, size_t, double, double, double, size_t *);
+    double (*sumAt[2])(const double *, const unsigned *, size_t, double);
+};
+
+#define DIVIDE_TABLE(kernel) {kernel<false>, kernel<true>}
+#define COMPARISON_TABLE(kernel) {{kernel<false, Comparison::Greater>, kernel<false, Comparison::GreaterOrEqual>}, \
+                                  {kernel<true, Comparison::Greater>, kernel<true, Comparison::GreaterOrEqual>}}
+
+template <bool Divide> static inline double convert(double value, double divisor)
+{
+    return Divide ? value / divisor : value;
+}
+
+template <Comparison C> static inline bool compare(double value, double threshold)
+{
+    return C == Comparison::Greater ? value > threshold : value >= threshold;
+}
+
+//Portable versions, which are also the reference for the others
+
+static void portableAccumulate(double *target, const double *source, size_t count)
+{
+    for(size_t i = 0; i < count; i++) {
+        target[i] += source[i];
+    }
+}
+
+static void portableScaledCopy(double *target, const double *source, size_t count, double divisor)
+{
+    for(size_t i = 0; i < count; i++) {
+        target[i] = source[i] / divisor;
+    }
+}
+
+template <bool Divide, Comparison C>
+static size_t portableCountAbove(const double *values, const unsigned char *mask, size_t count, double threshold,
+                                 double divisor)
+{
+    size_t result = 0;
+    for(size_t i = 0; i < count; i++) {
+        if((mask == nullptr || mask[i]) && compare<C>(convert<Divide>(values[i], divisor), threshold)) {
+            result++;
+        }
+    }
+    return result;
+}
+
+static bool portableAnyAbove(const double *values, size_t count, double threshold)
+{
+    for(size_t i = 0; i < count; i++) {
+        if(values[i] > threshold) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <bool Divide>
+static void portableCountBands(const double *values, const unsigned char *mask, size_t count, double low, double high,
+                               double divisor, size_t *counts)
+{
+    for(size_t i = 0; i < count; i++) {
+        if(mask == nullptr || mask[i]) {
+            double value = convert<Divide>(values[i], divisor);
+            if(value < low) {
+                counts[0]++;
+            } else if(value <= high) {
+                counts[1]++;
+            } else {
+                counts[2]++;
+            }
+        }
+    }
+}
+
+template <bool Divide>
+static double portableSum(const double *values, const unsigned char *mask, size_t count, double divisor)
+{
+    double result = 0;
+    for(size_t i = 0; i < count; i++) {
+        if(mask == nullptr || mask[i]) {
+            result += convert<Divide>(values[i], divisor);
+        }
+    }
+    return result;
+}
+
+template <bool Divide, Comparison C>
+static size_t portableCountAboveAt(const double *values, const unsigned *indices, size_t count, double threshold,
+                                   double divisor)
+{
+    size_t result = 0;
+    for(size_t i = 0; i < count; i++) {
+        result += compare<C>(convert<Divide>(values[indices[i]], divisor), threshold);
+    }
+    return result;
+}
+
+template <bool Divide>
+static void portableCountBandsAt(const double *values, const unsigned *indices, size_t count, double low, double high,
+                                 double divisor, size_t *counts)
+{
+    size_t below = 0;
+    size_t within = 0;
+    for(size_t i = 0; i < count; i++) {
+        double value = convert<Divide>(values[indices[i]], divisor);
+        below += value < low;
+        within += value >= low && value <= high;
+    }
+    counts[0] += below;
+    counts[1] += within;
+    counts[2] += count - below - within;
+}
+
+template <bool Divide>
+static double portableSumAt(const double *values, const unsigned *indices, size_t count, double divisor)
+{
+    double result = 0;
+    for(size_t i = 0; i < count; i++) {
+        result += convert<Divide>(values[indices[i]], divisor);
+    }
+    return result;
+}
+
+static const KernelTable portableKernels = {InstructionSet::Portable, portableAccumulate, portableScaledCopy,
+    COMPARISON_TABLE(portableCountAbove), portableAnyAbove, DIVIDE_TABLE(portableCountBands), DIVIDE_TABLE(portableSum),
+    COMPARISON_TABLE(portableCountAboveAt), DIVIDE_TABLE(portableCountBandsAt), DIVIDE_TABLE(portableSumAt)};
+
+#ifdef STADIC_X86_KERNELS
+
+//SSE2 versions, two values at a time
+
+TARGET_SSE2 static inline __m128d sse2MaskAt(const unsigned char *mask, size_t i)
+{
+    if(mask == nullptr) {
+        return _mm_castsi128_pd(_mm_set1_epi32(-1));
+    }
+    return _mm_castsi128_pd(_mm_set_epi64x(mask[i + 1] ? -1 : 0, mask[i] ? -1 : 0));
+}
+
+TARGET_SSE2 static inline size_t sse2Total(__m128i counts)
+{
+    //Each lane counted down by one for every match
+    long long lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), counts);
+    return static_cast<size_t>(-(lanes[0] + lanes[1]));
+}
+
+template <bool Divide> TARGET_SSE2 static inline __m128d sse2Convert(__m128d value, __m128d divisor)
+{
+    return Divide ? _mm_div_pd(value, divisor) : value;
+}
+
+template <Comparison C> TARGET_SSE2 static inline __m128d sse2Compare(__m128d value, __m128d threshold)
+{
+    return C == Comparison::Greater ? _mm_cmpgt_pd(value, threshold) : _mm_cmpge_pd(value, threshold);
+}
+
+TARGET_SSE2 static void sse2Accumulate(double *target, const double *source, size_t count)
+{
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(target + i, _mm_add_pd(_mm_loadu_pd(target + i), _mm_loadu_pd(source + i)));
+    }
+    portableAccumulate(target + i, source + i, count - i);
+}
+
+TARGET_SSE2 static void sse2ScaledCopy(double *target, const double *source, size_t count, double divisor)
+{
+    __m128d d = _mm_set1_pd(divisor);
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(target + i, _mm_div_pd(_mm_loadu_pd(source + i), d));
+    }
+    portableScaledCopy(target + i, source + i, count - i, divisor);
+}
+
+template <bool Divide, Comparison C>
+TARGET_SSE2 static size_t sse2CountAbove(const double *values, const unsigned char *mask, size_t count,
+                                         double threshold, double divisor)
+{
+    __m128d t = _mm_set1_pd(threshold);
+    __m128d d = _mm_set1_pd(divisor);
+    __m128i counts = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128d v = sse2Convert<Divide>(_mm_loadu_pd(values + i), d);
+        __m128d hit = _mm_and_pd(sse2Compare<C>(v, t), sse2MaskAt(mask, i));
+        counts = _mm_add_epi64(counts, _mm_castpd_si128(hit));
+    }
+    return sse2Total(counts) + portableCountAbove<Divide, C>(values + i, mask ? mask + i : nullptr, count - i, threshold,
+                                                             divisor);
+}
+
+TARGET_SSE2 static bool sse2AnyAbove(const double *values, size_t count, double threshold)
+{
+    __m128d t = _mm_set1_pd(threshold);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m128d hit = _mm_or_pd(_mm_or_pd(_mm_cmpgt_pd(_mm_loadu_pd(values + i), t),
+                                          _mm_cmpgt_pd(_mm_loadu_pd(values + i + 2), t)),
+                                _mm_or_pd(_mm_cmpgt_pd(_mm_loadu_pd(values + i + 4), t),
+                                          _mm_cmpgt_pd(_mm_loadu_pd(values + i + 6), t)));
+        if(_mm_movemask_pd(hit)) {
+            return true;
+        }
+    }
+    return portableAnyAbove(values + i, count - i, threshold);
+}
+
+template <bool Divide>
+TARGET_SSE2 static void sse2CountBands(const double *values, const unsigned char *mask, size_t count, double low,
+                                       double high, double divisor, size_t *counts)
+{
+    __m128d l = _mm_set1_pd(low);
+    __m128d h = _mm_set1_pd(high);
+    __m128d d = _mm_set1_pd(divisor);
+    __m128i below = _mm_setzero_si128();
+    __m128i within = _mm_setzero_si128();
+    __m128i considered = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128d v = sse2Convert<Divide>(_mm_loadu_pd(values + i), d);
+        __m128d m = sse2MaskAt(mask, i);
+        __m128d isBelow = _mm_and_pd(_mm_cmplt_pd(v, l), m);
+        __m128d isWithin = _mm_andnot_pd(isBelow, _mm_and_pd(_mm_cmple_pd(v, h), m));
+        below = _mm_add_epi64(below, _mm_castpd_si128(isBelow));
+        within = _mm_add_epi64(within, _mm_castpd_si128(isWithin));
+        considered = _mm_add_epi64(considered, _mm_castpd_si128(m));
+    }
+    size_t b = sse2Total(below);
+    size_t w = sse2Total(within);
+    counts[0] += b;
+    counts[1] += w;
+    counts[2] += sse2Total(considered) - b - w;
+    portableCountBands<Divide>(values + i, mask ? mask + i : nullptr, count - i, low, high, divisor, counts);
+}
+
+template <bool Divide>
+TARGET_SSE2 static double sse2Sum(const double *values, const unsigned char *mask, size_t count, double divisor)
+{
+    __m128d d = _mm_set1_pd(divisor);
+    __m128d total = _mm_setzero_pd();
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m128d v = sse2Convert<Divide>(_mm_loadu_pd(values + i), d);
+        total = _mm_add_pd(total, _mm_and_pd(v, sse2MaskAt(mask, i)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, total);
+    return lanes[0] + lanes[1] + portableSum<Divide>(values + i, mask ? mask + i : nullptr, count - i, divisor);
+}
+
+//SSE2 has no gather, so the indexed kernels are the portable ones
+static const KernelTable sse2Kernels = {InstructionSet::SSE2, sse2Accumulate, sse2ScaledCopy,
+    COMPARISON_TABLE(sse2CountAbove), sse2AnyAbove, DIVIDE_TABLE(sse2CountBands), DIVIDE_TABLE(sse2Sum),
+    COMPARISON_TABLE(portableCountAboveAt), DIVIDE_TABLE(portableCountBandsAt), DIVIDE_TABLE(portableSumAt)};
+
+//AVX2 versions, four values at a time
+
+TARGET_AVX2 static inline __m256d avx2MaskAt(const unsigned char *mask, size_t i)
+{
+    if(mask == nullptr) {
+        return _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+    }
+    int bytes;
+    std::memcpy(&bytes, mask + i, sizeof(bytes));
+    __m256i wide = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(bytes));
+    return _mm256_castsi256_pd(_mm256_xor_si256(_mm256_cmpeq_epi64(wide, _mm256_setzero_si256()),
+                                                 _mm256_set1_epi32(-1)));
+}
+
+TARGET_AVX2 static inline size_t avx2Total(__m256i counts)
+{
+    long long lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), counts);
+    return static_cast<size_t>(-(lanes[0] + lanes[1] + lanes[2] + lanes[3]));
+}
+
+TARGET_AVX2 static inline __m256d avx2GatherAt(const double *values, const unsigned *indices, size_t i)
+{
+    return _mm256_i32gather_pd(values, _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i)), 8);
+}
+
+template <bool Divide> TARGET_AVX2 static inline __m256d avx2Convert(__m256d value, __m256d divisor)
+{
+    return Divide ? _mm256_div_pd(value, divisor) : value;
+}
+
+template <Comparison C> TARGET_AVX2 static inline __m256d avx2Compare(__m256d value, __m256d threshold)
+{
+    return C == Comparison::Greater ? _mm256_cmp_pd(value, threshold, _CMP_GT_OQ)
+                                    : _mm256_cmp_pd(value, threshold, _CMP_GE_OQ);
+}
+
+TARGET_AVX2 static void avx2Accumulate(double *target, const double *source, size_t count)
+{
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(target + i, _mm256_add_pd(_mm256_loadu_pd(target + i), _mm256_loadu_pd(source + i)));
+    }
+    portableAccumulate(target + i, source + i, count - i);
+}
+
+TARGET_AVX2 static void avx2ScaledCopy(double *target, const double *source, size_t count, double divisor)
+{
+    __m256d d = _mm256_set1_pd(divisor);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(target + i, _mm256_div_pd(_mm256_loadu_pd(source + i), d));
+    }
+    portableScaledCopy(target + i, source + i, count - i, divisor);
+}
+
+template <bool Divide, Comparison C>
+TARGET_AVX2 static size_t avx2CountAbove(const double *values, const unsigned char *mask, size_t count,
+                                         double threshold, double divisor)
+{
+    __m256d t = _mm256_set1_pd(threshold);
+    __m256d d = _mm256_set1_pd(divisor);
+    __m256i counts = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256d v = avx2Convert<Divide>(_mm256_loadu_pd(values + i), d);
+        __m256d hit = _mm256_and_pd(avx2Compare<C>(v, t), avx2MaskAt(mask, i));
+        counts = _mm256_add_epi64(counts, _mm256_castpd_si256(hit));
+    }
+    return avx2Total(counts) + portableCountAbove<Divide, C>(values + i, mask ? mask + i : nullptr, count - i, threshold,
+                                                             divisor);
+}
+
+TARGET_AVX2 static bool avx2AnyAbove(const double *values, size_t count, double threshold)
+{
+    __m256d t = _mm256_set1_pd(threshold);
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m256d hit = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), t, _CMP_GT_OQ),
+                                                _mm256_cmp_pd(_mm256_loadu_pd(values + i + 4), t, _CMP_GT_OQ)),
+                                   _mm256_or_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i + 8), t, _CMP_GT_OQ),
+                                                _mm256_cmp_pd(_mm256_loadu_pd(values + i + 12), t, _CMP_GT_OQ)));
+        if(_mm256_movemask_pd(hit)) {
+            return true;
+        }
+    }
+    return portableAnyAbove(values + i, count - i, threshold);
+}
+
+template <bool Divide>
+TARGET_AVX2 static void avx2CountBands(const double *values, const unsigned char *mask, size_t count, double low,
+                                       double high, double divisor, size_t *counts)
+{
+    __m256d l = _mm256_set1_pd(low);
+    __m256d h = _mm256_set1_pd(high);
+    __m256d d = _mm256_set1_pd(divisor);
+    __m256i below = _mm256_setzero_si256();
+    __m256i within = _mm256_setzero_si256();
+    __m256i considered = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256d v = avx2Convert<Divide>(_mm256_loadu_pd(values + i), d);
+        __m256d m = avx2MaskAt(mask, i);
+        __m256d isBelow = _mm256_and_pd(_mm256_cmp_pd(v, l, _CMP_LT_OQ), m);
+        __m256d isWithin = _mm256_andnot_pd(isBelow, _mm256_and_pd(_mm256_cmp_pd(v, h, _CMP_LE_OQ), m));
+        below = _mm256_add_epi64(below, _mm256_castpd_si256(isBelow));
+        within = _mm256_add_epi64(within, _mm256_castpd_si256(isWithin));
+        considered = _mm256_add_epi64(considered, _mm256_castpd_si256(m));
+    }
+    size_t b = avx2Total(below);
+    size_t w = avx2Total(within);
+    counts[0] += b;
+    counts[1] += w;
+    counts[2] += avx2Total(considered) - b - w;
+    portableCountBands<Divide>(values + i, mask ? mask + i : nullptr, count - i, low, high, divisor, counts);
+}
+
+template <bool Divide>
+TARGET_AVX2 static double avx2Sum(const double *values, const unsigned char *mask, size_t count, double divisor)
+{
+    __m256d d = _mm256_set1_pd(divisor);
+    __m256d total = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256d v = avx2Convert<Divide>(_mm256_loadu_pd(values + i), d);
+        total = _mm256_add_pd(total, _mm256_and_pd(v, avx2MaskAt(mask, i)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, total);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3])
+        + portableSum<Divide>(values + i, mask ? mask + i : nullptr, count - i, divisor);
+}
+
+template <bool Divide, Comparison C>
+TARGET_AVX2 static size_t avx2CountAboveAt(const double *values, const unsigned *indices, size_t count,
+                                           double threshold, double divisor)
+{
+    __m256d t = _mm256_set1_pd(threshold);
+    __m256d d = _mm256_set1_pd(divisor);
+    __m256i counts = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256d v = avx2Convert<Divide>(avx2GatherAt(values, indices, i), d);
+        counts = _mm256_add_epi64(counts, _mm256_castpd_si256(avx2Compare<C>(v, t)));
+    }
+    return avx2Total(counts) + portableCountAboveAt<Divide, C>(values, indices + i, count - i, threshold, divisor);
+}
+
+template <bool Divide>
+TARGET_AVX2 static void avx2CountBandsAt(const double *values, const unsigned *indices, size_t count, double low,
+                                         double high, double divisor, size_t *counts)
+{
+    __m256d l = _mm256_set1_pd(low);
+    __m256d h = _mm256_set1_pd(high);
+    __m256d d = _mm256_set1_pd(divisor);
+    __m256i below = _mm256_setzero_si256();
+    __m256i within = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m256d v = avx2Convert<Divide>(avx2GatherAt(values, indices, i), d);
+        __m256d isBelow = _mm256_cmp_pd(v, l, _CMP_LT_OQ);
+        __m256d isWithin = _mm256_andnot_pd(isBelow, _mm256_cmp_pd(v, h, _CMP_LE_OQ));
+        below = _mm256_add_epi64(below, _mm256_castpd_si256(isBelow));
+        within = _mm256_add_epi64(within, _mm256_castpd_si256(isWithin));
+    }
+    size_t b = avx2Total(below);
+    size_t w = avx2Total(within);
+    counts[0] += b;
+    counts[1] += w;
+    counts[2] += i - b - w;
+    portableCountBandsAt<Divide>(values, indices + i, count - i, low, high, divisor, counts);
+}
+
+template <bool Divide>
+TARGET_AVX2 static double avx2SumAt(const double *values, const unsigned *indices, size_t count, double divisor)
+{
+    __m256d d = _mm256_set1_pd(divisor);
+    __m256d total = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        total = _mm256_add_pd(total, avx2Convert<Divide>(avx2GatherAt(values, indices, i), d));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, total);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + portableSumAt<Divide>(values, indices + i, count - i, divisor);
+}
+
+static const KernelTable avx2Kernels = {InstructionSet::AVX2, avx2Accumulate, avx2ScaledCopy,
+    COMPARISON_TABLE(avx2CountAbove), avx2AnyAbove, DIVIDE_TABLE(avx2CountBands), DIVIDE_TABLE(avx2Sum),
+    COMPARISON_TABLE(avx2CountAboveAt), DIVIDE_TABLE(avx2CountBandsAt), DIVIDE_TABLE(avx2SumAt)};
+
+#endif
+
+bool isSupported(InstructionSet set)
+{
+    switch(set) {
+    case InstructionSet::Portable:
+        return true;
+#if defined(STADIC_X86_KERNELS) && defined(_MSC_VER)
+    case InstructionSet::SSE2:
+    {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+    }
+    case InstructionSet::AVX2:
+    {
+        int info[4];
+        __cpuid(info, 1);
+        //The OS has to save the AVX registers as well
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if(!osxsave || (_xgetbv(0) & 6) != 6) {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+#elif defined(STADIC_X86_KERNELS)
+    case InstructionSet::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case InstructionSet::AVX2:
+        return __builtin_cpu_supports("avx2");
+#else
+    default:
+        break;
+#endif
+    }
+    return false;
+}
+
+static const KernelTable *tableFor(InstructionSet set)
+{
+#ifdef STADIC_X86_KERNELS
+    if(set == InstructionSet::AVX2) {
+        return &avx2Kernels;
+    } else if(set == InstructionSet::SSE2) {
+        return &sse2Kernels;
+    }
+#endif
+    return &portableKernels;
+}
+
+static const KernelTable *bestTable()
+{
+    if(isSupported(InstructionSet::AVX2)) {
+        return tableFor(InstructionSet::AVX2);
+    } else if(isSupported(InstructionSet::SSE2)) {
+        return tableFor(InstructionSet::SSE2);
+    }
+    return tableFor(InstructionSet::Portable);
+}
+
+static std::atomic<const KernelTable *> &activeTable()
+{
+    static std::atomic<const KernelTable *> table(bestTable());
+    return table;
+}
+
+InstructionSet instructionSet()
+{
+    return activeTable().load()->set;
+}
+
+bool setInstructionSet(InstructionSet set)
+{
+    if(!isSupported(set)) {
+        return false;
+    }
+    activeTable().store(tableFor(set));
+    return true;
+}
+
+KernelSet::KernelSet() : m_Table(activeTable().load())
+{
+}
+
+InstructionSet KernelSet::instructionSet() const
+{
+    return m_Table->set;
+}
+
+void KernelSet::accumulate(double *target, const double *source, size_t count) const
+{
+    m_Table->accumulate(target, source, count);
+}
+
+void KernelSet::scaledCopy(double *target, const double *source, size_t count, double divisor) const
+{
+    m_Table->scaledCopy(target, source, count, divisor);
+}
+
+size_t KernelSet::countAbove(const double *values, const unsigned char *mask, size_t count, double threshold, double divisor,
+                             Comparison comparison) const
+{
+    return m_Table->countAbove[divisor != 1][int(comparison)](values, mask, count, threshold, divisor);
+}
+
+bool KernelSet::anyAbove(const double *values, size_t count, double threshold) const
+{
+    return m_Table->anyAbove(values, count, threshold);
+}
+
+void KernelSet::countBands(const double *values, const unsigned char *mask, size_t count, double low, double high, double divisor,
+                           size_t *below, size_t *within, size_t *above) const
+{
+    size_t counts[3] = {0, 0, 0};
+    m_Table->countBands[divisor != 1](values, mask, count, low, high, divisor, counts);
+    *below = counts[0];
+    *within = counts[1];
+    *above = counts[2];
+}
+
+double KernelSet::sum(const double *values, const unsigned char *mask, size_t count, double divisor) const
+{
+    return m_Table->sum[divisor != 1](values, mask, count, divisor);
+}
+
+size_t KernelSet::countAboveAt(const double *values, const unsigned *indices, size_t count, double threshold, double divisor,
+                               Comparison comparison) const
+{
+    return m_Table->countAboveAt[divisor != 1][int(comparison)](values, indices, count, threshold, divisor);
+}
+
+void KernelSet::countBandsAt(const double *values, const unsigned *indices, size_t count, double low, double high, double divisor,
+                             size_t *below, size_t *within, size_t *above) const
+{
+    size_t counts[3] = {0, 0, 0};
+    m_Table->countBandsAt[divisor != 1](values, indices, count, low, high, divisor, counts);
+    *below = counts[0];
+    *within = counts[1];
+    *above = counts[2];
+}
+
+double KernelSet::sumAt(const double *values, const unsigned *indices, size_t count, double divisor) const
+{
+    return m_Table->sumAt[divisor != 1](values, indices, count, divisor);
+}
+
+void accumulate(double *target, const double *source, size_t count)
+{
+    KernelSet().accumulate(target, source, count);
+}
+
+void scaledCopy(double *target, const double *source, size_t count, double divisor)
+{
+    KernelSet().scaledCopy(target, source, count, divisor);
+}
+
+size_t countAbove(const double *values, const unsigned char *mask, size_t count, double threshold, double divisor,
+                  Comparison comparison)
+{
+    return KernelSet().countAbove(values, mask, count, threshold, divisor, comparison);
+}
+
+bool anyAbove(const double *values, size_t count, double threshold)
+{
+    return KernelSet().anyAbove(values, count, threshold);
+}
+
+void countBands(const double *values, const unsigned char *mask, size_t count, double low, double high, double divisor,
+                size_t *below, size_t *within, size_t *above)
+{
+    KernelSet().countBands(values, mask, count, low, high, divisor, below, within, above);
+}
+
+double sum(const double *values, const unsigned char *mask, size_t count, double divisor)
+{
+    return KernelSet().sum(values, mask, count, divisor);
+}
+
+size_t countAboveAt(const double *values, const unsigned *indices, size_t count, double threshold, double divisor,
+                    Comparison comparison)
+{
+    return KernelSet().countAboveAt(values, indices, count, threshold, divisor, comparison);
+}
+
+void countBandsAt(const double *values, const unsigned *indices, size_t count, double low, double high, double divisor,
+                  size_t *below, size_t *within, size_t *above)
+{
+    KernelSet().countBandsAt(values, indices, count, low, high, divisor, below, within, above);
+}
+
+double sumAt(const double *values, const unsigned *indices, size_t count, double divisor)
+{
+    return KernelSet().sumAt(values, indices, count, divisor);
+}
+
+}
+
+}
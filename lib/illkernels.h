@@ -0,0 +1,115 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef ILLKERNELS_H
+#define ILLKERNELS_H
+
+#include "stadicapi.h"
+#include <cstddef>
+
+namespace stadic {
+
+// Kernels for the loops over contiguous runs of illuminance values that the
+// metrics and the illuminance containers spend most of their time in. Each
+// kernel has a portable version and, on x86, SSE2 and AVX2 versions; the
+// widest one the processor supports is picked the first time a kernel is
+// called. The counting and copying kernels give exactly the same results as
+// the portable versions. Sums are accumulated in a different order and so
+// only agree to within rounding.
+//
+// Where a divisor is taken, each value is divided by it before use (10.764
+// converts lux to fc, 1 leaves the values alone). Where a mask is taken, only
+// the values with a nonzero mask byte are considered; a null mask considers
+// every value. The kernels ending in At consider only the values at a list
+// of indices (the selected timesteps of a TimeMask), so the loop runs over
+// those values alone instead of testing a mask at every one; on AVX2 they
+// gather four values at a time.
+//
+// Each kernel is compiled once for each case of the divisor (1 or not) and of
+// the comparison, and the case is picked once per call, so the inner loops
+// carry no unit or comparison tests. Callers should work out the divisor once
+// (per space, say) rather than per point.
+namespace kernels {
+
+enum class InstructionSet {Portable, SSE2, AVX2};
+enum class Comparison {Greater, GreaterOrEqual};
+
+InstructionSet STADIC_API instructionSet();                                     //Function that returns the instruction set the kernels use
+bool STADIC_API setInstructionSet(InstructionSet set);                          //Function to select an instruction set, returns false if the processor lacks it
+bool STADIC_API isSupported(InstructionSet set);                                //Function that returns true if the processor supports an instruction set
+
+struct KernelTable;
+
+// A KernelSet holds the kernels of the instruction set selected when it was
+// made. The free functions below look the selection up on every call; a loop
+// that calls a kernel for every point or hour takes a KernelSet once and calls
+// through it instead.
+class STADIC_API KernelSet
+{
+public:
+    KernelSet();                                                                //Constructor that takes the instruction set selected now
+    InstructionSet instructionSet() const;                                      //Function that returns the instruction set of the kernels
+    void accumulate(double *target, const double *source, size_t count) const; //Function that adds source to target element by element
+    void scaledCopy(double *target, const double *source, size_t count, double divisor) const;    //Function that copies source divided by divisor into target
+    size_t countAbove(const double *values, const unsigned char *mask, size_t count, double threshold, double divisor=1,
+                      Comparison comparison=Comparison::Greater) const;         //Function that counts the values greater than (or equal to) threshold
+    bool anyAbove(const double *values, size_t count, double threshold) const;  //Function that returns true if any value is greater than threshold
+    void countBands(const double *values, const unsigned char *mask, size_t count, double low, double high, double divisor,
+                    size_t *below, size_t *within, size_t *above) const;        //Function that counts the values below low, from low to high inclusive, and above high
+    double sum(const double *values, const unsigned char *mask, size_t count, double divisor=1) const; //Function that returns the sum of the values
+    size_t countAboveAt(const double *values, const unsigned *indices, size_t count, double threshold, double divisor=1,
+                        Comparison comparison=Comparison::Greater) const;       //Function that counts the indexed values greater than (or equal to) threshold
+    void countBandsAt(const double *values, const unsigned *indices, size_t count, double low, double high, double divisor,
+                      size_t *below, size_t *within, size_t *above) const;      //Function that counts the indexed values below low, from low to high inclusive, and above high
+    double sumAt(const double *values, const unsigned *indices, size_t count, double divisor=1) const; //Function that returns the sum of the indexed values
+
+private:
+    const KernelTable *m_Table;                                                 //Kernels of the instruction set
+};
+
+void STADIC_API accumulate(double *target, const double *source, size_t count); //Function that adds source to target element by element
+void STADIC_API scaledCopy(double *target, const double *source, size_t count, double divisor);    //Function that copies source divided by divisor into target
+size_t STADIC_API countAbove(const double *values, const unsigned char *mask, size_t count, double threshold, double divisor=1,
+                            Comparison comparison=Comparison::Greater);         //Function that counts the values greater than (or equal to) threshold
+bool STADIC_API anyAbove(const double *values, size_t count, double threshold); //Function that returns true if any value is greater than threshold
+void STADIC_API countBands(const double *values, const unsigned char *mask, size_t count, double low, double high, double divisor,
+                           size_t *below, size_t *within, size_t *above);       //Function that counts the values below low, from low to high inclusive, and above high
+double STADIC_API sum(const double *values, const unsigned char *mask, size_t count, double divisor=1); //Function that returns the sum of the values
+size_t STADIC_API countAboveAt(const double *values, const unsigned *indices, size_t count, double threshold, double divisor=1,
+                              Comparison comparison=Comparison::Greater);       //Function that counts the indexed values greater than (or equal to) threshold
+void STADIC_API countBandsAt(const double *values, const unsigned *indices, size_t count, double low, double high, double divisor,
+                             size_t *below, size_t *within, size_t *above);     //Function that counts the indexed values below low, from low to high inclusive, and above high
+double STADIC_API sumAt(const double *values, const unsigned *indices, size_t count, double divisor=1); //Function that returns the sum of the indexed values
+
+}
+
+}
+
+#endif // ILLKERNELS_H
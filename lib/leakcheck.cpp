@@ -61,26 +61,36 @@ bool LeakCheck::isEnclosed(){
     if (!runCalc()){
         return false;
     }
-    std::ifstream iFile;
-    iFile.open("Final.res");
-    if (!iFile.is_open()){
+    NumericReader reader;
+    if (!reader.open("Final.res")){
         STADIC_ERROR("The opening of the results file failed.");
         return false;
     }
-    std::string val;
+    size_t expected=0;
+    for (int i=0;i<m_Points.size();i++){
+        expected+=m_Points[i].size();
+    }
+    std::vector<double> vals;
+    size_t count=0;
     bool containsLeak=false;
     bool likelyEnclosed=false;
-    for (int i=0;i<m_Points.size();i++){
-        for (int j=0;j<m_Points[i].size();j++){
-            iFile>>val;
-            if (toDouble(val)>0 &&toDouble(val)<0.5){
+    while (count<expected && reader.readRow(vals)){
+        for (int j=0;j<vals.size() && count<expected;j++,count++){
+            if (vals[j]>0 && vals[j]<0.5){
                 likelyEnclosed=true;
-            }else if (toDouble(val)>=0.5){
+            }else if (vals[j]>=0.5){
                 containsLeak=true;
             }
         }
     }
-    iFile.close();
+    if (reader.failed()){
+        STADIC_ERROR("The results file contains a malformed value at "+reader.position()+".");
+        return false;
+    }
+    if (count<expected){
+        STADIC_ERROR("The results file does not contain a value for every analysis point.");
+        return false;
+    }
 
     if (containsLeak){
         STADIC_ERROR("The provided model either contains a leak or the provided point is outside the space.");
@@ -239,7 +249,7 @@ bool LeakCheck::runCalc(){
     std::vector<std::string> arguments2;
     arguments2.clear();
     arguments2.push_back("-e");
-    arguments2.push_back(Process::quote("$1=179*($1*0.265+$2*0.670+$3*0.065)"));
+    arguments2.push_back("$1=179*($1*0.265+$2*0.670+$3*0.065)");
     programName="rcalc";
     Process rcalc(programName,arguments2);
     rtrace.setStandardOutputProcess(&rcalc);
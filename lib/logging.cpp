@@ -33,16 +33,58 @@
 #include <cstdlib>
 #include <stdexcept>
 
+namespace stadic {
+
+static thread_local LogCapture *activeCapture=nullptr;
+
+LogCapture::LogCapture() : m_Previous(activeCapture)
+{
+    activeCapture=this;
+}
+
+LogCapture::~LogCapture()
+{
+    activeCapture=m_Previous;
+}
+
+void LogCapture::append(const std::string &line)
+{
+    m_Text+=line;
+    m_Text+='\n';
+}
+
+std::string LogCapture::text() const
+{
+    return m_Text;
+}
+
+LogCapture *LogCapture::current()
+{
+    return activeCapture;
+}
+
+}
+
+static void writeLine(const std::string &string)
+{
+    stadic::LogCapture *capture=stadic::LogCapture::current();
+    if (capture){
+        capture->append(string);
+    }else{
+        std::cerr << string << std::endl;
+    }
+}
+
 void STADIC_ERROR(std::string mesg)
 {
     std::string string ="ERROR: "+mesg;
-    std::cerr << string << std::endl;
+    writeLine(string);
 }
 
 void STADIC_WARNING(std::string mesg)
 {
     std::string string="WARNING: "+mesg;
-    std::cerr << string << std::endl;
+    writeLine(string);
 }
 
 void STADIC_LOG(stadic::Severity severity, std::string mesg)
@@ -52,22 +94,25 @@ void STADIC_LOG(stadic::Severity severity, std::string mesg)
     case stadic::Severity::Debug: // Not an error, write out information
         // We should change this so it only writes out for debug builds
         string = "DEBUG: " + mesg;
-        std::cerr << string << std::endl;
+        writeLine(string);
         break;
     case stadic::Severity::Info: // Not an error, write out information
         string = "INFO: "+mesg;
-        std::cerr << string << std::endl;
+        writeLine(string);
         break;
     case stadic::Severity::Warning: // Something is wrong, but can continue
         string = "WARNING: "+mesg;
-        std::cerr << string << std::endl;
+        writeLine(string);
         break;
     case stadic::Severity::Error: // Something is wrong, cannot continue
         string = "ERROR: "+mesg;
-        std::cerr << string << std::endl;
+        writeLine(string);
         throw std::runtime_error(mesg);
     default: //case stadic::Severity::Fatal:  // Something is really wrong, stop now!
         string = "FATAL: "+mesg;
+        if (stadic::LogCapture::current()){                             //Write out what has been held back before exiting
+            std::cerr << stadic::LogCapture::current()->text();
+        }
         std::cerr << string << std::endl;
         exit(EXIT_FAILURE);
     }
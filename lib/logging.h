@@ -37,6 +37,29 @@
 
 namespace stadic {
 enum class Severity {Debug, Info, Warning, Error, Fatal};
+
+// LogCapture collects the messages logged on the thread that creates it
+// instead of writing them to std::cerr, so that work spread over several
+// threads can report its messages in a fixed order once it is done. Captures
+// nest: destroying one restores the capture (if any) that was active before.
+// Fatal messages are never held back.
+class STADIC_API LogCapture
+{
+public:
+    LogCapture();
+    ~LogCapture();
+    void append(const std::string &line);                                       //Function to add a line to the captured text
+    std::string text() const;                                                   //Function that returns the captured text
+    static LogCapture *current();                                               //Function that returns the capture active on this thread, if any
+
+private:
+    LogCapture(const LogCapture&);
+    LogCapture &operator=(const LogCapture&);
+    LogCapture *m_Previous;
+    std::string m_Text;
+
+};
+
 }
 
 void STADIC_API STADIC_ERROR(std::string mesg);
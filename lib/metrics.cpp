@@ -32,136 +32,798 @@
 #include "logging.h"
 #include "dayill.h"
 #include <fstream>
+#include <algorithm>
+#include <atomic>
+#include "filepath.h"
 #include "functions.h"
 #include "gridmaker.h"
+#include "illkernels.h"
+#include "parallel.h"
+#include "timemask.h"
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
 
 namespace stadic {
-Metrics::Metrics(BuildingControl *model) :
-    m_Model(model)
+AnnualStatistics::AnnualStatistics() : m_DA(false), m_cDA(false), m_UDI(false), m_DATarget(0), m_cDATarget(0),
+    m_UDIMin(0), m_UDIMax(0), m_Divisor(1), m_Points(0), m_OccupiedHours(0)
 {
 }
 
-bool Metrics::processMetrics()
-{
-    std::vector<std::shared_ptr<Control>> spaces=m_Model->spaces();
-    for (int i=0;i<spaces.size();i++){
-        DaylightIlluminanceData daylightIll;
-        daylightIll.parseTimeBased(spaces[i].get()->spaceDirectory()+spaces[i].get()->resultsDirectory()+spaces[i].get()->spaceName()+".ill");
-        //Test whether Daylight Autonomy needs to be calculated
-        if (spaces[i].get()->runDA()){
-            if(calculateDA(spaces[i].get(), &daylightIll)){
-                spaces[i].get()->setCalcDA(false);      //Set calculate to false for DA in control file if returned true
+void AnnualStatistics::setDA(double target){
+    m_DA=true;
+    m_DATarget=target;
+}
+
+void AnnualStatistics::setcDA(double target){
+    m_cDA=true;
+    m_cDATarget=target;
+}
+
+void AnnualStatistics::setUDI(double minimum, double maximum){
+    m_UDI=true;
+    m_UDIMin=minimum;
+    m_UDIMax=maximum;
+}
+
+void AnnualStatistics::setDivisor(double divisor){
+    m_Divisor=divisor;
+}
+
+bool AnnualStatistics::compute(const DaylightIlluminanceData &data, const TimeMask &occupied){
+    if (occupied.timesteps()!=data.timesteps()){
+        STADIC_ERROR("The occupancy does not cover the same number of timesteps as the illuminance.");
+        return false;
+    }
+    m_Points=data.points();
+    m_OccupiedHours=occupied.count();
+    TimeMask litOccupied=occupied.stored(data);
+    const unsigned *hours=litOccupied.indices().data();
+    size_t steps=litOccupied.count();
+    size_t darkCount=m_OccupiedHours-steps;
+    m_DACounts.assign(m_DA ? m_Points : 0,0);
+    m_cDASums.assign(m_cDA ? m_Points : 0,0);
+    m_UDIBelow.assign(m_UDI ? m_Points : 0,0);
+    m_UDIWithin.assign(m_UDI ? m_Points : 0,0);
+    m_UDIAbove.assign(m_UDI ? m_Points : 0,0);
+    const kernels::KernelSet kernelSet;
+    for (unsigned i=0;i<m_Points;i++){
+        const double *values=data.point(i).data();
+        if (m_DA){
+            m_DACounts[i]=kernelSet.countAboveAt(values,hours,steps,m_DATarget,m_Divisor);
+            if (0>m_DATarget){                                                  //Dark hours hold zero illuminance
+                m_DACounts[i]+=darkCount;
             }
         }
-
-        if (spaces[i].get()->runcDA()){
-            if (calculatecDA(spaces[i].get(), &daylightIll)){
-                spaces[i].get()->setCalccDA(false);
+        if (m_cDA){
+            m_cDASums[i]=kernelSet.sumAt(values,hours,steps,m_Divisor);
+        }
+        if (m_UDI){
+            kernelSet.countBandsAt(values,hours,steps,m_UDIMin,m_UDIMax,m_Divisor,&m_UDIBelow[i],&m_UDIWithin[i],&m_UDIAbove[i]);
+            if (0<m_UDIMin){
+                m_UDIBelow[i]+=darkCount;
+            }else if (0<=m_UDIMax){
+                m_UDIWithin[i]+=darkCount;
+            }else{
+                m_UDIAbove[i]+=darkCount;
             }
         }
+    }
+    return true;
+}
 
-        if (spaces[i].get()->runDF()){
-            if (calculateDF(spaces[i].get(), &daylightIll)){
-                spaces[i].get()->setDF(false);
-            }
+//Getters
+bool AnnualStatistics::DA() const{
+    return m_DA;
+}
+
+bool AnnualStatistics::cDA() const{
+    return m_cDA;
+}
+
+bool AnnualStatistics::UDI() const{
+    return m_UDI;
+}
+
+double AnnualStatistics::cDATarget() const{
+    return m_cDATarget;
+}
+
+unsigned AnnualStatistics::points() const{
+    return m_Points;
+}
+
+size_t AnnualStatistics::occupiedHours() const{
+    return m_OccupiedHours;
+}
+
+const std::vector<size_t> &AnnualStatistics::DACounts() const{
+    return m_DACounts;
+}
+
+const std::vector<double> &AnnualStatistics::cDASums() const{
+    return m_cDASums;
+}
+
+const std::vector<size_t> &AnnualStatistics::UDIBelow() const{
+    return m_UDIBelow;
+}
+
+const std::vector<size_t> &AnnualStatistics::UDIWithin() const{
+    return m_UDIWithin;
+}
+
+const std::vector<size_t> &AnnualStatistics::UDIAbove() const{
+    return m_UDIAbove;
+}
+
+Metrics::Metrics(BuildingControl *model) :
+    m_Model(model), m_Threads(1), m_SpaceThreads(0), m_MemoryBudget(0), m_Incremental(false), m_Reused(0), m_Computed(0)
+{
+}
+
+IlluminanceHistogram::IlluminanceHistogram(std::vector<double> edges) : m_Edges(edges), m_Divisor(1), m_Points(0), m_OccupiedHours(0)
+{
+    std::sort(m_Edges.begin(),m_Edges.end());
+    m_Edges.erase(std::unique(m_Edges.begin(),m_Edges.end()),m_Edges.end());
+}
+
+void IlluminanceHistogram::setDivisor(double divisor){
+    m_Divisor=divisor;
+}
+
+bool IlluminanceHistogram::compute(const DaylightIlluminanceData &data, const TimeMask &occupied){
+    if (occupied.timesteps()!=data.timesteps()){
+        STADIC_ERROR("The occupancy does not cover the same number of timesteps as the illuminance.");
+        return false;
+    }
+    m_Points=data.points();
+    m_OccupiedHours=occupied.count();
+    TimeMask litOccupied=occupied.stored(data);
+    const std::vector<unsigned> &hours=litOccupied.indices();
+    size_t darkCount=m_OccupiedHours-hours.size();
+    size_t bins=2*m_Edges.size()+1;
+    size_t darkBin=bin(0);
+    m_Counts.assign(size_t(m_Points)*bins,0);
+    m_Sums.assign(m_Points,0);
+    for (unsigned i=0;i<m_Points;i++){
+        size_t *counts=&m_Counts[size_t(i)*bins];
+        if (m_Divisor==1){
+            m_Sums[i]=binPoint<false>(data.point(i).data(),hours,counts);
+        }else{
+            m_Sums[i]=binPoint<true>(data.point(i).data(),hours,counts);
         }
+        counts[darkBin]+=darkCount;                                             //Dark hours hold zero illuminance
+    }
+    return true;
+}
+
+template <bool Divide> double IlluminanceHistogram::binPoint(const double *values, const std::vector<unsigned> &hours, size_t *counts) const{
+    double sum=0;
+    for (size_t j=0;j<hours.size();j++){
+        double value=Divide ? values[hours[j]]/m_Divisor : values[hours[j]];
+        counts[bin(value)]++;
+        sum+=value;
+    }
+    return sum;
+}
+
+size_t IlluminanceHistogram::bin(double value) const{
+    size_t index=std::lower_bound(m_Edges.begin(),m_Edges.end(),value)-m_Edges.begin();
+    if (index<m_Edges.size() && m_Edges[index]==value){
+        return 2*index+1;
+    }
+    return 2*index;
+}
+
+size_t IlluminanceHistogram::countBins(unsigned point, size_t first, size_t last) const{
+    const size_t *counts=&m_Counts[size_t(point)*(2*m_Edges.size()+1)];
+    size_t total=0;
+    for (size_t i=first;i<last;i++){
+        total+=counts[i];
+    }
+    return total;
+}
+
+//Getters
+const std::vector<double> &IlluminanceHistogram::edges() const{
+    return m_Edges;
+}
 
-        if (spaces[i].get()->runUDI()){
-            if (calculateUDI(spaces[i].get(), &daylightIll)){
-                spaces[i].get()->setCalcUDI(false);
+unsigned IlluminanceHistogram::points() const{
+    return m_Points;
+}
+
+size_t IlluminanceHistogram::occupiedHours() const{
+    return m_OccupiedHours;
+}
+
+size_t IlluminanceHistogram::countAbove(unsigned point, double threshold) const{
+    return countBins(point,bin(threshold)+1,2*m_Edges.size()+1);
+}
+
+size_t IlluminanceHistogram::countBelow(unsigned point, double threshold) const{
+    return countBins(point,0,bin(threshold));
+}
+
+size_t IlluminanceHistogram::uncertainty(unsigned point, double threshold) const{
+    size_t index=bin(threshold);
+    if (index%2){                                                               //The threshold is an edge
+        return 0;
+    }
+    return countBins(point,index,index+1);
+}
+
+double IlluminanceHistogram::sum(unsigned point) const{
+    return m_Sums[point];
+}
+
+std::vector<bool> sDAShadeCombination(const std::vector<unsigned> &sunlitPoints, unsigned points, double limit)
+{
+    size_t groups=sunlitPoints.size();
+    std::vector<bool> shaded(groups,true);
+    if (points==0 || !(0<limit)){                                               //Not even the all shaded combination stays below the limit
+        return shaded;
+    }
+    //The largest count of sunlit points that stays below the limit
+    unsigned long long total=0;
+    for (size_t k=0;k<groups;k++){
+        total+=sunlitPoints[k];
+    }
+    unsigned long long capacity=total;
+    if (!(double(capacity)/points<limit)){
+        capacity=(unsigned long long)(limit*points);
+        while (capacity>0 && !(double(capacity)/points<limit)){
+            capacity--;
+        }
+    }
+    //reachable[k][c] is set when c sunlit points can be left open using the first k groups
+    std::vector<std::vector<unsigned char>> reachable(groups+1,std::vector<unsigned char>(capacity+1,0));
+    reachable[0][0]=1;
+    for (size_t k=0;k<groups;k++){
+        const std::vector<unsigned char> &previous=reachable[k];
+        std::vector<unsigned char> &next=reachable[k+1];
+        next=previous;
+        for (unsigned long long c=sunlitPoints[k];c<=capacity;c++){
+            if (previous[c-sunlitPoints[k]]){
+                next[c]=1;
             }
         }
+    }
+    unsigned long long best=capacity;
+    while (!reachable[groups][best]){
+        best--;
+    }
+    //Work down from the last group, opening each group that still allows the best count
+    for (size_t k=groups;k>0;k--){
+        unsigned count=sunlitPoints[k-1];
+        if (count<=best && reachable[k-1][best-count]){
+            shaded[k-1]=false;
+            best-=count;
+        }
+    }
+    return shaded;
+}
 
-        if (spaces[i].get()->runsDA()){
-            if (calculatesDA(spaces[i].get(), &daylightIll)){
-                spaces[i].get()->setCalcsDA(false);
-            }
+bool Metrics::processMetrics()
+{
+    m_Reused=0;
+    m_Computed=0;
+    std::vector<std::shared_ptr<Control>> spaces=m_Model->spaces();
+    unsigned threads=std::min<unsigned>(resolveThreads(m_Threads),spaces.size());
+    if (threads<=1){
+        m_SpaceThreads=0;
+        for (int i=0;i<spaces.size();i++){
+            processSpace(spaces[i].get());
         }
+        return true;
+    }
 
-        if (spaces[i].get()->runOccsDA()){
-            if (calculateOccsDA(spaces[i].get(), &daylightIll)){
-                spaces[i].get()->setCalcOccsDA(false);
+    //Each space runs on one thread and holds back its messages, which are
+    //then written out in the order of the spaces up to the first space that
+    //failed.  Spaces are started in order, and once a space fails no later
+    //space is started.  A later space that was already running when the
+    //failure happened is left to finish and write its results, but its
+    //messages are dropped along with the rest of the output after the failure.
+    m_SpaceThreads=1;
+    std::vector<std::string> logs(spaces.size());
+    std::vector<std::exception_ptr> errors(spaces.size());
+    std::atomic<unsigned> firstFailure(spaces.size());
+    parallelFor(spaces.size(),threads,[&](unsigned i){
+        if (i>firstFailure){
+            return;
+        }
+        LogCapture capture;
+        try{
+            processSpace(spaces[i].get());
+        }catch(...){
+            errors[i]=std::current_exception();
+            unsigned failed=firstFailure;
+            while (i<failed && !firstFailure.compare_exchange_weak(failed,i)){
             }
         }
+        logs[i]=capture.text();
+    });
+    for (int i=0;i<spaces.size();i++){
+        std::cerr<<logs[i];
+        if (errors[i]){
+            std::rethrow_exception(errors[i]);
+        }
     }
-
     return true;
 }
 
-bool Metrics::calculateDA(Control *model, DaylightIlluminanceData *dayIll)
+void Metrics::setThreads(unsigned threads){
+    m_Threads=threads;
+}
+
+unsigned Metrics::threads() const{
+    return m_Threads;
+}
+
+//Inputs, parameters and results of one metric of a space, used to decide whether its results can be reused
+enum MetricKind {DAMetric, cDAMetric, UDIMetric, SweepMetric, sDAMetric, OccsDAMetric, MetricKinds};
+
+struct MetricFingerprint
+{
+    std::string file;                                                           //Fingerprint file written next to the results
+    std::string text;                                                           //Stamps of the inputs followed by the parameters
+    std::vector<std::string> results;                                           //Result files that have to exist for a reuse
+};
+
+static const char *metricName(MetricKind kind)
+{
+    const char *names[]={"DA","cDA","UDI","sweep","sDA","occupancy_sDA"};
+    return names[kind];
+}
+
+//Size and modification time of an input, which is much cheaper than hashing an annual matrix.
+//The time is taken to the nanosecond so that a file simulated again within a second still differs.
+static std::string inputStamp(const std::string &file)
 {
-    std::vector<int> pointCount;
-    for (int i=0;i<dayIll->illuminance()[0].lux().size();i++){
-        pointCount.push_back(0);
+    time_t modified;
+    long long size;
+    long nanoseconds;
+    std::ostringstream stamp;
+    if (fileStamp(file,&modified,&size,&nanoseconds)){
+        stamp<<"input "<<file<<' '<<size<<' '<<static_cast<long long>(modified)<<'.'<<nanoseconds<<'\n';
+    }else{
+        stamp<<"input "<<file<<" missing\n";
     }
-    int hourCount=0;
-    for (int i=0;i<dayIll->illuminance().size();i++){
-        if(m_Occupancy[i]){
-            hourCount++;
-            if (model->illumUnits()=="lux"){
-                for (int j=0;j<dayIll->illuminance()[i].lux().size();j++){
-                    if (dayIll->illuminance()[i].lux()[j]>model->DAIllum()){
-                        pointCount[j]++;
-                    }
+    return stamp.str();
+}
+
+static MetricFingerprint metricFingerprint(Control *space, MetricKind kind)
+{
+    std::string prefix=space->spaceDirectory()+space->resultsDirectory()+space->spaceName();
+    std::string occupancy=space->spaceDirectory()+space->inputDirectory()+space->occSchedule();
+    MetricFingerprint fingerprint;
+    fingerprint.file=prefix+"_"+metricName(kind)+".fingerprint";
+    std::ostringstream text;
+    text.precision(17);
+    text<<inputStamp(prefix+".ill");
+    if (kind==sDAMetric || kind==OccsDAMetric){
+        text<<inputStamp(space->spaceDirectory()+space->geoDirectory()+space->geoFile());
+        std::vector<int> settings=space->sDAwgSettings();
+        for (int i=0;i<space->windowGroups().size();i++){
+            std::string group=prefix+"_"+space->windowGroups()[i].name();
+            if (kind==sDAMetric){
+                text<<inputStamp(group+"_base_direct.ill")<<inputStamp(group+"_base.ill");
+                if (i<settings.size()){
+                    text<<inputStamp(group+"_set"+toString(settings[i])+".ill");
                 }
             }else{
-                for (int j=0;j<dayIll->illuminance()[i].fc().size();j++){
-                    if (dayIll->illuminance()[i].fc()[j]>model->DAIllum()){
-                        pointCount[j]++;
-                    }
+                for (int j=0;j<=space->windowGroups()[i].shadeSettingGeometry().size();j++){
+                    text<<inputStamp(group+(j==0 ? "_base" : "_set"+toString(j))+".ill");
                 }
             }
         }
+        text<<"import_units "<<space->importUnits()<<'\n';
+        std::vector<std::string> layers;
+        if (space->identifiers()){
+            text<<"identifiers";
+            layers=space->identifiers().get();
+        }else if (space->modifiers()){
+            text<<"modifiers";
+            layers=space->modifiers().get();
+        }
+        for (int i=0;i<layers.size();i++){
+            text<<' '<<layers[i];
+        }
+        text<<'\n';
+    }
+    if (kind!=sDAMetric){
+        text<<inputStamp(occupancy);
+    }
+    text<<"illum_units "<<space->illumUnits()<<'\n';
+    switch (kind){
+    case DAMetric:
+        text<<"DA "<<space->DAIllum()<<'\n';
+        fingerprint.results={prefix+"_DA.res"};
+        break;
+    case cDAMetric:
+        text<<"cDA "<<space->cDAIllum()<<'\n';
+        fingerprint.results={prefix+"_cDA.res"};
+        break;
+    case UDIMetric:
+        text<<"UDI "<<space->UDIMin()<<' '<<space->UDIMax()<<'\n';
+        fingerprint.results={prefix+"_below_UDI.res",prefix+"_UDI.res",prefix+"_above_UDI.res"};
+        break;
+    case SweepMetric:
+        text<<"sweep DA";
+        for (double value : space->sweepDAIllums()){
+            text<<' '<<value;
+        }
+        text<<"\nsweep cDA";
+        for (double value : space->sweepcDAIllums()){
+            text<<' '<<value;
+        }
+        text<<"\nsweep UDI";
+        for (const std::pair<double, double> &range : space->sweepUDIRanges()){
+            text<<' '<<range.first<<' '<<range.second;
+        }
+        text<<'\n';
+        fingerprint.results={prefix+"_sweep.res"};
+        break;
+    case sDAMetric:
+        text<<"sDA "<<space->sDAIllum()<<' '<<space->sDAFrac()<<' '<<space->sDAStart()<<' '<<space->sDAEnd()<<'\n';
+        text<<"write_illuminance "<<space->writesDAIll()<<'\n';
+        fingerprint.results={prefix+"_ASE.res",prefix+"_sDA_ShadeSchedule.res",prefix+"_sDA_Points.res"};
+        if (space->writesDAIll()){
+            fingerprint.results.push_back(prefix+"_sDA.ill");
+        }
+        break;
+    default:
+        text<<"shade_schedule "<<inputStamp(prefix+"_shades.sch");
+        text<<"occupancy_sDA "<<space->occsDAIllum()<<' '<<space->occsDAFrac()<<'\n';
+        fingerprint.results={prefix+"_occupancy_sDA_Points.res",prefix+"_occupancy_sDA.ill"};
+        break;
     }
+    fingerprint.text=text.str();
+    return fingerprint;
+}
 
-    std::ofstream outDA;
-    std::string tmpFileName;
-    tmpFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_DA.res";
-    outDA.open(tmpFileName);
-    if (!outDA.is_open()){
-        STADIC_LOG(Severity::Error, "The opening of the Daylight Autonomy results file "+tmpFileName +" has failed.");
+//A metric is reused when its fingerprint is unchanged and its results are all still there
+static bool reusable(const MetricFingerprint &fingerprint)
+{
+    std::ifstream in(fingerprint.file);
+    if (!in.is_open()){
         return false;
     }
-    for (int i=0;i<dayIll->illuminance()[0].lux().size();i++){
-        outDA<<double(pointCount[i])/hourCount<<std::endl;
+    std::string recorded((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+    if (recorded!=fingerprint.text){
+        return false;
+    }
+    for (int i=0;i<fingerprint.results.size();i++){
+        if (!isFile(fingerprint.results[i])){
+            return false;
+        }
     }
-    outDA.close();
     return true;
 }
-bool Metrics::calculatecDA(Control *model, DaylightIlluminanceData *dayIll)
+
+static void recordFingerprint(const MetricFingerprint &fingerprint)
 {
-    std::vector<double> pointCount;
-    for (int i=0;i<dayIll->illuminance()[0].lux().size();i++){
-        pointCount.push_back(0);
+    if (fingerprint.file.empty()){                                              //Not running incrementally
+        return;
     }
-    int hourCount=0;
-    for (int i=0;i<dayIll->illuminance().size();i++){
-        if(m_Occupancy[i]){
-            hourCount++;
-            if (model->illumUnits()=="lux"){
-                for (int j=0;j<dayIll->illuminance()[i].lux().size();j++){
-                    pointCount[j]=pointCount[j]+dayIll->illuminance()[i].lux()[j]/model->cDAIllum();
-                }
-            }else{
-                for (int j=0;j<dayIll->illuminance()[i].fc().size();j++){
-                    pointCount[j]=pointCount[j]+dayIll->illuminance()[i].fc()[j]/model->cDAIllum();
-                }
+    std::ofstream out(fingerprint.file);
+    out<<fingerprint.text;
+    out.close();
+    if (out.fail()){
+        STADIC_LOG(Severity::Warning, "The writing of the fingerprint file "+fingerprint.file+" has failed.");
+    }
+}
+
+static bool runMetric(Control *space, MetricKind kind)
+{
+    switch (kind){
+    case DAMetric:
+        return space->runDA();
+    case cDAMetric:
+        return space->runcDA();
+    case UDIMetric:
+        return space->runUDI();
+    case SweepMetric:
+        return space->runSweep();
+    case sDAMetric:
+        return space->runsDA();
+    default:
+        return space->runOccsDA();
+    }
+}
+
+static void clearMetric(Control *space, MetricKind kind)
+{
+    switch (kind){
+    case DAMetric:
+        space->setCalcDA(false);
+        break;
+    case cDAMetric:
+        space->setCalccDA(false);
+        break;
+    case UDIMetric:
+        space->setCalcUDI(false);
+        break;
+    case SweepMetric:
+        space->setCalcSweep(false);
+        break;
+    case sDAMetric:
+        space->setCalcsDA(false);
+        break;
+    default:
+        space->setCalcOccsDA(false);
+        break;
+    }
+}
+
+//Count the timesteps in an hour from the spacing of the first two timesteps of the time axis
+static int stepsPerHour(const DaylightIlluminanceData &axis)
+{
+    if (axis.timesteps()<2 || axis.month(0)!=axis.month(1) || axis.day(0)!=axis.day(1)){
+        return 1;
+    }
+    double spacing=axis.hour(1)-axis.hour(0);
+    if (spacing<=0 || spacing>=1){
+        return 1;
+    }
+    return int(std::floor(1/spacing+0.5));
+}
+
+void Metrics::processSpace(Control *space)
+{
+    //Metrics whose inputs and parameters are unchanged since their results were written are reused
+    std::vector<MetricFingerprint> fingerprints(MetricKinds);
+    for (int i=0;i<MetricKinds;i++){
+        MetricKind kind=MetricKind(i);
+        if (!runMetric(space,kind)){
+            continue;
+        }
+        if (m_Incremental){
+            fingerprints[i]=metricFingerprint(space,kind);
+            if (reusable(fingerprints[i])){
+                STADIC_LOG(Severity::Info, "The "+std::string(metricName(kind))+" results of "+space->spaceName()+" are up to date and have been reused.");
+                clearMetric(space,kind);
+                m_Reused++;
+                continue;
+            }
+            //A failed calculation must not leave the old fingerprint behind
+            std::remove(fingerprints[i].file.c_str());
+        }
+        m_Computed++;
+    }
+    if (!space->runDA() && !space->runcDA() && !space->runUDI() && !space->runSweep() && !space->runsDA() && !space->runOccsDA()){
+        //Nothing else needs the illuminance
+        if (space->runDF() && calculateDF(space, nullptr)){
+            space->setDF(false);
+        }
+        return;
+    }
+
+    //With a memory budget the illuminance is taken a block of points at a time
+    std::string prefix=space->spaceDirectory()+space->resultsDirectory()+space->spaceName();
+    IlluminanceBlockReader reader;
+    DaylightIlluminanceData daylightIll;
+    unsigned timesteps, points;
+    if (m_MemoryBudget>0){
+        if (!reader.open(prefix+".ill",scratchFile(space,""))){
+            STADIC_ERROR("The illuminance of "+space->spaceName()+" could not be read, so no metrics have been calculated.");
+            return;
+        }
+        timesteps=reader.timesteps();
+        points=reader.points();
+    }else{
+        daylightIll.setThreads(m_SpaceThreads);
+        if (!daylightIll.parseTimeBased(prefix+".ill")){
+            STADIC_ERROR("The illuminance of "+space->spaceName()+" could not be read, so no metrics have been calculated.");
+            return;
+        }
+        daylightIll.elideDarkTimesteps();
+        timesteps=daylightIll.timesteps();
+        points=daylightIll.points();
+    }
+    std::vector<bool> occupancy;
+    if (space->runDA() || space->runcDA() || space->runUDI() || space->runOccsDA() || space->runSweep()){
+        if (!parseOccupancy(space->spaceDirectory()+space->inputDirectory()+space->occSchedule(),0.5,&occupancy)){
+            return;
+        }
+    }
+    //The time masks are compiled once and shared by every metric
+    const DaylightIlluminanceData &axis=m_MemoryBudget>0 ? reader.timeAxis() : daylightIll;
+    //An hourly occupancy schedule covers every timestep within each of its hours
+    unsigned stepsPerValue=1;
+    if (!occupancy.empty() && occupancy.size()!=timesteps){
+        stepsPerValue=stepsPerHour(axis);
+        if (occupancy.size()*stepsPerValue!=timesteps){
+            STADIC_LOG(Severity::Error, "The occupancy schedule of "+space->spaceName()+" has "+toString(occupancy.size())+" values, which matches neither the timesteps nor the hours of the illuminance.");
+            return;
+        }
+    }
+    TimeMask occupied(occupancy,timesteps,stepsPerValue);
+    TimeMask sDAHours=analysisWindow(space,axis);
+    //So is the unit conversion, which picks the kernels used for every point
+    double divisor=illuminanceDivisor(space);
+
+    //DA, cDA and UDI share a single sweep over the illuminance
+    AnnualStatistics statistics;
+    statistics.setDivisor(divisor);
+    if (space->runDA()){
+        statistics.setDA(space->DAIllum());
+    }
+    if (space->runcDA()){
+        statistics.setcDA(space->cDAIllum());
+    }
+    if (space->runUDI()){
+        statistics.setUDI(space->UDIMin(),space->UDIMax());
+    }
+    //Every threshold of the sweep is a bin edge, so the sweep is exact
+    std::vector<double> edges=space->sweepDAIllums();
+    std::vector<std::pair<double, double>> ranges=space->sweepUDIRanges();
+    for (int i=0;i<ranges.size();i++){
+        edges.push_back(ranges[i].first);
+        edges.push_back(ranges[i].second);
+    }
+    IlluminanceHistogram histogram(edges);
+    histogram.setDivisor(divisor);
+
+    bool DA=space->runDA();
+    bool cDA=space->runcDA();
+    bool UDI=space->runUDI();
+    bool sweep=space->runSweep();
+    unsigned blockSize=m_MemoryBudget>0 ? blockPoints(timesteps,1) : std::max(points,1u);
+    unsigned blocks=points==0 ? 1 : (points+blockSize-1)/blockSize;
+    for (unsigned block=0;block<blocks;block++){
+        unsigned first=block*blockSize;
+        if (m_MemoryBudget>0){
+            reader.readBlock(first,std::min(blockSize,points-first),&daylightIll);
+            daylightIll.elideDarkTimesteps();
+        }
+        //The results of later blocks are appended to those of the first
+        bool append=block>0;
+        if (statistics.DA() || statistics.cDA() || statistics.UDI()){
+            if (!statistics.compute(daylightIll,occupied)){
+                return;
             }
         }
+        DA=DA && calculateDA(space, statistics, append);
+        cDA=cDA && calculatecDA(space, statistics, append);
+        UDI=UDI && calculateUDI(space, statistics, append);
+        sweep=sweep && histogram.compute(daylightIll,occupied) && calculateSweep(space, histogram, append);
+    }
+
+    //Test whether Daylight Autonomy needs to be calculated
+    if (DA){
+        space->setCalcDA(false);      //Set calculate to false for DA in control file if returned true
+        recordFingerprint(fingerprints[DAMetric]);
+    }
+
+    if (cDA){
+        space->setCalccDA(false);
+        recordFingerprint(fingerprints[cDAMetric]);
+    }
+
+    if (space->runDF()){
+        if (calculateDF(space, &daylightIll)){
+            space->setDF(false);
+        }
+    }
+
+    if (UDI){
+        space->setCalcUDI(false);
+        recordFingerprint(fingerprints[UDIMetric]);
+    }
+
+    if (sweep){
+        space->setCalcSweep(false);
+        recordFingerprint(fingerprints[SweepMetric]);
+    }
+
+    if (m_MemoryBudget>0){
+        daylightIll=DaylightIlluminanceData();
+        reader.close();
+    }
+
+    if (space->runsDA()){
+        if (calculatesDA(space, sDAHours, divisor)){
+            space->setCalcsDA(false);
+            recordFingerprint(fingerprints[sDAMetric]);
+        }
+    }
+
+    if (space->runOccsDA()){
+        if (m_MemoryBudget>0 ? calculateOccsDABlocked(space, occupied, divisor) : calculateOccsDA(space, &daylightIll, occupied, divisor)){
+            space->setCalcOccsDA(false);
+            recordFingerprint(fingerprints[OccsDAMetric]);
+        }
+    }
+}
+
+void Metrics::setIncremental(bool incremental){
+    m_Incremental=incremental;
+}
+
+bool Metrics::incremental() const{
+    return m_Incremental;
+}
+
+unsigned Metrics::reusedMetrics() const{
+    return m_Reused;
+}
+
+unsigned Metrics::computedMetrics() const{
+    return m_Computed;
+}
+
+void Metrics::setMemoryBudget(size_t bytes){
+    m_MemoryBudget=bytes;
+}
+
+size_t Metrics::memoryBudget() const{
+    return m_MemoryBudget;
+}
+
+unsigned Metrics::blockPoints(unsigned timesteps, unsigned matrices) const{
+    size_t pointBytes=size_t(std::max(timesteps,1u))*matrices*sizeof(double);
+    size_t points=m_MemoryBudget/pointBytes;
+    if (points<1){
+        return 1;
+    }
+    return unsigned(std::min<size_t>(points,std::numeric_limits<unsigned>::max()));
+}
+
+std::string Metrics::scratchFile(Control *model, const std::string &suffix) const{
+    PathName directory(model->spaceDirectory()+model->intermediateDataDirectory());
+    if (!directory.exists() && !directory.create()){
+        STADIC_ERROR("The creation of the intermediate directory failed at "+directory.toString());
     }
+    return model->spaceDirectory()+model->intermediateDataDirectory()+model->spaceName()+suffix+".scratch";
+}
 
-    std::ofstream outcDA;
+bool Metrics::calculateDA(Control *model, const AnnualStatistics &statistics, bool append)
+{
+    BufferedWriter outDA;
+    std::string tmpFileName;
+    tmpFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_DA.res";
+    outDA.open(tmpFileName, append);
+    if (!outDA.isOpen()){
+        STADIC_LOG(Severity::Error, "The opening of the Daylight Autonomy results file "+tmpFileName +" has failed.");
+        return false;
+    }
+    int hourCount=statistics.occupiedHours();
+    for (unsigned i=0;i<statistics.points();i++){
+        outDA<<double(statistics.DACounts()[i])/hourCount<<'\n';
+    }
+    if (!outDA.close()){
+        STADIC_ERROR("The writing of the Daylight Autonomy results file "+tmpFileName+" has failed.");
+        return false;
+    }
+    return true;
+}
+bool Metrics::calculatecDA(Control *model, const AnnualStatistics &statistics, bool append)
+{
+    BufferedWriter outcDA;
     std::string tmpFileName;
     tmpFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_cDA.res";
-    outcDA.open(tmpFileName);
-    if (!outcDA.is_open()){
+    outcDA.open(tmpFileName, append);
+    if (!outcDA.isOpen()){
         STADIC_LOG(Severity::Error, "The opening of the Continuous Daylight Autonomy results file "+tmpFileName +" has failed.");
         return false;
     }
-    for (int i=0;i<dayIll->illuminance()[0].lux().size();i++){
-        outcDA<<double(pointCount[i])/hourCount<<std::endl;
+    int hourCount=statistics.occupiedHours();
+    for (unsigned i=0;i<statistics.points();i++){
+        double pointCount=statistics.cDASums()[i]/statistics.cDATarget();
+        outcDA<<pointCount/hourCount<<'\n';
+    }
+    if (!outcDA.close()){
+        STADIC_ERROR("The writing of the Continuous Daylight Autonomy results file "+tmpFileName+" has failed.");
+        return false;
     }
-    outcDA.close();
 
     return true;
 }
@@ -170,84 +832,125 @@ bool Metrics::calculateDF(Control *model, DaylightIlluminanceData *dayIll)
 
     return true;
 }
-bool Metrics::calculateUDI(Control *model, DaylightIlluminanceData *dayIll)
-{
-    std::vector<double> countWithin;
-    std::vector<double> countBelow;
-    std::vector<double> countAbove;
-    for (int i=0;i<dayIll->illuminance()[0].lux().size();i++){
-        countWithin.push_back(0);
-        countBelow.push_back(0);
-        countAbove.push_back(0);
-    }
-    int hourCount=0;
-    for (int i=0;i<dayIll->illuminance().size();i++){
-        if(m_Occupancy[i]){
-            hourCount++;
-            if (model->illumUnits()=="lux"){
-                for (int j=0;j<dayIll->illuminance()[i].lux().size();j++){
-                    if (dayIll->illuminance()[i].lux()[j]<model->UDIMin()){
-                        countBelow[j]++;
-                    }else if(dayIll->illuminance()[i].lux()[j]<=model->UDIMax()){
-                        countWithin[j]++;
-                    }else{
-                        countAbove[j]++;
-                    }
-                }
-            }else{
-                for (int j=0;j<dayIll->illuminance()[i].fc().size();j++){
-                    if (dayIll->illuminance()[i].fc()[j]<model->UDIMin()){
-                        countBelow[j]++;
-                    }else if(dayIll->illuminance()[i].fc()[j]<=model->UDIMax()){
-                        countWithin[j]++;
-                    }else{
-                        countAbove[j]++;
-                    }
-                }
-            }
-        }
-    }
+bool Metrics::calculateUDI(Control *model, const AnnualStatistics &statistics, bool append)
+{
+    int hourCount=statistics.occupiedHours();
+    const std::vector<size_t> &countBelow=statistics.UDIBelow();
+    const std::vector<size_t> &countWithin=statistics.UDIWithin();
+    const std::vector<size_t> &countAbove=statistics.UDIAbove();
 
-    std::ofstream outUDIbelow;
+    BufferedWriter outUDIbelow;
     std::string tmpFileName;
     tmpFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_below_UDI.res";
-    outUDIbelow.open(tmpFileName);
-    if (!outUDIbelow.is_open()){
+    outUDIbelow.open(tmpFileName, append);
+    if (!outUDIbelow.isOpen()){
         STADIC_LOG(Severity::Error, "The opening of the below UDI results file "+tmpFileName +" has failed.");
         return false;
     }
-    for (int i=0;i<dayIll->illuminance()[0].lux().size();i++){
-        outUDIbelow<<double(countBelow[i])/hourCount<<std::endl;
+    for (unsigned i=0;i<statistics.points();i++){
+        outUDIbelow<<double(countBelow[i])/hourCount<<'\n';
+    }
+    if (!outUDIbelow.close()){
+        STADIC_ERROR("The writing of the below UDI results file "+tmpFileName+" has failed.");
+        return false;
     }
-    outUDIbelow.close();
 
-    std::ofstream outUDI;
+    BufferedWriter outUDI;
     tmpFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_UDI.res";
-    outUDI.open(tmpFileName);
-    if (!outUDI.is_open()){
+    outUDI.open(tmpFileName, append);
+    if (!outUDI.isOpen()){
         STADIC_LOG(Severity::Error, "The opening of the UDI results file "+tmpFileName +" has failed.");
         return false;
     }
-    for (int i=0;i<dayIll->illuminance()[0].lux().size();i++){
-        outUDI<<double(countWithin[i])/hourCount<<std::endl;
+    for (unsigned i=0;i<statistics.points();i++){
+        outUDI<<double(countWithin[i])/hourCount<<'\n';
+    }
+    if (!outUDI.close()){
+        STADIC_ERROR("The writing of the UDI results file "+tmpFileName+" has failed.");
+        return false;
     }
-    outUDI.close();
 
-    std::ofstream outUDIabove;
+    BufferedWriter outUDIabove;
     tmpFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_above_UDI.res";
-    outUDIabove.open(tmpFileName);
-    if (!outUDIabove.is_open()){
+    outUDIabove.open(tmpFileName, append);
+    if (!outUDIabove.isOpen()){
         STADIC_LOG(Severity::Error, "The opening of the above UDI results file "+tmpFileName +" has failed.");
         return false;
     }
-    for (int i=0;i<dayIll->illuminance()[0].lux().size();i++){
-        outUDIabove<<double(countAbove[i])/hourCount<<std::endl;
+    for (unsigned i=0;i<statistics.points();i++){
+        outUDIabove<<double(countAbove[i])/hourCount<<'\n';
+    }
+    if (!outUDIabove.close()){
+        STADIC_ERROR("The writing of the above UDI results file "+tmpFileName+" has failed.");
+        return false;
     }
-    outUDIabove.close();
 
     return true;
 }
-bool Metrics::calculatesDA(Control *model, DaylightIlluminanceData *dayIll)
+bool Metrics::calculateSweep(Control *model, const IlluminanceHistogram &histogram, bool append)
+{
+    BufferedWriter outSweep;
+    std::string tmpFileName;
+    tmpFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_sweep.res";
+    outSweep.open(tmpFileName, append);
+    if (!outSweep.isOpen()){
+        STADIC_LOG(Severity::Error, "The opening of the metric sweep results file "+tmpFileName +" has failed.");
+        return false;
+    }
+    std::vector<double> DAIllums=model->sweepDAIllums();
+    std::vector<double> cDAIllums=model->sweepcDAIllums();
+    std::vector<std::pair<double, double>> UDIRanges=model->sweepUDIRanges();
+    //One column per metric, named after its thresholds
+    std::vector<std::string> columns;
+    for (int i=0;i<DAIllums.size();i++){
+        columns.push_back("DA_"+toString(DAIllums[i]));
+    }
+    for (int i=0;i<cDAIllums.size();i++){
+        columns.push_back("cDA_"+toString(cDAIllums[i]));
+    }
+    for (int i=0;i<UDIRanges.size();i++){
+        std::string range=toString(UDIRanges[i].first)+"_"+toString(UDIRanges[i].second);
+        columns.push_back("below_UDI_"+range);
+        columns.push_back("UDI_"+range);
+        columns.push_back("above_UDI_"+range);
+    }
+    if (!append){
+        for (int i=0;i<columns.size();i++){
+            outSweep<<(i>0 ? " " : "")<<columns[i];
+        }
+        outSweep<<'\n';
+    }
+    int hourCount=histogram.occupiedHours();
+    for (unsigned p=0;p<histogram.points();p++){
+        bool first=true;
+        for (int i=0;i<DAIllums.size();i++){
+            outSweep<<(first ? "" : " ")<<double(histogram.countAbove(p,DAIllums[i]))/hourCount;
+            first=false;
+        }
+        for (int i=0;i<cDAIllums.size();i++){
+            double pointCount=histogram.sum(p)/cDAIllums[i];
+            outSweep<<(first ? "" : " ")<<pointCount/hourCount;
+            first=false;
+        }
+        for (int i=0;i<UDIRanges.size();i++){
+            size_t below=histogram.countBelow(p,UDIRanges[i].first);
+            size_t above=histogram.countAbove(p,UDIRanges[i].second);
+            outSweep<<(first ? "" : " ")<<double(below)/hourCount;
+            outSweep<<" "<<double(hourCount-below-above)/hourCount;
+            outSweep<<" "<<double(above)/hourCount;
+            first=false;
+        }
+        outSweep<<'\n';
+    }
+    if (!outSweep.close()){
+        STADIC_ERROR("The writing of the metric sweep results file "+tmpFileName+" has failed.");
+        return false;
+    }
+    return true;
+}
+
+//Floor area of the space in square feet
+static bool floorArea(Control *model, double *area)
 {
     //Calculate the area of the floor polygons
     GridMaker gridSize(model->spaceDirectory()+model->geoDirectory()+model->geoFile());
@@ -263,288 +966,339 @@ bool Metrics::calculatesDA(Control *model, DaylightIlluminanceData *dayIll)
         STADIC_LOG(Severity::Error, "The calculation of the floor area for "+model->spaceName()+" has failed.");
         return false;
     }
-    double area;
-    area=gridSize.area();
+    *area=gridSize.area();
     //Correct all values to be in feet.
     if (model->importUnits()=="mm"){
-        area=area*0.00328084*0.00328084;
+        *area=*area*0.00328084*0.00328084;
     }else if (model->importUnits()=="in"){
-        area=area/144;
+        *area=*area/144;
     }else if (model->importUnits()=="m"){
-        area=area*3.28084*3.28084;
+        *area=*area*3.28084*3.28084;
     }
+    return true;
+}
 
+//Fraction of the points that may see direct sun in an hour
+static double sDALimit(double area, unsigned points)
+{
     //Calculate the target sDA Percentage to stay under with direct sun.
     double sDAPercent=0.02;
     if (area<200){
-        sDAPercent=2.0/dayIll->illuminance()[0].lux().size();
+        sDAPercent=2.0/points;
     }else if (area<500){
-        sDAPercent=4.0/dayIll->illuminance()[0].lux().size();
+        sDAPercent=4.0/points;
     }else if (area<1000){
-        sDAPercent=6.0/dayIll->illuminance()[0].lux().size();
+        sDAPercent=6.0/points;
     }
     if (sDAPercent<0.02){
         sDAPercent=0.2;
     }
+    return sDAPercent;
+}
 
-    //Create possible shade combinations array
-    std::vector<std::vector<bool>> combinations;
-    combinations.resize(int(std::pow(2, model->windowGroups().size())));        //Resizes the main vector to the number of combinations
-    for (int i=0;i<combinations.size();i++){
-        combinations[i].resize(model->windowGroups().size());                   //Resizes the inner vectors to the number of window groups
-    }
-    for (int i=0;i<model->windowGroups().size();i++){                           //This section fills the first window group with [on, off, on, off,...]
-        int count=0;                                                            //The second window group with [on, on, off, off, ...]
-        bool shadesEmployed=true;
-        for (int j=0;j<combinations.size();j++){
-            count++;
-            combinations[j][i]=shadesEmployed;
-            if (count==int(std::pow(2,i))){
-                count=0;
-                if (shadesEmployed==true){
-                    shadesEmployed=false;
-                }else{
-                    shadesEmployed=true;
-                }
+//Sum the chosen input of every window group at each timestep, for a block of points
+static void combineIlluminance(const std::vector<std::vector<const DaylightIlluminanceData*>> &inputs, const std::vector<std::vector<int>> &choices, DaylightIlluminanceData *finalIlluminance)
+{
+    finalIlluminance->copyTimeAxis(*inputs[0][0]);
+    finalIlluminance->resize(inputs[0][0]->points());
+    for (unsigned k=0;k<finalIlluminance->points();k++){    //Loop over points
+        double *finalIll=finalIlluminance->pointData(k);
+        for (int j=0;j<inputs.size();j++){                  //Loop over window groups
+            for (int i=0;i<choices.size();i++){             //Loop over the entire year
+                finalIll[i]=finalIll[i] + inputs[j][choices[i][j]]->lux(k,i);
             }
         }
     }
+}
 
-    //Parse the direct illuminance files and store objects in vectors for both base and setting cases.
-    std::vector<DaylightIlluminanceData> baseDirectIlls;
-    for (int i=0;i<model->windowGroups().size();i++){
-        DaylightIlluminanceData illBase;
-        illBase.parseTimeBased(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base_direct.ill");
-        baseDirectIlls.push_back(illBase);
-    }
-    //Calculate ASE
-    std::vector<int> countASE;
-    for (int i=0;i<baseDirectIlls[0].illuminance()[0].lux().size();i++){            //Loop over points
-        countASE.push_back(0);
-        for (int j=0;j<baseDirectIlls[0].illuminance().size();j++){                 //Loop over hours in the year
-            if (baseDirectIlls[0].illuminance()[j].hour()>=model->sDAStart()&&baseDirectIlls[0].illuminance()[j].hour()<=model->sDAEnd()){
-                double tempIll=0;
-                for (int k=0;k<baseDirectIlls.size();k++){                          //Loop over window groups
-                    tempIll=tempIll+baseDirectIlls[k].illuminance()[j].lux()[i];    //Sum the direct illuminance from window groups
-                }
-                if (tempIll>1000){                                                  //Test whether it is over the threshold of 1000 lux and add 1 to the count if it is
-                    countASE[i]++;
-                }
-            }
+//Write the sum of the chosen input of every window group as a time based .ill file, a timestep at a time
+static bool writeCombinedIlluminance(const std::string &fileName, const std::vector<std::vector<const IlluminanceBlockReader*>> &inputs, const std::vector<std::vector<int>> &choices, const kernels::KernelSet &kernelSet)
+{
+    const DaylightIlluminanceData &axis=inputs[0][0]->timeAxis();
+    unsigned points=inputs[0][0]->points();
+    BufferedWriter oFile;
+    if (!oFile.open(fileName)){
+        STADIC_ERROR("The opening of the illuminance file "+fileName+" failed.");
+        return false;
+    }
+    std::vector<double> total(points);
+    std::vector<double> row(points);
+    for (unsigned i=0;i<axis.timesteps();i++){
+        std::fill(total.begin(),total.end(),0);
+        for (int j=0;j<inputs.size();j++){
+            inputs[j][choices[i][j]]->readRow(i,row.data());
+            kernelSet.accumulate(total.data(),row.data(),points);
+        }
+        oFile<<axis.month(i)<<' '<<axis.day(i)<<' '<<axis.hour(i);
+        for (unsigned k=0;k<points;k++){
+            oFile<<' '<<total[k];
+        }
+        oFile<<'\n';
+    }
+    if (!oFile.close()){
+        STADIC_ERROR("The writing of the illuminance file "+fileName+" failed.");
+        return false;
+    }
+    return true;
+}
+
+//Parse the shade option file, one setting per window group and timestep (0 for the base case)
+static bool parseShadeSchedule(Control *model, unsigned timesteps, std::vector<std::vector<int>> *shadeSchedule)
+{
+    shadeSchedule->assign(timesteps,std::vector<int>(model->windowGroups().size(),0));
+    std::ifstream shadeFile;
+    shadeFile.open(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_shades.sch");
+    if (!shadeFile.is_open()){
+        STADIC_LOG(Severity::Error, "The opening of the shade schedule file "+model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_shades.sch has failed.");
+        return false;
+    }
+    std::string line;
+    int lineCounter=0;
+    while (std::getline(shadeFile, line) && lineCounter<timesteps){
+        std::vector<std::string> vals;
+        vals=trimmedSplit(line, ',');
+        for (int i=3;i<vals.size() && i-3<model->windowGroups().size();i++){
+            (*shadeSchedule)[lineCounter][i-3]=toInteger(vals[i]);
         }
+        lineCounter++;
     }
+    return true;
+}
+
+//Write out ASE from the hours of direct sun over 1000 lux at each point
+static bool writeASE(Control *model, double area, const std::vector<int> &countASE, int stepsPerHour)
+{
     int totalPoints=0;
     for (int i=0;i<countASE.size();i++){
-        if (countASE[i]>250){
+        if (countASE[i]>250*stepsPerHour){
             totalPoints++;
         }
     }
     //Write out ASE
-    std::ofstream outASE;
-    outASE.open(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_ASE.res");
-    if (!outASE.is_open()){
-        STADIC_LOG(Severity::Warning, "The results file for the ASE calculation failed to open for "+model->spaceName()+".");
-    }else{
-        outASE<<"area= "<<area<<std::endl;
-        outASE<<"ASE= "<<double(totalPoints)/countASE.size()<<std::endl;
-        outASE.close();
-    }
-
-    //Find the combination closest to the sDAPercent without going over and produce shade schedule
-    std::vector<std::vector<int>> shadeSchedule;
-    shadeSchedule.resize(baseDirectIlls[0].illuminance().size());
-    for (int i=0;i<baseDirectIlls[0].illuminance().size();i++){
-        for (int j=0;j<model->windowGroups().size();j++){
-            shadeSchedule[i].push_back(0);
-        }
+    BufferedWriter outASE;
+    std::string tempFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_ASE.res";
+    outASE.open(tempFileName);
+    if (!outASE.isOpen()){
+        STADIC_ERROR("The results file for the ASE calculation failed to open for "+model->spaceName()+".");
+        return false;
     }
-    for (int i=0;i<baseDirectIlls[0].illuminance().size();i++){         //Loop through the number of hours in the year
-        bool allZeros=true;
-        for (int p=0;p<model->windowGroups().size();p++){
-            if (!baseDirectIlls[p].illuminance()[i].allZeros()){
-                allZeros=false;
-            }
-        }
-        if (!allZeros){
-            std::vector<double> fracDirectSun;                              //Fraction of direct sun per window group
-            for (int j=0;j<model->windowGroups().size();j++){
-                fracDirectSun.push_back(baseDirectIlls[j].illuminance()[i].fractionAboveTarget(300));
-            }
-            int closestCombo;                                               //Variable to hold the index of the best combination
-            double tempFracTotal=0;
-            double min=1;
-            for (int j=0;j<combinations.size();j++){                        //Loop through the possible combinations
-                for (int k=0;k<fracDirectSun.size();k++){
-                    if (!combinations[j][k]){                                  //True if the shades are employed
-                        tempFracTotal=tempFracTotal+fracDirectSun[k];
-                    }
-                }
-                if (sDAPercent>tempFracTotal && (sDAPercent-tempFracTotal)<=min){
-                    closestCombo=j;
-                    min=sDAPercent-tempFracTotal;
-                }
-            }
-            for (int j=0;j<model->windowGroups().size();j++){
-                if (combinations[closestCombo][j]){
-                    shadeSchedule[i][j]=model->sDAwgSettings()[j];
-                }
-            }
-        }
+    outASE<<"area= "<<area<<'\n';
+    outASE<<"ASE= "<<double(totalPoints)/countASE.size()<<'\n';
+    if (!outASE.close()){
+        STADIC_ERROR("The writing of the ASE results file "+tempFileName+" has failed.");
+        return false;
     }
+    return true;
+}
 
-    //Write out the sDA shade option file
-    std::ofstream sDAShades;
+//Write out the sDA shade option file
+static bool writesDAShadeSchedule(Control *model, const DaylightIlluminanceData &axis, const std::vector<std::vector<int>> &shadeSchedule)
+{
+    BufferedWriter sDAShades;
     std::string tempFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_sDA_ShadeSchedule.res";
     sDAShades.open(tempFileName);
-    if (!sDAShades.is_open()){
+    if (!sDAShades.isOpen()){
         STADIC_LOG(Severity::Error, "The opening of the file "+tempFileName+" has failed.");
         return false;
     }
     for (int i=0;i<shadeSchedule.size();i++){
-        sDAShades<<toString(baseDirectIlls[0].illuminance()[i].month())<<" ";
-        sDAShades<<toString(baseDirectIlls[0].illuminance()[i].day())<<" ";
-        sDAShades<<toString(baseDirectIlls[0].illuminance()[i].hour());
+        sDAShades<<axis.month(i)<<" ";
+        sDAShades<<axis.day(i)<<" ";
+        sDAShades<<axis.hour(i);
         for (int j=0;j<shadeSchedule[i].size();j++){
-            sDAShades<<" "<<toString(shadeSchedule[i][j])<<std::endl;
+            sDAShades<<" "<<shadeSchedule[i][j];
         }
+        sDAShades<<'\n';
     }
-
-    //Combine Illuminance files based on shade option schedule
-    std::vector<DaylightIlluminanceData> baseIlls;
-    std::vector<DaylightIlluminanceData> settingIlls;
-    for (int i=0;i<model->windowGroups().size();i++){
-        DaylightIlluminanceData illBase;
-        illBase.parseTimeBased(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base.ill");
-        baseIlls.push_back(illBase);
-        DaylightIlluminanceData illSetting;
-        illSetting.parseTimeBased(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+toString(model->sDAwgSettings()[i])+".ill");
-        settingIlls.push_back(illSetting);
-    }
-    DaylightIlluminanceData finalIlluminance;
-    std::vector<double> finalTemporalIll;
-    for (int i=0;i<shadeSchedule.size();i++){               //Loop over the entire year
-        finalTemporalIll.clear();
-        for (int j=0;j<baseIlls[0].illuminance()[0].lux().size();j++){      //Set the illuminance vector to zero for all points
-            finalTemporalIll.push_back(0);
-        }
-        for (int j=0;j<shadeSchedule[i].size();j++){        //Loop over window groups
-            if (shadeSchedule[i][j]){           //Shades Employed
-                for (int k=0;k<settingIlls[j].illuminance()[i].lux().size();k++){
-                    finalTemporalIll[k]=finalTemporalIll[k] + settingIlls[j].illuminance()[i].lux()[k];
-                }
-            }else{                              //Use base condition
-                for (int k=0;k<baseIlls[j].illuminance()[i].lux().size();k++){
-                    finalTemporalIll[k]=finalTemporalIll[k] + baseIlls[j].illuminance()[i].lux()[k];
-                }
-            }
-        }
-        TemporalIlluminance dataPoint(baseDirectIlls[0].illuminance()[i].month(), baseDirectIlls[0].illuminance()[i].day(), baseDirectIlls[0].illuminance()[i].hour(), finalTemporalIll);
-        finalIlluminance.addDataPoint(dataPoint);
+    if (!sDAShades.close()){
+        STADIC_ERROR("The writing of the file "+tempFileName+" has failed.");
+        return false;
     }
-    //Write out sDA by point (DA with sDA shade control)
-    int countHours=0;
-    std::vector<int> sDACount;
-    sDACount.resize(finalIlluminance.illuminance()[0].lux().size());
-    if (model->illumUnits()=="lux"){
-        for (int i=0;i<finalIlluminance.illuminance().size();i++){          //Loop over the whole year
-            if (finalIlluminance.illuminance()[i].hour()>=model->sDAStart()&&finalIlluminance.illuminance()[i].hour()<=model->sDAEnd()){
-                countHours++;
-                for (int j=0;j<finalIlluminance.illuminance()[0].lux().size();j++){
-                    if (finalIlluminance.illuminance()[i].lux()[j]>model->sDAIllum()){
-                        sDACount[j]++;
-                    }
-                }
-            }
-        }
-    }else{
-        for (int i=0;i<finalIlluminance.illuminance().size();i++){          //Loop over the whole year
-            if (finalIlluminance.illuminance()[i].hour()>=model->sDAStart()&&finalIlluminance.illuminance()[i].hour()<=model->sDAEnd()){
-                countHours++;
-                for (int j=0;j<finalIlluminance.illuminance()[0].fc().size();j++){
-                    if (finalIlluminance.illuminance()[i].fc()[j]>model->sDAIllum()){
-                        sDACount[j]++;
-                    }
-                }
-            }
-        }
+    return true;
+}
+
+//Count the hours above the target at each point of a block
+static void countsDA(const DaylightIlluminanceData &finalIlluminance, const TimeMask &hours, double target, double divisor, const kernels::KernelSet &kernelSet, std::vector<int> *counts)
+{
+    TimeMask storedHours=hours.stored(finalIlluminance);
+    for (unsigned j=0;j<finalIlluminance.points();j++){
+        counts->push_back(kernelSet.countAboveAt(finalIlluminance.point(j).data(),storedHours.indices().data(),storedHours.count(),target,divisor));
     }
+}
 
-    finalIlluminance.writeIllFileLux(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_sDA.ill");
+//Write out sDA by point
+static bool writesDAPoints(Control *model, double area, const std::vector<int> &sDACount, int countHours, double fraction, const std::string &name, const std::string &suffix)
+{
     int finalsDA=0;
     for (int i=0;i<sDACount.size();i++){
-        if (sDACount[i]/double(countHours)>model->sDAFrac()){
+        if (sDACount[i]/double(countHours)>fraction){
             finalsDA++;
         }
     }
-    std::ofstream sDAPoint;
-    tempFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_sDA_Points.res";
+    BufferedWriter sDAPoint;
+    std::string tempFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+suffix;
     sDAPoint.open(tempFileName);
-    if (!sDAPoint.is_open()){
+    if (!sDAPoint.isOpen()){
         STADIC_LOG(Severity::Warning, "The opening of the sDA points result file "+tempFileName+" has failed.");
         return false;
     }
-    sDAPoint<<"area= "<<area<<std::endl;
-    sDAPoint<<"points= "<<sDACount.size()<<std::endl;
-    sDAPoint<<"sDA= "<<finalsDA/double(sDACount.size())<<std::endl;
+    sDAPoint<<"area= "<<area<<'\n';
+    sDAPoint<<"points= "<<sDACount.size()<<'\n';
+    sDAPoint<<name<<"= "<<finalsDA/double(sDACount.size())<<'\n';
     for (int i=0;i<sDACount.size();i++){
-        sDAPoint<<toString(sDACount[i]/double(countHours))<<std::endl;
+        sDAPoint<<sDACount[i]/double(countHours)<<'\n';
+    }
+    if (!sDAPoint.close()){
+        STADIC_ERROR("The writing of the sDA points result file "+tempFileName+" has failed.");
+        return false;
     }
-    sDAPoint.close();
-
-
     return true;
 }
-bool Metrics::calculateOccsDA(Control *model, DaylightIlluminanceData *dayIll)
+
+bool Metrics::calculatesDA(Control *model, const TimeMask &sDAHours, double divisor)
 {
-    //Calculate the area of the floor polygons
-    GridMaker gridSize(model->spaceDirectory()+model->geoDirectory()+model->geoFile());
-    if (model->identifiers()){
-        gridSize.setIdentifiers(model->identifiers().get());
-    }else if (model->modifiers()){
-        gridSize.setLayerNames(model->modifiers().get());
-    }else{
-        STADIC_LOG(Severity::Warning, "The calculation of sDA for "+model->spaceName()+" cannot be completed without a list of floor geometry.");
+    double area;
+    if (!floorArea(model,&area)){
         return false;
     }
-    if (!gridSize.calcArea()){
-        STADIC_LOG(Severity::Error, "The calculation of the floor area for "+model->spaceName()+" has failed.");
+    std::string prefix=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_";
+    size_t groups=model->windowGroups().size();
+    std::vector<int> settings=model->sDAwgSettings();
+    if (settings.size()<groups){
+        STADIC_LOG(Severity::Error, "The sDA of "+model->spaceName()+" needs a window group setting for every window group.");
         return false;
     }
-    double area;
-    area=gridSize.area();
-    //Correct all values to be in feet.
-    if (model->importUnits()=="mm"){
-        area=area*0.00328084*0.00328084;
-    }else if (model->importUnits()=="in"){
-        area=area/144;
-    }else if (model->importUnits()=="m"){
-        area=area*3.28084*3.28084;
+
+    //The base direct, base and sDA setting illuminance of each window group are read a timestep at a time
+    std::vector<std::unique_ptr<IlluminanceBlockReader>> readers;
+    for (int i=0;i<groups;i++){
+        std::string group=model->windowGroups()[i].name();
+        for (const std::string &name : {group+"_base_direct",group+"_base",group+"_set"+toString(settings[i])}){
+            readers.push_back(std::unique_ptr<IlluminanceBlockReader>(new IlluminanceBlockReader));
+            if (!readers.back()->open(prefix+name+".ill",scratchFile(model,"_"+name))){
+                return false;
+            }
+        }
     }
-    //Parse the shade option file
-    std::vector<std::vector<int>> shadeSchedule;
-    shadeSchedule.resize(dayIll->illuminance().size());
-    for (int i=0;i<shadeSchedule.size();i++){
-        for (int j=0;j<model->windowGroups().size();j++){
-            shadeSchedule[i].push_back(0);
+    const DaylightIlluminanceData &axis=readers[0]->timeAxis();
+    unsigned hours=axis.timesteps();
+    unsigned points=readers[0]->points();
+    for (int i=0;i<readers.size();i++){
+        if (readers[i]->timesteps()!=sDAHours.timesteps() || readers[i]->points()!=points){
+            STADIC_LOG(Severity::Error, "The illuminance files of "+model->spaceName()+" do not cover the same timesteps and points.");
+            return false;
         }
     }
-    std::ifstream shadeFile;
-    shadeFile.open(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_shades.sch");
-    if (!shadeFile.is_open()){
-        STADIC_LOG(Severity::Error, "The opening of the shade schedule file "+model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_shades.sch has failed.");
+    double sDAPercent=sDALimit(area,points);
+    BufferedWriter illFile;
+    if (model->writesDAIll() && !illFile.open(prefix+"sDA.ill")){
+        STADIC_ERROR("The opening of the illuminance file "+prefix+"sDA.ill failed.");
         return false;
     }
-    std::string line;
-    int lineCounter=0;
-    while (std::getline(shadeFile, line)){
-        std::vector<std::string> vals;
-        vals=trimmedSplit(line, ',');
-        for (int i=3;i<vals.size();i++){
-            shadeSchedule[lineCounter][i-3]=toInteger(vals[i]);
+
+    //One pass over the hours: the direct illuminance gives the ASE and picks the shades, and the
+    //chosen inputs are summed into a single row for the sDA. Within an hour the rows are taken a
+    //block of points at a time, with blocks too small to be worth a thread of their own merged.
+    unsigned threads=resolveThreads(m_SpaceThreads);
+    unsigned blockSize=std::max(4096u,(points+threads-1)/threads);
+    unsigned blocks=std::max((points+blockSize-1)/blockSize,1u);
+    std::vector<double> row(points);
+    std::vector<double> total(points);
+    std::vector<std::vector<unsigned>> blockSunlit(blocks,std::vector<unsigned>(groups));
+    std::vector<unsigned char> blockLit(blocks);
+    std::vector<unsigned> sunlitPoints(groups);
+    std::vector<int> ASECounts(points,0);
+    std::vector<int> sDACount(points,0);
+    std::vector<std::vector<int>> shadeSchedule(hours,std::vector<int>(groups,0));
+    double target=model->sDAIllum();
+    const kernels::KernelSet kernelSet;
+    for (unsigned i=0;i<hours;i++){
+        bool analyzed=sDAHours.selected(i);
+        parallelFor(blocks,threads,[&](unsigned block){
+            unsigned first=block*blockSize;
+            unsigned count=std::min(blockSize,points-first);
+            double *values=row.data()+first;
+            double *sum=total.data()+first;
+            std::fill(sum,sum+count,0);
+            blockLit[block]=0;
+            for (int j=0;j<groups;j++){
+                readers[3*j]->readRow(i,first,count,values);
+                blockSunlit[block][j]=kernelSet.countAbove(values,nullptr,count,300);
+                blockLit[block]=blockLit[block] || kernelSet.anyAbove(values,count,0);
+                if (analyzed){
+                    kernelSet.accumulate(sum,values,count);
+                }
+            }
+            if (analyzed){
+                for (unsigned k=0;k<count;k++){
+                    ASECounts[first+k]+=sum[k]>1000;
+                }
+            }
+        });
+        //Find the combination closest to the sDAPercent without going over
+        bool anyLight=false;
+        std::fill(sunlitPoints.begin(),sunlitPoints.end(),0);
+        for (unsigned block=0;block<blocks;block++){
+            anyLight=anyLight || blockLit[block];
+            for (int j=0;j<groups;j++){
+                sunlitPoints[j]+=blockSunlit[block][j];
+            }
         }
-        lineCounter++;
+        if (anyLight){
+            std::vector<bool> shaded=sDAShadeCombination(sunlitPoints,points,sDAPercent);
+            for (int j=0;j<groups;j++){
+                if (shaded[j]){
+                    shadeSchedule[i][j]=settings[j];
+                }
+            }
+        }
+        parallelFor(blocks,threads,[&](unsigned block){
+            unsigned first=block*blockSize;
+            unsigned count=std::min(blockSize,points-first);
+            double *values=row.data()+first;
+            double *sum=total.data()+first;
+            std::fill(sum,sum+count,0);
+            for (int j=0;j<groups;j++){
+                readers[3*j+(shadeSchedule[i][j] ? 2 : 1)]->readRow(i,first,count,values);
+                kernelSet.accumulate(sum,values,count);
+            }
+            if (analyzed){
+                for (unsigned k=0;k<count;k++){
+                    sDACount[first+k]+=sum[k]/divisor>target;
+                }
+            }
+        });
+        if (illFile.isOpen()){
+            illFile<<axis.month(i)<<' '<<axis.day(i)<<' '<<axis.hour(i);
+            for (unsigned k=0;k<points;k++){
+                illFile<<' '<<total[k];
+            }
+            illFile<<'\n';
+        }
+    }
+    if (illFile.isOpen() && !illFile.close()){
+        STADIC_ERROR("The writing of the illuminance file "+prefix+"sDA.ill failed.");
+        return false;
+    }
+    if (!writeASE(model,area,ASECounts,stepsPerHour(axis))){
+        return false;
     }
+    if (!writesDAShadeSchedule(model,axis,shadeSchedule)){
+        return false;
+    }
+    return writesDAPoints(model,area,sDACount,sDAHours.count(),model->sDAFrac(),"sDA","_sDA_Points.res");
+}
 
+bool Metrics::calculateOccsDA(Control *model, DaylightIlluminanceData *dayIll, const TimeMask &occupied, double divisor)
+{
+    double area;
+    if (!floorArea(model,&area)){
+        return false;
+    }
+    std::vector<std::vector<int>> shadeSchedule;
+    if (!parseShadeSchedule(model,dayIll->timesteps(),&shadeSchedule)){
+        return false;
+    }
 
     //Combine Illuminance files based on shade option schedule
     std::vector<DaylightIlluminanceData> baseIlls;
@@ -552,103 +1306,118 @@ bool Metrics::calculateOccsDA(Control *model, DaylightIlluminanceData *dayIll)
     settingIlls.resize(model->windowGroups().size());
     for (int i=0;i<model->windowGroups().size();i++){
         DaylightIlluminanceData illBase;
+        illBase.setThreads(m_SpaceThreads);
         illBase.parseTimeBased(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_base.ill");
         baseIlls.push_back(illBase);
         for (int j=0;j<model->windowGroups()[i].shadeSettingGeometry().size();j++){
             DaylightIlluminanceData illSetting;
+            illSetting.setThreads(m_SpaceThreads);
             illSetting.parseTimeBased(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_"+model->windowGroups()[i].name()+"_set"+toString(j+1)+".ill");
             settingIlls[i].push_back(illSetting);
         }
 
     }
-    DaylightIlluminanceData finalIlluminance;
-    std::vector<double> finalTemporalIll;
-    for (int i=0;i<shadeSchedule.size();i++){               //Loop over the entire year
-        finalTemporalIll.clear();
-        for (int j=0;j<baseIlls[0].illuminance()[0].lux().size();j++){      //Set the illuminance vector to zero for all points
-            finalTemporalIll.push_back(0);
-        }
-        for (int j=0;j<shadeSchedule[i].size();j++){        //Loop over window groups
-            if (shadeSchedule[i][j]){           //Shades Employed
-                for (int k=0;k<settingIlls[j][shadeSchedule[i][j]-1].illuminance()[i].lux().size();k++){
-                    finalTemporalIll[k]=finalTemporalIll[k] + settingIlls[j][shadeSchedule[i][j]-1].illuminance()[i].lux()[k];
-                }
-            }else{                              //Use base condition
-                for (int k=0;k<baseIlls[j].illuminance()[i].lux().size();k++){
-                    finalTemporalIll[k]=finalTemporalIll[k] + baseIlls[j].illuminance()[i].lux()[k];
-                }
-            }
+    std::vector<std::vector<const DaylightIlluminanceData*>> inputs(model->windowGroups().size());
+    for (int i=0;i<model->windowGroups().size();i++){
+        inputs[i].push_back(&baseIlls[i]);
+        for (int j=0;j<settingIlls[i].size();j++){
+            inputs[i].push_back(&settingIlls[i][j]);
         }
-        TemporalIlluminance dataPoint(baseIlls[0].illuminance()[i].month(), baseIlls[0].illuminance()[i].day(), baseIlls[0].illuminance()[i].hour(), finalTemporalIll);
-        finalIlluminance.addDataPoint(dataPoint);
     }
+    DaylightIlluminanceData finalIlluminance;
+    const kernels::KernelSet kernelSet;
+    combineIlluminance(inputs,shadeSchedule,&finalIlluminance);
     //Write out sDA by point (DA with sDA shade control)
-    int countHours=0;
     std::vector<int> sDACount;
-    sDACount.resize(finalIlluminance.illuminance()[0].lux().size());
-    if (model->illumUnits()=="lux"){
-        for (int i=0;i<finalIlluminance.illuminance().size();i++){          //Loop over the whole year
-            if (m_Occupancy[i]>(0.1)){                                      //This threshold should probably come from the user.
-                countHours++;
-                for (int j=0;j<finalIlluminance.illuminance()[0].lux().size();j++){
-                    if (finalIlluminance.illuminance()[i].lux()[j]>model->occsDAIllum()){
-                        sDACount[j]++;
-                    }
-                }
+    countsDA(finalIlluminance,occupied,model->occsDAIllum(),divisor,kernelSet,&sDACount);
+    if (!finalIlluminance.writeIllFileLux(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_occupancy_sDA.ill")){
+        return false;
+    }
+    return writesDAPoints(model,area,sDACount,occupied.count(),model->occsDAFrac(),"occupancy_sDA","_occupancy_sDA_Points.res");
+}
+
+bool Metrics::calculateOccsDABlocked(Control *model, const TimeMask &occupied, double divisor)
+{
+    double area;
+    if (!floorArea(model,&area)){
+        return false;
+    }
+    std::string prefix=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_";
+    size_t groups=model->windowGroups().size();
+    std::vector<std::unique_ptr<IlluminanceBlockReader>> readers;
+    std::vector<std::vector<const IlluminanceBlockReader*>> readerInputs(groups);
+    std::vector<std::vector<int>> offsets(groups);                              //Index of each input within readers
+    for (int i=0;i<groups;i++){
+        for (int j=0;j<=model->windowGroups()[i].shadeSettingGeometry().size();j++){
+            std::string name=model->windowGroups()[i].name()+(j==0 ? "_base" : "_set"+toString(j));
+            readers.push_back(std::unique_ptr<IlluminanceBlockReader>(new IlluminanceBlockReader));
+            if (!readers.back()->open(prefix+name+".ill",scratchFile(model,"_"+name))){
+                return false;
             }
+            readerInputs[i].push_back(readers.back().get());
+            offsets[i].push_back(readers.size()-1);
         }
-    }else{
-        for (int i=0;i<finalIlluminance.illuminance().size();i++){          //Loop over the whole year
-            if (m_Occupancy[i]>(0.1)){
-                countHours++;
-                for (int j=0;j<finalIlluminance.illuminance()[0].fc().size();j++){
-                    if (finalIlluminance.illuminance()[i].fc()[j]>model->occsDAIllum()){
-                        sDACount[j]++;
-                    }
-                }
-            }
+    }
+    unsigned hours=readers[0]->timesteps();
+    std::vector<std::vector<int>> shadeSchedule;
+    if (!parseShadeSchedule(model,hours,&shadeSchedule)){
+        return false;
+    }
+    std::vector<DaylightIlluminanceData> blocks(readers.size());
+    std::vector<std::vector<const DaylightIlluminanceData*>> inputs(groups);
+    for (int i=0;i<groups;i++){
+        for (int j=0;j<offsets[i].size();j++){
+            inputs[i].push_back(&blocks[offsets[i][j]]);
         }
     }
-
-    finalIlluminance.writeIllFileLux(model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_occupancy_sDA.ill");
-    int finalsDA=0;
-    for (int i=0;i<sDACount.size();i++){
-        if (sDACount[i]/double(countHours)>model->occsDAFrac()){
-            finalsDA++;
+    std::vector<int> sDACount;
+    DaylightIlluminanceData finalIlluminance;
+    const kernels::KernelSet kernelSet;
+    unsigned blockSize=blockPoints(hours,readers.size()+1);
+    for (unsigned first=0;first<readers[0]->points();first+=blockSize){
+        unsigned count=std::min(blockSize,readers[0]->points()-first);
+        for (int i=0;i<readers.size();i++){
+            readers[i]->readBlock(first,count,&blocks[i]);
         }
+        combineIlluminance(inputs,shadeSchedule,&finalIlluminance);
+        countsDA(finalIlluminance,occupied,model->occsDAIllum(),divisor,kernelSet,&sDACount);
     }
-    std::ofstream sDAPoint;
-    std::string tempFileName=model->spaceDirectory()+model->resultsDirectory()+model->spaceName()+"_occupancy_sDA_Points.res";
-    sDAPoint.open(tempFileName);
-    if (!sDAPoint.is_open()){
-        STADIC_LOG(Severity::Warning, "The opening of the sDA points result file "+tempFileName+" has failed.");
+    blocks.clear();
+    finalIlluminance=DaylightIlluminanceData();
+    if (!writeCombinedIlluminance(prefix+"occupancy_sDA.ill",readerInputs,shadeSchedule,kernelSet)){
         return false;
     }
-    sDAPoint<<"area= "<<area<<std::endl;
-    sDAPoint<<"points= "<<sDACount.size()<<std::endl;
-    sDAPoint<<"occupancy_sDA= "<<finalsDA/double(sDACount.size())<<std::endl;
-    for (int i=0;i<sDACount.size();i++){
-        sDAPoint<<toString(sDACount[i]/double(countHours))<<std::endl;
-    }
-    sDAPoint.close();
+    return writesDAPoints(model,area,sDACount,occupied.count(),model->occsDAFrac(),"occupancy_sDA","_occupancy_sDA_Points.res");
+}
 
-    return true;
+TimeMask Metrics::analysisWindow(Control *model, const DaylightIlluminanceData &axis){
+    return TimeMask::hourWindow(axis,model->sDAStart(),model->sDAEnd());
+}
+
+double Metrics::illuminanceDivisor(Control *model){
+    //Exactly 1 for lux, which lets the kernels skip the division
+    return model->illumUnits()=="lux" ? 1 : 10.764;
 }
-bool Metrics::parseOccupancy(std::string file, double threshold){
+
+bool Metrics::parseOccupancy(std::string file, double threshold, std::vector<bool> *occupancy){
     std::ifstream occFile;
     occFile.open(file);
     if (!occFile.is_open()){
         STADIC_LOG(Severity::Error, "The opening of the occupancy csv file "+file+" has failed.");
         return false;
     }
+    occupancy->clear();
     std::string line;
     while (std::getline(occFile, line)){
         std::vector<std::string> vals;
         vals=split(line, ',');
+        if (vals.size()<4){
+            continue;
+        }
         if (toDouble(vals[3])<threshold){
-            m_Occupancy.push_back(false);
+            occupancy->push_back(false);
         }else{
-            m_Occupancy.push_back(true);
+            occupancy->push_back(true);
         }
     }
     occFile.close();
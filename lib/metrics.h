@@ -33,30 +33,159 @@
 
 #include "spacecontrol.h"
 #include "buildingcontrol.h"
+#include <atomic>
 #include <vector>
 #include <string>
 #include "dayill.h"
+#include "timemask.h"
 
 #include "stadicapi.h"
 
 namespace stadic {
+
+// AnnualStatistics gathers the per-point statistics behind DA, cDA and UDI in
+// a single sweep over an illuminance data set: each point's annual series is
+// visited once and every requested statistic is taken from it while it is in
+// cache. Only the occupied timesteps are visited, from the list held by the
+// occupancy TimeMask, so the loops do not test every hour. Timesteps dropped by
+// elideDarkTimesteps are not visited, but their occupied hours are still
+// counted, in the band that zero illuminance falls in.
+class STADIC_API AnnualStatistics
+{
+public:
+    explicit AnnualStatistics();
+    void setDA(double target);                                                  //Function to request the count of hours above the DA target
+    void setcDA(double target);                                                 //Function to request the illuminance sum behind cDA
+    void setUDI(double minimum, double maximum);                                //Function to request the counts of hours in the three UDI bands
+    void setDivisor(double divisor);                                            //Function to set the divisor that converts lux to the units of the targets
+    bool compute(const DaylightIlluminanceData &data, const TimeMask &occupied);    //Function to sweep the occupied timesteps of the data
+
+    //Getters
+    bool DA() const;                                                            //Function that returns true if the DA counts were requested
+    bool cDA() const;                                                           //Function that returns true if the cDA sums were requested
+    bool UDI() const;                                                           //Function that returns true if the UDI counts were requested
+    double cDATarget() const;                                                   //Function that returns the cDA target
+    unsigned points() const;                                                    //Function that returns the number of points swept
+    size_t occupiedHours() const;                                               //Function that returns the number of occupied timesteps
+    const std::vector<size_t> &DACounts() const;                                //Function that returns the occupied hours above the DA target per point
+    const std::vector<double> &cDASums() const;                                 //Function that returns the occupied illuminance sum per point
+    const std::vector<size_t> &UDIBelow() const;                                //Function that returns the occupied hours below the UDI minimum per point
+    const std::vector<size_t> &UDIWithin() const;                               //Function that returns the occupied hours within the UDI range per point
+    const std::vector<size_t> &UDIAbove() const;                                //Function that returns the occupied hours above the UDI maximum per point
+
+private:
+    bool m_DA;
+    bool m_cDA;
+    bool m_UDI;
+    double m_DATarget;
+    double m_cDATarget;
+    double m_UDIMin;
+    double m_UDIMax;
+    double m_Divisor;                                                           //Divisor converting lux to the units of the targets
+    unsigned m_Points;
+    size_t m_OccupiedHours;
+    std::vector<size_t> m_DACounts;
+    std::vector<double> m_cDASums;
+    std::vector<size_t> m_UDIBelow;
+    std::vector<size_t> m_UDIWithin;
+    std::vector<size_t> m_UDIAbove;
+
+};
+
+// IlluminanceHistogram counts each point's occupied hours in bins bounded by
+// a list of edges, in one pass over the illuminance, so that any number of
+// DA and UDI thresholds can be answered afterwards without the data. Each
+// edge gets a bin of its own for the hours exactly at it, so the counts
+// above and below a threshold that is one of the edges are exact. For any
+// other threshold the hours in the bin around it cannot be split: the counts
+// returned leave them out, and uncertainty() returns how many there are. The
+// sum of the occupied illuminance is kept as well for cDA.
+class STADIC_API IlluminanceHistogram
+{
+public:
+    explicit IlluminanceHistogram(std::vector<double> edges);                  //Constructor that takes the bin edges in the units of the thresholds
+    void setDivisor(double divisor);                                            //Function to set the divisor that converts lux to the units of the edges
+    bool compute(const DaylightIlluminanceData &data, const TimeMask &occupied);    //Function to bin the occupied timesteps of the data
+
+    //Getters
+    const std::vector<double> &edges() const;                                   //Function that returns the sorted bin edges
+    unsigned points() const;                                                    //Function that returns the number of points binned
+    size_t occupiedHours() const;                                               //Function that returns the number of occupied timesteps
+    size_t countAbove(unsigned point, double threshold) const;                  //Function that returns the occupied hours known to be above threshold
+    size_t countBelow(unsigned point, double threshold) const;                  //Function that returns the occupied hours known to be below threshold
+    size_t uncertainty(unsigned point, double threshold) const;                 //Function that returns the occupied hours that may lie on either side of threshold
+    double sum(unsigned point) const;                                           //Function that returns the occupied illuminance sum
+
+private:
+    size_t bin(double value) const;                                             //Function that returns the bin a value falls in
+    size_t countBins(unsigned point, size_t first, size_t last) const;          //Function that returns the hours in the bins [first,last)
+    template <bool Divide> double binPoint(const double *values, const std::vector<unsigned> &hours, size_t *counts) const;    //Function to bin one point's hours, returning their sum
+
+    std::vector<double> m_Edges;
+    double m_Divisor;                                                           //Divisor converting lux to the units of the edges
+    unsigned m_Points;
+    size_t m_OccupiedHours;
+    std::vector<size_t> m_Counts;                                               //2*edges+1 bins per point
+    std::vector<double> m_Sums;
+
+};
+
+// Picks the window groups to shade in one hour of the sDA calculation. Each
+// entry of sunlitPoints holds the number of the points (out of points) that
+// see more than 300 lux of direct sun through that window group when it is
+// left open. The open groups may together light less than limit of the
+// points, and as many sunlit points as that allows are left open. Because the
+// fractions share the denominator points, this is a subset sum over whole
+// counts bounded by limit*points, solved exactly by dynamic programming in
+// O(groups*limit*points) rather than by trying all 2^groups combinations.
+// Among equally good choices the higher numbered groups are left open first,
+// which is the choice the original enumeration made. The result holds true
+// for each group to shade.
+std::vector<bool> STADIC_API sDAShadeCombination(const std::vector<unsigned> &sunlitPoints, unsigned points, double limit);
+
+// Metrics calculates the requested metrics of every space of a building.
+// When run incrementally, each metric that is calculated leaves a fingerprint
+// file next to its results holding the size and modification time of each of
+// its inputs and the parameters it used. On the next run a metric whose
+// fingerprint is unchanged and whose results are all still there is reused,
+// and a space with nothing left to calculate is not read at all.
 class STADIC_API Metrics
 {
 public:
     explicit Metrics(BuildingControl *model);                         //Constructor that takes a Control object as an argument                                                           //Function to simulate the daylight
     bool processMetrics();
+    void setThreads(unsigned threads);                                          //Function to set the number of spaces processed at once, 0 uses every core
+    unsigned threads() const;                                                   //Function that returns the number of spaces processed at once
+    void setMemoryBudget(size_t bytes);                                         //Function to bound the illuminance held in memory per space, 0 holds it all
+    size_t memoryBudget() const;                                                //Function that returns the bound on the illuminance held in memory per space
+    void setIncremental(bool incremental);                                      //Function to set whether metrics with unchanged inputs are reused
+    bool incremental() const;                                                   //Function that returns whether metrics with unchanged inputs are reused
+    unsigned reusedMetrics() const;                                             //Function that returns the metrics reused by the last processMetrics
+    unsigned computedMetrics() const;                                           //Function that returns the metrics calculated by the last processMetrics
 
 private:
+    void processSpace(Control *space);                                          //Function to calculate and write every requested metric of one space
+    unsigned blockPoints(unsigned timesteps, unsigned matrices) const;          //Function that returns how many points of several annual matrices fit in the memory budget
+    std::string scratchFile(Control *model, const std::string &suffix) const;   //Function that returns the scratch file a text input is converted into
 
-    bool calculateDA(Control *model, DaylightIlluminanceData *dayIll);
-    bool calculatecDA(Control *model, DaylightIlluminanceData *dayIll);
+    bool calculateDA(Control *model, const AnnualStatistics &statistics, bool append=false);
+    bool calculatecDA(Control *model, const AnnualStatistics &statistics, bool append=false);
     bool calculateDF(Control *model, DaylightIlluminanceData *dayIll);
-    bool calculateUDI(Control *model, DaylightIlluminanceData *dayIll);
-    bool calculatesDA(Control *model, DaylightIlluminanceData *dayIll);
-    bool calculateOccsDA(Control *model, DaylightIlluminanceData *dayIll);
-    bool parseOccupancy(std::string file, double threshold);
+    bool calculateUDI(Control *model, const AnnualStatistics &statistics, bool append=false);
+    bool calculateSweep(Control *model, const IlluminanceHistogram &histogram, bool append=false);
+    bool calculatesDA(Control *model, const TimeMask &sDAHours, double divisor);   //Function to calculate ASE and sDA in one pass over the hours
+    bool calculateOccsDA(Control *model, DaylightIlluminanceData *dayIll, const TimeMask &occupied, double divisor);
+    bool calculateOccsDABlocked(Control *model, const TimeMask &occupied, double divisor);
+    static bool parseOccupancy(std::string file, double threshold, std::vector<bool> *occupancy);
+    static TimeMask analysisWindow(Control *model, const DaylightIlluminanceData &axis);    //Function that returns the sDA and ASE hours on the time axis
+    static double illuminanceDivisor(Control *model);                           //Function that returns the divisor converting lux to the units of the targets
     BuildingControl *m_Model;
-    std::vector<bool> m_Occupancy;
+    unsigned m_Threads;                                                         //Number of spaces processed at once
+    unsigned m_SpaceThreads;                                                    //Number of threads used within a single space
+    size_t m_MemoryBudget;                                                      //Bytes of illuminance held per space, 0 for no bound
+    bool m_Incremental;                                                         //Reuse the results of metrics whose fingerprint is unchanged
+    std::atomic<unsigned> m_Reused;                                             //Metrics reused, counted across the space threads
+    std::atomic<unsigned> m_Computed;                                           //Metrics calculated, counted across the space threads
 
 };
 
@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "parallel.h"
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stadic {
+
+unsigned hardwareThreads()
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads > 0 ? threads : 1;
+}
+
+unsigned resolveThreads(unsigned threads)
+{
+    return threads > 0 ? threads : hardwareThreads();
+}
+
+void parallelFor(unsigned count, unsigned threads, const std::function<void(unsigned)> &work)
+{
+    threads = resolveThreads(threads);
+    if(threads > count) {
+        threads = count;
+    }
+    if(threads <= 1) {
+        for(unsigned i = 0; i < count; i++) {
+            work(i);
+        }
+        return;
+    }
+    std::atomic<unsigned> next(0);
+    std::atomic<bool> abandon(false);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&]() {
+        unsigned i;
+        while(!abandon && (i = next++) < count) {
+            try {
+                work(i);
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if(!error) {
+                    error = std::current_exception();
+                }
+                abandon = true;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for(unsigned i = 1; i < threads; i++) {
+        pool.push_back(std::thread(worker));
+    }
+    worker();
+    for(std::thread &thread : pool) {
+        thread.join();
+    }
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "stadicapi.h"
+#include <functional>
+
+namespace stadic {
+
+unsigned STADIC_API hardwareThreads();                                          //Function that returns the number of threads the hardware supports (at least 1)
+unsigned STADIC_API resolveThreads(unsigned threads);                           //Function that maps a thread count of 0 to hardwareThreads()
+
+// Runs work(i) for every i in [0,count) on up to the given number of worker
+// threads, handing out the indices in order as the workers become free. The
+// call returns once every index has been processed. If any call of work
+// throws, the remaining indices are abandoned and the first exception is
+// rethrown on the calling thread. With one thread (or one index) everything
+// runs on the calling thread.
+void STADIC_API parallelFor(unsigned count, unsigned threads, const std::function<void(unsigned)> &work);
+
+}
+
+#endif // PARALLEL_H
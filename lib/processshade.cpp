@@ -52,11 +52,11 @@ bool ProcessShade::processShades()
         if (!timeData.parseTimeBased(spaces[i].get()->spaceDirectory()+spaces[i].get()->resultsDirectory()+spaces[i].get()->spaceName()+"_"+spaces[i].get()->windowGroups()[0].name()+"_base.ill")){
             return false;
         }
-        for (int j=0;j<timeData.illuminance().size();j++){
+        for (unsigned j=0;j<timeData.timesteps();j++){
             std::vector<std::string> tempVec;
-            tempVec.push_back(toString(timeData.illuminance()[j].month()));
-            tempVec.push_back(toString(timeData.illuminance()[j].day()));
-            tempVec.push_back(toString(timeData.illuminance()[j].hour()));
+            tempVec.push_back(toString(timeData.month(j)));
+            tempVec.push_back(toString(timeData.day(j)));
+            tempVec.push_back(toString(timeData.hour(j)));
             m_TimeIntervals.push_back(tempVec);
         }
 
@@ -70,22 +70,24 @@ bool ProcessShade::processShades()
     return true;
 }
 bool ProcessShade::writeSched(std::vector<std::vector<int>> shadeSched, std::string file){
-    std::ofstream oFile;
-    oFile.open(file);
-    if (!oFile.is_open()){
+    BufferedWriter oFile;
+    if (!oFile.open(file)){
         STADIC_LOG(Severity::Error, "The opening of the file "+ file + " has failed.");
         return false;
     }
     //Write out the shade schedule here.  M D H WG1Set WG2Set...
     for (int i=0;i<m_TimeIntervals.size();i++){
-        oFile<<m_TimeIntervals[i][0]<<" "<<m_TimeIntervals[i][1]<<" "<<m_TimeIntervals[i][2];
+        oFile<<m_TimeIntervals[i][0]<<' '<<m_TimeIntervals[i][1]<<' '<<m_TimeIntervals[i][2];
         for (int j=0;j<shadeSched[i].size();j++){
-            oFile<<" "<<shadeSched[i][j];
+            oFile<<' '<<shadeSched[i][j];
         }
-        oFile<<std::endl;
+        oFile<<'\n';
     }
 
-    oFile.close();
+    if (!oFile.close()){
+        STADIC_LOG(Severity::Error, "The writing of the file "+ file + " has failed.");
+        return false;
+    }
     return true;
 }
 
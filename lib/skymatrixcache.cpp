@@ -0,0 +1,109 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "skymatrixcache.h"
+
+namespace stadic {
+
+SkyMatrixCache::SkyMatrixCache(const std::string &program) : m_Program(program)
+{
+}
+
+std::string SkyMatrixCache::matrix(const std::string &prefix, const std::vector<std::string> &arguments)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    unsigned sharing = 0;
+    for(const std::unique_ptr<Matrix> &matrix : m_Matrices) {
+        if(matrix->prefix == prefix) {
+            if(matrix->arguments == arguments) {
+                return matrix->file;
+            }
+            sharing++;
+        }
+    }
+    std::unique_ptr<Matrix> matrix(new Matrix);
+    matrix->arguments = arguments;
+    matrix->prefix = prefix;
+    matrix->file = prefix + (sharing == 0 ? "" : std::to_string(sharing + 1)) + ".smx";
+    matrix->process.reset(new Process(m_Program, arguments));
+    matrix->process->setStandardOutputFile(matrix->file);
+    // The program starts under the lock so that nobody waits on a matrix that
+    // has not been started
+    matrix->process->start();
+    m_Matrices.push_back(std::move(matrix));
+    return m_Matrices.back()->file;
+}
+
+Process *SkyMatrixCache::process(const std::string &file) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for(const std::unique_ptr<Matrix> &matrix : m_Matrices) {
+        if(matrix->file == file) {
+            return matrix->process.get();
+        }
+    }
+    return nullptr;
+}
+
+bool SkyMatrixCache::wait(const std::string &file)
+{
+    // Processes are never removed, so the pointer outlives the lock
+    Process *generator = process(file);
+    if(!generator) {
+        return false;
+    }
+    return generator->wait();
+}
+
+std::string SkyMatrixCache::error(const std::string &file) const
+{
+    Process *generator = process(file);
+    if(!generator) {
+        return "The matrix " + file + " has not been asked for.";
+    }
+    return generator->error();
+}
+
+std::string SkyMatrixCache::commandLine(const std::string &file) const
+{
+    Process *generator = process(file);
+    if(!generator) {
+        return std::string();
+    }
+    return generator->commandLine();
+}
+
+unsigned SkyMatrixCache::runs() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Matrices.size();
+}
+
+}
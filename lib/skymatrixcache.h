@@ -0,0 +1,78 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef SKYMATRIXCACHE_H
+#define SKYMATRIXCACHE_H
+
+#include "stadicprocess.h"
+#include "stadicapi.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace stadic {
+
+// A SkyMatrixCache runs gendaymtx once for each distinct set of arguments,
+// which name the weather file, the divisions, the rotation and the options,
+// and hands the same matrix file to every window group, setting and space that
+// asks for it. The first request starts the program, and wait blocks until the
+// matrix is written, so requests from several threads for a matrix that is
+// still being generated all wait on that one run. The matrix is written to the
+// given prefix with ".smx" added, or with a number and ".smx" when the prefix
+// was already used for other arguments.
+class STADIC_API SkyMatrixCache
+{
+public:
+    explicit SkyMatrixCache(const std::string &program = "gendaymtx");
+    std::string matrix(const std::string &prefix, const std::vector<std::string> &arguments);    //Function that returns the file of a matrix, starting the program the first time it is asked for
+    bool wait(const std::string &file);                                         //Function that waits for a matrix, returns true if it was generated
+    std::string error(const std::string &file) const;                           //Function that returns the errors of the run that generates a matrix
+    std::string commandLine(const std::string &file) const;                     //Function that returns the command line that generates a matrix
+    unsigned runs() const;                                                      //Function that returns the number of matrices generated
+
+private:
+    struct Matrix
+    {
+        std::vector<std::string> arguments;
+        std::string prefix;
+        std::string file;
+        std::unique_ptr<Process> process;
+    };
+    Process *process(const std::string &file) const;
+
+    std::string m_Program;                                                      //Program that generates the matrices
+    std::vector<std::unique_ptr<Matrix>> m_Matrices;                            //Matrices in the order they were first asked for
+    mutable std::mutex m_Mutex;                                                 //Guards m_Matrices
+};
+
+}
+
+#endif // SKYMATRIXCACHE_H
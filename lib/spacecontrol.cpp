@@ -37,7 +37,7 @@
 
 namespace stadic {
 
-Control::Control()
+Control::Control() : m_DA(false), m_sDA(false), m_WritesDAIll(false), m_OccsDA(false), m_cDA(false), m_DF(false), m_UDI(false), m_Sweep(false)
 {
 }
 
@@ -245,6 +245,9 @@ bool Control::setsDAwgSettings(std::vector<int> settingNumbers){
     m_sDAwgSettings=settingNumbers;
     return true;
 }
+void Control::setWritesDAIll(bool write){
+    m_WritesDAIll=write;
+}
 bool Control::setOccsDA(bool run, double illum, double DAFrac){
     m_OccsDA=run;
     if (illum>0){
@@ -281,6 +284,34 @@ bool Control::setUDI(bool run, double minIllum, double maxIllum){
 void Control::setCalcUDI(bool run){
     m_UDI=run;
 }
+bool Control::setSweep(bool run, std::vector<double> DAIllums, std::vector<double> cDAIllums, std::vector<std::pair<double, double>> UDIRanges){
+    m_Sweep=run;
+    for (int i=0;i<DAIllums.size();i++){
+        if (DAIllums[i]<=0){
+            STADIC_ERROR("The DA sweep illuminances must be greater than 0.");
+            return false;
+        }
+    }
+    for (int i=0;i<cDAIllums.size();i++){
+        if (cDAIllums[i]<=0){
+            STADIC_ERROR("The cDA sweep illuminances must be greater than 0.");
+            return false;
+        }
+    }
+    for (int i=0;i<UDIRanges.size();i++){
+        if (UDIRanges[i].first<0 || UDIRanges[i].first>=UDIRanges[i].second){
+            STADIC_ERROR("The UDI sweep minimum illuminances must be between 0 and the maximum illuminance.");
+            return false;
+        }
+    }
+    m_SweepDAIllums=DAIllums;
+    m_SweepcDAIllums=cDAIllums;
+    m_SweepUDIRanges=UDIRanges;
+    return true;
+}
+void Control::setCalcSweep(bool run){
+    m_Sweep=run;
+}
 
 
 //Getters
@@ -454,6 +485,9 @@ double Control::sDAStart(){
 double Control::sDAEnd(){
     return m_sDAEnd;
 }
+bool Control::writesDAIll(){
+    return m_WritesDAIll;
+}
 std::vector<int> Control::sDAwgSettings(){
     return m_sDAwgSettings;
 }
@@ -485,6 +519,18 @@ double Control::UDIMin(){
 double Control::UDIMax(){
     return m_UDIMax;
 }
+bool Control::runSweep(){
+    return m_Sweep;
+}
+std::vector<double> Control::sweepDAIllums(){
+    return m_SweepDAIllums;
+}
+std::vector<double> Control::sweepcDAIllums(){
+    return m_SweepcDAIllums;
+}
+std::vector<std::pair<double, double>> Control::sweepUDIRanges(){
+    return m_SweepUDIRanges;
+}
 
 
 
@@ -900,6 +946,11 @@ bool Control::parseJson(const JsonObject &json, BuildingControl *buildingControl
             }
         }
         list.reset();
+        bVal=getBool(treeVal.get(), "write_illuminance", false, "The key \"write_illuminance\" is not a boolean.", Severity::Info);
+        if (bVal){
+            setWritesDAIll(bVal.get());
+            bVal.reset();
+        }
         treeVal.reset();
     }
 
@@ -1020,6 +1071,50 @@ bool Control::parseJson(const JsonObject &json, BuildingControl *buildingControl
         }
         treeVal.reset();
     }
+
+    treeVal=getObject(json, "metric_sweep");
+    if (treeVal){
+        bool calculate;
+        std::vector<double> DAIllums;
+        std::vector<double> cDAIllums;
+        std::vector<std::pair<double, double>> UDIRanges;
+        bVal=getBool(treeVal.get(), "calculate", false, "The key \"calculate\" is not a boolean.", Severity::Info);
+        if (!bVal){
+            calculate=false;
+        }else{
+            calculate=bVal.get();
+            bVal.reset();
+        }
+        list=getArray(treeVal.get(), "DA");
+        if (list){
+            for (unsigned index=0;index<list.get().size();index++){
+                DAIllums.push_back(list.get()[index].asDouble());
+            }
+        }
+        list.reset();
+        list=getArray(treeVal.get(), "cDA");
+        if (list){
+            for (unsigned index=0;index<list.get().size();index++){
+                cDAIllums.push_back(list.get()[index].asDouble());
+            }
+        }
+        list.reset();
+        list=getArray(treeVal.get(), "UDI");
+        if (list){
+            for (unsigned index=0;index<list.get().size();index++){
+                if (!list.get()[index].isArray() || list.get()[index].size()!=2){
+                    STADIC_ERROR("Each UDI range within \"metric_sweep\" must hold a minimum and a maximum.");
+                    return false;
+                }
+                UDIRanges.push_back(std::make_pair(list.get()[index][0].asDouble(), list.get()[index][1].asDouble()));
+            }
+        }
+        list.reset();
+        if (!setSweep(calculate, DAIllums, cDAIllums, UDIRanges)){
+            return false;
+        }
+        treeVal.reset();
+    }
     return true;
 }
 
@@ -33,6 +33,8 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
+#include <utility>
 #include "windowgroup.h"
 #include "controlzone.h"
 #include <boost/optional.hpp>
@@ -103,12 +105,15 @@ public:
     void setCalccDA(bool run);
     bool setsDA(bool run, double illum, double DAFrac, double startTime, double endTime);
     bool setsDAwgSettings(std::vector<int> settingNumbers);         //these are assumed to be base 1
+    void setWritesDAIll(bool write);                                //Function to set whether the shaded illuminance of the sDA is written out
     void setCalcsDA(bool run);
     bool setOccsDA(bool run, double illum, double DAFrac);
     void setCalcOccsDA(bool run);
     void setDF(bool run);
     bool setUDI(bool run, double minIllum, double maxIllum);
     void setCalcUDI(bool run);
+    bool setSweep(bool run, std::vector<double> DAIllums, std::vector<double> cDAIllums, std::vector<std::pair<double, double>> UDIRanges);
+    void setCalcSweep(bool run);
 
 
     //Getters
@@ -177,6 +182,7 @@ public:
     double sDAStart();
     double sDAEnd();
     std::vector<int> sDAwgSettings();
+    bool writesDAIll();
     bool runOccsDA();
     double occsDAIllum();
     double occsDAFrac();
@@ -186,6 +192,10 @@ public:
     bool runUDI();
     double UDIMin();
     double UDIMax();
+    bool runSweep();
+    std::vector<double> sweepDAIllums();
+    std::vector<double> sweepcDAIllums();
+    std::vector<std::pair<double, double>> sweepUDIRanges();
 
 private:
     bool verifyParameters();
@@ -246,23 +256,29 @@ private:
     //******************
     //Metrics
     //******************
-    bool m_DA;                                          //  Variable holding whether the DA analysis should be completed
+    //The run flags are atomic so the metrics can be cleared from worker threads
+    std::atomic<bool> m_DA;                             //  Variable holding whether the DA analysis should be completed
     double m_DAIllum;                                   //  Variable holding the illuminance for the DA analysis
-    bool m_sDA;                                         //  Variable holding whether the sDA analysis should be completed
+    std::atomic<bool> m_sDA;                            //  Variable holding whether the sDA analysis should be completed
     double m_sDAIllum;                                  //  Variable holding the illuminance for the sDA analysis
     double m_sDAFrac;                                   //  Variable holding the DA fraction for the sDA analysis
     double m_sDAStart;                                  //  Variable holding the start time for the sDA analysis
     double m_sDAEnd;                                    //  Variable holding the end time for the sDA analysis
     std::vector<int> m_sDAwgSettings;
-    bool m_OccsDA;                                      //  Variable holding whether the occupancy schedule based sDA should be completed
+    bool m_WritesDAIll;                                 //  Variable holding whether the illuminance under the sDA shade schedule is written out
+    std::atomic<bool> m_OccsDA;                         //  Variable holding whether the occupancy schedule based sDA should be completed
     double m_OccsDAIllum;                               //  Variable holding the illuminance for the occupancy schedule based sDA analysis
     double m_OccsDAFrac;                                //  Variable holding the DA fraction for the occupancy schedule based sDA analysis
-    bool m_cDA;                                         //  Variable holding whether the cDA analysis should be completed
+    std::atomic<bool> m_cDA;                            //  Variable holding whether the cDA analysis should be completed
     double m_cDAIllum;                                  //  Variable holding the illuminance for the cDA analysis
-    bool m_DF;                                          //  Variable holding whether the DF analysis should be completed
-    bool m_UDI;                                         //  Variable holding whether the UDI analysis shoud be completed
+    std::atomic<bool> m_DF;                             //  Variable holding whether the DF analysis should be completed
+    std::atomic<bool> m_UDI;                            //  Variable holding whether the UDI analysis shoud be completed
     double m_UDIMin;                                    //  Variable holding the minimum illuminance for UDI
     double m_UDIMax;                                    //  Variable holding the maximum illuminance for UDI
+    std::atomic<bool> m_Sweep;                          //  Variable holding whether the metric sweep should be completed
+    std::vector<double> m_SweepDAIllums;                //  Variable holding the illuminances for the DA sweep
+    std::vector<double> m_SweepcDAIllums;               //  Variable holding the illuminances for the cDA sweep
+    std::vector<std::pair<double, double>> m_SweepUDIRanges;    //  Variable holding the minimum and maximum illuminances for the UDI sweep
     
 };
 
@@ -30,15 +30,65 @@
 
 #include "stadicprocess.h"
 #include "logging.h"
+#include "parallel.h"
+#include <cstdio>
+#include <fstream>
 #include <sstream>
 
 #ifndef USE_QT
 #include <stdlib.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char **environ;
+#endif
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 
 namespace stadic{
+// Shared by every process: the limit on running programs and the signal that
+// a process has finished, which ProcessGroup::waitAny waits for
+static std::mutex s_mutex;
+static std::condition_variable s_slotFreed;
+static std::condition_variable s_finished;
+static unsigned s_running = 0;
+static unsigned s_maxRunning = 0;
+
+#if !defined(USE_QT) && !defined(_WIN32)
+//Open a pipe whose ends are not inherited by the programs that are started
+static bool openPipe(int fds[2])
+{
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if(pipe(fds) != 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+static void closeDescriptor(int fd)
+{
+    if(fd >= 0) {
+        close(fd);
+    }
+}
+#endif
+
 //*************************
 //Process
 //*************************
@@ -48,9 +98,14 @@ Process::Process(const std::string &program)
     m_process.setProgram(QString::fromStdString(program));
 #else
     m_state = Initialized;
+    m_stdoutMode = OverWriteOutput;
     m_inputProcess = nullptr;
     m_outputProcess = nullptr;
     m_program = program;
+    m_exitCode = -1;
+    m_pid = 0;
+    m_errorPipe = -1;
+    m_result = m_finished.get_future().share();
 #endif
 }
 
@@ -65,10 +120,28 @@ Process::Process(const std::string &program, const std::vector<std::string> &arg
     m_process.setArguments(arguments);
 #else
     m_state = Initialized;
+    m_stdoutMode = OverWriteOutput;
     m_inputProcess = nullptr;
     m_outputProcess = nullptr;
     m_program = program;
     m_args = args;
+    m_exitCode = -1;
+    m_pid = 0;
+    m_errorPipe = -1;
+    m_result = m_finished.get_future().share();
+#endif
+}
+
+Process::~Process()
+{
+#ifndef USE_QT
+    // Don't leave a started pipeline behind
+    if(m_state != Initialized) {
+        m_result.wait();
+    }
+    if(m_monitor.joinable()) {
+        m_monitor.join();
+    }
 #endif
 }
 
@@ -76,7 +149,7 @@ bool Process::run()
 {
 #ifdef USE_QT
     m_process.start();
-#else
+#elif defined(_WIN32)
     if(m_state == Initialized) {
         std::string command = commandLine();
         if(command.empty()) {
@@ -89,6 +162,7 @@ bool Process::run()
         if(returnCode != 0) {
             m_state = RunFailed;
         }
+        m_exitCode = returnCode;
         if(m_inputProcess || m_outputProcess) {
             // Get to the first process
             Process *first = this;
@@ -96,12 +170,22 @@ bool Process::run()
                 first = first->m_inputProcess;
             }
             while(first) {
-                first->m_state = m_state;
+                if(first != this && first->m_state == Initialized) {
+                    first->m_state = m_state.load();
+                    first->m_exitCode = m_exitCode;
+                    first->m_finished.set_value(m_state == RunCompleted);
+                }
                 first = first->m_outputProcess;
             }
         }
+        m_finished.set_value(m_state == RunCompleted);
         return m_state == RunCompleted;
     }
+#else
+    if(m_state == Initialized) {
+        startPipeline();
+        return wait();
+    }
 #endif
     return true;
 }
@@ -110,8 +194,12 @@ void Process::start()
 {
 #ifdef USE_QT
     m_process.start();
-#else
+#elif defined(_WIN32)
     run();
+#else
+    if(m_state == Initialized) {
+        startPipeline();
+    }
 #endif
 }
 
@@ -120,20 +208,48 @@ bool Process::wait()
 #ifdef USE_QT
     return m_process.waitForFinished(-1);
 #else
-    return m_state == RunCompleted;
+    if(m_state == Initialized) {
+        return false;
+    }
+    return m_result.get();
 #endif
 }
 
-/*
-std::string Process::error()
+bool Process::waitFor(int msecs)
+{
+#ifdef USE_QT
+    return m_process.waitForFinished(msecs);
+#else
+    if(m_state == Initialized) {
+        return false;
+    }
+    return m_result.wait_for(std::chrono::milliseconds(msecs)) == std::future_status::ready;
+#endif
+}
+
+void Process::setMaxRunning(unsigned count)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_maxRunning = count;
+    s_slotFreed.notify_all();
+}
+
+unsigned Process::maxRunning()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_maxRunning;
+}
+
+std::string Process::error() const
 {
 #ifdef USE_QT
     return QString(m_process.readAllStandardError()).toStdString();
 #else
-    return std::string();
+    return m_error;
 #endif
 }
 
+/*
 std::string Process::output()
 {
 #ifdef USE_QT
@@ -144,6 +260,15 @@ std::string Process::output()
 }
 */
 
+int Process::exitCode() const
+{
+#ifdef USE_QT
+    return m_process.exitCode();
+#else
+    return m_exitCode;
+#endif
+}
+
 void Process::setStandardOutputProcess(Process *destination)
 {
 #ifdef USE_QT
@@ -217,29 +342,38 @@ std::string Process::quote(const std::string &string)
 #endif
 }
 
+//Quote an argument only when the shell would otherwise split or expand it
+static std::string shellArgument(const std::string &string)
+{
+    if(!string.empty() && string.find_first_of(" \t\"'$*?;&|<>()`\\") == std::string::npos) {
+        return string;
+    }
+    return Process::quote(string);
+}
+
 std::string Process::processCommandLine() const
 {
 #ifdef USE_QT
     return std::string;
 #else
-    std::string command = m_program;
+    std::string command = shellArgument(m_program);
     for(unsigned i = 0; i<m_args.size(); i++) {
-        command += " " + m_args[i];
+        command += " " + shellArgument(m_args[i]);
     }
     if(!m_inputFile.empty()) {
-        command += " < " + m_inputFile;
+        command += " < " + shellArgument(m_inputFile);
     }
     if(!m_outputFile.empty()) {
         switch(m_stdoutMode) {
         case AppendOutput:
-          command += " >> " + m_outputFile;
+          command += " >> " + shellArgument(m_outputFile);
           break;
         default: // OverWriteOutput
-          command += " > " + m_outputFile;
+          command += " > " + shellArgument(m_outputFile);
         }
     }
     if(!m_errorFile.empty()) {
-        command += " 2> " + m_errorFile;
+        command += " 2> " + shellArgument(m_errorFile);
     }
     return command;
 #endif
@@ -270,4 +404,495 @@ std::string Process::commandLine()
 #endif
 }
 
+#if !defined(USE_QT) && !defined(_WIN32)
+Process *Process::firstProcess()
+{
+    Process *first = this;
+    while(first->m_inputProcess) {
+        first = first->m_inputProcess;
+    }
+    return first;
+}
+
+void Process::startPipeline()
+{
+    std::vector<Process*> processes;
+    for(Process *current = firstProcess(); current; current = current->m_outputProcess) {
+        processes.push_back(current);
+        if(current->m_state == Initialized) {
+            current->m_state = ReadyToRun;
+        }
+    }
+    m_monitor = std::thread(&Process::runPipeline, processes);
+}
+
+void Process::runPipeline(std::vector<Process*> processes)
+{
+    std::vector<Process*> started;
+    for(Process *process : processes) {
+        if(process->m_state == ReadyToRun) {
+            started.push_back(process);
+        }
+    }
+    unsigned count = started.size();
+    // Wait for room under the limit, a pipeline longer than the limit runs alone
+    {
+        std::unique_lock<std::mutex> lock(s_mutex);
+        while(s_maxRunning > 0 && s_running > 0 && s_running + count > s_maxRunning) {
+            s_slotFreed.wait(lock);
+        }
+        s_running += count;
+    }
+
+    // Start every process of the pipeline, each one reading from the pipe
+    // that the previous one writes to
+    int input = -1;
+    for(Process *current : processes) {
+        int next = -1;
+        int output = -1;
+        if(current->m_outputProcess) {
+            int fds[2];
+            if(openPipe(fds)) {
+                next = fds[0];
+                output = fds[1];
+            }
+        }
+        if(current->m_state == ReadyToRun) {
+            current->startProcess(input, output);
+        }
+        closeDescriptor(input);
+        closeDescriptor(output);
+        input = next;
+    }
+    closeDescriptor(input);
+    waitPipeline(processes);
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_running -= count;
+    }
+    s_slotFreed.notify_all();
+
+    // Nothing may touch a process once its promise is kept, the owner is free
+    // to destroy it
+    std::vector<bool> results;
+    for(Process *process : started) {
+        results.push_back(process->m_state == RunCompleted);
+    }
+    for(unsigned i = 0; i<started.size(); i++) {
+        started[i]->m_finished.set_value(results[i]);
+    }
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+    }
+    s_finished.notify_all();
+}
+
+bool Process::startProcess(int input, int output)
+{
+    m_error.clear();
+    m_exitCode = -1;
+    int error = -1;
+    bool opened = true;
+    if(input < 0 && !m_inputFile.empty()) {
+        input = open(m_inputFile.c_str(), O_RDONLY | O_CLOEXEC);
+        opened = input >= 0;
+        if(!opened) {
+            m_error = "The standard input file \"" + m_inputFile + "\" could not be opened: " + strerror(errno) + "\n";
+        }
+    } else {
+        input = input >= 0 ? fcntl(input, F_DUPFD_CLOEXEC, 0) : -1;
+    }
+    if(opened && output < 0 && !m_outputFile.empty()) {
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (m_stdoutMode == AppendOutput ? O_APPEND : O_TRUNC);
+        output = open(m_outputFile.c_str(), flags, 0666);
+        opened = output >= 0;
+        if(!opened) {
+            m_error = "The standard output file \"" + m_outputFile + "\" could not be opened: " + strerror(errno) + "\n";
+        }
+    } else {
+        output = output >= 0 ? fcntl(output, F_DUPFD_CLOEXEC, 0) : -1;
+    }
+    if(opened && !m_errorFile.empty()) {
+        error = open(m_errorFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        opened = error >= 0;
+        if(!opened) {
+            m_error = "The standard error file \"" + m_errorFile + "\" could not be opened: " + strerror(errno) + "\n";
+        }
+    } else if(opened) {
+        int fds[2];
+        if(openPipe(fds)) {
+            m_errorPipe = fds[0];
+            error = fds[1];
+        }
+    }
+
+    int result = -1;
+    if(opened) {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        if(input >= 0) {
+            posix_spawn_file_actions_adddup2(&actions, input, STDIN_FILENO);
+        }
+        if(output >= 0) {
+            posix_spawn_file_actions_adddup2(&actions, output, STDOUT_FILENO);
+        }
+        if(error >= 0) {
+            posix_spawn_file_actions_adddup2(&actions, error, STDERR_FILENO);
+        }
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(m_program.c_str()));
+        for(unsigned i = 0; i<m_args.size(); i++) {
+            argv.push_back(const_cast<char*>(m_args[i].c_str()));
+        }
+        argv.push_back(nullptr);
+        pid_t pid;
+        result = posix_spawnp(&pid, m_program.c_str(), &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if(result == 0) {
+            m_pid = pid;
+        } else {
+            m_error = "The program \"" + m_program + "\" could not be started: " + strerror(result) + "\n";
+        }
+    }
+    closeDescriptor(input);
+    closeDescriptor(output);
+    closeDescriptor(error);
+    if(result != 0) {
+        closeDescriptor(m_errorPipe);
+        m_errorPipe = -1;
+        m_state = BadProgram;
+        return false;
+    }
+    m_state = Running;
+    return true;
+}
+
+void Process::waitPipeline(const std::vector<Process*> &processes)
+{
+    // Read the standard error of every process until they are all closed, so
+    // that no program blocks on a full pipe
+    std::vector<pollfd> fds;
+    std::vector<Process*> readers;
+    for(Process *process : processes) {
+        if(process->m_errorPipe >= 0) {
+            pollfd fd;
+            fd.fd = process->m_errorPipe;
+            fd.events = POLLIN;
+            fd.revents = 0;
+            fds.push_back(fd);
+            readers.push_back(process);
+        }
+    }
+    char buffer[4096];
+    while(!fds.empty()) {
+        if(poll(fds.data(), fds.size(), -1) < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for(unsigned i = 0; i<fds.size();) {
+            if(fds[i].revents == 0) {
+                i++;
+                continue;
+            }
+            ssize_t count = read(fds[i].fd, buffer, sizeof(buffer));
+            if(count > 0) {
+                readers[i]->m_error.append(buffer, count);
+                fds[i].revents = 0;
+                i++;
+            } else if(count < 0 && errno == EINTR) {
+                fds[i].revents = 0;
+                i++;
+            } else {
+                close(fds[i].fd);
+                readers[i]->m_errorPipe = -1;
+                fds.erase(fds.begin() + i);
+                readers.erase(readers.begin() + i);
+            }
+        }
+    }
+    for(Process *process : processes) {
+        closeDescriptor(process->m_errorPipe);
+        process->m_errorPipe = -1;
+        if(process->m_state != Running) {
+            continue;
+        }
+        int status = 0;
+        pid_t result;
+        do {
+            result = waitpid(process->m_pid, &status, 0);
+        } while(result < 0 && errno == EINTR);
+        process->m_pid = 0;
+        if(result < 0) {
+            process->m_state = RunFailed;
+        } else if(WIFEXITED(status)) {
+            process->m_exitCode = WEXITSTATUS(status);
+            process->m_state = process->m_exitCode == 0 ? RunCompleted : RunFailed;
+        } else {
+            process->m_exitCode = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : -1;
+            process->m_state = RunFailed;
+        }
+    }
+}
+#endif
+
+//*************************
+//ProcessGroup
+//*************************
+void ProcessGroup::add(Process *process)
+{
+    if(process->state() == Process::Initialized) {
+        process->start();
+    }
+    m_processes.push_back(process);
+}
+
+Process *ProcessGroup::waitAny()
+{
+    if(m_processes.empty()) {
+        return nullptr;
+    }
+    std::unique_lock<std::mutex> lock(s_mutex);
+    while(true) {
+        for(unsigned i = 0; i<m_processes.size(); i++) {
+            if(m_processes[i]->waitFor(0)) {
+                Process *process = m_processes[i];
+                m_processes.erase(m_processes.begin() + i);
+                return process;
+            }
+        }
+        s_finished.wait(lock);
+    }
+}
+
+bool ProcessGroup::waitAll()
+{
+    bool success = true;
+    while(Process *process = waitAny()) {
+        success = process->wait() && success;
+    }
+    return success;
+}
+
+bool ProcessGroup::empty() const
+{
+    return m_processes.empty();
+}
+
+size_t ProcessGroup::size() const
+{
+    return m_processes.size();
+}
+
+// Fewer lines than this per part are not worth the start up of another program
+static const size_t s_minimumPartLines = 50;
+
+PartitionedProcess::PartitionedProcess(const std::string &program, const std::vector<std::string> &args) : m_program(program),
+    m_args(args), m_maxPartitions(0), m_started(false), m_waited(false), m_success(false)
+{
+}
+
+std::string PartitionedProcess::commandLine()
+{
+    // The command line of the single run that the parts add up to
+    Process process(m_program, m_args);
+    if(!m_inputFile.empty()) {
+        process.setStandardInputFile(m_inputFile);
+    }
+    if(!m_outputFile.empty()) {
+        process.setStandardOutputFile(m_outputFile);
+    }
+    return process.commandLine();
+}
+
+void PartitionedProcess::setMaxPartitions(unsigned count)
+{
+    m_maxPartitions = count;
+}
+
+unsigned PartitionedProcess::partitions() const
+{
+    return m_processes.size();
+}
+
+bool PartitionedProcess::setStandardInputFile(const std::string &fileName)
+{
+    if(m_started) {
+        return false;
+    }
+    m_inputFile = fileName;
+    return true;
+}
+
+bool PartitionedProcess::setStandardOutputFile(const std::string &fileName)
+{
+    if(m_started) {
+        return false;
+    }
+    m_outputFile = fileName;
+    return true;
+}
+
+unsigned PartitionedProcess::partitionCount(size_t lines, unsigned cores)
+{
+    size_t count = lines / s_minimumPartLines;
+    if(count > cores) {
+        count = cores;
+    }
+    if(count < 1) {
+        count = 1;
+    }
+    return count;
+}
+
+bool PartitionedProcess::splittable(const std::vector<std::string> &args)
+{
+    // Output to files (-o), a picture resolution (-y), records of several
+    // rays (-c) or a switched header (-h) do not survive being joined
+    for(const std::string &arg : args) {
+        if(arg == "-o" || arg == "-y" || arg == "-c" || arg == "-h" || arg == "-h+" || arg == "-h-" || arg == "+h") {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string PartitionedProcess::partFile(unsigned part) const
+{
+    return m_outputFile + ".part" + std::to_string(part);
+}
+
+void PartitionedProcess::start()
+{
+    if(m_started) {
+        return;
+    }
+    m_started = true;
+    // Collect the lines, each with its end of line, so that the parts put
+    // back together are exactly the input
+    std::vector<std::string> lines;
+    if(!m_inputFile.empty() && !m_outputFile.empty()) {
+        std::ifstream input(m_inputFile, std::ios::binary);
+        if(!input.is_open()) {
+            m_error = "The input file " + m_inputFile + " could not be opened.\n";
+            return;
+        }
+        std::string line;
+        while(std::getline(input, line)) {
+            if(!input.eof()) {
+                line += '\n';
+            }
+            lines.push_back(line);
+        }
+    }
+    unsigned count = partitionCount(lines.size(), resolveThreads(m_maxPartitions));
+    if(count == 1 || !splittable(m_args)) {
+        std::unique_ptr<Process> process(new Process(m_program, m_args));
+        if(!m_inputFile.empty()) {
+            process->setStandardInputFile(m_inputFile);
+        }
+        if(!m_outputFile.empty()) {
+            process->setStandardOutputFile(m_outputFile);
+        }
+        process->start();
+        m_processes.push_back(std::move(process));
+        return;
+    }
+    size_t begin = 0;
+    for(unsigned i = 0; i < count; i++) {
+        size_t end = lines.size() * (i + 1) / count;
+        std::ofstream part(partFile(i) + ".in", std::ios::binary);
+        for(size_t j = begin; j < end; j++) {
+            part << lines[j];
+        }
+        part.close();
+        if(!part) {
+            m_error = "The input part " + partFile(i) + ".in could not be written.\n";
+            m_processes.clear();
+            removeParts();
+            return;
+        }
+        begin = end;
+        std::unique_ptr<Process> process(new Process(m_program, m_args));
+        process->setStandardInputFile(partFile(i) + ".in");
+        process->setStandardOutputFile(partFile(i));
+        m_processes.push_back(std::move(process));
+    }
+    for(unsigned i = 0; i < m_processes.size(); i++) {
+        m_processes[i]->start();
+    }
+}
+
+bool PartitionedProcess::wait()
+{
+    if(m_processes.empty()) {
+        return false;
+    }
+    // The parts are joined and removed only once
+    if(m_waited) {
+        return m_success;
+    }
+    m_waited = true;
+    bool success = true;
+    for(unsigned i = 0; i < m_processes.size(); i++) {
+        success = m_processes[i]->wait() && success;
+    }
+    if(m_processes.size() == 1) {
+        m_success = success;
+        return success;
+    }
+    if(success) {
+        std::ofstream output(m_outputFile, std::ios::binary);
+        for(unsigned i = 0; i < m_processes.size() && output; i++) {
+            std::ifstream part(partFile(i), std::ios::binary);
+            // Every part repeats the header, only the first one is kept
+            if(i > 0) {
+                std::streampos begin = part.tellg();
+                std::string line;
+                std::getline(part, line);
+                if(line.compare(0, 10, "#?RADIANCE") == 0) {
+                    while(std::getline(part, line) && !line.empty()) {
+                    }
+                } else {
+                    part.clear();
+                    part.seekg(begin);
+                }
+            }
+            // Inserting an empty buffer would mark the output as failed
+            if(part.peek() != std::ifstream::traits_type::eof()) {
+                output << part.rdbuf();
+            }
+        }
+        output.close();
+        if(!output) {
+            m_error += "The output file " + m_outputFile + " could not be written.\n";
+            success = false;
+        }
+    }
+    removeParts();
+    m_success = success;
+    return success;
+}
+
+std::string PartitionedProcess::error() const
+{
+    std::string error = m_error;
+    for(unsigned i = 0; i < m_processes.size(); i++) {
+        error += m_processes[i]->error();
+    }
+    return error;
+}
+
+void PartitionedProcess::removeParts()
+{
+    for(unsigned i = 0; ; i++) {
+        bool found = std::remove((partFile(i) + ".in").c_str()) == 0;
+        found = std::remove(partFile(i).c_str()) == 0 || found;
+        if(!found) {
+            break;
+        }
+    }
+}
+
 }
@@ -34,7 +34,10 @@
 #include <time.h>
 #include "stadicapi.h"
 
+#include <atomic>
+#include <future>
 #include <memory>
+#include <thread>
 #include <vector>
 #include <string>
 
@@ -64,11 +67,26 @@ namespace stadic{
 // defined. The QProcess version is a bit out of date, so it should be tested
 // before it is used (by defining USE_QT).
 //
-// The non-Qt version uses the C standard library system function. A command
-// line is generated for the program using the standard shell constructs. 
-// Processes that are connected together (using setStandardOutputProcess) are 
-// run all at once (with pipes in between) and are started once start is
-// called for one of the processes. 
+// On POSIX systems the programs are started directly with posix_spawnp, no
+// shell is involved, so the arguments reach the program exactly as given.
+// Processes that are connected together (using setStandardOutputProcess) are
+// run all at once with pipes in between and are started once start is called
+// for one of the processes. Waiting on any process of a pipeline waits for all
+// of them. Standard input and output are redirected through file descriptors,
+// and standard error is captured in memory (see error) unless it is sent to a
+// file. Each process keeps its own exit code.
+//
+// start returns at once: a thread runs the pipeline, draining standard error
+// and collecting the exit codes, and fulfills a future for each process that
+// wait and waitFor block on. The error and exit code of a process should only
+// be read once it has been waited on. setMaxRunning puts a limit on the number
+// of programs running at once across all pipelines; a pipeline that would go
+// over the limit stays ReadyToRun until enough programs have finished. A
+// ProcessGroup collects independent processes as they finish, and a
+// PartitionedProcess spreads one program over parts of its input.
+//
+// On Windows a command line is generated for the program using the standard
+// shell constructs and run with the C standard library system function.
 //
 // To get this behavior, there are a lot of old-school linked list operations
 // to move around in the process pipeline. Modify the code with care.
@@ -84,6 +102,7 @@ public:
 
     Process(const std::string &program);
     Process(const std::string &program, const std::vector<std::string> &args);
+    ~Process();
 
     std::string commandLine();
     static std::string quote(const std::string &string);
@@ -91,9 +110,14 @@ public:
     bool run();
     void start();
     bool wait();
+    bool waitFor(int msecs);
 
-    //std::string error();
+    std::string error() const;
     //std::string output();
+    int exitCode() const;
+
+    static void setMaxRunning(unsigned count);
+    static unsigned maxRunning();
 
     void setStandardOutputProcess(Process *destination);
     bool setStandardErrorFile(const std::string &fileName);
@@ -112,11 +136,18 @@ public:
 
 private:
     std::string processCommandLine() const;
+#if !defined(USE_QT) && !defined(_WIN32)
+    Process *firstProcess();
+    void startPipeline();
+    static void runPipeline(std::vector<Process*> processes);
+    bool startProcess(int input, int output);
+    static void waitPipeline(const std::vector<Process*> &processes);
+#endif
 
 #ifdef USE_QT
     QProcess m_process;
 #else
-    ProcessState m_state;     // Flag that describes the current state of the object
+    std::atomic<ProcessState> m_state; // Flag that describes the current state of the object
     OutputMode m_stdoutMode;  // Flag that determines what happens with stdout
     Process *m_inputProcess;  // Upstream process whose stdout stream will be directed to this object's stdin
     Process *m_outputProcess; // Downstream process whose stdin stream will get this object's stdout
@@ -126,9 +157,78 @@ private:
     std::string m_inputFile;  // File that standard input will be read from
     std::string m_outputFile; // File that standard output will be written to
     std::string m_errorFile;  // File that standard error will be written to
+    std::string m_error;      // Standard error captured when it is not written to a file
+    int m_exitCode;           // Exit code of the program, or -1 before it has finished
+    long m_pid;               // Process id of the running program
+    int m_errorPipe;          // Read end of the pipe that captures standard error
+    std::promise<bool> m_finished;     // Promise kept once the program has finished
+    std::shared_future<bool> m_result; // Future of m_finished, true if the program succeeded
+    std::thread m_monitor;    // Thread running the pipeline, held by the process that started it
     //unsigned m_index;  // Index of the corresponding process in m_children
 #endif
 };
 
+// A ProcessGroup holds processes that do not depend on each other so that
+// they can be collected in the order that they finish.
+class STADIC_API ProcessGroup
+{
+public:
+    void add(Process *process);
+    Process *waitAny();
+    bool waitAll();
+    bool empty() const;
+    size_t size() const;
+
+private:
+    std::vector<Process*> m_processes;
+};
+
+// A PartitionedProcess runs a program that handles each line of its standard
+// input on its own, like rcontrib reading points, as several processes that
+// each read consecutive lines of the input file. The outputs are joined in
+// input order with the Radiance header of all but the first part dropped.
+// The parts are written next to the output file and removed by wait. Options
+// that change how the output is laid out (see splittable) leave the program
+// to run as a single process.
+//
+// The joined output is byte for byte what a single run would have written
+// only when each line's result does not depend on the others. With ambient
+// bounces (-ab above 0) every part samples from its own random sequence and
+// builds its own ambient cache, so the values agree with a single run only
+// statistically.
+class STADIC_API PartitionedProcess
+{
+public:
+    PartitionedProcess(const std::string &program, const std::vector<std::string> &args);
+
+    std::string commandLine();
+    void start();
+    bool wait();
+    std::string error() const;
+
+    void setMaxPartitions(unsigned count);
+    unsigned partitions() const;
+    bool setStandardInputFile(const std::string &fileName);
+    bool setStandardOutputFile(const std::string &fileName);
+
+    static unsigned partitionCount(size_t lines, unsigned cores);
+    static bool splittable(const std::vector<std::string> &args);
+
+private:
+    std::string partFile(unsigned part) const;
+    void removeParts();
+
+    std::string m_program;    // Program name
+    std::vector<std::string> m_args;  // Arguments passed to every part
+    std::string m_inputFile;  // File that is split among the parts
+    std::string m_outputFile; // File that the outputs are joined into
+    unsigned m_maxPartitions; // Upper limit on the parts, 0 uses every core
+    std::vector<std::unique_ptr<Process>> m_processes; // One process per part
+    std::string m_error;      // Problems found outside of the processes
+    bool m_started;           // Set once start has been called
+    bool m_waited;            // Set once wait has joined the parts
+    bool m_success;           // Result of the first wait
+};
+
 }
 #endif // OBJECTS_H
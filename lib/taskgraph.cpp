@@ -0,0 +1,222 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+#include "taskgraph.h"
+#include "parallel.h"
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <thread>
+
+namespace stadic {
+
+TaskGraph::TaskGraph() : m_CancelOnFailure(false), m_Cancelled(false)
+{
+}
+
+unsigned TaskGraph::addTask(const std::string &name, const std::vector<std::string> &inputs, const std::vector<std::string> &outputs, const std::function<bool()> &work)
+{
+    Task task;
+    task.name = name;
+    task.inputs = inputs;
+    task.outputs = outputs;
+    task.work = work;
+    task.state = Pending;
+    // The last task that writes an input is the one to wait for
+    for(const std::string &input : inputs) {
+        for(unsigned i = m_Tasks.size(); i > 0; i--) {
+            const std::vector<std::string> &outputs = m_Tasks[i - 1].outputs;
+            if(std::find(outputs.begin(), outputs.end(), input) != outputs.end()) {
+                if(std::find(task.prerequisites.begin(), task.prerequisites.end(), i - 1) == task.prerequisites.end()) {
+                    task.prerequisites.push_back(i - 1);
+                }
+                break;
+            }
+        }
+    }
+    m_Tasks.push_back(task);
+    return m_Tasks.size() - 1;
+}
+
+void TaskGraph::addDependency(unsigned task, unsigned prerequisite)
+{
+    std::vector<unsigned> &prerequisites = m_Tasks[task].prerequisites;
+    if(prerequisite < task && std::find(prerequisites.begin(), prerequisites.end(), prerequisite) == prerequisites.end()) {
+        prerequisites.push_back(prerequisite);
+    }
+}
+
+void TaskGraph::setCancelOnFailure(bool cancel)
+{
+    m_CancelOnFailure = cancel;
+}
+
+void TaskGraph::cancel()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Cancelled = true;
+    m_Changed.notify_all();
+}
+
+bool TaskGraph::run(unsigned threads)
+{
+    // Prerequisites always come earlier, so the graph has no cycles
+    unsigned count = m_Tasks.size();
+    std::vector<std::vector<unsigned>> dependents(count);
+    std::vector<unsigned> waiting(count, 0);
+    std::deque<unsigned> ready;
+    for(unsigned i = 0; i < count; i++) {
+        m_Tasks[i].state = Pending;
+        m_Tasks[i].error.clear();
+        waiting[i] = m_Tasks[i].prerequisites.size();
+        for(unsigned prerequisite : m_Tasks[i].prerequisites) {
+            dependents[prerequisite].push_back(i);
+        }
+        if(waiting[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+    m_Cancelled = false;
+
+    unsigned finished = 0;
+    // Cancel a task that will never run along with everything that waits on it
+    std::function<void(unsigned)> cancelTask = [&](unsigned task) {
+        if(m_Tasks[task].state != Pending) {
+            return;
+        }
+        m_Tasks[task].state = Cancelled;
+        finished++;
+        for(unsigned dependent : dependents[task]) {
+            cancelTask(dependent);
+        }
+    };
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while(true) {
+            if(m_Cancelled) {
+                for(unsigned i = 0; i < count; i++) {
+                    cancelTask(i);
+                }
+                ready.clear();
+                m_Changed.notify_all();
+            }
+            if(finished == count) {
+                return;
+            }
+            if(ready.empty()) {
+                m_Changed.wait(lock);
+                continue;
+            }
+            unsigned task = ready.front();
+            ready.pop_front();
+            if(m_Tasks[task].state != Pending) {
+                continue;
+            }
+            m_Tasks[task].state = Running;
+            lock.unlock();
+            bool success = false;
+            std::string error;
+            try {
+                success = m_Tasks[task].work();
+            } catch(const std::exception &e) {
+                error = e.what();
+            } catch(...) {
+                error = "Unknown exception";
+            }
+            lock.lock();
+            finished++;
+            m_Tasks[task].error = error;
+            if(success) {
+                m_Tasks[task].state = Succeeded;
+                for(unsigned dependent : dependents[task]) {
+                    if(--waiting[dependent] == 0 && m_Tasks[dependent].state == Pending) {
+                        ready.push_back(dependent);
+                    }
+                }
+            } else {
+                m_Tasks[task].state = Failed;
+                for(unsigned dependent : dependents[task]) {
+                    cancelTask(dependent);
+                }
+                if(m_CancelOnFailure) {
+                    m_Cancelled = true;
+                }
+            }
+            m_Changed.notify_all();
+        }
+    };
+
+    threads = resolveThreads(threads);
+    if(threads > count) {
+        threads = count;
+    }
+    std::vector<std::thread> pool;
+    for(unsigned i = 1; i < threads; i++) {
+        pool.push_back(std::thread(worker));
+    }
+    if(count > 0) {
+        worker();
+    }
+    for(std::thread &thread : pool) {
+        thread.join();
+    }
+    for(const Task &task : m_Tasks) {
+        if(task.state != Succeeded) {
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned TaskGraph::size() const
+{
+    return m_Tasks.size();
+}
+
+std::string TaskGraph::name(unsigned task) const
+{
+    return m_Tasks[task].name;
+}
+
+TaskGraph::TaskState TaskGraph::state(unsigned task) const
+{
+    return m_Tasks[task].state;
+}
+
+std::string TaskGraph::error(unsigned task) const
+{
+    return m_Tasks[task].error;
+}
+
+std::vector<unsigned> TaskGraph::prerequisites(unsigned task) const
+{
+    return m_Tasks[task].prerequisites;
+}
+
+}
@@ -0,0 +1,93 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include "stadicapi.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace stadic {
+
+// A TaskGraph runs the steps of a calculation that communicate through files.
+// Each task names the files that it reads and writes, and waits for the tasks
+// added before it that write any of its inputs, as well as for any task given
+// to addDependency. run starts every task as soon as the tasks that it waits
+// for have succeeded, on up to the given number of worker threads.
+//
+// A task fails when its work returns false or throws. The tasks that depend on
+// a failed task are cancelled without being run. With cancelOnFailure set, a
+// failure also cancels every task that has not started yet, and cancel does
+// the same from any thread, waking the idle workers to do so. Tasks that are already running are always left to
+// finish, so run does not return until nothing is running.
+class STADIC_API TaskGraph
+{
+public:
+    enum TaskState { Pending, Running, Succeeded, Failed, Cancelled };
+
+    TaskGraph();
+    unsigned addTask(const std::string &name, const std::vector<std::string> &inputs, const std::vector<std::string> &outputs, const std::function<bool()> &work);    //Function to add a task, returns its index
+    void addDependency(unsigned task, unsigned prerequisite);                   //Function to make a task wait for another
+    void setCancelOnFailure(bool cancel);                                       //Function to set whether a failure cancels the tasks that have not started
+    bool run(unsigned threads);                                                 //Function to run the tasks, 0 threads uses every core, returns true if every task succeeded
+    void cancel();                                                              //Function to cancel the tasks that have not started
+
+    unsigned size() const;                                                      //Function that returns the number of tasks
+    std::string name(unsigned task) const;                                      //Function that returns the name of a task
+    TaskState state(unsigned task) const;                                       //Function that returns the state of a task after run
+    std::string error(unsigned task) const;                                     //Function that returns the message of the exception that failed a task
+    std::vector<unsigned> prerequisites(unsigned task) const;                   //Function that returns the tasks that a task waits for
+
+private:
+    struct Task
+    {
+        std::string name;
+        std::vector<std::string> inputs;
+        std::vector<std::string> outputs;
+        std::function<bool()> work;
+        std::vector<unsigned> prerequisites;
+        TaskState state;
+        std::string error;
+    };
+
+    std::vector<Task> m_Tasks;                                                  //Tasks in the order that they were added
+    bool m_CancelOnFailure;                                                     //Whether a failure cancels the tasks that have not started
+    std::atomic<bool> m_Cancelled;                                              //Set by cancel
+    std::mutex m_Mutex;                                                         //Guards the task states while run is in progress
+    std::condition_variable m_Changed;                                          //Wakes the idle workers when a task finishes or the graph is cancelled
+};
+
+}
+
+#endif // TASKGRAPH_H
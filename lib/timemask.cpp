@@ -0,0 +1,241 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "timemask.h"
+#include "dayill.h"
+#include <algorithm>
+
+namespace stadic {
+
+static const int monthStart[]={0,31,59,90,120,151,181,212,243,273,304,334};
+
+//Day of the year of a timestep, 0 for January 1
+static int dayOfYear(const DaylightIlluminanceData &axis, unsigned timestep)
+{
+    int month=axis.month(timestep);
+    if (month<1 || month>12){
+        return 0;
+    }
+    return monthStart[month-1]+axis.day(timestep)-1;
+}
+
+//Day of the week of a day of the year, 0 for Sunday
+static int dayOfWeek(int day, int firstDay)
+{
+    return (firstDay-1+day)%7;
+}
+
+TimeMask::TimeMask(unsigned timesteps, bool selected) : m_Timesteps(timesteps), m_Words((timesteps+63)/64,0)
+{
+    if (selected){
+        for (unsigned i=0;i<timesteps;i++){
+            set(i);
+        }
+    }
+    index();
+}
+
+TimeMask::TimeMask(const std::vector<unsigned char> &mask) : m_Timesteps(mask.size()), m_Words((mask.size()+63)/64,0)
+{
+    for (unsigned i=0;i<m_Timesteps;i++){
+        if (mask[i]){
+            set(i);
+        }
+    }
+    index();
+}
+
+TimeMask::TimeMask(const std::vector<bool> &values, unsigned timesteps, unsigned stepsPerValue) : m_Timesteps(timesteps), m_Words((timesteps+63)/64,0)
+{
+    stepsPerValue=std::max(stepsPerValue,1u);
+    for (unsigned i=0;i<timesteps && i/stepsPerValue<values.size();i++){
+        if (values[i/stepsPerValue]){
+            set(i);
+        }
+    }
+    index();
+}
+
+TimeMask TimeMask::hourWindow(const DaylightIlluminanceData &axis, double start, double end, const TimeMask *daylightSavings){
+    TimeMask mask(axis.timesteps());
+    for (unsigned i=0;i<axis.timesteps();i++){
+        double hour=axis.hour(i);
+        if (daylightSavings!=nullptr && daylightSavings->selected(i)){
+            hour=hour+1;                                                        //Clocks are set an hour ahead
+        }
+        if (hour>=start && hour<=end){
+            mask.set(i);
+        }
+    }
+    mask.index();
+    return mask;
+}
+
+TimeMask TimeMask::months(const DaylightIlluminanceData &axis, int first, int last){
+    TimeMask mask(axis.timesteps());
+    for (unsigned i=0;i<axis.timesteps();i++){
+        int month=axis.month(i);
+        if (first<=last ? (month>=first && month<=last) : (month>=first || month<=last)){
+            mask.set(i);
+        }
+    }
+    mask.index();
+    return mask;
+}
+
+TimeMask TimeMask::weekdays(const DaylightIlluminanceData &axis, int firstDay){
+    TimeMask mask(axis.timesteps());
+    for (unsigned i=0;i<axis.timesteps();i++){
+        int day=dayOfWeek(dayOfYear(axis,i),firstDay);
+        if (day>=1 && day<=5){
+            mask.set(i);
+        }
+    }
+    mask.index();
+    return mask;
+}
+
+TimeMask TimeMask::daylightSavings(const DaylightIlluminanceData &axis, int firstDay){
+    //Daylight savings time starts at 2:00 on the second Sunday in March and
+    //ends at 2:00 daylight time (1:00 standard time) on the first Sunday in
+    //November; the time axis is in standard time
+    int march=monthStart[2];
+    int november=monthStart[10];
+    int startDay=march+(7-dayOfWeek(march,firstDay))%7+7;
+    int endDay=november+(7-dayOfWeek(november,firstDay))%7;
+    TimeMask mask(axis.timesteps());
+    for (unsigned i=0;i<axis.timesteps();i++){
+        int day=dayOfYear(axis,i);
+        double hour=axis.hour(i);
+        if ((day>startDay || (day==startDay && hour>=2)) && (day<endDay || (day==endDay && hour<1))){
+            mask.set(i);
+        }
+    }
+    mask.index();
+    return mask;
+}
+
+TimeMask &TimeMask::operator&=(const TimeMask &other){
+    for (size_t i=0;i<m_Words.size();i++){
+        m_Words[i]&=i<other.m_Words.size() ? other.m_Words[i] : 0;
+    }
+    index();
+    return *this;
+}
+
+TimeMask &TimeMask::operator|=(const TimeMask &other){
+    for (size_t i=0;i<m_Words.size() && i<other.m_Words.size();i++){
+        m_Words[i]|=other.m_Words[i];
+    }
+    if (m_Timesteps%64!=0 && !m_Words.empty()){
+        m_Words.back()&=(uint64_t(1)<<(m_Timesteps%64))-1;
+    }
+    index();
+    return *this;
+}
+
+TimeMask TimeMask::operator~() const{
+    TimeMask mask(*this);
+    for (size_t i=0;i<mask.m_Words.size();i++){
+        mask.m_Words[i]=~mask.m_Words[i];
+    }
+    if (m_Timesteps%64!=0 && !mask.m_Words.empty()){
+        mask.m_Words.back()&=(uint64_t(1)<<(m_Timesteps%64))-1;
+    }
+    mask.index();
+    return mask;
+}
+
+TimeMask TimeMask::stored(const DaylightIlluminanceData &data) const{
+    if (!data.isSparse()){
+        return *this;
+    }
+    TimeMask mask(data.storedTimesteps());
+    for (unsigned i=0;i<data.storedTimesteps();i++){
+        if (selected(data.storedTimestep(i))){
+            mask.set(i);
+        }
+    }
+    mask.index();
+    return mask;
+}
+
+//Getters
+unsigned TimeMask::timesteps() const{
+    return m_Timesteps;
+}
+
+size_t TimeMask::count() const{
+    return m_Indices.size();
+}
+
+bool TimeMask::selected(unsigned timestep) const{
+    if (timestep>=m_Timesteps){
+        return false;
+    }
+    return (m_Words[timestep/64]>>(timestep%64))&1;
+}
+
+const std::vector<unsigned> &TimeMask::indices() const{
+    return m_Indices;
+}
+
+const std::vector<uint64_t> &TimeMask::words() const{
+    return m_Words;
+}
+
+std::vector<unsigned char> TimeMask::bytes() const{
+    std::vector<unsigned char> mask(m_Timesteps,0);
+    for (size_t i=0;i<m_Indices.size();i++){
+        mask[m_Indices[i]]=1;
+    }
+    return mask;
+}
+
+//Private
+void TimeMask::set(unsigned timestep){
+    m_Words[timestep/64]|=uint64_t(1)<<(timestep%64);
+}
+
+void TimeMask::index(){
+    m_Indices.clear();
+    for (size_t i=0;i<m_Words.size();i++){
+        if (m_Words[i]==0){                                                     //Skip whole words of unselected timesteps
+            continue;
+        }
+        for (unsigned bit=0;bit<64;bit++){
+            if ((m_Words[i]>>bit)&1){
+                m_Indices.push_back(unsigned(i*64+bit));
+            }
+        }
+    }
+}
+
+}
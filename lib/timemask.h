@@ -0,0 +1,87 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef TIMEMASK_H
+#define TIMEMASK_H
+
+#include "stadicapi.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace stadic {
+
+class DaylightIlluminanceData;
+
+// A TimeMask selects some of the timesteps of an annual time axis: the
+// occupied hours, the hours of the sDA and ASE analysis window, the
+// timesteps within daylight savings time, a range of months, the weekdays.
+// It is compiled once per space and held two ways, as a packed bitset (64
+// timesteps to a word) for testing and combining masks, and as the ascending
+// list of the selected timesteps, which the metric kernels run over instead
+// of testing every timestep of every point. Masks over the same time axis
+// combine with &= and |=, so a new filter costs nothing in the kernels.
+class STADIC_API TimeMask
+{
+public:
+    explicit TimeMask(unsigned timesteps=0, bool selected=false);              //Constructor that selects every timestep or none
+    explicit TimeMask(const std::vector<unsigned char> &mask);                  //Constructor that selects the timesteps with a nonzero byte
+    explicit TimeMask(const std::vector<bool> &values, unsigned timesteps, unsigned stepsPerValue=1);   //Constructor that selects the true values, each covering stepsPerValue timesteps, timesteps past the end are not selected
+    static TimeMask hourWindow(const DaylightIlluminanceData &axis, double start, double end, const TimeMask *daylightSavings=nullptr);  //Function that selects the hours within [start, end], read on the clock an hour ahead within daylightSavings
+    static TimeMask months(const DaylightIlluminanceData &axis, int first, int last);   //Function that selects the months from first to last, wrapping past December
+    static TimeMask weekdays(const DaylightIlluminanceData &axis, int firstDay);    //Function that selects Monday to Friday, firstDay is the day of the week of January 1 (1 for Sunday)
+    static TimeMask daylightSavings(const DaylightIlluminanceData &axis, int firstDay); //Function that selects the timesteps from the second Sunday in March to the first Sunday in November
+
+    TimeMask &operator&=(const TimeMask &other);                                //Function to keep only the timesteps selected by both masks
+    TimeMask &operator|=(const TimeMask &other);                                //Function to add the timesteps selected by the other mask
+    TimeMask operator~() const;                                                 //Function that returns the timesteps not selected
+    TimeMask stored(const DaylightIlluminanceData &data) const;                 //Function that reduces the mask to the stored timesteps of data
+
+    //Getters
+    unsigned timesteps() const;                                                 //Function that returns the number of timesteps in the time axis
+    size_t count() const;                                                       //Function that returns the number of selected timesteps
+    bool selected(unsigned timestep) const;                                     //Function that returns true if a timestep is selected
+    const std::vector<unsigned> &indices() const;                               //Function that returns the selected timesteps in ascending order
+    const std::vector<uint64_t> &words() const;                                 //Function that returns the packed bits, timestep i in bit i%64 of word i/64
+    std::vector<unsigned char> bytes() const;                                   //Function that returns the mask as one byte per timestep
+
+private:
+    void set(unsigned timestep);                                                //Function to select a timestep while the mask is built
+    void index();                                                               //Function to rebuild the list of selected timesteps from the bits
+
+    unsigned m_Timesteps;
+    std::vector<uint64_t> m_Words;                                              //Packed bits, unused bits of the last word are zero
+    std::vector<unsigned> m_Indices;                                            //Selected timesteps in ascending order
+
+};
+
+}
+
+#endif // TIMEMASK_H
@@ -40,6 +40,9 @@
 #include "logging.h"
 #include "functions.h"
 #include "math.h"
+#include "filepath.h"
+#include <map>
+#include <mutex>
 
 const double PI=3.1415926535897932;
 
@@ -48,6 +51,7 @@ namespace stadic {
 WeatherData::WeatherData()
 {
     m_JulianDate.clear();
+    m_Intervals=1;
 }
 
 //Setters
@@ -109,6 +113,14 @@ std::vector<int> WeatherData::julianDate() const{
     return m_JulianDate;
 }
 
+int WeatherData::intervalsPerHour() const{
+    return m_Intervals;
+}
+
+unsigned WeatherData::timesteps() const{
+    return m_DirectNormal.size();
+}
+
 
 std::string WeatherData::place() const
 {
@@ -157,37 +169,33 @@ bool WeatherData::parseWeather(std::string file)
     }else{
         parseTMY(file);
     }
-    if (m_DirectNormal.size()==8760){
-        for (int i=0;i<365;i++){
-            for (int j=0;j<24;j++){
-                m_JulianDate.push_back(i+1);
-            }
-        }
-    }
+    calcJulianDate();
     if (!calcDirectIll()){
         return false;
     }
     return true;
 }
 
-bool WeatherData::writeWea(std::string file)
+bool WeatherData::writeWea(std::string file) const
 {
-    std::ofstream oFile;
-    oFile.open(file);
-    if(!oFile.is_open()){
+    BufferedWriter oFile;
+    if(!oFile.open(file)){
         STADIC_ERROR("The opening of the output weather file \""+file+"\" has failed.");
         return false;
     }
-    oFile<<"place "<<place()<<std::endl;
-    oFile<<"latitude "<<latitude()<<std::endl;
-    oFile<<"longitude "<<longitude()<<std::endl;
-    oFile<<"time_zone "<<timeZoneDeg()<<std::endl;
-    oFile<<"site_elevation "<<elevation()<<std::endl;
+    oFile<<"place "<<place()<<'\n';
+    oFile<<"latitude "<<latitude()<<'\n';
+    oFile<<"longitude "<<longitude()<<'\n';
+    oFile<<"time_zone "<<timeZoneDeg()<<'\n';
+    oFile<<"site_elevation "<<elevation()<<'\n';
     oFile<<"weather_data_file_units 1";
-    for (int i=0;i<month().size();i++){
-        oFile<<std::endl<<month()[i]<<" "<<day()[i]<<" "<<hour()[i]<<" "<<directNormal()[i]<<" "<<diffuseHorizontal()[i];
+    for (int i=0;i<m_Month.size();i++){
+        oFile<<'\n'<<m_Month[i]<<' '<<m_Day[i]<<' '<<m_Hour[i]<<' '<<m_DirectNormal[i]<<' '<<m_DiffuseHorizontal[i];
+    }
+    if(!oFile.close()){
+        STADIC_ERROR("The writing of the output weather file \""+file+"\" has failed.");
+        return false;
     }
-    oFile.close();
     return true;
 }
 
@@ -216,13 +224,18 @@ bool WeatherData::parseEPW(std::string file)
     for(int i = 1; i<8; i++){
         std::getline(iFile, line);
     }
-    //This is where the number of periods per hour should be read in.
+    //The number of periods per hour sets the length of the time axis
     vals=trimmedSplit(line,',');
     if(vals.size() < 7) {
         STADIC_ERROR("Weather file " + file + " DATA PERIODS line is missing information.");
         return false;
     }
     int intervals=atoi(vals[2].c_str());
+    if (intervals<1 || 60%intervals!=0){
+        STADIC_ERROR("Weather file " + file + " has "+vals[2]+" intervals per hour, which does not divide the hour into whole minutes.");
+        return false;
+    }
+    m_Intervals=intervals;
     double delta=1.0/(double)intervals;
     int counter=0;
     while(std::getline(iFile, line)){
@@ -379,9 +392,24 @@ bool WeatherData::parseTMY(std::string file){
     */
     return true;
 }
+void WeatherData::calcJulianDate(){
+    //Days before the first of each month in a year without a leap day
+    static const int firstDay[12]={0,31,59,90,120,151,181,212,243,273,304,334};
+    m_JulianDate.clear();
+    m_JulianDate.reserve(m_Month.size());
+    for (int i=0;i<m_Month.size();i++){
+        int month=m_Month[i]<1 ? 1 : (m_Month[i]>12 ? 12 : m_Month[i]);
+        int julianDate=firstDay[month-1]+m_Day[i];
+        if (julianDate>365){
+            julianDate=365;
+        }
+        m_JulianDate.push_back(julianDate);
+    }
+}
+
 bool WeatherData::calcDirectIll(){
     if (m_JulianDate.empty()){
-        STADIC_WARNING("There are not 8760 intervals in the weather file.");
+        STADIC_WARNING("There are no intervals in the weather file.");
         return false;
     }
     setSolarPositions();
@@ -576,4 +604,47 @@ std::vector<double> WeatherData::directLumEff(double epsilon){
     return tempVec;
 }
 
+struct CachedWeather
+{
+    time_t modified;
+    long long size;
+    std::shared_ptr<const WeatherData> data;
+};
+
+static std::mutex weatherCacheMutex;
+static std::map<std::string, CachedWeather> weatherCache;
+
+std::shared_ptr<const WeatherData> WeatherCache::weatherData(const std::string &file)
+{
+    time_t modified;
+    long long size;
+    if (!fileStamp(file, &modified, &size)){
+        STADIC_ERROR("The weather file "+file+" does not exist.");
+        return nullptr;
+    }
+    //The lock is held while parsing so that threads asking for the same file
+    //wait for the one parse rather than repeating it
+    std::lock_guard<std::mutex> lock(weatherCacheMutex);
+    auto found=weatherCache.find(file);
+    if (found!=weatherCache.end() && found->second.modified==modified && found->second.size==size){
+        return found->second.data;
+    }
+    std::shared_ptr<WeatherData> data=std::make_shared<WeatherData>();
+    if (!data->parseWeather(file)){
+        return nullptr;
+    }
+    CachedWeather entry;
+    entry.modified=modified;
+    entry.size=size;
+    entry.data=data;
+    weatherCache[file]=entry;
+    return data;
+}
+
+void WeatherCache::clear()
+{
+    std::lock_guard<std::mutex> lock(weatherCacheMutex);
+    weatherCache.clear();
+}
+
 }
@@ -33,6 +33,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include "stadicapi.h"
 
@@ -43,7 +44,7 @@ class STADIC_API WeatherData
 public:
     WeatherData();
     bool parseWeather(std::string file);                    //Function to parse the weather file
-    bool writeWea(std::string file);                        //Function to write the wea file to a given filename
+    bool writeWea(std::string file) const;                  //Function to write the wea file to a given filename
 
     //Setters
     /*
@@ -74,10 +75,13 @@ public:
     double timeZoneDeg() const;                             //Function that returns the timezone as a double in degrees
     std::string elevation() const;                          //Function that returns the elevation as a string
     std::vector<int> julianDate() const;                    //Function that returns the julian date as a vector
+    int intervalsPerHour() const;                           //Function that returns the number of intervals per hour
+    unsigned timesteps() const;                             //Function that returns the number of intervals in the weather file
 
 private:
     bool parseEPW(std::string file);                        //Function to parse an EPW file
     bool parseTMY(std::string file);                        //Function to pase a TMY file
+    void calcJulianDate();                                  //Function to set the julian date of each interval from its month and day
     bool calcDirectIll();                                   //Function to calculate the direct illuminance
     void setSolarPositions();                               //Function to set the solar positions
     double solarDec(int julianDate);                        //Function to calculate the solar declination angle
@@ -113,6 +117,20 @@ private:
     std::string m_Longitude;                                //Variable holding the longitude as a string
     std::string m_TimeZone;                                 //Variable holding the timezone as a string
     std::string m_Elevation;                                //Variable holding the elevation as a string
+    int m_Intervals;                                        //Variable holding the number of intervals per hour
+
+};
+
+// The WeatherCache holds one parsed WeatherData per weather file so that the
+// many steps of a run that need the time axis or the solar data do not each
+// parse the file again.  Entries are keyed by the path, modification time and
+// size of the file, so a file that is rewritten during a run is parsed again.
+// The cache may be used from several threads at once.
+class STADIC_API WeatherCache
+{
+public:
+    static std::shared_ptr<const WeatherData> weatherData(const std::string &file);    //Function that returns the parsed weather file, or null if the parsing fails
+    static void clear();                                    //Function to empty the cache
 
 };
 
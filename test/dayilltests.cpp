@@ -0,0 +1,570 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "dayill.h"
+#include "weatherdata.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#ifdef _MSC_VER
+#define UNLINK _unlink
+#else
+#define UNLINK unlink
+#endif
+
+TEST(DayIllTests, ParseTimeBased)
+{
+    std::ofstream out("timebased.ill");
+    out << "1 1 0.5 0 0 0 0" << std::endl;
+    out << "1 1 1.5 10 20 30 40" << std::endl;
+    out << "1 1 2.5 100 200 300 400" << std::endl;
+    out.close();
+
+    stadic::DaylightIlluminanceData data;
+    ASSERT_TRUE(data.parseTimeBased("timebased.ill"));
+    ASSERT_EQ(4, data.points());
+    ASSERT_EQ(3, data.timesteps());
+    EXPECT_EQ(1, data.month(2));
+    EXPECT_EQ(1, data.day(2));
+    EXPECT_EQ(2.5, data.hour(2));
+    EXPECT_EQ(300, data.lux(2, 2));
+
+    // A point view is contiguous and runs over the year
+    stadic::IlluminanceView point = data.point(3);
+    ASSERT_EQ(3, point.size());
+    EXPECT_EQ(1, point.stride());
+    EXPECT_EQ(0, point[0]);
+    EXPECT_EQ(40, point[1]);
+    EXPECT_EQ(400, point[2]);
+    EXPECT_EQ(400/10.764, point.fc(2));
+
+    // A timestep view strides across the points
+    stadic::IlluminanceView hour = data.timestep(1);
+    ASSERT_EQ(4, hour.size());
+    EXPECT_EQ(10, hour[0]);
+    EXPECT_EQ(40, hour[3]);
+    EXPECT_TRUE(data.timestep(0).allZeros());
+    EXPECT_FALSE(hour.allZeros());
+    EXPECT_EQ(0.5, hour.fractionAboveTarget(20));
+    UNLINK("timebased.ill");
+}
+
+TEST(DayIllTests, WriteRoundTrip)
+{
+    std::vector<int> month = {6, 6};
+    std::vector<int> day = {21, 21};
+    std::vector<double> hour = {11.5, 12.5};
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(month, day, hour);
+    data.resize(3);
+    for (unsigned i = 0; i < data.points(); i++) {
+        double *values = data.pointData(i);
+        values[0] = i + 1;
+        values[1] = 10 * (i + 1);
+    }
+    ASSERT_TRUE(data.writeIllFileLux("roundtrip.ill"));
+
+    stadic::DaylightIlluminanceData reread;
+    ASSERT_TRUE(reread.parseTimeBased("roundtrip.ill"));
+    ASSERT_EQ(3, reread.points());
+    ASSERT_EQ(2, reread.timesteps());
+    EXPECT_EQ(21, reread.day(1));
+    EXPECT_EQ(12.5, reread.hour(1));
+    for (unsigned i = 0; i < 3; i++) {
+        EXPECT_EQ(data.lux(i, 0), reread.lux(i, 0));
+        EXPECT_EQ(data.lux(i, 1), reread.lux(i, 1));
+    }
+    UNLINK("roundtrip.ill");
+}
+
+TEST(DayIllTests, ParseRaggedFails)
+{
+    std::ofstream out("ragged.ill");
+    out << "1 1 0.5 1 2 3" << std::endl;
+    out << "1 1 1.5 1 2" << std::endl;
+    out.close();
+
+    stadic::DaylightIlluminanceData data;
+    EXPECT_FALSE(data.parseTimeBased("ragged.ill"));
+    UNLINK("ragged.ill");
+}
+
+TEST(DayIllTests, ParsePointMajor)
+{
+    // One value per line, every hour of the year for point 0 then point 1
+    std::ofstream out("pointmajor.tmp");
+    for (int i = 0; i < 2 * 8760; i++) {
+        out << i << std::endl;
+    }
+    out.close();
+
+    stadic::DaylightIlluminanceData data;
+    ASSERT_TRUE(data.parse("pointmajor.tmp", "USA_PA_Lancaster.AP.725116_TMY3.epw"));
+    ASSERT_EQ(2, data.points());
+    ASSERT_EQ(8760, data.timesteps());
+    EXPECT_EQ(1, data.month(710));
+    EXPECT_EQ(30, data.day(710));
+    EXPECT_EQ(14.5, data.hour(710));
+    EXPECT_EQ(710, data.lux(0, 710));
+    EXPECT_EQ(8760 + 710, data.lux(1, 710));
+    EXPECT_EQ(8760 + 710, data.timestep(710)[1]);
+    UNLINK("pointmajor.tmp");
+}
+
+TEST(DayIllTests, BinaryRoundTrip)
+{
+    std::ofstream out("binarysource.ill");
+    out << "3 14 9.5 1.25 2.5 3.75" << std::endl;
+    out << "3 14 10.5 100 200 300" << std::endl;
+    out.close();
+
+    stadic::DaylightIlluminanceData data;
+    ASSERT_TRUE(data.parseTimeBased("binarysource.ill"));
+    EXPECT_FALSE(stadic::DaylightIlluminanceData::isBinaryIllFile("binarysource.ill"));
+    ASSERT_TRUE(data.writeIllFileBinary("binary.ill"));
+    EXPECT_TRUE(stadic::DaylightIlluminanceData::isBinaryIllFile("binary.ill"));
+
+    // parseTimeBased picks up the binary format on its own
+    stadic::DaylightIlluminanceData reread;
+    ASSERT_TRUE(reread.parseTimeBased("binary.ill"));
+    ASSERT_EQ(3, reread.points());
+    ASSERT_EQ(2, reread.timesteps());
+    EXPECT_EQ(3, reread.month(1));
+    EXPECT_EQ(14, reread.day(1));
+    EXPECT_EQ(10.5, reread.hour(1));
+    for (unsigned i = 0; i < 3; i++) {
+        EXPECT_EQ(data.lux(i, 0), reread.lux(i, 0));
+        EXPECT_EQ(data.lux(i, 1), reread.lux(i, 1));
+    }
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(reread.point(0).data()) % 64);
+
+    // Copies share the mapping, writing detaches only the written copy
+    stadic::DaylightIlluminanceData copy = reread;
+    copy.pointData(0)[0] = 7;
+    EXPECT_EQ(7, copy.lux(0, 0));
+    EXPECT_EQ(1.25, reread.lux(0, 0));
+
+    ASSERT_TRUE(reread.addTimeBasedIll("binary.ill"));
+    EXPECT_EQ(600, reread.lux(2, 1));
+    UNLINK("binarysource.ill");
+    UNLINK("binary.ill");
+}
+
+TEST(DayIllTests, BinarySinglePrecisionFootcandles)
+{
+    std::vector<int> month = {1, 1, 1};
+    std::vector<int> day = {2, 2, 2};
+    std::vector<double> hour = {8.5, 9.5, 10.5};
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(month, day, hour);
+    data.resize(2);
+    for (unsigned i = 0; i < data.points(); i++) {
+        double *values = data.pointData(i);
+        for (unsigned j = 0; j < data.timesteps(); j++) {
+            values[j] = 10.764 * (i * 10 + j);
+        }
+    }
+    ASSERT_TRUE(data.writeIllFileBinary("single.ill", stadic::DaylightIlluminanceData::Footcandles,
+                                        stadic::DaylightIlluminanceData::SinglePrecision));
+
+    stadic::DaylightIlluminanceData reread;
+    ASSERT_TRUE(reread.parseBinary("single.ill"));
+    ASSERT_EQ(2, reread.points());
+    ASSERT_EQ(3, reread.timesteps());
+    for (unsigned i = 0; i < 2; i++) {
+        for (unsigned j = 0; j < 3; j++) {
+            EXPECT_NEAR(data.lux(i, j), reread.lux(i, j), 1e-4);
+        }
+    }
+    UNLINK("single.ill");
+}
+
+TEST(DayIllTests, BinaryRejectsText)
+{
+    std::ofstream out("notbinary.ill");
+    out << "1 1 0.5 0 0 0 0" << std::endl;
+    out.close();
+
+    stadic::DaylightIlluminanceData data;
+    EXPECT_FALSE(data.parseBinary("notbinary.ill"));
+    UNLINK("notbinary.ill");
+}
+
+TEST(DayIllTests, BinaryRejectsWrappedHeader)
+{
+    std::ofstream out("wrapsource.ill");
+    out << "1 1 0.5 1 2" << std::endl;
+    out.close();
+    stadic::DaylightIlluminanceData data;
+    ASSERT_TRUE(data.parseTimeBased("wrapsource.ill"));
+    ASSERT_TRUE(data.writeIllFileBinary("wrap.ill"));
+
+    // Counts whose products wrap around to small sizes, and a point count
+    // past what the object can index
+    std::vector<std::pair<uint64_t, uint64_t>> headers = {{2, uint64_t(1) << 60}, {(uint64_t(1) << 32) + 1, 0}};
+    for (const std::pair<uint64_t, uint64_t> &header : headers) {
+        std::fstream file("wrap.ill", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(24);
+        file.write(reinterpret_cast<const char *>(&header.first), sizeof(uint64_t));
+        file.write(reinterpret_cast<const char *>(&header.second), sizeof(uint64_t));
+        file.close();
+        stadic::DaylightIlluminanceData reread;
+        EXPECT_FALSE(reread.parseBinary("wrap.ill")) << header.first << " " << header.second;
+    }
+    UNLINK("wrapsource.ill");
+    UNLINK("wrap.ill");
+}
+
+// Builds an annual data set on the time axis of the Lancaster weather file
+// with values derived from the direct illuminance so that they have a mix
+// of magnitudes and digits
+static stadic::DaylightIlluminanceData lancasterData(unsigned points)
+{
+    stadic::WeatherData weather;
+    EXPECT_TRUE(weather.parseWeather("USA_PA_Lancaster.AP.725116_TMY3.epw"));
+    std::vector<double> direct = weather.directIlluminance();
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(weather.month(), weather.day(), weather.hour());
+    data.resize(points);
+    for (unsigned i = 0; i < points; i++) {
+        double *values = data.pointData(i);
+        for (unsigned j = 0; j < data.timesteps(); j++) {
+            values[j] = direct[j] / (i + 3.0) + 0.001 * j;
+        }
+    }
+    return data;
+}
+
+static bool sameData(const stadic::DaylightIlluminanceData &a, const stadic::DaylightIlluminanceData &b)
+{
+    if (a.points() != b.points() || a.timesteps() != b.timesteps()) {
+        return false;
+    }
+    for (unsigned j = 0; j < a.timesteps(); j++) {
+        if (a.month(j) != b.month(j) || a.day(j) != b.day(j) || a.hour(j) != b.hour(j)) {
+            return false;
+        }
+    }
+    for (unsigned i = 0; i < a.points(); i++) {
+        if (std::memcmp(a.point(i).data(), b.point(i).data(), a.timesteps() * sizeof(double)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(DayIllTests, ParallelParseMatchesSerial)
+{
+    stadic::DaylightIlluminanceData data = lancasterData(40);
+    ASSERT_TRUE(data.writeIllFileLux("parallel.ill"));
+
+    stadic::DaylightIlluminanceData serial;
+    serial.setThreads(1);
+    ASSERT_TRUE(serial.parseTimeBased("parallel.ill"));
+    ASSERT_EQ(40, serial.points());
+    ASSERT_EQ(8760, serial.timesteps());
+    for (unsigned threads : {2, 3, 8}) {
+        stadic::DaylightIlluminanceData parallel;
+        parallel.setThreads(threads);
+        ASSERT_TRUE(parallel.parseTimeBased("parallel.ill"));
+        EXPECT_TRUE(sameData(serial, parallel)) << threads << " threads";
+    }
+
+    // The point-major intermediate files take the same route
+    std::ofstream out("parallel.tmp");
+    out.precision(17);
+    for (unsigned i = 0; i < data.points(); i++) {
+        for (unsigned j = 0; j < data.timesteps(); j++) {
+            out << data.lux(i, j) << std::endl;
+        }
+    }
+    out.close();
+    serial.setThreads(1);
+    ASSERT_TRUE(serial.parse("parallel.tmp", "USA_PA_Lancaster.AP.725116_TMY3.epw"));
+    EXPECT_TRUE(sameData(data, serial));
+    stadic::DaylightIlluminanceData parallel;
+    parallel.setThreads(4);
+    ASSERT_TRUE(parallel.parse("parallel.tmp", "USA_PA_Lancaster.AP.725116_TMY3.epw"));
+    EXPECT_TRUE(sameData(serial, parallel));
+    UNLINK("parallel.ill");
+    UNLINK("parallel.tmp");
+}
+
+TEST(DayIllTests, ParallelParseFindsBadLines)
+{
+    stadic::DaylightIlluminanceData data = lancasterData(20);
+    ASSERT_TRUE(data.writeIllFileLux("parallelbad.ill"));
+    std::ofstream out("parallelbad.ill", std::ios::app);
+    out << "12 31 23.5 1 2 3" << std::endl;
+    out.close();
+
+    stadic::DaylightIlluminanceData serial;
+    serial.setThreads(1);
+    EXPECT_FALSE(serial.parseTimeBased("parallelbad.ill"));
+    stadic::DaylightIlluminanceData parallel;
+    parallel.setThreads(4);
+    EXPECT_FALSE(parallel.parseTimeBased("parallelbad.ill"));
+    UNLINK("parallelbad.ill");
+}
+
+TEST(DayIllTests, AddIllFileEveryRow)
+{
+    std::vector<int> month = {1, 1, 1};
+    std::vector<int> day = {1, 1, 1};
+    std::vector<double> hour = {0.5, 1.5, 2.5};
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(month, day, hour);
+    data.resize(2);
+
+    std::ofstream out("layer.ill");
+    out << "1 2" << std::endl;
+    out << "3 4" << std::endl;
+    out << "5 6" << std::endl;
+    out.close();
+    ASSERT_TRUE(data.addIllFile("layer.ill"));
+    EXPECT_EQ(1, data.lux(0, 0));
+    EXPECT_EQ(4, data.lux(1, 1));
+    EXPECT_EQ(5, data.lux(0, 2));
+    EXPECT_EQ(6, data.lux(1, 2));
+
+    // A layer that stops early is an error rather than a partial sum
+    out.open("layer.ill");
+    out << "1 2" << std::endl;
+    out.close();
+    EXPECT_FALSE(data.addIllFile("layer.ill"));
+    UNLINK("layer.ill");
+}
+
+TEST(DayIllTests, MergerMatchesInMemorySum)
+{
+    std::vector<int> month = {3, 3, 3};
+    std::vector<int> day = {4, 4, 4};
+    std::vector<double> hour = {8.5, 9.5, 10.5};
+
+    // Two points, point-major with a trailing blank line
+    std::ofstream out("merge.tmp");
+    out << "1\n2\n3\n10\n20\n30\n\n";
+    out.close();
+    out.open("merge_bsdf0.ill");
+    out << "0.5 0.25\n1.5 1.25\n2.5 2.25\n";
+    out.close();
+    out.open("merge_bsdf1.ill");
+    out << "100 200\n\n300 400\n500 600\n";
+    out.close();
+
+    stadic::IlluminanceMerger merger;
+    merger.setTimeAxis(month, day, hour);
+    merger.setPointMajorInput("merge.tmp");
+    merger.addLayer("merge_bsdf0.ill");
+    merger.addLayer("merge_bsdf1.ill");
+    ASSERT_TRUE(merger.write("merged.ill"));
+
+    stadic::DaylightIlluminanceData expected;
+    expected.setTimeAxis(month, day, hour);
+    expected.resize(2);
+    double first[] = {1, 2, 3};
+    double second[] = {10, 20, 30};
+    std::memcpy(expected.pointData(0), first, sizeof(first));
+    std::memcpy(expected.pointData(1), second, sizeof(second));
+    ASSERT_TRUE(expected.addIllFile("merge_bsdf0.ill"));
+    ASSERT_TRUE(expected.addIllFile("merge_bsdf1.ill"));
+    ASSERT_TRUE(expected.writeIllFileLux("expected.ill"));
+
+    std::ifstream merged("merged.ill");
+    std::ifstream reference("expected.ill");
+    std::string mergedText((std::istreambuf_iterator<char>(merged)), std::istreambuf_iterator<char>());
+    std::string referenceText((std::istreambuf_iterator<char>(reference)), std::istreambuf_iterator<char>());
+    merged.close();
+    reference.close();
+    EXPECT_EQ(referenceText, mergedText);
+
+    // The layers alone, with the first layer as the base
+    merger.clearInputs();
+    merger.addLayer("merge_bsdf0.ill");
+    merger.addLayer("merge_bsdf1.ill");
+    ASSERT_TRUE(merger.write("merged.ill"));
+    stadic::DaylightIlluminanceData layers;
+    ASSERT_TRUE(layers.parseTimeBased("merged.ill"));
+    ASSERT_EQ(2, layers.points());
+    ASSERT_EQ(3, layers.timesteps());
+    EXPECT_EQ(10.5, layers.hour(2));
+    EXPECT_EQ(502.5, layers.lux(0, 2));
+    EXPECT_EQ(401.25, layers.lux(1, 1));
+
+    // A layer with a row too many is rejected
+    out.open("merge_bsdf1.ill", std::ios_base::app);
+    out << "1 1\n";
+    out.close();
+    EXPECT_FALSE(merger.write("merged.ill"));
+
+    UNLINK("merge.tmp");
+    UNLINK("merge_bsdf0.ill");
+    UNLINK("merge_bsdf1.ill");
+    UNLINK("merged.ill");
+    UNLINK("expected.ill");
+}
+
+TEST(DayIllTests, ElideDarkTimesteps)
+{
+    std::vector<int> month = {1, 1, 1, 1, 1};
+    std::vector<int> day = {1, 1, 1, 1, 1};
+    std::vector<double> hour = {0.5, 1.5, 2.5, 3.5, 4.5};
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(month, day, hour);
+    data.resize(2);
+    double first[] = {0, 5, 0, 7, 0};
+    double second[] = {0, 0, 0, 8, 9};
+    std::memcpy(data.pointData(0), first, sizeof(first));
+    std::memcpy(data.pointData(1), second, sizeof(second));
+    ASSERT_TRUE(data.writeIllFileLux("dense.ill"));
+
+    data.elideDarkTimesteps();
+    ASSERT_TRUE(data.isSparse());
+    EXPECT_EQ(5, data.timesteps());
+    ASSERT_EQ(3, data.storedTimesteps());
+    EXPECT_EQ(1, data.storedTimestep(0));
+    EXPECT_EQ(4, data.storedTimestep(2));
+    EXPECT_EQ(0, data.lux(1, 2));
+    EXPECT_EQ(8, data.lux(1, 3));
+    EXPECT_TRUE(data.timestep(2).allZeros());
+    EXPECT_EQ(9, data.timestep(4)[1]);
+    ASSERT_EQ(3, data.point(0).size());
+    EXPECT_EQ(7, data.point(0)[1]);
+    std::vector<unsigned char> mask = {1, 0, 1, 1, 1};
+    std::vector<unsigned char> stored = data.storedMask(mask);
+    ASSERT_EQ(3, stored.size());
+    EXPECT_EQ(0, stored[0]);
+    EXPECT_EQ(1, stored[1]);
+
+    // The text output still holds every timestep
+    ASSERT_TRUE(data.writeIllFileLux("sparse.ill"));
+    std::ifstream dense("dense.ill");
+    std::ifstream sparse("sparse.ill");
+    std::string denseText((std::istreambuf_iterator<char>(dense)), std::istreambuf_iterator<char>());
+    std::string sparseText((std::istreambuf_iterator<char>(sparse)), std::istreambuf_iterator<char>());
+    dense.close();
+    sparse.close();
+    EXPECT_EQ(denseText, sparseText);
+
+    // The binary output keeps only the stored timesteps
+    ASSERT_TRUE(data.writeIllFileBinary("sparse.bill"));
+    stadic::DaylightIlluminanceData reread;
+    ASSERT_TRUE(reread.parseTimeBased("sparse.bill"));
+    ASSERT_TRUE(reread.isSparse());
+    EXPECT_EQ(3, reread.storedTimesteps());
+    for (unsigned i = 0; i < 5; i++) {
+        EXPECT_EQ(data.lux(0, i), reread.lux(0, i));
+        EXPECT_EQ(data.lux(1, i), reread.lux(1, i));
+    }
+
+    // Adding a layer brings back every timestep
+    std::ofstream out("layer.ill");
+    for (unsigned i = 0; i < 5; i++) {
+        out << "1 1" << std::endl;
+    }
+    out.close();
+    ASSERT_TRUE(reread.addIllFile("layer.ill"));
+    EXPECT_FALSE(reread.isSparse());
+    EXPECT_EQ(1, reread.lux(0, 0));
+    EXPECT_EQ(10, reread.lux(1, 4));
+
+    data.restoreDarkTimesteps();
+    EXPECT_FALSE(data.isSparse());
+    ASSERT_EQ(5, data.point(1).size());
+    EXPECT_EQ(9, data.point(1)[4]);
+    EXPECT_EQ(0, data.point(1)[0]);
+
+    UNLINK("dense.ill");
+    UNLINK("sparse.ill");
+    UNLINK("sparse.bill");
+    UNLINK("layer.ill");
+}
+
+TEST(DayIllTests, BlockReaderMatchesParse)
+{
+    std::vector<int> month = {1, 1, 1, 1};
+    std::vector<int> day = {1, 1, 1, 1};
+    std::vector<double> hour = {0.5, 1.5, 2.5, 3.5};
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(month, day, hour);
+    data.resize(5);
+    for (unsigned i = 0; i < data.points(); i++) {
+        for (unsigned j = 1; j < data.timesteps(); j++) {
+            data.pointData(i)[j] = 10 * i + j + 0.25;
+        }
+    }
+    ASSERT_TRUE(data.writeIllFileLux("blocks.ill"));
+    data.elideDarkTimesteps();
+    ASSERT_TRUE(data.writeIllFileBinary("blocks.bill"));
+
+    for (std::string file : {"blocks.ill", "blocks.bill"}) {
+        stadic::IlluminanceBlockReader reader;
+        ASSERT_TRUE(reader.open(file, "blocks.scratch")) << file;
+        ASSERT_EQ(5, reader.points());
+        ASSERT_EQ(4, reader.timesteps());
+        EXPECT_EQ(3.5, reader.timeAxis().hour(3));
+
+        // Blocks that do not divide the points evenly still cover them all
+        stadic::DaylightIlluminanceData block;
+        for (unsigned first = 0; first < 5; first += 2) {
+            unsigned count = std::min(2u, 5 - first);
+            reader.readBlock(first, count, &block);
+            ASSERT_EQ(count, block.points());
+            for (unsigned j = 0; j < count; j++) {
+                for (unsigned i = 0; i < 4; i++) {
+                    EXPECT_EQ(data.lux(first + j, i), block.lux(j, i)) << file;
+                }
+            }
+        }
+        std::vector<double> row(5);
+        reader.readRow(2, row.data());
+        for (unsigned j = 0; j < 5; j++) {
+            EXPECT_EQ(data.lux(j, 2), row[j]) << file;
+        }
+        // Part of a row, including a timestep that is dark
+        for (unsigned i : {0u, 2u}) {
+            std::fill(row.begin(), row.end(), -1);
+            reader.readRow(i, 1, 3, row.data());
+            EXPECT_EQ(-1, row[3]) << file;
+            for (unsigned j = 0; j < 3; j++) {
+                EXPECT_EQ(data.lux(j + 1, i), row[j]) << file;
+            }
+        }
+        reader.close();
+        EXPECT_FALSE(std::ifstream("blocks.scratch").is_open());
+    }
+    UNLINK("blocks.ill");
+    UNLINK("blocks.bill");
+}
@@ -33,6 +33,15 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#ifdef _MSC_VER
+#define UNLINK _unlink
+#else
+#define UNLINK unlink
+#endif
 
 TEST(FunctionTests, Split)
 {
@@ -143,3 +152,141 @@ TEST(FunctionTests, Tokenize)
     queue.pop();
     EXPECT_EQ("tokenize", queue.front());
 }
+
+TEST(FunctionTests, ParseDouble)
+{
+    const char *numbers[] = {"0", "-0", "20.5", "+3", "1.", ".25", "0.001", "6.02e23", "1.5E-7", "123456789012345678901234",
+                             "0.1234567890123456789", "2.2250738585072014e-308", "4.9e-324", "1e400"};
+    for(const char *number : numbers) {
+        double value;
+        const char *end = number + std::strlen(number);
+        EXPECT_EQ(end, stadic::parseDouble(number, end, &value)) << number;
+        EXPECT_EQ(std::strtod(number, nullptr), value) << number;
+    }
+    const char *bad[] = {"", "-", ".", "e5", "1e", "1e+", "abc"};
+    for(const char *number : bad) {
+        double value;
+        EXPECT_EQ(nullptr, stadic::parseDouble(number, number + std::strlen(number), &value)) << number;
+    }
+    std::string text = "12.5 7";
+    double value;
+    EXPECT_EQ(text.c_str() + 4, stadic::parseDouble(text.c_str(), text.c_str() + text.size(), &value));
+    EXPECT_EQ(12.5, value);
+}
+
+TEST(FunctionTests, NumericReader)
+{
+    std::ofstream out("numeric.txt");
+    out << "1 2.5\t-3e2" << std::endl;
+    out << std::endl;
+    out << "  0.125 4  \r" << std::endl;
+    out << "5 x6 7" << std::endl;
+    out << "8";
+    out.close();
+
+    // A tiny buffer makes the reader refill and grow mid-line
+    stadic::NumericReader reader(4);
+    ASSERT_TRUE(reader.open("numeric.txt"));
+    std::vector<double> row;
+    ASSERT_TRUE(reader.readRow(row));
+    ASSERT_EQ(3, row.size());
+    EXPECT_EQ(1, row[0]);
+    EXPECT_EQ(2.5, row[1]);
+    EXPECT_EQ(-300, row[2]);
+    EXPECT_EQ("-3e2", reader.token(2));
+    ASSERT_TRUE(reader.readRow(row));
+    EXPECT_TRUE(row.empty());
+    ASSERT_TRUE(reader.readRow(row));
+    ASSERT_EQ(2, row.size());
+    EXPECT_EQ(0.125, row[0]);
+    EXPECT_EQ("0.125", reader.token(0));
+    EXPECT_FALSE(reader.readRow(row));
+    EXPECT_TRUE(reader.failed());
+    EXPECT_EQ(4, reader.line());
+    EXPECT_EQ(3, reader.column());
+    EXPECT_EQ("line 4, column 3", reader.position());
+    reader.close();
+
+    ASSERT_TRUE(reader.open("numeric.txt"));
+    for(int i = 0; i < 3; i++) {
+        ASSERT_TRUE(reader.readRow(row));
+    }
+    reader.close();
+    UNLINK("numeric.txt");
+
+    std::ofstream last("numericlast.txt");
+    last << "1 2" << std::endl << "3";
+    last.close();
+    ASSERT_TRUE(reader.open("numericlast.txt"));
+    ASSERT_TRUE(reader.readRow(row));
+    ASSERT_TRUE(reader.readRow(row));
+    ASSERT_EQ(1, row.size());
+    EXPECT_EQ(3, row[0]);
+    EXPECT_FALSE(reader.readRow(row));
+    EXPECT_FALSE(reader.failed());
+    reader.close();
+    UNLINK("numericlast.txt");
+}
+
+TEST(FunctionTests, FormatNumbers)
+{
+    char buffer[32];
+    EXPECT_EQ("0", std::string(buffer, stadic::formatInteger(0, buffer)));
+    EXPECT_EQ("-9223372036854775808", std::string(buffer, stadic::formatInteger(-9223372036854775807LL - 1, buffer)));
+    EXPECT_EQ("8760", std::string(buffer, stadic::formatInteger(8760, buffer)));
+
+    // The default matches what a std::ostream writes
+    double samples[] = {0, -0.0, 12, 0.1, -123.4567, 114977.34245069593, 999999.5, 1234565, 0.000123, 1e-5, 1e20, 1.5e-7, 2.5};
+    char expected[32];
+    for(double value : samples) {
+        std::sprintf(expected, "%g", value);
+        EXPECT_EQ(std::string(expected), std::string(buffer, stadic::formatDouble(value, buffer)));
+    }
+
+    // Precision 0 gives the shortest exact text
+    EXPECT_EQ("0", std::string(buffer, stadic::formatDouble(0, buffer, 0)));
+    EXPECT_EQ("12", std::string(buffer, stadic::formatDouble(12, buffer, 0)));
+    EXPECT_EQ("0.1", std::string(buffer, stadic::formatDouble(0.1, buffer, 0)));
+    EXPECT_EQ("-123.4567", std::string(buffer, stadic::formatDouble(-123.4567, buffer, 0)));
+    EXPECT_EQ("114977.34245069593", std::string(buffer, stadic::formatDouble(114977.34245069593, buffer, 0)));
+    EXPECT_EQ("0.000123", std::string(buffer, stadic::formatDouble(0.000123, buffer, 0)));
+    EXPECT_EQ("1e+20", std::string(buffer, stadic::formatDouble(1e20, buffer, 0)));
+    EXPECT_EQ("1.5e-07", std::string(buffer, stadic::formatDouble(1.5e-7, buffer, 0)));
+
+    srand(1);
+    for(int i = 0; i < 20000; i++) {
+        double value = (rand() - RAND_MAX / 2) / double(1 + rand() % 100000) * std::pow(10.0, rand() % 40 - 20);
+        unsigned length = stadic::formatDouble(value, buffer, 0);
+        buffer[length] = '\0';
+        EXPECT_EQ(value, std::strtod(buffer, nullptr)) << buffer;
+        for(unsigned precision = 1; precision <= 10; precision += 3) {
+            std::sprintf(expected, "%.*g", int(precision), value);
+            length = stadic::formatDouble(value, buffer, precision);
+            EXPECT_EQ(std::string(expected), std::string(buffer, length));
+        }
+    }
+}
+
+TEST(FunctionTests, BufferedWriter)
+{
+    // A tiny buffer makes the writer flush mid-line and write around it
+    stadic::BufferedWriter writer(64);
+    ASSERT_TRUE(writer.open("buffered.txt"));
+    writer << 1 << ' ' << 2.5 << ' ' << -3LL << '\n';
+    writer << std::string(100, 'x') << '\n';
+    writer << "last " << 8760u;
+    EXPECT_FALSE(writer.failed());
+    ASSERT_TRUE(writer.close());
+
+    std::ifstream in("buffered.txt");
+    std::string line;
+    ASSERT_TRUE(bool(std::getline(in, line)));
+    EXPECT_EQ("1 2.5 -3", line);
+    ASSERT_TRUE(bool(std::getline(in, line)));
+    EXPECT_EQ(std::string(100, 'x'), line);
+    ASSERT_TRUE(bool(std::getline(in, line)));
+    EXPECT_EQ("last 8760", line);
+    EXPECT_FALSE(bool(std::getline(in, line)));
+    in.close();
+    UNLINK("buffered.txt");
+}
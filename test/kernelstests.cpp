@@ -0,0 +1,283 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "illkernels.h"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using stadic::kernels::InstructionSet;
+
+// Values around the thresholds used below, including values exactly on them
+static std::vector<double> testValues(size_t count, unsigned seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(0, 3000);
+    const double special[] = {0, 100, 300, 1000, 2000, 1076.4, 3229.2, std::numeric_limits<double>::quiet_NaN()};
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; i++) {
+        values[i] = generator() % 5 == 0 ? special[generator() % 8] : uniform(generator);
+    }
+    return values;
+}
+
+static std::vector<unsigned char> testMask(size_t count, unsigned seed)
+{
+    std::mt19937 generator(seed);
+    std::vector<unsigned char> mask(count);
+    for (size_t i = 0; i < count; i++) {
+        mask[i] = generator() % 3 != 0;
+    }
+    return mask;
+}
+
+class KernelTests : public ::testing::TestWithParam<InstructionSet>
+{
+protected:
+    void SetUp()
+    {
+        m_Original = stadic::kernels::instructionSet();
+        if (!stadic::kernels::isSupported(GetParam())) {
+            m_Skip = true;
+        }
+    }
+    void TearDown()
+    {
+        stadic::kernels::setInstructionSet(m_Original);
+    }
+    // Runs a kernel with the portable reference and then with the set under test
+    template <typename Function> void compare(Function function)
+    {
+        if (m_Skip) {
+            return;
+        }
+        for (size_t count : {0, 1, 2, 3, 4, 5, 7, 15, 16, 17, 33, 8760}) {
+            std::vector<double> values = testValues(count, count + 1);
+            std::vector<unsigned char> mask = testMask(count, count + 2);
+            stadic::kernels::setInstructionSet(InstructionSet::Portable);
+            auto expected = function(values, mask);
+            ASSERT_TRUE(stadic::kernels::setInstructionSet(GetParam()));
+            auto actual = function(values, mask);
+            check(expected, actual, count);
+        }
+    }
+    template <typename T> void check(const T &expected, const T &actual, size_t count)
+    {
+        EXPECT_EQ(expected, actual) << count << " values";
+    }
+    void check(double expected, double actual, size_t count)
+    {
+        EXPECT_NEAR(expected, actual, 1e-9 * std::fabs(expected)) << count << " values";
+    }
+
+    InstructionSet m_Original;
+    bool m_Skip = false;
+};
+
+TEST_P(KernelTests, CountAbove)
+{
+    for (double divisor : {1.0, 10.764}) {
+        compare([divisor](const std::vector<double> &values, const std::vector<unsigned char> &mask) {
+            std::vector<size_t> counts;
+            for (double threshold : {0.0, 100.0, 300.0, 1000.0}) {
+                counts.push_back(stadic::kernels::countAbove(values.data(), nullptr, values.size(), threshold, divisor));
+                counts.push_back(stadic::kernels::countAbove(values.data(), mask.data(), values.size(), threshold, divisor));
+            }
+            return counts;
+        });
+    }
+}
+
+TEST_P(KernelTests, CountAtOrAbove)
+{
+    using stadic::kernels::Comparison;
+    for (double divisor : {1.0, 10.764}) {
+        compare([divisor](const std::vector<double> &values, const std::vector<unsigned char> &mask) {
+            std::vector<unsigned> indices;
+            for (unsigned i = 0; i < mask.size(); i++) {
+                if (mask[i]) {
+                    indices.push_back(i);
+                }
+            }
+            std::vector<size_t> counts;
+            for (double threshold : {0.0, 100.0, 300.0, 1000.0}) {
+                size_t atOrAbove = stadic::kernels::countAbove(values.data(), mask.data(), values.size(), threshold, divisor,
+                                                               Comparison::GreaterOrEqual);
+                size_t above = stadic::kernels::countAbove(values.data(), mask.data(), values.size(), threshold, divisor);
+                size_t at = 0;
+                for (size_t i = 0; i < values.size(); i++) {
+                    at += mask[i] && values[i] / divisor == threshold;
+                }
+                EXPECT_EQ(above + at, atOrAbove);
+                EXPECT_EQ(atOrAbove, stadic::kernels::countAboveAt(values.data(), indices.data(), indices.size(), threshold,
+                                                                   divisor, Comparison::GreaterOrEqual));
+                counts.push_back(atOrAbove);
+            }
+            return counts;
+        });
+    }
+}
+
+TEST_P(KernelTests, AnyAbove)
+{
+    compare([](const std::vector<double> &values, const std::vector<unsigned char> &) {
+        std::vector<bool> results;
+        for (double threshold : {0.0, 2999.0, 3000.0}) {
+            results.push_back(stadic::kernels::anyAbove(values.data(), values.size(), threshold));
+        }
+        std::vector<double> zeros(values.size(), 0);
+        results.push_back(stadic::kernels::anyAbove(zeros.data(), zeros.size(), 0));
+        if (!zeros.empty()) {
+            zeros.back() = 1;
+        }
+        results.push_back(stadic::kernels::anyAbove(zeros.data(), zeros.size(), 0));
+        return results;
+    });
+}
+
+TEST_P(KernelTests, CountBands)
+{
+    for (double divisor : {1.0, 10.764}) {
+        compare([divisor](const std::vector<double> &values, const std::vector<unsigned char> &mask) {
+            std::vector<size_t> counts(6);
+            stadic::kernels::countBands(values.data(), nullptr, values.size(), 100, 2000, divisor,
+                                        &counts[0], &counts[1], &counts[2]);
+            stadic::kernels::countBands(values.data(), mask.data(), values.size(), 100, 2000, divisor,
+                                        &counts[3], &counts[4], &counts[5]);
+            return counts;
+        });
+    }
+}
+
+TEST_P(KernelTests, AccumulateAndConvert)
+{
+    compare([](const std::vector<double> &values, const std::vector<unsigned char> &) {
+        std::vector<double> total(values.size(), 0.5);
+        stadic::kernels::accumulate(total.data(), values.data(), values.size());
+        stadic::kernels::accumulate(total.data(), values.data(), values.size());
+        std::vector<double> converted(values.size());
+        stadic::kernels::scaledCopy(converted.data(), total.data(), total.size(), 10.764);
+        // Compare the bits so that NaN compares equal to NaN
+        std::vector<unsigned long long> bits(converted.size());
+        std::memcpy(bits.data(), converted.data(), converted.size() * sizeof(double));
+        return bits;
+    });
+}
+
+TEST_P(KernelTests, Sum)
+{
+    compare([](const std::vector<double> &values, const std::vector<unsigned char> &mask) {
+        // Leave out the NaN values, which would make every sum NaN
+        std::vector<double> finite(values);
+        for (double &value : finite) {
+            if (value != value) {
+                value = 1;
+            }
+        }
+        return stadic::kernels::sum(finite.data(), mask.data(), finite.size(), 10.764);
+    });
+}
+
+TEST_P(KernelTests, IndexedMatchesMasked)
+{
+    compare([](const std::vector<double> &values, const std::vector<unsigned char> &mask) {
+        std::vector<unsigned> indices;
+        for (unsigned i = 0; i < mask.size(); i++) {
+            if (mask[i]) {
+                indices.push_back(i);
+            }
+        }
+        std::vector<size_t> counts;
+        for (double threshold : {0.0, 300.0, 1000.0}) {
+            counts.push_back(stadic::kernels::countAboveAt(values.data(), indices.data(), indices.size(), threshold, 10.764));
+            EXPECT_EQ(stadic::kernels::countAbove(values.data(), mask.data(), values.size(), threshold, 10.764), counts.back());
+        }
+        std::vector<size_t> bands(6);
+        stadic::kernels::countBandsAt(values.data(), indices.data(), indices.size(), 100, 2000, 1,
+                                      &bands[0], &bands[1], &bands[2]);
+        stadic::kernels::countBands(values.data(), mask.data(), values.size(), 100, 2000, 1,
+                                    &bands[3], &bands[4], &bands[5]);
+        EXPECT_EQ(bands[0], bands[3]);
+        EXPECT_EQ(bands[1], bands[4]);
+        EXPECT_EQ(bands[2], bands[5]);
+        counts.insert(counts.end(), bands.begin(), bands.end());
+        return counts;
+    });
+}
+
+TEST_P(KernelTests, SumAt)
+{
+    compare([](const std::vector<double> &values, const std::vector<unsigned char> &mask) {
+        std::vector<unsigned> indices;
+        for (unsigned i = 0; i < mask.size(); i++) {
+            if (mask[i] && values[i] == values[i]) {
+                indices.push_back(i);
+            }
+        }
+        return stadic::kernels::sumAt(values.data(), indices.data(), indices.size(), 10.764);
+    });
+}
+
+TEST_P(KernelTests, KernelSetKeepsItsSelection)
+{
+    if (m_Skip) {
+        return;
+    }
+    ASSERT_TRUE(stadic::kernels::setInstructionSet(GetParam()));
+    const stadic::kernels::KernelSet kernelSet;
+    stadic::kernels::setInstructionSet(InstructionSet::Portable);
+    EXPECT_EQ(GetParam(), kernelSet.instructionSet());
+    std::vector<double> values = testValues(8760, 8761);
+    std::vector<unsigned char> mask = testMask(8760, 8762);
+    std::vector<unsigned> indices;
+    for (unsigned i = 0; i < mask.size(); i++) {
+        if (mask[i] && values[i] == values[i]) {
+            indices.push_back(i);
+        }
+    }
+    size_t below, within, above, setBelow, setWithin, setAbove;
+    stadic::kernels::countBandsAt(values.data(), indices.data(), indices.size(), 100, 300, 10.764, &below, &within, &above);
+    kernelSet.countBandsAt(values.data(), indices.data(), indices.size(), 100, 300, 10.764, &setBelow, &setWithin, &setAbove);
+    EXPECT_EQ(below, setBelow);
+    EXPECT_EQ(within, setWithin);
+    EXPECT_EQ(above, setAbove);
+    EXPECT_EQ(stadic::kernels::countAbove(values.data(), mask.data(), values.size(), 300, 1, stadic::kernels::Comparison::GreaterOrEqual),
+              kernelSet.countAbove(values.data(), mask.data(), values.size(), 300, 1, stadic::kernels::Comparison::GreaterOrEqual));
+    EXPECT_EQ(stadic::kernels::countAboveAt(values.data(), indices.data(), indices.size(), 300, 10.764),
+              kernelSet.countAboveAt(values.data(), indices.data(), indices.size(), 300, 10.764));
+    EXPECT_NEAR(stadic::kernels::sumAt(values.data(), indices.data(), indices.size()),
+                kernelSet.sumAt(values.data(), indices.data(), indices.size()), 1e-9 * kernelSet.sumAt(values.data(), indices.data(), indices.size()));
+}
+
+INSTANTIATE_TEST_CASE_P(InstructionSets, KernelTests,
+                        ::testing::Values(InstructionSet::Portable, InstructionSet::SSE2, InstructionSet::AVX2));
@@ -0,0 +1,800 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "metrics.h"
+#include "buildingcontrol.h"
+#include "dayill.h"
+#include "filepath.h"
+#include "logging.h"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+static stadic::DaylightIlluminanceData annualData(unsigned points, std::vector<unsigned char> *occupied)
+{
+    int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    std::vector<int> month;
+    std::vector<int> day;
+    std::vector<double> hour;
+    occupied->clear();
+    for (int m = 0; m < 12; m++) {
+        for (int d = 1; d <= daysInMonth[m]; d++) {
+            for (int h = 0; h < 24; h++) {
+                month.push_back(m + 1);
+                day.push_back(d);
+                hour.push_back(h + 0.5);
+                occupied->push_back(h >= 8 && h < 18 ? 1 : 0);
+            }
+        }
+    }
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(month, day, hour);
+    data.resize(points);
+    for (unsigned p = 0; p < points; p++) {
+        double *values = data.pointData(p);
+        for (unsigned i = 0; i < data.timesteps(); i++) {
+            int h = i % 24;
+            int d = i / 24;
+            values[i] = (h < 7 || h > 18) ? 0 : (p + 1) * 11.3 * (h - 6) * (1 + d % 7);
+        }
+    }
+    return data;
+}
+
+TEST(MetricsTests, StatisticsMatchSeparateLoops)
+{
+    std::vector<unsigned char> occupied;
+    stadic::DaylightIlluminanceData data = annualData(4, &occupied);
+    stadic::AnnualStatistics statistics;
+    statistics.setDA(300);
+    statistics.setcDA(300);
+    statistics.setUDI(100, 250);
+    ASSERT_TRUE(statistics.compute(data, stadic::TimeMask(occupied)));
+    EXPECT_EQ(3650, statistics.occupiedHours());
+    ASSERT_EQ(4, statistics.points());
+    for (unsigned p = 0; p < data.points(); p++) {
+        size_t above = 0, below = 0, within = 0, udiAbove = 0;
+        double sum = 0;
+        for (unsigned i = 0; i < data.timesteps(); i++) {
+            if (occupied[i]) {
+                double value = data.lux(p, i);
+                if (value > 300) {
+                    above++;
+                }
+                sum += value;
+                if (value < 100) {
+                    below++;
+                } else if (value > 250) {
+                    udiAbove++;
+                } else {
+                    within++;
+                }
+            }
+        }
+        EXPECT_EQ(above, statistics.DACounts()[p]);
+        EXPECT_NEAR(sum, statistics.cDASums()[p], sum * 1e-12);
+        EXPECT_EQ(below, statistics.UDIBelow()[p]);
+        EXPECT_EQ(within, statistics.UDIWithin()[p]);
+        EXPECT_EQ(udiAbove, statistics.UDIAbove()[p]);
+    }
+
+    // Dropping the dark hours leaves every statistic unchanged
+    stadic::DaylightIlluminanceData sparse = annualData(4, &occupied);
+    sparse.elideDarkTimesteps();
+    ASSERT_TRUE(sparse.isSparse());
+    stadic::AnnualStatistics sparseStatistics;
+    sparseStatistics.setDA(300);
+    sparseStatistics.setcDA(300);
+    sparseStatistics.setUDI(100, 250);
+    ASSERT_TRUE(sparseStatistics.compute(sparse, stadic::TimeMask(occupied)));
+    EXPECT_EQ(statistics.DACounts(), sparseStatistics.DACounts());
+    for (unsigned p = 0; p < data.points(); p++) {
+        EXPECT_NEAR(statistics.cDASums()[p], sparseStatistics.cDASums()[p], statistics.cDASums()[p] * 1e-12);
+    }
+    EXPECT_EQ(statistics.UDIBelow(), sparseStatistics.UDIBelow());
+    EXPECT_EQ(statistics.UDIWithin(), sparseStatistics.UDIWithin());
+    EXPECT_EQ(statistics.UDIAbove(), sparseStatistics.UDIAbove());
+
+    occupied.pop_back();
+    EXPECT_FALSE(statistics.compute(data, stadic::TimeMask(occupied)));
+}
+
+// The original search: try every combination and keep the last one that
+// comes closest to the limit without reaching it
+static std::vector<bool> bruteForceCombination(const std::vector<unsigned> &sunlitPoints, unsigned points, double limit)
+{
+    size_t groups = sunlitPoints.size();
+    std::vector<bool> best(groups, true);
+    double min = 1e300;
+    for (unsigned j = 0; j < (1u << groups); j++) {
+        unsigned total = 0;
+        for (size_t k = 0; k < groups; k++) {
+            if ((j >> k) & 1) {
+                total += sunlitPoints[k];
+            }
+        }
+        double fraction = double(total) / points;
+        if (limit > fraction && (limit - fraction) <= min) {
+            min = limit - fraction;
+            for (size_t k = 0; k < groups; k++) {
+                best[k] = !((j >> k) & 1);
+            }
+        }
+    }
+    return best;
+}
+
+TEST(MetricsTests, ShadeCombinationMatchesBruteForce)
+{
+    unsigned seed = 12345;
+    for (int trial = 0; trial < 2000; trial++) {
+        seed = seed * 1103515245 + 12345;
+        size_t groups = 1 + (seed >> 16) % 10;
+        seed = seed * 1103515245 + 12345;
+        unsigned points = 1 + (seed >> 16) % 60;
+        std::vector<unsigned> sunlit(groups);
+        for (size_t k = 0; k < groups; k++) {
+            seed = seed * 1103515245 + 12345;
+            // Leave some groups without sun and repeat counts to exercise ties
+            sunlit[k] = (seed >> 16) % 3 == 0 ? 0 : (seed >> 18) % (points / 4 + 2);
+        }
+        double limits[] = {0.02, 2.0 / points, 6.0 / points, 0.2, 0.5};
+        for (double limit : limits) {
+            EXPECT_EQ(bruteForceCombination(sunlit, points, limit), stadic::sDAShadeCombination(sunlit, points, limit))
+                << "trial " << trial << " limit " << limit;
+        }
+    }
+
+    // Nothing fits below a limit of zero
+    EXPECT_EQ(std::vector<bool>(2, true), stadic::sDAShadeCombination(std::vector<unsigned>(2, 0), 10, 0));
+}
+
+TEST(MetricsTests, ShadeCombinationManyGroups)
+{
+    // 2^30 combinations would be out of reach of the enumeration
+    std::vector<unsigned> sunlit(30);
+    for (unsigned k = 0; k < sunlit.size(); k++) {
+        sunlit[k] = 1 + (k * 7) % 13;
+    }
+    std::vector<bool> shaded = stadic::sDAShadeCombination(sunlit, 1000, 0.05);
+    unsigned total = 0;
+    for (unsigned k = 0; k < sunlit.size(); k++) {
+        if (!shaded[k]) {
+            total += sunlit[k];
+        }
+    }
+    EXPECT_EQ(49, total);
+}
+
+static void checkResults(const std::string &file, const std::vector<double> &expected)
+{
+    std::ifstream results(file);
+    ASSERT_TRUE(results.is_open()) << file;
+    std::string line;
+    for (double value : expected) {
+        ASSERT_TRUE(bool(std::getline(results, line))) << file;
+        std::ostringstream text;
+        text << value;
+        EXPECT_EQ(text.str(), line) << file;
+    }
+    EXPECT_FALSE(bool(std::getline(results, line))) << file;
+}
+
+static void writeSpace(const std::string &directory, stadic::DaylightIlluminanceData &data, const std::vector<unsigned char> &occupied)
+{
+    ASSERT_TRUE(stadic::PathName(directory + "res/").create());
+    ASSERT_TRUE(stadic::PathName(directory + "data/").create());
+    ASSERT_TRUE(data.writeIllFileLux(directory + "res/test1.ill"));
+    std::ofstream occupancy(directory + "data/8to6.csv");
+    int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    unsigned i = 0;
+    for (int m = 0; m < 12; m++) {
+        for (int d = 1; d <= daysInMonth[m]; d++) {
+            for (int h = 0; h < 24; h++) {
+                occupancy << m + 1 << "," << d << "," << h + 0.5 << "," << int(occupied[i++]) << std::endl;
+            }
+        }
+    }
+    occupancy.close();
+}
+
+static std::string spaceJson(const std::string &directory, const std::string &extra)
+{
+    std::ostringstream json;
+    json << "{\"space_name\" : \"test1\", \"space_directory\" : \"" << directory << "\","
+         << "\"geometry_directory\" : \"rad/\", \"results_directory\" : \"res/\", \"input_directory\" : \"data/\","
+         << "\"ground_reflectance\" : 0.2, \"lighting_schedule\" : \"8to6.csv\", \"occupancy_schedule\" : \"8to6.csv\","
+         << "\"material_file\" : \"mat1.rad\", \"geometry_file\" : \"geom1.rad\","
+         << "\"analysis_points\" : {\"files\" : [\"grid.pts\"]},"
+         << "\"window_groups\" : [{\"name\" : \"WG1\", \"base_geometry\" : \"wg1base.rad\", \"calculate_base\" : true,"
+         << "\"glazing_materials\" : [\"l_glazing\"]}],"
+         << "\"DA\" : {\"calculate\" : true, \"illuminance\" : 300},"
+         << "\"cDA\" : {\"calculate\" : true, \"illuminance\" : 300},"
+         << "\"DF\" : false,"
+         << "\"UDI\" : {\"calculate\" : true, \"minimum\" : 100, \"maximum\" : 250}" << extra << "}";
+    return json.str();
+}
+
+static void writeControl(const std::string &file, const std::vector<std::string> &directories, const std::string &extra = "")
+{
+    std::ofstream json(file);
+    json << "{\"spaces\" : [";
+    for (size_t i = 0; i < directories.size(); i++) {
+        json << (i > 0 ? "," : "") << spaceJson(directories[i], extra);
+    }
+    json << "],"
+         << "\"general\" : {\"import_units\" : \"ft\", \"illum_units\" : \"lux\", \"display_units\" : \"ft\","
+         << "\"epw_file\" : \"USA_PA_Lancaster.AP.725116_TMY3.epw\", \"first_day\" : 1, \"building_rotation\" : 0,"
+         << "\"target_illuminance\" : 500, \"sky_divisions\" : 4, \"sun_divisions\" : 4,"
+         << "\"radiance_parameters\" : {\"default\" : {\"ab\" : 5}}, \"daylight_savings_time\" : true}}" << std::endl;
+    json.close();
+}
+
+static void checkSpace(const std::string &directory, const stadic::DaylightIlluminanceData &data, const std::vector<unsigned char> &occupied)
+{
+    // The expected values follow the original separate passes over the data
+    std::vector<double> DA, cDA, below, within, above;
+    for (unsigned p = 0; p < data.points(); p++) {
+        int hourCount = 0;
+        int countDA = 0;
+        double sum = 0;
+        double countBelow = 0, countWithin = 0, countAbove = 0;
+        for (unsigned i = 0; i < data.timesteps(); i++) {
+            if (occupied[i]) {
+                hourCount++;
+                double value = data.lux(p, i);
+                if (value > 300) {
+                    countDA++;
+                }
+                sum += value;
+                if (value < 100) {
+                    countBelow++;
+                } else if (value > 250) {
+                    countAbove++;
+                } else {
+                    countWithin++;
+                }
+            }
+        }
+        DA.push_back(double(countDA) / hourCount);
+        cDA.push_back(sum / 300 / hourCount);
+        below.push_back(countBelow / hourCount);
+        within.push_back(countWithin / hourCount);
+        above.push_back(countAbove / hourCount);
+    }
+    checkResults(directory + "res/test1_DA.res", DA);
+    checkResults(directory + "res/test1_cDA.res", cDA);
+    checkResults(directory + "res/test1_below_UDI.res", below);
+    checkResults(directory + "res/test1_UDI.res", within);
+    checkResults(directory + "res/test1_above_UDI.res", above);
+}
+
+TEST(MetricsTests, ProcessMetricsResults)
+{
+    std::vector<unsigned char> occupied;
+    stadic::DaylightIlluminanceData data = annualData(3, &occupied);
+    writeSpace("metricscase/", data, occupied);
+    writeControl("metricscontrol.json", std::vector<std::string>(1, "metricscase/"));
+
+    stadic::BuildingControl model;
+    ASSERT_TRUE(model.parseJson("metricscontrol.json"));
+    stadic::Metrics metrics(&model);
+    ASSERT_TRUE(metrics.processMetrics());
+    checkSpace("metricscase/", data, occupied);
+}
+
+TEST(MetricsTests, HourlyOccupancyOnSubHourlyAxis)
+{
+    // Half hourly illuminance with the usual hourly occupancy schedule
+    std::vector<unsigned char> occupied;
+    stadic::DaylightIlluminanceData hourly = annualData(3, &occupied);
+    std::vector<int> month;
+    std::vector<int> day;
+    std::vector<double> hour;
+    std::vector<unsigned char> halfHours;
+    for (unsigned i = 0; i < hourly.timesteps(); i++) {
+        for (int k = 0; k < 2; k++) {
+            month.push_back(hourly.month(i));
+            day.push_back(hourly.day(i));
+            hour.push_back(hourly.hour(i) - 0.25 + 0.5 * k);
+            halfHours.push_back(occupied[i]);
+        }
+    }
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(month, day, hour);
+    data.resize(3);
+    for (unsigned p = 0; p < 3; p++) {
+        double *values = data.pointData(p);
+        for (unsigned i = 0; i < data.timesteps(); i++) {
+            values[i] = hourly.lux(p, i / 2) * (i % 2 ? 1.5 : 0.5);
+        }
+    }
+    writeSpace("subhourlycase/", data, occupied);
+    writeControl("subhourlycontrol.json", std::vector<std::string>(1, "subhourlycase/"));
+    stadic::BuildingControl model;
+    ASSERT_TRUE(model.parseJson("subhourlycontrol.json"));
+    stadic::Metrics metrics(&model);
+    ASSERT_TRUE(metrics.processMetrics());
+    checkSpace("subhourlycase/", data, halfHours);
+
+    // A schedule that fits neither the timesteps nor the hours is refused
+    std::ofstream("subhourlycase/data/8to6.csv") << "1,1,0.5,1\n1,1,1.5,1\n";
+    stadic::BuildingControl mismatched;
+    ASSERT_TRUE(mismatched.parseJson("subhourlycontrol.json"));
+    stadic::Metrics mismatchedMetrics(&mismatched);
+    EXPECT_THROW(mismatchedMetrics.processMetrics(), std::runtime_error);
+    EXPECT_TRUE(mismatched.spaces()[0]->runDA());
+}
+
+TEST(MetricsTests, HistogramMatchesStatistics)
+{
+    std::vector<unsigned char> occupied;
+    stadic::DaylightIlluminanceData data = annualData(4, &occupied);
+    data.elideDarkTimesteps();
+    std::vector<double> edges = {500, 100, 300, 250, 100};
+    stadic::IlluminanceHistogram histogram(edges);
+    ASSERT_EQ(4, histogram.edges().size());
+    ASSERT_TRUE(histogram.compute(data, stadic::TimeMask(occupied)));
+    stadic::AnnualStatistics statistics;
+    statistics.setDA(300);
+    statistics.setcDA(300);
+    statistics.setUDI(100, 250);
+    ASSERT_TRUE(statistics.compute(data, stadic::TimeMask(occupied)));
+    EXPECT_EQ(statistics.occupiedHours(), histogram.occupiedHours());
+    for (unsigned p = 0; p < data.points(); p++) {
+        EXPECT_EQ(statistics.DACounts()[p], histogram.countAbove(p, 300));
+        EXPECT_EQ(0, histogram.uncertainty(p, 300));
+        EXPECT_EQ(statistics.UDIBelow()[p], histogram.countBelow(p, 100));
+        EXPECT_EQ(statistics.UDIAbove()[p], histogram.countAbove(p, 250));
+        EXPECT_NEAR(statistics.cDASums()[p], histogram.sum(p), histogram.sum(p) * 1e-12);
+
+        // A threshold between edges is bracketed by the uncertainty
+        size_t above = 0;
+        for (unsigned i = 0; i < data.timesteps(); i++) {
+            if (occupied[i] && data.lux(p, i) > 400) {
+                above++;
+            }
+        }
+        size_t known = histogram.countAbove(p, 400);
+        EXPECT_LE(known, above);
+        EXPECT_LE(above, known + histogram.uncertainty(p, 400));
+        EXPECT_EQ(histogram.occupiedHours(), histogram.countBelow(p, 400) + known + histogram.uncertainty(p, 400));
+    }
+}
+
+TEST(MetricsTests, SweepMatchesSingleMetrics)
+{
+    std::vector<unsigned char> occupied;
+    stadic::DaylightIlluminanceData data = annualData(3, &occupied);
+    writeSpace("sweepcase/", data, occupied);
+    writeControl("sweepcontrol.json", std::vector<std::string>(1, "sweepcase/"),
+                 ",\"metric_sweep\" : {\"calculate\" : true, \"DA\" : [300, 150], \"cDA\" : [300], \"UDI\" : [[100, 250], [50, 2000]]}");
+
+    stadic::BuildingControl model;
+    ASSERT_TRUE(model.parseJson("sweepcontrol.json"));
+    ASSERT_TRUE(model.spaces()[0]->runSweep());
+    stadic::Metrics metrics(&model);
+    ASSERT_TRUE(metrics.processMetrics());
+    EXPECT_FALSE(model.spaces()[0]->runSweep());
+
+    std::ifstream sweep("sweepcase/res/test1_sweep.res");
+    ASSERT_TRUE(sweep.is_open());
+    std::string line;
+    ASSERT_TRUE(bool(std::getline(sweep, line)));
+    EXPECT_EQ("DA_300 DA_150 cDA_300 below_UDI_100_250 UDI_100_250 above_UDI_100_250 below_UDI_50_2000 UDI_50_2000 above_UDI_50_2000", line);
+    std::ifstream DA("sweepcase/res/test1_DA.res");
+    std::ifstream cDA("sweepcase/res/test1_cDA.res");
+    std::ifstream below("sweepcase/res/test1_below_UDI.res");
+    std::ifstream within("sweepcase/res/test1_UDI.res");
+    std::ifstream above("sweepcase/res/test1_above_UDI.res");
+    for (unsigned p = 0; p < data.points(); p++) {
+        ASSERT_TRUE(bool(std::getline(sweep, line)));
+        std::istringstream values(line);
+        std::vector<std::string> columns((std::istream_iterator<std::string>(values)), std::istream_iterator<std::string>());
+        ASSERT_EQ(9, columns.size());
+        std::string expected;
+        std::getline(DA, expected);
+        EXPECT_EQ(expected, columns[0]);
+        std::getline(cDA, expected);
+        EXPECT_EQ(expected, columns[2]);
+        std::getline(below, expected);
+        EXPECT_EQ(expected, columns[3]);
+        std::getline(within, expected);
+        EXPECT_EQ(expected, columns[4]);
+        std::getline(above, expected);
+        EXPECT_EQ(expected, columns[5]);
+
+        int hourCount = 0;
+        int countDA = 0;
+        for (unsigned i = 0; i < data.timesteps(); i++) {
+            if (occupied[i]) {
+                hourCount++;
+                if (data.lux(p, i) > 150) {
+                    countDA++;
+                }
+            }
+        }
+        std::ostringstream text;
+        text << double(countDA) / hourCount;
+        EXPECT_EQ(text.str(), columns[1]);
+    }
+    EXPECT_FALSE(bool(std::getline(sweep, line)));
+}
+
+static std::string fileText(const std::string &file)
+{
+    std::ifstream in(file);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+TEST(MetricsTests, MemoryBudgetMatchesInMemory)
+{
+    std::vector<unsigned char> occupied;
+    stadic::DaylightIlluminanceData data = annualData(5, &occupied);
+    std::string sweep = ",\"metric_sweep\" : {\"calculate\" : true, \"DA\" : [300, 150], \"cDA\" : [300], \"UDI\" : [[100, 250]]}";
+    writeSpace("memorycase/", data, occupied);
+    writeControl("memorycontrol.json", std::vector<std::string>(1, "memorycase/"), sweep);
+    stadic::BuildingControl model;
+    ASSERT_TRUE(model.parseJson("memorycontrol.json"));
+    stadic::Metrics metrics(&model);
+    ASSERT_TRUE(metrics.processMetrics());
+    std::vector<std::string> names = {"_DA.res", "_cDA.res", "_below_UDI.res", "_UDI.res", "_above_UDI.res", "_sweep.res"};
+    std::vector<std::string> expected;
+    for (const std::string &name : names) {
+        expected.push_back(fileText("memorycase/res/test1" + name));
+    }
+
+    // A budget too small for one point still takes a point at a time
+    stadic::BuildingControl blockedModel;
+    ASSERT_TRUE(blockedModel.parseJson("memorycontrol.json"));
+    stadic::Metrics blocked(&blockedModel);
+    blocked.setMemoryBudget(1);
+    EXPECT_EQ(1, blocked.memoryBudget());
+    ASSERT_TRUE(blocked.processMetrics());
+    for (size_t i = 0; i < names.size(); i++) {
+        EXPECT_EQ(expected[i], fileText("memorycase/res/test1" + names[i])) << names[i];
+    }
+    checkSpace("memorycase/", data, occupied);
+    EXPECT_FALSE(blockedModel.spaces()[0]->runDA());
+    EXPECT_FALSE(blockedModel.spaces()[0]->runSweep());
+    EXPECT_FALSE(std::ifstream("memorycase/res/intermediateData/test1.scratch").is_open());
+}
+
+// Two window groups over 50 points of a 1200 ft2 floor, so that a single
+// point may see direct sun in any hour. Every fifth point gets more than
+// 1000 lux of direct sun on two days in three.
+static void writesDASpace(const std::string &directory, std::vector<stadic::DaylightIlluminanceData> *direct,
+                          std::vector<stadic::DaylightIlluminanceData> *base, std::vector<stadic::DaylightIlluminanceData> *setting)
+{
+    ASSERT_TRUE(stadic::PathName(directory + "res/").create());
+    ASSERT_TRUE(stadic::PathName(directory + "rad/").create());
+    std::ofstream geometry(directory + "rad/geo.rad");
+    geometry << "l_floor polygon floor\n0\n0\n12 0 0 0 40 0 0 40 30 0 0 30 0\n";
+    geometry.close();
+    std::vector<unsigned char> occupied;
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (int g = 0; g < 2; g++) {
+        direct->push_back(annualData(50, &occupied));
+        base->push_back(annualData(50, &occupied));
+        setting->push_back(annualData(50, &occupied));
+        for (unsigned p = 0; p < 50; p++) {
+            for (unsigned i = 0; i < 8760; i++) {
+                int h = i % 24;
+                int d = i / 24;
+                double sun = 0;
+                if (h >= 7 && h <= 18) {
+                    sun = p % 5 == 0 && d % 3 != 0 ? 1100 + 10 * g : std::round(400 * uniform(generator));
+                }
+                // Whole values survive the text files exactly
+                double diffuse = (h >= 7 && h <= 18) ? std::round(50 + 450 * uniform(generator)) : 0;
+                (*direct)[g].pointData(p)[i] = sun;
+                (*base)[g].pointData(p)[i] = sun + diffuse;
+                (*setting)[g].pointData(p)[i] = 0.25 * (sun + diffuse);
+            }
+        }
+        std::string prefix = directory + "res/sda_WG" + std::to_string(g + 1);
+        ASSERT_TRUE((*direct)[g].writeIllFileLux(prefix + "_base_direct.ill"));
+        ASSERT_TRUE((*base)[g].writeIllFileLux(prefix + "_base.ill"));
+        ASSERT_TRUE((*setting)[g].writeIllFileLux(prefix + "_set1.ill"));
+    }
+    // The space illuminance sets the time axis of the analysis window
+    ASSERT_TRUE((*base)[0].writeIllFileLux(directory + "res/sda.ill"));
+}
+
+static void writesDAControl(const std::string &file, const std::string &directory, bool writeIll)
+{
+    std::ofstream json(file);
+    json << "{\"spaces\" : [{\"space_name\" : \"sda\", \"space_directory\" : \"" << directory << "\","
+         << "\"geometry_directory\" : \"rad/\", \"results_directory\" : \"res/\", \"input_directory\" : \"data/\","
+         << "\"ground_reflectance\" : 0.2, \"lighting_schedule\" : \"8to6.csv\", \"occupancy_schedule\" : \"8to6.csv\","
+         << "\"material_file\" : \"mat.rad\", \"geometry_file\" : \"geo.rad\","
+         << "\"analysis_points\" : {\"files\" : [\"grid.pts\"], \"modifier\" : [\"l_floor\"]},"
+         << "\"window_groups\" : [{\"name\" : \"WG1\", \"base_geometry\" : \"wg1.rad\", \"calculate_base\" : true,"
+         << "\"glazing_materials\" : [\"l_glazing\"]}, {\"name\" : \"WG2\", \"base_geometry\" : \"wg2.rad\","
+         << "\"calculate_base\" : true, \"glazing_materials\" : [\"l_glazing\"]}],"
+         << "\"sDA\" : {\"calculate\" : true, \"illuminance\" : 300, \"DA_fraction\" : 0.5, \"start_time\" : 8,"
+         << "\"end_time\" : 17, \"window_group_settings\" : [1, 1], \"write_illuminance\" : " << (writeIll ? "true" : "false") << "}}],"
+         << "\"general\" : {\"import_units\" : \"ft\", \"illum_units\" : \"lux\", \"display_units\" : \"ft\","
+         << "\"epw_file\" : \"USA_PA_Lancaster.AP.725116_TMY3.epw\", \"first_day\" : 1, \"building_rotation\" : 0,"
+         << "\"target_illuminance\" : 500, \"sky_divisions\" : 4, \"sun_divisions\" : 4,"
+         << "\"radiance_parameters\" : {\"default\" : {\"ab\" : 5}}, \"daylight_savings_time\" : false}}" << std::endl;
+    json.close();
+}
+
+TEST(MetricsTests, SpatialDaylightAutonomy)
+{
+    std::vector<stadic::DaylightIlluminanceData> direct, base, setting;
+    writesDASpace("sdacase/", &direct, &base, &setting);
+    writesDAControl("sdacontrol.json", "sdacase/", false);
+    std::remove("sdacase/res/sda_sDA.ill");
+
+    // The expected values follow the original materialized calculation
+    stadic::TimeMask hours = stadic::TimeMask::hourWindow(direct[0], 8, 17);
+    std::vector<int> ASECounts(50, 0), sDACounts(50, 0);
+    std::vector<std::vector<double>> finalIll(50, std::vector<double>(8760, 0));
+    std::ostringstream schedule;
+    for (unsigned i = 0; i < 8760; i++) {
+        std::vector<unsigned> sunlit(2, 0);
+        bool anyLight = false;
+        for (int g = 0; g < 2; g++) {
+            for (unsigned p = 0; p < 50; p++) {
+                sunlit[g] += direct[g].lux(p, i) > 300;
+                anyLight = anyLight || direct[g].lux(p, i) > 0;
+            }
+        }
+        std::vector<bool> shaded = anyLight ? stadic::sDAShadeCombination(sunlit, 50, 0.02) : std::vector<bool>(2, false);
+        schedule << direct[0].month(i) << " " << direct[0].day(i) << " " << direct[0].hour(i);
+        for (int g = 0; g < 2; g++) {
+            schedule << " " << (shaded[g] ? 1 : 0);
+        }
+        schedule << "\n";
+        for (unsigned p = 0; p < 50; p++) {
+            for (int g = 0; g < 2; g++) {
+                finalIll[p][i] += shaded[g] ? setting[g].lux(p, i) : base[g].lux(p, i);
+            }
+            if (hours.selected(i)) {
+                ASECounts[p] += direct[0].lux(p, i) + direct[1].lux(p, i) > 1000;
+                sDACounts[p] += finalIll[p][i] > 300;
+            }
+        }
+    }
+    std::ostringstream points;
+    int passing = 0;
+    for (int count : sDACounts) {
+        passing += count / double(hours.count()) > 0.5;
+    }
+    points << "area= 1200\npoints= 50\nsDA= " << passing / 50.0 << "\n";
+    for (int count : sDACounts) {
+        points << count / double(hours.count()) << "\n";
+    }
+
+    for (size_t budget : {0, 1}) {
+        stadic::BuildingControl model;
+        ASSERT_TRUE(model.parseJson("sdacontrol.json"));
+        EXPECT_FALSE(model.spaces()[0]->writesDAIll());
+        stadic::Metrics metrics(&model);
+        metrics.setMemoryBudget(budget);
+        ASSERT_TRUE(metrics.processMetrics());
+        EXPECT_FALSE(model.spaces()[0]->runsDA());
+        EXPECT_EQ("area= 1200\nASE= 0.2\n", fileText("sdacase/res/sda_ASE.res"));
+        EXPECT_EQ(schedule.str(), fileText("sdacase/res/sda_sDA_ShadeSchedule.res"));
+        EXPECT_EQ(points.str(), fileText("sdacase/res/sda_sDA_Points.res"));
+        EXPECT_FALSE(std::ifstream("sdacase/res/sda_sDA.ill").is_open());
+        EXPECT_FALSE(std::ifstream("sdacase/res/intermediateData/sda_WG1_base.scratch").is_open());
+    }
+
+    // The shaded illuminance is only written when asked for
+    writesDAControl("sdacontrol.json", "sdacase/", true);
+    stadic::BuildingControl model;
+    ASSERT_TRUE(model.parseJson("sdacontrol.json"));
+    EXPECT_TRUE(model.spaces()[0]->writesDAIll());
+    stadic::Metrics metrics(&model);
+    ASSERT_TRUE(metrics.processMetrics());
+    EXPECT_EQ(points.str(), fileText("sdacase/res/sda_sDA_Points.res"));
+    stadic::DaylightIlluminanceData written;
+    ASSERT_TRUE(written.parseTimeBased("sdacase/res/sda_sDA.ill"));
+    ASSERT_EQ(50, written.points());
+    ASSERT_EQ(8760, written.timesteps());
+    for (unsigned p = 0; p < 50; p += 7) {
+        for (unsigned i = 0; i < 8760; i += 13) {
+            EXPECT_NEAR(finalIll[p][i], written.lux(p, i), 1e-5 * finalIll[p][i]);
+        }
+    }
+}
+
+TEST(MetricsTests, IncrementalReuse)
+{
+    std::vector<std::string> directories = {"incrementalcase0/", "incrementalcase1/"};
+    std::vector<unsigned char> occupied;
+    for (unsigned i = 0; i < 2; i++) {
+        stadic::DaylightIlluminanceData data = annualData(i + 2, &occupied);
+        writeSpace(directories[i], data, occupied);
+        for (const char *metric : {"DA", "cDA", "UDI"}) {
+            std::remove((directories[i] + "res/test1_" + metric + ".fingerprint").c_str());
+        }
+    }
+    writeControl("incrementalcontrol.json", directories);
+    auto run = [](bool incremental, unsigned *computed, unsigned *reused) {
+        stadic::BuildingControl model;
+        ASSERT_TRUE(model.parseJson("incrementalcontrol.json"));
+        stadic::Metrics metrics(&model);
+        metrics.setIncremental(incremental);
+        ASSERT_TRUE(metrics.processMetrics());
+        for (size_t i = 0; i < model.spaces().size(); i++) {
+            EXPECT_FALSE(model.spaces()[i]->runDA());
+            EXPECT_FALSE(model.spaces()[i]->runUDI());
+        }
+        *computed = metrics.computedMetrics();
+        *reused = metrics.reusedMetrics();
+    };
+
+    // DA, cDA and UDI of both spaces, then all of them again from the fingerprints
+    unsigned computed, reused;
+    run(true, &computed, &reused);
+    EXPECT_EQ(6, computed);
+    EXPECT_EQ(0, reused);
+    EXPECT_TRUE(stadic::isFile("incrementalcase0/res/test1_DA.fingerprint"));
+    run(true, &computed, &reused);
+    EXPECT_EQ(0, computed);
+    EXPECT_EQ(6, reused);
+
+    // A new simulation of one space only repeats the metrics of that space
+    stadic::DaylightIlluminanceData data = annualData(7, &occupied);
+    ASSERT_TRUE(data.writeIllFileLux("incrementalcase1/res/test1.ill"));
+    run(true, &computed, &reused);
+    EXPECT_EQ(3, computed);
+    EXPECT_EQ(3, reused);
+    checkSpace("incrementalcase1/", data, occupied);
+
+    // The same simulation changed in place, most likely within the same second
+    {
+        std::fstream ill("incrementalcase1/res/test1.ill", std::ios::in | std::ios::out | std::ios::binary);
+        ill.seekg(-2, std::ios::end);
+        char digit = char(ill.get());
+        ill.seekp(-2, std::ios::end);
+        ill.put(digit == '9' ? '8' : char(digit + 1));
+    }
+    run(true, &computed, &reused);
+    EXPECT_EQ(3, computed);
+    EXPECT_EQ(3, reused);
+
+    // A missing result is calculated again, and nothing is reused unless asked for
+    std::remove("incrementalcase0/res/test1_DA.res");
+    run(true, &computed, &reused);
+    EXPECT_EQ(1, computed);
+    EXPECT_EQ(5, reused);
+    checkSpace("incrementalcase0/", annualData(2, &occupied), occupied);
+    run(false, &computed, &reused);
+    EXPECT_EQ(6, computed);
+    EXPECT_EQ(0, reused);
+
+    // An unreadable simulation is neither used nor fingerprinted, and the
+    // other spaces are still processed
+    std::ofstream("incrementalcase0/res/test1.ill") << "1 1 0.5 10 x\n";
+    stadic::BuildingControl model;
+    ASSERT_TRUE(model.parseJson("incrementalcontrol.json"));
+    stadic::Metrics metrics(&model);
+    metrics.setIncremental(true);
+    ASSERT_TRUE(metrics.processMetrics());
+    EXPECT_TRUE(model.spaces()[0]->runDA());
+    EXPECT_FALSE(stadic::isFile("incrementalcase0/res/test1_DA.fingerprint"));
+    EXPECT_FALSE(model.spaces()[1]->runDA());
+    EXPECT_EQ(3, metrics.computedMetrics());
+
+#ifdef __linux__
+    // A result that cannot be written out in full is not fingerprinted either
+    std::remove("incrementalcase1/res/test1_DA.fingerprint");
+    std::remove("incrementalcase1/res/test1_DA.res");
+    ASSERT_EQ(0, symlink("/dev/full", "incrementalcase1/res/test1_DA.res"));
+    stadic::BuildingControl full;
+    ASSERT_TRUE(full.parseJson("incrementalcontrol.json"));
+    stadic::Metrics fullMetrics(&full);
+    fullMetrics.setIncremental(true);
+    ASSERT_TRUE(fullMetrics.processMetrics());
+    EXPECT_TRUE(full.spaces()[1]->runDA());
+    EXPECT_FALSE(full.spaces()[1]->runUDI());
+    EXPECT_FALSE(stadic::isFile("incrementalcase1/res/test1_DA.fingerprint"));
+    std::remove("incrementalcase1/res/test1_DA.res");
+#endif
+}
+
+TEST(MetricsTests, ParallelSpaces)
+{
+    std::vector<std::string> directories;
+    std::vector<stadic::DaylightIlluminanceData> spaces;
+    std::vector<unsigned char> occupied;
+    for (unsigned i = 0; i < 5; i++) {
+        directories.push_back("parallelcase" + std::to_string(i) + "/");
+        spaces.push_back(annualData(i + 1, &occupied));
+        // Each space gets its own occupancy
+        for (unsigned j = 0; j < occupied.size(); j++) {
+            occupied[j] = occupied[j] && (j / 24) % (i + 2) != 0;
+        }
+        writeSpace(directories.back(), spaces.back(), occupied);
+    }
+    writeControl("parallelcontrol.json", directories);
+
+    stadic::BuildingControl model;
+    ASSERT_TRUE(model.parseJson("parallelcontrol.json"));
+    stadic::Metrics metrics(&model);
+    metrics.setThreads(4);
+    ASSERT_TRUE(metrics.processMetrics());
+    for (unsigned i = 0; i < 5; i++) {
+        annualData(i + 1, &occupied);
+        for (unsigned j = 0; j < occupied.size(); j++) {
+            occupied[j] = occupied[j] && (j / 24) % (i + 2) != 0;
+        }
+        checkSpace(directories[i], spaces[i], occupied);
+        EXPECT_FALSE(model.spaces()[i]->runDA());
+        EXPECT_FALSE(model.spaces()[i]->runcDA());
+        EXPECT_FALSE(model.spaces()[i]->runUDI());
+    }
+
+    // A space missing its occupancy schedule fails, and is reported after the spaces before it
+    writeSpace("parallelmissing/", spaces[0], occupied);
+    std::remove("parallelmissing/data/8to6.csv");
+    directories.push_back("parallelmissing/");
+    writeControl("parallelcontrol.json", directories);
+    stadic::BuildingControl failing;
+    ASSERT_TRUE(failing.parseJson("parallelcontrol.json"));
+    stadic::Metrics failingMetrics(&failing);
+    failingMetrics.setThreads(0);
+    EXPECT_THROW(failingMetrics.processMetrics(), std::runtime_error);
+}
+
+TEST(MetricsTests, LogCapture)
+{
+    EXPECT_EQ(nullptr, stadic::LogCapture::current());
+    {
+        stadic::LogCapture outer;
+        STADIC_WARNING("first");
+        {
+            stadic::LogCapture inner;
+            EXPECT_EQ(&inner, stadic::LogCapture::current());
+            STADIC_LOG(stadic::Severity::Info, "second");
+            EXPECT_EQ("INFO: second\n", inner.text());
+        }
+        EXPECT_EQ(&outer, stadic::LogCapture::current());
+        STADIC_ERROR("third");
+        EXPECT_EQ("WARNING: first\nERROR: third\n", outer.text());
+    }
+    EXPECT_EQ(nullptr, stadic::LogCapture::current());
+}
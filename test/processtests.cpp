@@ -30,10 +30,12 @@
 
 #include "stadicprocess.h"
 #include "functions.h"
+#include "filepath.h"
 #include "gtest/gtest.h"
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
 #ifdef _WIN32
 #include <Windows.h>
 #else
@@ -55,6 +57,13 @@ std::string readFileToString(const std::string &filename)
     UNLINK("");
 }
 
+std::string readErrorString(const stadic::Process &proc)
+{
+    std::string string = proc.error();
+    string.erase(std::remove_if(string.begin(), string.end(), ::iscntrl), string.end());
+    return stadic::trim(string);
+}
+
 TEST(ProcessTests, ProcessBadProgram)
 {
     stadic::Process proc("ThisIsHopefullyNotAProgramName");
@@ -93,7 +102,7 @@ TEST(ProcessTests, ProcessProgramArgs)
     stadic::Process proc("cmd", args);
 #else
     std::vector<std::string> args;
-    args.push_back("+\"%a %F\"");
+    args.push_back("+%a %F");
     stadic::Process proc("date", args);
     time_t result = time(NULL);
     struct tm *current = localtime(&result);
@@ -162,22 +171,232 @@ TEST(ProcessTests, ProcessAppendFileOutErr)
   UNLINK("error.txt");
 }
 
-/*
 TEST(ProcessTests, ProcessCaptureOutErr)
 {
     stadic::Process proc(PROGRAM);
-    proc.setStandardErrorFile("error.txt");
     proc.setStandardOutputFile("output.txt");
     proc.start();
     ASSERT_TRUE(proc.wait());
-    std::string output = stadic::trim(proc.output());
+    std::string output = readFileToString("output.txt");
     std::string error = stadic::trim(proc.error());
     EXPECT_EQ("This is the standard output", output);
     EXPECT_EQ("This is the standard error", error);
+    EXPECT_EQ(0, proc.exitCode());
+    UNLINK("output.txt");
+}
+
+#ifndef _WIN32
+TEST(ProcessTests, ProcessExitCode)
+{
+    std::vector<std::string> args;
+    args.push_back("-e");
+    args.push_back("3");
+    stadic::Process proc(PROGRAM, args);
+    EXPECT_EQ(-1, proc.exitCode());
+    proc.start();
+    EXPECT_FALSE(proc.wait());
+    EXPECT_EQ(stadic::Process::RunFailed, proc.state());
+    EXPECT_EQ(3, proc.exitCode());
+    EXPECT_EQ("Exiting with 3", stadic::trim(proc.error()));
+
+    stadic::Process bad("ThisIsHopefullyNotAProgramName");
+    bad.start();
+    EXPECT_FALSE(bad.wait());
+    EXPECT_FALSE(bad.error().empty());
+}
+
+TEST(ProcessTests, ProcessPipeErrors)
+{
+    std::ofstream out("input.txt");
+    out << "first" << std::endl;
+    out << "STOP" << std::endl;
+    out.close();
+
+    // Each process of the pipeline keeps its own standard error and exit code
+    std::vector<std::string> args;
+    args.push_back("-R");
+    stadic::Process proc0(PROGRAM, args);
+    proc0.setStandardInputFile("input.txt");
+    stadic::Process proc1(PROGRAM, args);
+    stadic::Process proc2(PROGRAM, args);
+    proc0.setStandardOutputProcess(&proc1);
+    proc1.setStandardOutputProcess(&proc2);
+    proc2.setStandardErrorFile("error.txt");
+    proc2.setStandardOutputFile("output.txt");
+    proc0.start();
+    EXPECT_TRUE(proc2.wait());
+    EXPECT_TRUE(proc0.wait());
+    EXPECT_TRUE(proc1.wait());
+    EXPECT_EQ("Error:firstError:STOP", readErrorString(proc0));
+    EXPECT_EQ("Error:Input:firstError:Input:STOP", readErrorString(proc1));
+    EXPECT_TRUE(proc2.error().empty());
+    EXPECT_EQ("Error:Input:Input:firstError:Input:Input:STOP", readFileToString("error.txt"));
+    EXPECT_EQ("Input:Input:Input:firstInput:Input:Input:STOP", readFileToString("output.txt"));
+    EXPECT_EQ(0, proc1.exitCode());
+    EXPECT_EQ(0, proc2.exitCode());
+    UNLINK("input.txt");
     UNLINK("output.txt");
     UNLINK("error.txt");
 }
-*/
+
+TEST(ProcessTests, ProcessStartReturnsAtOnce)
+{
+    std::vector<std::string> args;
+    args.push_back("-s");
+    args.push_back("500");
+    stadic::Process proc(PROGRAM, args);
+    proc.setStandardOutputFile("output.txt");
+    EXPECT_FALSE(proc.waitFor(0));
+    proc.start();
+    EXPECT_FALSE(proc.waitFor(10));
+    EXPECT_TRUE(proc.waitFor(10000));
+    EXPECT_TRUE(proc.wait());
+    EXPECT_EQ("Slept 500", readFileToString("output.txt"));
+    UNLINK("output.txt");
+}
+
+TEST(ProcessTests, ProcessGroupWaitAny)
+{
+    // The processes are collected in the order that they finish
+    std::vector<std::string> slow = { "-s", "600" };
+    std::vector<std::string> fast = { "-s", "50" };
+    std::vector<std::string> fails = { "-e", "1" };
+    stadic::Process proc0(PROGRAM, slow);
+    stadic::Process proc1(PROGRAM, fast);
+    stadic::Process proc2(PROGRAM, fails);
+    proc0.setStandardOutputFile("output0.txt");
+    proc1.setStandardOutputFile("output1.txt");
+    stadic::ProcessGroup group;
+    group.add(&proc0);
+    group.add(&proc1);
+    EXPECT_EQ(2, group.size());
+    EXPECT_EQ(&proc1, group.waitAny());
+    EXPECT_EQ(&proc0, group.waitAny());
+    EXPECT_TRUE(group.empty());
+    EXPECT_TRUE(group.waitAny() == nullptr);
+    EXPECT_TRUE(proc0.wait());
+    EXPECT_TRUE(proc1.wait());
+
+    stadic::Process proc3(PROGRAM, fast);
+    proc3.setStandardOutputFile("output1.txt");
+    group.add(&proc2);
+    group.add(&proc3);
+    EXPECT_FALSE(group.waitAll());
+    EXPECT_EQ(1, proc2.exitCode());
+    EXPECT_TRUE(proc3.wait());
+    UNLINK("output0.txt");
+    UNLINK("output1.txt");
+}
+
+TEST(ProcessTests, ProcessMaxRunning)
+{
+    // With one program allowed at a time, the second waits for the first
+    stadic::Process::setMaxRunning(1);
+    EXPECT_EQ(1, stadic::Process::maxRunning());
+    std::vector<std::string> args = { "-s", "300" };
+    stadic::Process proc0(PROGRAM, args);
+    stadic::Process proc1(PROGRAM, args);
+    proc0.setStandardOutputFile("output0.txt");
+    proc1.setStandardOutputFile("output1.txt");
+    auto begin = std::chrono::steady_clock::now();
+    proc0.start();
+    proc1.start();
+    EXPECT_TRUE(proc0.wait());
+    EXPECT_TRUE(proc1.wait());
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    EXPECT_GE(elapsed.count(), 600);
+    stadic::Process::setMaxRunning(0);
+    UNLINK("output0.txt");
+    UNLINK("output1.txt");
+}
+
+TEST(ProcessTests, ProcessArgumentsWithSpaces)
+{
+    // Arguments and file names reach the program as they are, without a shell
+    std::vector<std::string> args;
+    args.push_back("-w");
+    args.push_back("two words $HOME '*'");
+    stadic::Process proc(PROGRAM, args);
+    proc.setStandardOutputFile("output file.txt");
+    proc.start();
+    ASSERT_TRUE(proc.wait());
+    EXPECT_EQ("two words $HOME '*'", readFileToString("output file.txt"));
+    EXPECT_EQ(std::string(PROGRAM) + " -w 'two words $HOME '*'' > 'output file.txt'", proc.commandLine());
+    UNLINK("output file.txt");
+}
+#endif
+
+TEST(ProcessTests, PartitionedProcessMatchesSingleRun)
+{
+    std::ofstream out("points.txt", std::ios::binary);
+    for(int i = 0; i < 1000; i++) {
+        out << i << " 0.5 0.76 0 0 1" << std::endl;
+    }
+    out << "1000 0.5 0.76 0 0 1";
+    out.close();
+
+    std::vector<std::string> args;
+    args.push_back("-H");
+    stadic::Process single(PROGRAM, args);
+    single.setStandardInputFile("points.txt");
+    single.setStandardOutputFile("single.txt");
+    single.start();
+    ASSERT_TRUE(single.wait());
+
+    stadic::PartitionedProcess proc(PROGRAM, args);
+    proc.setMaxPartitions(4);
+    proc.setStandardInputFile("points.txt");
+    proc.setStandardOutputFile("output.txt");
+    EXPECT_EQ(std::string(PROGRAM) + " -H < points.txt > output.txt", proc.commandLine());
+    proc.start();
+    ASSERT_TRUE(proc.wait());
+    EXPECT_EQ(4, proc.partitions());
+
+    // The joined output has one header and the lines in order
+    std::ifstream singleStream("single.txt", std::ios::binary);
+    std::string expected((std::istreambuf_iterator<char>(singleStream)), std::istreambuf_iterator<char>());
+    std::ifstream outputStream("output.txt", std::ios::binary);
+    std::string output((std::istreambuf_iterator<char>(outputStream)), std::istreambuf_iterator<char>());
+    singleStream.close();
+    outputStream.close();
+    EXPECT_EQ(expected, output);
+    EXPECT_FALSE(stadic::exists("output.txt.part0"));
+    EXPECT_FALSE(stadic::exists("output.txt.part0.in"));
+
+    // Waiting again leaves the joined output alone
+    ASSERT_TRUE(proc.wait());
+    outputStream.open("output.txt", std::ios::binary);
+    EXPECT_EQ(expected, std::string((std::istreambuf_iterator<char>(outputStream)), std::istreambuf_iterator<char>()));
+    outputStream.close();
+    UNLINK("single.txt");
+    UNLINK("output.txt");
+    UNLINK("points.txt");
+}
+
+TEST(ProcessTests, PartitionedProcessCount)
+{
+    // Small inputs are not split, large ones use at most the cores
+    EXPECT_EQ(1, stadic::PartitionedProcess::partitionCount(0, 16));
+    EXPECT_EQ(1, stadic::PartitionedProcess::partitionCount(60, 16));
+    EXPECT_EQ(4, stadic::PartitionedProcess::partitionCount(200, 16));
+    EXPECT_EQ(16, stadic::PartitionedProcess::partitionCount(10000, 16));
+    EXPECT_EQ(1, stadic::PartitionedProcess::partitionCount(10000, 1));
+
+    // Options that change the layout of the output are not split
+    EXPECT_TRUE(stadic::PartitionedProcess::splittable({ "-ab", "2", "-ad", "1000" }));
+    EXPECT_FALSE(stadic::PartitionedProcess::splittable({ "-ab", "2", "-y", "100" }));
+    EXPECT_FALSE(stadic::PartitionedProcess::splittable({ "-h", "-ab", "2" }));
+    EXPECT_FALSE(stadic::PartitionedProcess::splittable({ "-o", "out%s.dat" }));
+
+    std::vector<std::string> args = { "-e", "3" };
+    stadic::PartitionedProcess proc(PROGRAM, args);
+    proc.setStandardInputFile("ThisFileDoesNotExist.txt");
+    proc.setStandardOutputFile("output.txt");
+    proc.start();
+    EXPECT_FALSE(proc.wait());
+    EXPECT_FALSE(proc.error().empty());
+    UNLINK("output.txt");
+}
 
 TEST(ProcessTests, ProcessCaptureBigOut)
 {
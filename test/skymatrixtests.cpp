@@ -0,0 +1,110 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "skymatrixcache.h"
+#include "gtest/gtest.h"
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define PROGRAM "testprogram"
+#else
+#define PROGRAM "./testprogram"
+#endif
+
+static std::string firstLine(const std::string &fileName)
+{
+    std::ifstream stream(fileName);
+    std::string line;
+    std::getline(stream, line);
+    return line;
+}
+
+TEST(SkyMatrixCacheTests, SameArgumentsRunOnce)
+{
+    stadic::SkyMatrixCache cache(PROGRAM);
+    std::vector<std::string> sun = { "-w", "sun matrix" };
+    std::vector<std::string> sky = { "-w", "sky matrix" };
+    std::string first = cache.matrix("building_d", sun);
+    std::string second = cache.matrix("building_d", sun);
+    EXPECT_EQ("building_d.smx", first);
+    EXPECT_EQ(first, second);
+    // Different arguments under the same name get a file of their own
+    std::string other = cache.matrix("building_d", sky);
+    EXPECT_EQ("building_d2.smx", other);
+    EXPECT_EQ(2, cache.runs());
+    ASSERT_TRUE(cache.wait(first));
+    ASSERT_TRUE(cache.wait(other));
+    EXPECT_EQ("sun matrix", firstLine(first));
+    EXPECT_EQ("sky matrix", firstLine(other));
+    remove(first.c_str());
+    remove(other.c_str());
+}
+
+TEST(SkyMatrixCacheTests, ThreadsShareOneRun)
+{
+    stadic::SkyMatrixCache cache(PROGRAM);
+    std::vector<std::string> args = { "-s", "200" };
+    std::vector<std::string> files(8);
+    std::vector<char> results(8, 0);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < files.size(); i++) {
+        threads.push_back(std::thread([&, i]() {
+            files[i] = cache.matrix("building_k", args);
+            results[i] = cache.wait(files[i]);
+        }));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(1, cache.runs());
+    for (unsigned i = 0; i < files.size(); i++) {
+        EXPECT_EQ("building_k.smx", files[i]);
+        EXPECT_TRUE(results[i]);
+    }
+    EXPECT_EQ("Slept 200", firstLine("building_k.smx"));
+    remove("building_k.smx");
+}
+
+TEST(SkyMatrixCacheTests, FailureReachesEveryRequest)
+{
+    stadic::SkyMatrixCache cache(PROGRAM);
+    std::vector<std::string> args = { "-e", "2" };
+    std::string file = cache.matrix("building_kd", args);
+    EXPECT_FALSE(cache.wait(file));
+    EXPECT_FALSE(cache.wait(cache.matrix("building_kd", args)));
+    EXPECT_EQ(1, cache.runs());
+    EXPECT_NE(std::string::npos, cache.error(file).find("Exiting with 2"));
+    EXPECT_FALSE(cache.wait("ThisMatrixWasNeverAskedFor.smx"));
+    remove(file.c_str());
+}
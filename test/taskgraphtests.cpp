@@ -0,0 +1,152 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "taskgraph.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(TaskGraphTests, FilesOrderTasks)
+{
+    stadic::TaskGraph graph;
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&](const std::string &name) {
+        return [&, name]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(name);
+            return true;
+        };
+    };
+    unsigned sum = graph.addTask("sum", {"a.txt", "b.txt"}, {"sum.txt"}, record("sum"));
+    unsigned a = graph.addTask("a", {"input.txt"}, {"a.txt"}, record("a"));
+    unsigned b = graph.addTask("b", {"input.txt"}, {"b.txt"}, record("b"));
+    unsigned total = graph.addTask("total", {"a.txt", "b.txt"}, {"total.txt"}, record("total"));
+    // Only tasks added earlier are waited for
+    EXPECT_TRUE(graph.prerequisites(sum).empty());
+    EXPECT_TRUE(graph.prerequisites(a).empty());
+    ASSERT_EQ(2, graph.prerequisites(total).size());
+    EXPECT_EQ(a, graph.prerequisites(total)[0]);
+    EXPECT_EQ(b, graph.prerequisites(total)[1]);
+
+    ASSERT_TRUE(graph.run(4));
+    ASSERT_EQ(4, order.size());
+    EXPECT_EQ("total", order[3]);
+    for (unsigned i = 0; i < graph.size(); i++) {
+        EXPECT_EQ(stadic::TaskGraph::Succeeded, graph.state(i));
+    }
+}
+
+TEST(TaskGraphTests, FailureCancelsDependents)
+{
+    stadic::TaskGraph graph;
+    std::atomic<int> runs(0);
+    unsigned suns = graph.addTask("suns", {}, {"suns.rad"}, [&]() { runs++; return false; });
+    unsigned group = graph.addTask("group", {"suns.rad"}, {"group.ill"}, [&]() { runs++; return true; });
+    unsigned sum = graph.addTask("sum", {"group.ill"}, {}, [&]() { runs++; return true; });
+    unsigned other = graph.addTask("other", {}, {"other.ill"}, [&]() { runs++; return true; });
+    EXPECT_FALSE(graph.run(1));
+    EXPECT_EQ(stadic::TaskGraph::Failed, graph.state(suns));
+    EXPECT_EQ(stadic::TaskGraph::Cancelled, graph.state(group));
+    EXPECT_EQ(stadic::TaskGraph::Cancelled, graph.state(sum));
+    // Independent work still runs unless asked otherwise
+    EXPECT_EQ(stadic::TaskGraph::Succeeded, graph.state(other));
+    EXPECT_EQ(2, runs);
+}
+
+TEST(TaskGraphTests, CancelOnFailure)
+{
+    stadic::TaskGraph graph;
+    graph.setCancelOnFailure(true);
+    std::atomic<int> runs(0);
+    graph.addTask("first", {}, {"first.txt"}, [&]() { runs++; return false; });
+    for (int i = 0; i < 10; i++) {
+        graph.addTask("later" + std::to_string(i), {}, {}, [&]() { runs++; return true; });
+    }
+    EXPECT_FALSE(graph.run(1));
+    EXPECT_EQ(1, runs);
+    for (unsigned i = 1; i < graph.size(); i++) {
+        EXPECT_EQ(stadic::TaskGraph::Cancelled, graph.state(i));
+    }
+}
+
+TEST(TaskGraphTests, ExceptionFailsTask)
+{
+    stadic::TaskGraph graph;
+    unsigned bad = graph.addTask("bad", {}, {"bad.txt"}, []() -> bool { throw std::runtime_error("The program failed."); });
+    unsigned after = graph.addTask("after", {"bad.txt"}, {}, []() { return true; });
+    EXPECT_FALSE(graph.run(2));
+    EXPECT_EQ(stadic::TaskGraph::Failed, graph.state(bad));
+    EXPECT_EQ("The program failed.", graph.error(bad));
+    EXPECT_EQ(stadic::TaskGraph::Cancelled, graph.state(after));
+}
+
+TEST(TaskGraphTests, CancelFromTask)
+{
+    stadic::TaskGraph graph;
+    std::atomic<int> runs(0);
+    graph.addTask("first", {}, {"first.txt"}, [&]() { runs++; graph.cancel(); return true; });
+    graph.addTask("second", {"first.txt"}, {}, [&]() { runs++; return true; });
+    EXPECT_FALSE(graph.run(2));
+    EXPECT_EQ(1, runs);
+    EXPECT_EQ(stadic::TaskGraph::Succeeded, graph.state(0));
+    EXPECT_EQ(stadic::TaskGraph::Cancelled, graph.state(1));
+}
+
+TEST(TaskGraphTests, JobsLimitConcurrency)
+{
+    for (unsigned jobs : {1, 3}) {
+        stadic::TaskGraph graph;
+        std::atomic<int> running(0);
+        std::atomic<int> most(0);
+        for (int i = 0; i < 9; i++) {
+            graph.addTask("task" + std::to_string(i), {}, {}, [&]() {
+                int now = ++running;
+                int seen = most;
+                while (now > seen && !most.compare_exchange_weak(seen, now)) {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                running--;
+                return true;
+            });
+        }
+        ASSERT_TRUE(graph.run(jobs));
+        EXPECT_LE(most, int(jobs));
+        if (jobs == 1) {
+            EXPECT_EQ(1, most);
+        } else {
+            EXPECT_GT(most, 1);
+        }
+    }
+}
@@ -28,8 +28,10 @@
  * SUCH DAMAGE.
  *****************************************************************************/
 
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <thread>
 
 // This is a test program for testing the Process object. It should be replaced later
 // with using one of the other real programs, but this will do for now.
@@ -60,6 +62,14 @@ int main(int argc, char *argv[])
                     break;
                 }
             }
+        } else if(std::string("-H") == argv[1]) {
+            // A Radiance header ahead of the lines, like rcontrib writes
+            std::cout << "#?RADIANCE" << std::endl << "testprogram -H" << std::endl;
+            std::cout << "FORMAT=ascii" << std::endl << std::endl;
+            std::string string;
+            while(std::getline(std::cin, string)) {
+                std::cout << "Input:" << string << std::endl;
+            }
         } else if(std::string("-d") == argv[1]) {
             std::string string;
             while(std::getline(std::cin, string)) {
@@ -73,6 +83,16 @@ int main(int argc, char *argv[])
             }
             std::cout << "STOP";
         }
+    } else if(argc == 3) {
+        if(std::string("-e") == argv[1]) {
+            std::cerr << "Exiting with " << argv[2] << std::endl;
+            return std::stoi(argv[2]);
+        } else if(std::string("-w") == argv[1]) {
+            std::cout << argv[2] << std::endl;
+        } else if(std::string("-s") == argv[1]) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::stoi(argv[2])));
+            std::cout << "Slept " << argv[2] << std::endl;
+        }
     }
 
     return 0;
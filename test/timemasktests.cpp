@@ -0,0 +1,170 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "timemask.h"
+#include "dayill.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+// An hourly time axis over a whole year
+static stadic::DaylightIlluminanceData annualAxis()
+{
+    int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    std::vector<int> month;
+    std::vector<int> day;
+    std::vector<double> hour;
+    for (int m = 0; m < 12; m++) {
+        for (int d = 1; d <= daysInMonth[m]; d++) {
+            for (int h = 0; h < 24; h++) {
+                month.push_back(m + 1);
+                day.push_back(d);
+                hour.push_back(h + 0.5);
+            }
+        }
+    }
+    stadic::DaylightIlluminanceData axis;
+    axis.setTimeAxis(month, day, hour);
+    return axis;
+}
+
+// Timestep of an hour of the year
+static unsigned timestep(int dayOfYear, int hour)
+{
+    return 24 * dayOfYear + hour;
+}
+
+TEST(TimeMaskTests, BitsAndIndices)
+{
+    std::vector<unsigned char> bytes(130, 0);
+    bytes[0] = 1;
+    bytes[63] = 1;
+    bytes[64] = 1;
+    bytes[129] = 1;
+    stadic::TimeMask mask(bytes);
+    ASSERT_EQ(130, mask.timesteps());
+    ASSERT_EQ(4, mask.count());
+    EXPECT_EQ(std::vector<unsigned>({0, 63, 64, 129}), mask.indices());
+    ASSERT_EQ(3, mask.words().size());
+    EXPECT_EQ(0x8000000000000001ull, mask.words()[0]);
+    EXPECT_EQ(1, mask.words()[1]);
+    EXPECT_EQ(2, mask.words()[2]);
+    EXPECT_TRUE(mask.selected(63));
+    EXPECT_FALSE(mask.selected(62));
+    EXPECT_FALSE(mask.selected(130));
+    EXPECT_EQ(bytes, mask.bytes());
+
+    // The complement leaves the bits past the end clear
+    stadic::TimeMask inverse = ~mask;
+    EXPECT_EQ(126, inverse.count());
+    EXPECT_EQ(128, inverse.indices().back());
+    stadic::TimeMask all = mask;
+    all |= inverse;
+    EXPECT_EQ(130, all.count());
+    all &= mask;
+    EXPECT_EQ(mask.indices(), all.indices());
+    EXPECT_EQ(130, stadic::TimeMask(130, true).count());
+    EXPECT_EQ(0, stadic::TimeMask(130).count());
+
+    // Occupancy shorter than the time axis leaves the rest unoccupied
+    std::vector<bool> occupancy = {true, false, true};
+    stadic::TimeMask occupied(occupancy, 5);
+    EXPECT_EQ(5, occupied.timesteps());
+    EXPECT_EQ(std::vector<unsigned>({0, 2}), occupied.indices());
+
+    // An hourly schedule covers every timestep of a sub-hourly axis
+    stadic::TimeMask quarterHours(occupancy, 13, 4);
+    EXPECT_EQ(13, quarterHours.timesteps());
+    EXPECT_EQ(std::vector<unsigned>({0, 1, 2, 3, 8, 9, 10, 11}), quarterHours.indices());
+}
+
+TEST(TimeMaskTests, CalendarFilters)
+{
+    stadic::DaylightIlluminanceData axis = annualAxis();
+
+    stadic::TimeMask window = stadic::TimeMask::hourWindow(axis, 8, 17);
+    EXPECT_EQ(365 * 9, window.count());
+    EXPECT_TRUE(window.selected(timestep(0, 8)));
+    EXPECT_FALSE(window.selected(timestep(0, 17)));
+
+    // A season may run past the end of the year
+    stadic::TimeMask winter = stadic::TimeMask::months(axis, 12, 2);
+    EXPECT_EQ(24 * (31 + 31 + 28), winter.count());
+    EXPECT_EQ(24 * (31 + 30 + 31), stadic::TimeMask::months(axis, 6, 8).count());
+
+    // January 1 2013 was a Tuesday
+    stadic::TimeMask weekdays = stadic::TimeMask::weekdays(axis, 3);
+    EXPECT_EQ(24 * 261, weekdays.count());
+    EXPECT_TRUE(weekdays.selected(timestep(0, 12)));
+    EXPECT_FALSE(weekdays.selected(timestep(4, 12)));
+    EXPECT_FALSE(weekdays.selected(timestep(5, 12)));
+    EXPECT_TRUE(weekdays.selected(timestep(6, 12)));
+
+    // In 2013 daylight savings time ran from March 10 to November 3
+    stadic::TimeMask summer = stadic::TimeMask::daylightSavings(axis, 3);
+    EXPECT_FALSE(summer.selected(timestep(68, 1)));
+    EXPECT_TRUE(summer.selected(timestep(68, 2)));
+    EXPECT_TRUE(summer.selected(timestep(306, 0)));
+    EXPECT_FALSE(summer.selected(timestep(306, 1)));
+    EXPECT_EQ(24 * (306 - 68) - 2 + 1, summer.count());
+
+    // The analysis window is read on the clock, an hour ahead in the summer
+    stadic::TimeMask clock = stadic::TimeMask::hourWindow(axis, 8, 17, &summer);
+    EXPECT_EQ(365 * 9, clock.count());
+    EXPECT_TRUE(clock.selected(timestep(180, 7)));
+    EXPECT_FALSE(clock.selected(timestep(180, 16)));
+    EXPECT_TRUE(clock.selected(timestep(0, 16)));
+
+    stadic::TimeMask combined = window;
+    combined &= weekdays;
+    combined &= winter;
+    for (unsigned i : combined.indices()) {
+        EXPECT_TRUE(window.selected(i) && weekdays.selected(i) && winter.selected(i));
+    }
+}
+
+TEST(TimeMaskTests, StoredTimesteps)
+{
+    std::vector<int> month = {1, 1, 1, 1, 1};
+    std::vector<int> day = {1, 1, 1, 1, 1};
+    std::vector<double> hour = {0.5, 1.5, 2.5, 3.5, 4.5};
+    stadic::DaylightIlluminanceData data;
+    data.setTimeAxis(month, day, hour);
+    data.resize(1);
+    double values[] = {0, 5, 0, 7, 9};
+    std::copy(values, values + 5, data.pointData(0));
+    stadic::TimeMask mask(std::vector<unsigned char>({1, 1, 1, 0, 1}));
+    EXPECT_EQ(mask.indices(), mask.stored(data).indices());
+
+    data.elideDarkTimesteps();
+    stadic::TimeMask stored = mask.stored(data);
+    ASSERT_EQ(3, stored.timesteps());
+    EXPECT_EQ(std::vector<unsigned>({0, 2}), stored.indices());
+    EXPECT_EQ(data.storedMask(mask.bytes()), stored.bytes());
+}
@@ -32,6 +32,7 @@
 #include <fstream>
 #include <string>
 #include "functions.h"
+#include <vector>
 
 TEST(WeatherTests, ReadEpw)
 {
@@ -52,6 +53,74 @@ TEST(WeatherTests, ReadEpw)
   EXPECT_EQ("67",data.diffuseHorizontal()[710]);
 }
 
+TEST(WeatherTests, ReadSubHourlyEpw)
+{
+  // Repeat each hour of the Lancaster file as four 15 minute intervals
+  std::ifstream hourly("USA_PA_Lancaster.AP.725116_TMY3.epw");
+  ASSERT_TRUE(hourly.is_open());
+  std::ofstream quarter("Lancaster15.epw");
+  ASSERT_TRUE(quarter.is_open());
+  std::string line;
+  for (int i = 0; i < 8 && std::getline(hourly, line); i++) {
+    if (i == 7) {
+      line = "DATA PERIODS,1,4,Data,Sunday, 1/ 1,12/31";
+    }
+    quarter << line << std::endl;
+  }
+  while (std::getline(hourly, line)) {
+    std::vector<std::string> vals = stadic::split(line, ',');
+    for (int i = 0; i < 4; i++) {
+      vals[4] = stadic::toString(15 * (i + 1));
+      quarter << vals[0];
+      for (int j = 1; j < vals.size(); j++) {
+        quarter << ',' << vals[j];
+      }
+      quarter << std::endl;
+    }
+  }
+  quarter.close();
+
+  stadic::WeatherData data;
+  ASSERT_TRUE(data.parseWeather("Lancaster15.epw"));
+  EXPECT_EQ(4, data.intervalsPerHour());
+  ASSERT_EQ(35040, data.timesteps());
+  ASSERT_EQ(35040, data.julianDate().size());
+  ASSERT_EQ(35040, data.directIlluminance().size());
+  EXPECT_EQ(1, data.month()[4 * 710 + 2]);
+  EXPECT_EQ(30, data.day()[4 * 710 + 2]);
+  EXPECT_EQ(14.625, data.hour()[4 * 710 + 2]);
+  EXPECT_EQ("0", data.directNormal()[4 * 710 + 2]);
+  EXPECT_EQ(30, data.julianDate()[4 * 710]);
+  EXPECT_EQ(365, data.julianDate().back());
+  EXPECT_EQ(0.125, data.hour()[0]);
+
+  // Each interval sees the sun at its own time, so the midday intervals of a
+  // clear hour differ from each other
+  stadic::WeatherData hourlyData;
+  ASSERT_TRUE(hourlyData.parseWeather("USA_PA_Lancaster.AP.725116_TMY3.epw"));
+  EXPECT_EQ(1, hourlyData.intervalsPerHour());
+  EXPECT_EQ(8760, hourlyData.timesteps());
+  EXPECT_EQ(30, hourlyData.julianDate()[710]);
+  EXPECT_NE(data.directIlluminance()[4 * 9 + 1], data.directIlluminance()[4 * 9 + 2]);
+}
+
+TEST(WeatherTests, CacheParsesOnce)
+{
+  stadic::WeatherCache::clear();
+  std::shared_ptr<const stadic::WeatherData> first = stadic::WeatherCache::weatherData("USA_PA_Lancaster.AP.725116_TMY3.epw");
+  ASSERT_TRUE(first != nullptr);
+  ASSERT_EQ(8760, first->hour().size());
+  EXPECT_EQ(14.5, first->hour()[710]);
+  // The second request is answered from the cache
+  EXPECT_EQ(first.get(), stadic::WeatherCache::weatherData("USA_PA_Lancaster.AP.725116_TMY3.epw").get());
+  stadic::WeatherCache::clear();
+  std::shared_ptr<const stadic::WeatherData> second = stadic::WeatherCache::weatherData("USA_PA_Lancaster.AP.725116_TMY3.epw");
+  ASSERT_TRUE(second != nullptr);
+  EXPECT_NE(first.get(), second.get());
+  EXPECT_EQ(first->place(), second->place());
+  EXPECT_TRUE(stadic::WeatherCache::weatherData("nosuchfile.epw") == nullptr);
+}
+
 TEST(WeatherTests, ReadTMY)
 {
   stadic::WeatherData data;
@@ -32,11 +32,16 @@
 #include "logging.h"
 #include "buildingcontrol.h"
 #include <iostream>
+#include <cerrno>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
 
 void usage()
 {
     std::cout << "dxdaylight - Simulate the daylight for a space model" << std::endl;
-    std::cout << "usage: dxdaylight <STADIC Control File>" << std::endl;
+    std::cout << "usage: dxdaylight [--jobs N] <STADIC Control File>" << std::endl;
+    std::cout << "  --jobs N  Run up to N simulation programs at once, 0 uses every core (default 0)" << std::endl;
 }
 
 
@@ -45,13 +50,38 @@ int main (int argc, char *argv[]){
         usage();
         return EXIT_FAILURE;
     }
-    std::string fileName=argv[1];
+    std::string fileName;
+    unsigned jobs=0;
+    for (int i=1;i<argc;i++){
+        if (std::string("--jobs")==argv[i] && i+1<argc){
+            i++;
+            //Only a plain count is taken, strtoul alone would wrap "-1" around
+            char *end;
+            errno=0;
+            unsigned long value=strtoul(argv[i],&end,10);
+            if (!isdigit((unsigned char)argv[i][0]) || *end!='\0' || errno==ERANGE || value>UINT_MAX){
+                usage();
+                return EXIT_FAILURE;
+            }
+            jobs=value;
+        }else if (fileName.empty()){
+            fileName=argv[i];
+        }else{
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (fileName.empty()){
+        usage();
+        return EXIT_FAILURE;
+    }
     stadic::BuildingControl model;
     //stadic::Control model;
     if (!model.parseJson(fileName)){
         return EXIT_FAILURE;
     }
     stadic::Daylight sim(&model);
+    sim.setThreads(jobs);
     if (!sim.simDaylight()){
         return EXIT_FAILURE;
     }
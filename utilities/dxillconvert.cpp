@@ -0,0 +1,111 @@
+/******************************************************************************
+ * Copyright (c) 2014-2015, The Pennsylvania State University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission of the
+ *    respective copyright holder or contributor.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ * AND NONINFRINGEMENT OF INTELLECTUAL PROPERTY ARE EXPRESSLY DISCLAIMED. IN
+ * NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *****************************************************************************/
+
+#include "dayill.h"
+#include "logging.h"
+#include "functions.h"
+#include <iostream>
+#include <string>
+
+void usage(){
+    std::cerr << "Usage: dxillconvert [OPTIONS] input output" << std::endl;
+    std::cerr << stadic::wrapAtN("Convert an illuminance file that contains time values between the text and the"
+        " binary formats.  By default the output is written in the format the input is not in.") << std::endl;
+    std::cerr<<std::endl;
+    std::cerr << stadic::wrapAtN("-b        Write the output as a binary illuminance file.", 72, 10, true) << std::endl;
+    std::cerr << stadic::wrapAtN("-t        Write the output as a text illuminance file.", 72, 10, true) << std::endl;
+    std::cerr << stadic::wrapAtN("-fc       Write the output values in footcandles rather than lux.", 72, 10, true) << std::endl;
+    std::cerr << stadic::wrapAtN("-single   Store the binary output values in single precision.", 72, 10, true) << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+    if(argc == 1) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    std::string inFile;
+    std::string outFile;
+    bool toBinary=false;
+    bool toText=false;
+    stadic::DaylightIlluminanceData::Units units=stadic::DaylightIlluminanceData::Lux;
+    stadic::DaylightIlluminanceData::Precision precision=stadic::DaylightIlluminanceData::DoublePrecision;
+
+    for (int i=1;i<argc;i++){
+        if (std::string("-b")==argv[i]){
+            toBinary=true;
+        }else if (std::string("-t")==argv[i]){
+            toText=true;
+        }else if (std::string("-fc")==argv[i]){
+            units=stadic::DaylightIlluminanceData::Footcandles;
+        }else if (std::string("-single")==argv[i]){
+            precision=stadic::DaylightIlluminanceData::SinglePrecision;
+        }else if (argv[i][0]!='-' && inFile.empty()){
+            inFile=argv[i];
+        }else if (argv[i][0]!='-' && outFile.empty()){
+            outFile=argv[i];
+        }else{
+            std::string temp=argv[i];
+            STADIC_ERROR("Invalid option \""+temp+"\".  Run with no arguments to get usage.");
+            return EXIT_FAILURE;
+        }
+    }
+    if (inFile.empty() || outFile.empty()){
+        STADIC_ERROR("Both the input and the output file must be specified.");
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (toBinary && toText){
+        STADIC_ERROR("Only one of -b and -t may be given.");
+        return EXIT_FAILURE;
+    }
+    if (!toBinary && !toText){
+        toBinary=!stadic::DaylightIlluminanceData::isBinaryIllFile(inFile);
+    }
+
+    stadic::DaylightIlluminanceData data;
+    if (!data.parseTimeBased(inFile)){
+        return EXIT_FAILURE;
+    }
+    bool written;
+    if (toBinary){
+        written=data.writeIllFileBinary(outFile,units,precision);
+    }else if (units==stadic::DaylightIlluminanceData::Footcandles){
+        written=data.writeIllFileFC(outFile);
+    }else{
+        written=data.writeIllFileLux(outFile);
+    }
+    if (!written){
+        STADIC_ERROR("The writing of the illuminance file "+outFile+" failed.");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -32,11 +32,16 @@
 #include "logging.h"
 #include "buildingcontrol.h"
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
 
 void usage()
 {
     std::cout << "dxmetrics - Process the requested metrics by space and whole building." << std::endl;
-    std::cout << "usage: dxmetrics <STADIC Control File>" << std::endl;
+    std::cout << "usage: dxmetrics [--jobs N] [--memory MB] [--force] <STADIC Control File>" << std::endl;
+    std::cout << "  --jobs N  Process up to N spaces at once, 0 uses every core (default 1)" << std::endl;
+    std::cout << "  --memory MB  Hold at most MB megabytes of illuminance per space, 0 holds whole files (default 0)" << std::endl;
+    std::cout << "  --force   Calculate every metric, even those whose inputs are unchanged since the last run" << std::endl;
 }
 
 
@@ -45,16 +50,43 @@ int main (int argc, char *argv[]){
         usage();
         return EXIT_FAILURE;
     }
-    std::string fileName=argv[1];
+    std::string fileName;
+    unsigned jobs=1;
+    double memory=0;
+    bool force=false;
+    for (int i=1;i<argc;i++){
+        if (std::string("--jobs")==argv[i] && i+1<argc){
+            i++;
+            jobs=atoi(argv[i]);
+        }else if (std::string("--memory")==argv[i] && i+1<argc){
+            i++;
+            memory=atof(argv[i]);
+        }else if (std::string("--force")==argv[i]){
+            force=true;
+        }else if (fileName.empty()){
+            fileName=argv[i];
+        }else{
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (fileName.empty()){
+        usage();
+        return EXIT_FAILURE;
+    }
     stadic::BuildingControl model;
     //stadic::Control model;
     if (!model.parseJson(fileName)){
         return EXIT_FAILURE;
     }
     stadic::Metrics analyze(&model);
+    analyze.setThreads(jobs);
+    analyze.setMemoryBudget(size_t(std::max(memory,0.0)*1024*1024));
+    analyze.setIncremental(!force);
     if (!analyze.processMetrics()){
         return EXIT_FAILURE;
     }
+    std::cout << analyze.computedMetrics() << " metrics calculated, " << analyze.reusedMetrics() << " reused" << std::endl;
 
     return EXIT_SUCCESS;
 }